@@ -6,7 +6,15 @@ FluxFile - 文件系统 API 路由
 - /api/fs/list - 目录列表
 - /api/fs/info - 文件信息
 - /api/fs/download - 文件下载（Zero-Copy）
+- /api/fs/preview - 字节范围预览
 - /api/fs/hash - 哈希计算
+- /api/fs/search - 内容搜索
+- /api/fs/find - 按条件查找文件
+- /api/fs/top - 最大 / 最近修改的文件
+- /api/fs/names - 文件名子串 / glob 搜索（三元组索引）
+- /api/fs/quickopen - 模糊路径匹配（Ctrl-P）
+- /api/fs/lines - 大文本文件按行读取
+- /api/fs/tail - 实时跟踪文件新增内容（Server-Sent Events）
 
 关键实现：
 1. 使用依赖注入获取 fast_fs 单例
@@ -14,14 +22,16 @@ FluxFile - 文件系统 API 路由
 3. 路径安全验证
 """
 
+import asyncio
 import os
 import stat
+from concurrent.futures import ThreadPoolExecutor
 from pathlib import Path
-from typing import Any, Dict, List, Optional, Union
+from typing import Any, Dict, List, Optional, Tuple, Union
 from enum import Enum
 
-from fastapi import APIRouter, Depends, HTTPException, Query, Response
-from fastapi.responses import FileResponse
+from fastapi import APIRouter, Depends, HTTPException, Query, Request, Response
+from fastapi.responses import FileResponse, StreamingResponse
 from pydantic import BaseModel, ConfigDict, Field, field_validator
 
 from app.core.config import settings
@@ -43,12 +53,13 @@ from app.core.dependencies import (
     FastFSLoader,
     get_fast_fs,
     get_filesystem_service,
+    get_name_index_service,
     get_request_context,
     RequestContext,
 )
 from app.core.logging import get_logger
 from app.services.filesystem import FileSystemService
-from app.utils.responses import ZeroCopyFileResponse
+from app.utils.responses import BufferResponse, ZeroCopyFileResponse
 
 router = APIRouter()
 logger = get_logger(__name__)
@@ -57,6 +68,15 @@ logger = get_logger(__name__)
 # Pydantic v2 \u9700\u8981\u663e\u5f0f\u542f\u7528 by_alias
 _RESPONSE_CONFIG = {"response_model_by_alias": True}
 
+# /list 的列式二进制编码，客户端通过 Accept 请求
+_MSGPACK_MEDIA_TYPE = "application/x-msgpack"
+
+# /tail 长轮询专用线程池：等待中的客户端不占用默认线程池，
+# 每次只阻塞 _TAIL_POLL_SECONDS，客户端多于线程数时轮流得到调度
+_tail_executor = ThreadPoolExecutor(max_workers=16, thread_name_prefix="tail")
+_TAIL_POLL_SECONDS = 1.0
+_TAIL_KEEPALIVE_SECONDS = 15.0
+
 
 # ============================================================================
 # 请求/响应模型
@@ -89,6 +109,11 @@ class FileEntry(CamelModel):
     is_hidden: bool = Field(False, description="是否为隐藏文件")
     permissions: Optional[str] = Field(None, description="权限字符串")
     extension: Optional[str] = Field(None, description="文件扩展名")
+    owner: Optional[str] = Field(None, description="属主（仅 include_owner 时返回）")
+    group: Optional[str] = Field(None, description="属组（仅 include_owner 时返回）")
+    mime_type: Optional[str] = Field(None, description="MIME 类型（仅 include_mime 时返回）")
+    link_target: Optional[str] = Field(None, description="符号链接目标（仅 follow_symlinks 时返回）")
+    link_broken: Optional[bool] = Field(None, description="符号链接目标是否失效（仅 follow_symlinks 时返回）")
     
     @field_validator("mtime_iso", mode="before")
     @classmethod
@@ -125,8 +150,15 @@ class FileInfoResponse(CamelModel):
     mtime_iso: str
     type: FileType
     permissions: str
+    btime: Optional[float] = Field(None, description="创建时间（文件系统不支持时为空）")
+    btime_iso: Optional[str] = None
+    uid: Optional[int] = None
+    gid: Optional[int] = None
     owner: Optional[str] = None
     group: Optional[str] = None
+    inode: Optional[int] = None
+    nlink: Optional[int] = None
+    blocks: Optional[int] = Field(None, description="占用的 512 字节块数")
     mime_type: Optional[str] = None
     is_readable: bool = True
     is_writable: bool = True
@@ -146,6 +178,31 @@ class HashResponse(CamelModel):
 class BatchHashRequest(BaseModel):
     """批量哈希请求"""
     paths: List[str] = Field(..., min_length=1, max_length=1000)
+    priority: str = Field(
+        "interactive",
+        pattern="^(interactive|background)$",
+        description="background：IDLE I/O 调度类，让目录浏览等交互请求先行",
+    )
+
+
+class SearchContentRequest(BaseModel):
+    """内容搜索请求"""
+    path: str = Field("/", description="搜索根目录")
+    patterns: List[str] = Field(..., min_length=1, max_length=64, description="字面量模式")
+    ignore_case: bool = Field(False, description="忽略大小写")
+    max_matches_per_file: int = Field(100, ge=1, le=10000)
+    max_results: int = Field(1000, ge=1, le=100000)
+    max_file_size: int = Field(64 * 1024 * 1024, ge=0, description="跳过更大的文件（0=不限）")
+    include_hidden: bool = False
+    
+    @field_validator("patterns")
+    @classmethod
+    def check_pattern_length(cls, v):
+        """单个模式最多 1024 字节（UTF-8）：Aho-Corasick 每个字节约占 1KB 状态表"""
+        for pattern in v:
+            if len(pattern.encode("utf-8")) > 1024:
+                raise ValueError("pattern longer than 1024 bytes")
+        return v
 
 
 class ErrorResponse(CamelModel):
@@ -170,6 +227,28 @@ def _permissions_to_string(mode: int) -> str:
     return "".join(perms)
 
 
+# 魔数探测只能给出容器 / 泛化类型的 MIME，遇到这些再参考扩展名细化
+# （如 docx 是 zip，.py 是 text/plain）
+_GENERIC_MIME_TYPES = {
+    "application/octet-stream",
+    "application/zip",
+    "application/x-ole-storage",
+    "application/xml",
+    "text/plain",
+}
+
+
+def _refine_mime_type(sniffed: Optional[str], path: str) -> Optional[str]:
+    """合并魔数探测结果与扩展名猜测，优先采用更具体的一方"""
+    import mimetypes
+    
+    if sniffed is None or sniffed in _GENERIC_MIME_TYPES:
+        guessed, _ = mimetypes.guess_type(path)
+        if guessed:
+            return guessed
+    return sniffed
+
+
 def _validate_path(path: str, root: Path) -> Path:
     """
     验证并解析路径
@@ -199,6 +278,23 @@ def _validate_path(path: str, root: Path) -> Path:
             detail={"error": "Invalid path", "error_code": "INVALID_PATH"}
         )
     
+    _check_path_scope(resolved, root)
+    return resolved
+
+
+def _check_path_scope(resolved: Path, root: Path) -> None:
+    """
+    检查已解析的绝对路径是否在允许范围内
+    
+    不再对请求路径本身做 resolve，可直接用于 stat_batch 返回的 realpath。
+    
+    Args:
+        resolved: 已解析（无符号链接、无 ..）的绝对路径
+        root: 允许访问的根目录
+        
+    Raises:
+        HTTPException: 如果路径越界或命中禁止访问列表
+    """
     # 检查是否在根目录下（防止目录穿越）
     try:
         resolved.relative_to(root)
@@ -257,8 +353,29 @@ def _validate_path(path: str, root: Path) -> Path:
                     "error_code": "FORBIDDEN_PATH"
                 }
             )
+
+
+def _forbidden_exclusions() -> Tuple[List[str], List[str]]:
+    """
+    把 FORBIDDEN_PATHS 转换为遍历时剪枝用的 (exclude_paths, exclude_names)
     
-    return resolved
+    与 _check_path_scope 的判定一致：绝对路径按前缀排除，
+    去掉斜杠后的单段名字按任意层级的路径组件排除。
+    """
+    paths: List[str] = []
+    names: List[str] = []
+    for forbidden in settings.FORBIDDEN_PATHS:
+        if forbidden.startswith('/'):
+            paths.append(str(Path(forbidden).resolve()))
+        name = forbidden.strip('/')
+        if name and '/' not in name:
+            names.append(name)
+    return paths, names
+
+
+def _scope_roots(root: Path) -> List[str]:
+    """允许访问的根目录（ROOT_PATH 与 ALLOWED_PATHS），与 _check_path_scope 一致"""
+    return [str(root)] + [str(Path(p).resolve()) for p in settings.ALLOWED_PATHS]
 
 
 def _convert_to_file_entry(
@@ -299,6 +416,10 @@ def _convert_to_file_entry(
         type=file_type,
         is_hidden=name.startswith("."),
         extension=extension,
+        owner=item.get("owner"),
+        group=item.get("group"),
+        link_target=item.get("link_target"),
+        link_broken=item.get("link_broken"),
     )
 
 
@@ -311,6 +432,7 @@ def _convert_to_file_entry(
     response_model=DirectoryListResponse,
     response_model_by_alias=True,
     responses={
+        200: {"content": {_MSGPACK_MEDIA_TYPE: {}}},
         403: {"model": ErrorResponse, "description": "权限不足"},
         404: {"model": ErrorResponse, "description": "路径不存在"},
     },
@@ -318,6 +440,7 @@ def _convert_to_file_entry(
     description="使用高性能 C++ 扩展扫描目录，返回文件列表",
 )
 async def list_directory(
+    request: Request,
     path: str = Query("/", description="目录路径"),
     show_hidden: bool = Query(False, description="显示隐藏文件"),
     sort_by: SortField = Query(SortField.NAME, description="排序字段"),
@@ -325,8 +448,11 @@ async def list_directory(
     dirs_first: bool = Query(True, description="目录优先"),
     limit: int = Query(0, ge=0, le=10000, description="限制返回数量（0=不限）"),
     offset: int = Query(0, ge=0, description="偏移量"),
+    include_owner: bool = Query(False, description="返回属主 / 属组名称"),
+    include_mime: bool = Query(False, description="按文件头探测当前页文件的 MIME 类型"),
+    follow_symlinks: bool = Query(False, description="符号链接显示目标的大小 / 时间与链接目标"),
     fast_fs: FastFSLoader = Depends(get_fast_fs),
-) -> DirectoryListResponse:
+) -> Union[DirectoryListResponse, Response]:
     """
     列出目录内容
     
@@ -335,6 +461,12 @@ async def list_directory(
     特性：
     - 使用 C++ 扩展突破 Python GIL 限制
     - 支持 10 万+ 文件的高效扫描
+    - 不探测 MIME 时响应体由 fast_fs.list_directory_json 直接生成，
+      不逐条构造 FileEntry 模型
+    - Accept 含 application/x-msgpack 时返回列式 MessagePack
+      （扩展名字符串表去重、修改时间差值编码），格式见 fast_fs.list_directory_msgpack
+    - 大目录的扫描结果与各排序方式的置换数组缓存在扩展内，翻页只取当前页
+      （目录 mtime 变化、写操作或 LISTING_CACHE_TTL 到期时重新扫描）
     - 自动降级到 Python 实现（如果扩展不可用）
     
     路径安全：
@@ -365,12 +497,66 @@ async def list_directory(
             detail={"error": "Path is not a directory", "error_code": "NOT_DIRECTORY", "path": path}
         )
     
+    # 计算父目录
+    parent = None
+    if resolved != root:
+        try:
+            parent = "/" + str(resolved.parent.relative_to(root))
+        except ValueError:
+            parent = "/"
+    display_path = "/" + str(resolved.relative_to(root)) if resolved != root else "/"
+    
+    # 跟随符号链接时，目标在允许范围之外的链接不报告目标与目标元数据
+    exclude_paths, exclude_names = _forbidden_exclusions()
+    link_scope = {
+        "scope_roots": _scope_roots(root),
+        "exclude_paths": exclude_paths,
+        "exclude_names": exclude_names,
+    }
+    
     # 调用 fast_fs 扫描（或降级实现）
     try:
+        # 预序列化：扫描到 JSON 编码全部在扩展内完成（MIME 探测需要逐条补充，走模型路径）
+        if not include_mime:
+            media_type = (
+                _MSGPACK_MEDIA_TYPE
+                if _MSGPACK_MEDIA_TYPE in request.headers.get("accept", "")
+                else "application/json"
+            )
+            encode = (
+                fast_fs.list_directory_msgpack
+                if media_type == _MSGPACK_MEDIA_TYPE
+                else fast_fs.list_directory_json
+            )
+            body = encode(
+                str(resolved),
+                str(root),
+                display_path,
+                parent,
+                include_hidden=show_hidden,
+                include_owner=include_owner,
+                sort_by=sort_by.value,
+                sort_desc=sort_desc,
+                dirs_first=dirs_first,
+                follow_symlinks=follow_symlinks,
+                offset=offset,
+                limit=limit,
+                **link_scope,
+            )
+            if body is not None:
+                return Response(content=body, media_type=media_type, headers={"Vary": "Accept"})
+        
+        # 排序在扩展内完成：自然排序键每个条目只计算一次，目录优先一并处理
         raw_results = fast_fs.scandir_recursive(
             str(resolved),
             max_depth=1,  # 只扫描当前层
             include_hidden=show_hidden,
+            include_owner=include_owner,
+            sort_by=sort_by.value,
+            sort_desc=sort_desc,
+            dirs_first=dirs_first,
+            follow_symlinks=follow_symlinks,
+            **link_scope,
         )
     except PermissionError:
         raise HTTPException(
@@ -391,26 +577,6 @@ async def list_directory(
         if item_path.parent == resolved:
             entries.append(_convert_to_file_entry(item, root))
     
-    # 排序
-    def sort_key(entry: FileEntry):
-        if sort_by == SortField.NAME:
-            return entry.name.lower()
-        elif sort_by == SortField.SIZE:
-            return entry.size
-        elif sort_by == SortField.MTIME:
-            return entry.mtime
-        elif sort_by == SortField.TYPE:
-            return entry.type.value
-        return entry.name.lower()
-    
-    entries.sort(key=sort_key, reverse=sort_desc)
-    
-    # 目录优先
-    if dirs_first:
-        dirs = [e for e in entries if e.type == FileType.DIRECTORY]
-        files = [e for e in entries if e.type != FileType.DIRECTORY]
-        entries = dirs + files
-    
     # 统计
     total_count = len(entries)
     directory_count = sum(1 for e in entries if e.type == FileType.DIRECTORY)
@@ -423,16 +589,18 @@ async def list_directory(
     elif offset > 0:
         entries = entries[offset:]
     
-    # 计算父目录
-    parent = None
-    if resolved != root:
-        try:
-            parent = "/" + str(resolved.parent.relative_to(root))
-        except ValueError:
-            parent = "/"
+    # MIME 探测只针对当前页的文件，一次并行批量调用
+    if include_mime:
+        file_entries = [e for e in entries if e.type == FileType.FILE]
+        abs_paths = [str(resolved / e.name) for e in file_entries]
+        if abs_paths:
+            for entry, abs_path, sniffed in zip(
+                file_entries, abs_paths, fast_fs.detect_types(abs_paths)
+            ):
+                entry.mime_type = _refine_mime_type(sniffed, abs_path)
     
     return DirectoryListResponse(
-        path="/" + str(resolved.relative_to(root)) if resolved != root else "/",
+        path=display_path,
         parent=parent,
         entries=entries,
         total_count=total_count,
@@ -458,48 +626,59 @@ async def get_file_info(
 ) -> FileInfoResponse:
     """获取文件或目录的详细信息"""
     from datetime import datetime
-    import mimetypes
     
     root = Path(settings.ROOT_PATH).resolve()
     resolved = _validate_path(path, root)
     
-    if not resolved.exists():
-        raise HTTPException(status_code=404, detail="Path not found")
-    
+    # get_file_info 一次 statx 即返回类型、时间、权限和访问性，
+    # 不再额外调用 exists() / stat() / os.access()
     try:
         info = fast_fs.get_file_info(str(resolved))
+    except FileNotFoundError:
+        raise HTTPException(status_code=404, detail="Path not found")
     except Exception as e:
         logger.error(f"获取文件信息失败: {e}")
         raise HTTPException(status_code=500, detail=str(e))
     
-    # 获取 stat 信息
-    stat_info = resolved.stat()
-    
     # 确定文件类型
-    if resolved.is_symlink():
+    if info.get("is_symlink", False):
         file_type = FileType.SYMLINK
-    elif resolved.is_dir():
+    elif info.get("is_directory", False):
         file_type = FileType.DIRECTORY
     else:
         file_type = FileType.FILE
     
-    # 获取 MIME 类型
+    # 获取 MIME 类型：以文件头魔数为准，扩展名只用于细化泛化类型
     mime_type = None
     if file_type == FileType.FILE:
-        mime_type, _ = mimetypes.guess_type(str(resolved))
+        mime_type = _refine_mime_type(
+            fast_fs.detect_types([str(resolved)])[0], str(resolved)
+        )
+    
+    mtime = info["mtime"]
+    btime = info.get("btime")
     
     return FileInfoResponse(
         path="/" + str(resolved.relative_to(root)),
         name=resolved.name,
-        size=info.get("size", stat_info.st_size),
-        mtime=stat_info.st_mtime,
-        mtime_iso=datetime.fromtimestamp(stat_info.st_mtime).isoformat(),
+        size=info.get("size", 0),
+        mtime=mtime,
+        mtime_iso=datetime.fromtimestamp(mtime).isoformat(),
+        btime=btime,
+        btime_iso=datetime.fromtimestamp(btime).isoformat() if btime else None,
         type=file_type,
-        permissions=_permissions_to_string(stat_info.st_mode),
+        permissions=_permissions_to_string(info.get("permissions", 0)),
+        uid=info.get("uid"),
+        gid=info.get("gid"),
+        owner=info.get("owner"),
+        group=info.get("group"),
+        inode=info.get("inode"),
+        nlink=info.get("nlink"),
+        blocks=info.get("blocks"),
         mime_type=mime_type,
-        is_readable=os.access(resolved, os.R_OK),
-        is_writable=os.access(resolved, os.W_OK),
-        is_executable=os.access(resolved, os.X_OK),
+        is_readable=info.get("is_readable", True),
+        is_writable=info.get("is_writable", True),
+        is_executable=info.get("is_executable", False),
     )
 
 
@@ -546,6 +725,101 @@ async def download_file(
     )
 
 
+class PreviewBatchRequest(BaseModel):
+    """批量预览请求"""
+    paths: List[str] = Field(..., min_length=1, max_length=1000)
+    length: int = Field(4096, ge=1, le=64 * 1024)
+
+
+@router.get(
+    "/preview",
+    summary="读取文件的字节范围",
+)
+async def preview_range(
+    path: str = Query(..., description="文件路径"),
+    offset: int = Query(0, ge=0, description="起始偏移"),
+    length: int = Query(64 * 1024, ge=1, le=16 * 1024 * 1024, description="最大长度"),
+    fast_fs: FastFSLoader = Depends(get_fast_fs),
+) -> Response:
+    """
+    读取文件的一段字节（head / tail / 任意范围预览）
+    
+    C++ 扩展释放 GIL 后 pread 到池化缓冲区，返回其上的只读 memoryview，
+    响应体直接引用该缓冲区，不复制（不使用 mmap，文件在响应发送前被截短
+    也不会触发 SIGBUS）；读取在线程池中执行，不阻塞事件循环。
+    """
+    from starlette.concurrency import run_in_threadpool
+    
+    root = Path(settings.ROOT_PATH).resolve()
+    resolved = _validate_path(path, root)
+    
+    if not resolved.exists():
+        raise HTTPException(status_code=404, detail="File not found")
+    
+    if not resolved.is_file():
+        raise HTTPException(status_code=400, detail="Path is not a file")
+    
+    try:
+        data = await run_in_threadpool(fast_fs.read_range, str(resolved), offset, length)
+    except OSError as e:
+        raise HTTPException(status_code=500, detail=e.strerror)
+    
+    return BufferResponse(
+        content=data,
+        headers={"X-Range-Offset": str(offset), "X-Range-Length": str(len(data))},
+    )
+
+
+@router.post(
+    "/preview/batch",
+    summary="批量预览文件开头",
+)
+async def preview_batch(
+    request: PreviewBatchRequest,
+    fast_fs: FastFSLoader = Depends(get_fast_fs),
+) -> Dict[str, Any]:
+    """
+    批量读取多个文件的开头，用于列表悬停预览
+    
+    文本内容按 UTF-8 解码返回；包含 NUL 字节的视为二进制，只返回标记。
+    读取在线程池中执行，不阻塞事件循环。
+    """
+    from starlette.concurrency import run_in_threadpool
+    
+    root = Path(settings.ROOT_PATH).resolve()
+    
+    resolved_paths = {}
+    errors = {}
+    for p in request.paths:
+        try:
+            resolved_paths[p] = str(_validate_path(p, root))
+        except HTTPException as e:
+            errors[p] = e.detail.get("error", "Validation failed")
+    
+    heads = await run_in_threadpool(
+        fast_fs.read_heads, list(resolved_paths.values()), request.length
+    )
+    
+    previews = {}
+    for p, head in zip(resolved_paths, heads):
+        if head is None:
+            errors[p] = "Cannot read file"
+            continue
+        data = head.tobytes()
+        is_binary = b"\0" in data
+        previews[p] = {
+            "binary": is_binary,
+            "text": None if is_binary else data.decode("utf-8", "replace"),
+            "length": len(head),
+        }
+    
+    return {
+        "success": True,
+        "previews": previews,
+        "errors": errors,
+    }
+
+
 @router.get(
     "/hash",
     response_model=HashResponse,
@@ -591,6 +865,148 @@ async def calculate_hash(
     )
 
 
+@router.get(
+    "/lines",
+    summary="读取文本文件的指定行",
+)
+async def read_lines(
+    path: str = Query(..., description="文件路径"),
+    start: int = Query(1, ge=1, description="起始行号（从 1 开始）"),
+    count: int = Query(100, ge=1, le=10000, description="行数"),
+    fast_fs: FastFSLoader = Depends(get_fast_fs),
+) -> Dict[str, Any]:
+    """
+    读取文本文件中任意位置的一段行
+    
+    C++ 扩展维护稀疏行索引（增量更新），大日志文件的任意行窗口只需一次读取。
+    首次建立索引需要扫描整个文件，在线程池中执行，不阻塞事件循环。
+    """
+    import hashlib
+    from starlette.concurrency import run_in_threadpool
+    
+    root = Path(settings.ROOT_PATH).resolve()
+    resolved = _validate_path(path, root)
+    
+    if not resolved.exists():
+        raise HTTPException(status_code=404, detail="File not found")
+    
+    if not resolved.is_file():
+        raise HTTPException(status_code=400, detail="Path is not a file")
+    
+    # 索引文件以路径摘要命名，存放在 LINE_INDEX_DIR 下
+    index_path = ""
+    if settings.LINE_INDEX_DIR:
+        index_dir = Path(settings.LINE_INDEX_DIR)
+        try:
+            index_dir.mkdir(mode=0o700, parents=True, exist_ok=True)
+            digest = hashlib.sha1(str(resolved).encode()).hexdigest()
+            index_path = str(index_dir / f"{digest}.lidx")
+        except OSError as e:
+            logger.warning(f"无法创建行索引目录: {e}")
+    
+    try:
+        result = await run_in_threadpool(
+            fast_fs.read_lines,
+            str(resolved), start, count, index_path, settings.LINE_INDEX_STRIDE,
+        )
+    except Exception as e:
+        logger.error(f"读取行失败: {e}")
+        raise HTTPException(status_code=500, detail=str(e))
+    
+    return {
+        "success": True,
+        "path": "/" + str(resolved.relative_to(root)),
+        "start": result["first_line"],
+        "lines": result["lines"],
+        "offset": result["offset"],
+        "total_lines": result["total_lines"],
+        "size": result["indexed_size"],
+    }
+
+
+@router.get(
+    "/tail",
+    summary="实时跟踪文件新增内容",
+)
+async def tail_file(
+    request: Request,
+    path: str = Query(..., description="文件路径"),
+    offset: int = Query(-64 * 1024, description="起始偏移，负数表示从末尾倒数"),
+    fast_fs: FastFSLoader = Depends(get_fast_fs),
+) -> StreamingResponse:
+    """
+    以 Server-Sent Events 推送文件新增内容（tail -f）
+    
+    C++ 扩展在后台线程等待 inotify 事件，多个客户端跟踪同一文件时共享 watch 与读取。
+    每个事件为 JSON：{"data", "offset", "rotated", "truncated"}；空闲时发送心跳注释。
+    等待在专用的有界线程池中以短超时进行，不会随客户端数占满默认线程池。
+    """
+    import codecs
+    import json
+    import time
+    
+    root = Path(settings.ROOT_PATH).resolve()
+    resolved = _validate_path(path, root)
+    
+    if not resolved.exists():
+        raise HTTPException(status_code=404, detail="File not found")
+    
+    if not resolved.is_file():
+        raise HTTPException(status_code=400, detail="Path is not a file")
+    
+    async def event_stream():
+        # 增量解码：多字节字符可能被拆在两次读取之间
+        decoder = codecs.getincrementaldecoder("utf-8")("replace")
+        position, inode = offset, 0
+        loop = asyncio.get_running_loop()
+        last_sent = time.monotonic()
+        # 订阅在整个连接期间保持 fd 与 inotify watch，每次轮询超时不再重建
+        try:
+            subscription = await loop.run_in_executor(
+                _tail_executor, fast_fs.tail_subscribe, str(resolved)
+            )
+        except OSError as e:
+            yield f"event: error\ndata: {json.dumps({'error': e.strerror})}\n\n"
+            return
+        try:
+            while not await request.is_disconnected():
+                try:
+                    chunk = await loop.run_in_executor(
+                        _tail_executor,
+                        subscription.read, position, inode, _TAIL_POLL_SECONDS,
+                    )
+                except OSError as e:
+                    yield f"event: error\ndata: {json.dumps({'error': e.strerror})}\n\n"
+                    return
+                
+                if chunk["rotated"] or chunk["truncated"]:
+                    decoder.reset()
+                position, inode = chunk["offset"], chunk["inode"]
+                text = decoder.decode(chunk["data"])
+                
+                if not text and not (chunk["rotated"] or chunk["truncated"]):
+                    if time.monotonic() - last_sent >= _TAIL_KEEPALIVE_SECONDS:
+                        last_sent = time.monotonic()
+                        yield ": keep-alive\n\n"
+                    continue
+                last_sent = time.monotonic()
+                payload = {
+                    "data": text,
+                    "offset": position,
+                    "rotated": chunk["rotated"],
+                    "truncated": chunk["truncated"],
+                }
+                yield f"data: {json.dumps(payload, ensure_ascii=False)}\n\n"
+        finally:
+            subscription.close()
+    
+    return StreamingResponse(
+        event_stream(),
+        media_type="text/event-stream",
+        headers={"Cache-Control": "no-cache", "X-Accel-Buffering": "no"},
+    )
+
+
 @router.post(
     "/hash/batch",
     summary="批量计算哈希",
@@ -603,33 +1019,64 @@ async def calculate_hash_batch(
     批量计算多个文件的哈希值
     
     使用多线程并行计算，显著提升大量文件的处理速度。
+    stat 与哈希都在线程池中执行，不阻塞事件循环。
     """
     import time
     
+    from starlette.concurrency import run_in_threadpool
+    
     root = Path(settings.ROOT_PATH).resolve()
     
-    # 验证并解析所有路径
+    # 验证并解析所有路径：一次并行 stat_batch 取回 realpath 和类型，
+    # Python 侧只做纯路径运算的范围检查
     valid_paths = []
     errors = {}
     
+    # 先按词法规范化的路径检查范围，越界路径不做 stat：
+    # 否则 "No such file" 与越界错误可区分，泄露范围外路径是否存在
+    candidates = []
     for p in request.paths:
+        normalized = os.path.normpath(p if p.startswith("/") else "/" + p)
         try:
-            resolved = _validate_path(p, root)
-            if resolved.is_file():
-                valid_paths.append(str(resolved))
-            else:
-                errors[p] = "Not a file"
+            _check_path_scope(Path(normalized), root)
         except HTTPException as e:
             errors[p] = e.detail.get("error", "Validation failed")
-        except Exception as e:
-            errors[p] = str(e)
+            continue
+        candidates.append((p, normalized))
+    
+    stats = await run_in_threadpool(
+        fast_fs.stat_batch, [normalized for _, normalized in candidates], ["realpath", "type"]
+    )
+    
+    for (p, normalized), real_path, file_type, error in zip(
+        candidates, stats["realpath"], stats["type"], stats["error"]
+    ):
+        # 范围内的符号链接可能指向范围外：先按 realpath 检查范围，再报告 stat 错误。
+        # stat 失败时 realpath 不可用，改用 os.path.realpath 解析（不要求目标存在），
+        # 越界目标的任何失败都报告为同一个范围错误，不泄露其是否存在
+        if error is not None:
+            real_path = os.path.realpath(normalized)
+        try:
+            _check_path_scope(Path(real_path), root)
+        except HTTPException as e:
+            errors[p] = e.detail.get("error", "Validation failed")
+            continue
+        if error is not None:
+            errors[p] = error
+            continue
+        if file_type == "file":
+            valid_paths.append(real_path)
+        else:
+            errors[p] = "Not a file"
     
     start_time = time.perf_counter()
     
     try:
-        results = fast_fs.calculate_blake3_batch(
+        results = await run_in_threadpool(
+            fast_fs.calculate_blake3_batch,
             valid_paths,
             settings.HASH_THREADS,
+            request.priority,
         )
     except Exception as e:
         logger.error(f"批量哈希计算失败: {e}")
@@ -656,3 +1103,398 @@ async def calculate_hash_batch(
         "failed": len(errors),
         "duration_ms": round(duration_ms, 2),
     }
+
+
+@router.get(
+    "/find",
+    summary="按条件查找文件",
+)
+async def find_files(
+    path: str = Query("/", description="搜索根目录"),
+    name: Optional[str] = Query(None, description="文件名 glob（忽略大小写）"),
+    ext: Optional[str] = Query(None, description="扩展名，逗号分隔"),
+    min_size: Optional[int] = Query(None, ge=0, description="最小大小（字节）"),
+    max_size: Optional[int] = Query(None, ge=0, description="最大大小（字节）"),
+    modified_after: Optional[float] = Query(None, description="修改时间下限（Unix 时间戳）"),
+    modified_before: Optional[float] = Query(None, description="修改时间上限（Unix 时间戳）"),
+    entry_type: Optional[FileType] = Query(None, alias="type", description="条目类型"),
+    max_depth: int = Query(0, ge=0, description="最大深度，0 表示无限制"),
+    limit: int = Query(1000, ge=1, le=100000, description="最多返回条目数"),
+    show_hidden: bool = Query(False, description="包含隐藏文件"),
+    fast_fs: FastFSLoader = Depends(get_fast_fs),
+) -> Dict[str, Any]:
+    """
+    按名称 / 扩展名 / 大小 / 修改时间 / 类型查找文件
+    
+    条件编译为谓词后在 C++ 遍历中求值，不匹配的条目不会进入 Python。
+    禁止访问的目录在遍历时剪枝，不计入 limit；遍历在线程池中执行。
+    """
+    import time
+    from starlette.concurrency import run_in_threadpool
+    
+    root = Path(settings.ROOT_PATH).resolve()
+    resolved = _validate_path(path, root)
+    
+    if not resolved.is_dir():
+        raise HTTPException(status_code=400, detail="Path is not a directory")
+    
+    query: Dict[str, Any] = {}
+    if name:
+        query["iname"] = name
+    if ext:
+        query["ext"] = [e.strip() for e in ext.split(",") if e.strip()]
+    size_range = {}
+    if min_size is not None:
+        size_range["gte"] = min_size
+    if max_size is not None:
+        size_range["lte"] = max_size
+    if size_range:
+        query["size"] = size_range
+    mtime_range = {}
+    if modified_after is not None:
+        mtime_range["gte"] = modified_after
+    if modified_before is not None:
+        mtime_range["lt"] = modified_before
+    if mtime_range:
+        query["mtime"] = mtime_range
+    if entry_type is not None:
+        query["type"] = entry_type.value
+    if max_depth:
+        query["depth"] = {"lte": max_depth}
+    
+    start_time = time.perf_counter()
+    exclude_paths, exclude_names = _forbidden_exclusions()
+    
+    try:
+        result = await run_in_threadpool(
+            fast_fs.find,
+            str(resolved),
+            query or None,
+            include_hidden=show_hidden or settings.SHOW_HIDDEN_FILES,
+            limit=limit,
+            one_file_system=settings.SCAN_ONE_FILE_SYSTEM,
+            skip_fs_types=settings.SCAN_SKIP_FS_TYPES,
+            exclude_paths=exclude_paths,
+            exclude_names=exclude_names,
+        )
+    except ValueError as e:
+        raise HTTPException(status_code=400, detail=str(e))
+    except Exception as e:
+        logger.error(f"查找失败: {e}")
+        raise HTTPException(status_code=500, detail=str(e))
+    
+    duration_ms = (time.perf_counter() - start_time) * 1000
+    
+    items = []
+    for item in result["entries"]:
+        try:
+            _check_path_scope(Path(item["path"]), root)
+        except HTTPException:
+            continue
+        items.append(_convert_to_file_entry(item, root))
+    
+    return {
+        "success": True,
+        "path": "/" + str(resolved.relative_to(root)),
+        "items": items,
+        "total": len(items),
+        "truncated": result["truncated"],
+        # 未进入的挂载点（SCAN_ONE_FILE_SYSTEM / SCAN_SKIP_FS_TYPES）
+        "skipped_mounts": [
+            {"path": "/" + str(Path(m["path"]).relative_to(root)), "fstype": m["fstype"]}
+            for m in result.get("skipped_mounts", [])
+        ],
+        "duration_ms": round(duration_ms, 2),
+    }
+
+
+@router.get(
+    "/top",
+    summary="最大 / 最近修改的文件",
+)
+async def top_files(
+    path: str = Query("/", description="根目录"),
+    n: int = Query(100, ge=1, le=10000, description="返回条目数"),
+    key: str = Query("size", pattern="^(size|mtime)$", description="排序依据"),
+    show_hidden: bool = Query(False, description="包含隐藏文件"),
+    fast_fs: FastFSLoader = Depends(get_fast_fs),
+) -> Dict[str, Any]:
+    """
+    找出目录树中占用空间最大或最近修改的文件
+    
+    C++ 扩展并行遍历，每个线程只保留 n 个候选，内存占用与目录树规模无关。
+    禁止访问的目录在遍历时剪枝，不会占用前 n 名的位置。
+    """
+    import time
+    from starlette.concurrency import run_in_threadpool
+    
+    root = Path(settings.ROOT_PATH).resolve()
+    resolved = _validate_path(path, root)
+    
+    if not resolved.is_dir():
+        raise HTTPException(status_code=400, detail="Path is not a directory")
+    
+    start_time = time.perf_counter()
+    exclude_paths, exclude_names = _forbidden_exclusions()
+    
+    try:
+        entries = await run_in_threadpool(
+            fast_fs.top_files,
+            str(resolved), n, key,
+            include_hidden=show_hidden or settings.SHOW_HIDDEN_FILES,
+            exclude_paths=exclude_paths,
+            exclude_names=exclude_names,
+        )
+    except Exception as e:
+        logger.error(f"Top-N 扫描失败: {e}")
+        raise HTTPException(status_code=500, detail=str(e))
+    
+    duration_ms = (time.perf_counter() - start_time) * 1000
+    
+    items = []
+    for item in entries:
+        try:
+            _check_path_scope(Path(item["path"]), root)
+        except HTTPException:
+            continue
+        items.append(_convert_to_file_entry(item, root))
+    
+    return {
+        "success": True,
+        "path": "/" + str(resolved.relative_to(root)),
+        "key": key,
+        "items": items,
+        "duration_ms": round(duration_ms, 2),
+    }
+
+
+@router.get(
+    "/names",
+    summary="按文件名搜索",
+)
+async def search_names(
+    q: str = Query(..., min_length=1, description="文件名子串，glob=true 时为 fnmatch 模式"),
+    glob: bool = Query(False, description="按 glob 模式匹配"),
+    path: str = Query("/", description="限定搜索的目录"),
+    limit: int = Query(100, ge=1, le=10000, description="最多返回条目数"),
+    show_hidden: bool = Query(False, description="包含隐藏文件"),
+    fast_fs: FastFSLoader = Depends(get_fast_fs),
+) -> Dict[str, Any]:
+    """
+    在整个共享目录中按文件名搜索（忽略大小写）
+    
+    查询三元组倒排索引，只验证候选条目；索引尚未就绪时降级为全量遍历。
+    """
+    import time
+    from starlette.concurrency import run_in_threadpool
+    
+    root = Path(settings.ROOT_PATH).resolve()
+    resolved = _validate_path(path, root)
+    
+    if not resolved.is_dir():
+        raise HTTPException(status_code=400, detail="Path is not a directory")
+    
+    include_hidden = show_hidden or settings.SHOW_HIDDEN_FILES
+    scoped = resolved != root
+    # 限定目录在索引内过滤（不占 limit）；过滤隐藏条目时多取一些候选
+    fetch_limit = limit if include_hidden else min(limit * 10, 100000)
+    
+    name_index = get_name_index_service()
+    start_time = time.perf_counter()
+    
+    try:
+        paths = await run_in_threadpool(
+            name_index.search, q, fetch_limit, glob, str(resolved) if scoped else ""
+        )
+    except Exception as e:
+        logger.error(f"文件名搜索失败: {e}")
+        raise HTTPException(status_code=500, detail=str(e))
+    
+    prefix = str(resolved).rstrip("/") + "/"
+    selected = []
+    for p in paths:
+        if scoped and not p.startswith(prefix):
+            continue
+        rel = p[len(str(root)):].lstrip("/")
+        if not include_hidden and any(part.startswith(".") for part in rel.split("/")):
+            continue
+        try:
+            _check_path_scope(Path(p), root)
+        except HTTPException:
+            continue
+        selected.append(p)
+        if len(selected) >= limit:
+            break
+    
+    # 一次并行 stat 补全元数据（索引只记录名称）
+    columns = await run_in_threadpool(
+        fast_fs.stat_batch, selected, ["type", "size", "mtime"], False
+    )
+    
+    items = []
+    for i, p in enumerate(selected):
+        if columns["error"][i] is not None:
+            continue  # 索引滞后于磁盘：条目已被外部删除
+        entry_type = columns["type"][i]
+        items.append(_convert_to_file_entry({
+            "path": p,
+            "name": os.path.basename(p),
+            "is_directory": entry_type == "directory",
+            "is_symlink": entry_type == "symlink",
+            "size": columns["size"][i] if entry_type == "file" else 0,
+            "mtime": columns["mtime"][i],
+        }, root))
+    
+    duration_ms = (time.perf_counter() - start_time) * 1000
+    
+    return {
+        "success": True,
+        "query": q,
+        "items": items,
+        "total": len(items),
+        "truncated": len(paths) >= fetch_limit,
+        "indexed": name_index.ready,
+        "duration_ms": round(duration_ms, 2),
+    }
+
+
+@router.get(
+    "/quickopen",
+    summary="模糊路径匹配",
+)
+async def quick_open(
+    q: str = Query(..., min_length=1, max_length=256, description="查询串（子序列匹配，含大写时区分大小写）"),
+    limit: int = Query(50, ge=1, le=500, description="返回的最佳结果数"),
+    show_hidden: bool = Query(False, description="包含隐藏文件"),
+) -> Dict[str, Any]:
+    """
+    Ctrl-P 风格的快速打开：在整个共享目录的路径表上做模糊匹配
+    
+    返回的 positions 是匹配字符在 path 中的下标，前端可直接用于高亮。
+    """
+    import time
+    from starlette.concurrency import run_in_threadpool
+    
+    root = Path(settings.ROOT_PATH).resolve()
+    root_prefix = str(root).rstrip("/")
+    include_hidden = show_hidden or settings.SHOW_HIDDEN_FILES
+    
+    name_index = get_name_index_service()
+    start_time = time.perf_counter()
+    
+    try:
+        # 过滤隐藏条目时多取一些候选
+        matches = await run_in_threadpool(
+            name_index.fuzzy, q, limit if include_hidden else limit * 4
+        )
+    except Exception as e:
+        logger.error(f"模糊匹配失败: {e}")
+        raise HTTPException(status_code=500, detail=str(e))
+    
+    items = []
+    for match in matches:
+        # 绝对路径 -> "/" 开头的根目录相对路径，下标同步平移
+        rel_path = match["path"][len(root_prefix):]
+        if not include_hidden and "/." in rel_path:
+            continue
+        try:
+            _check_path_scope(Path(match["path"]), root)
+        except HTTPException:
+            continue
+        shift = len(root_prefix)
+        items.append({
+            "path": rel_path,
+            "name": rel_path.rsplit("/", 1)[-1],
+            "score": match["score"],
+            "positions": [p - shift for p in match["positions"] if p >= shift],
+        })
+        if len(items) >= limit:
+            break
+    
+    duration_ms = (time.perf_counter() - start_time) * 1000
+    
+    return {
+        "success": True,
+        "query": q,
+        "items": items,
+        "indexed": name_index.ready,
+        "duration_ms": round(duration_ms, 2),
+    }
+
+
+@router.post(
+    "/search",
+    summary="搜索文件内容",
+)
+async def search_content(
+    request: SearchContentRequest,
+    fast_fs: FastFSLoader = Depends(get_fast_fs),
+) -> Dict[str, Any]:
+    """
+    在目录树中搜索文件内容
+    
+    多个字面量模式一次扫描完成，C++ 扩展并行遍历与匹配，二进制文件自动跳过。
+    整树扫描在线程池中执行，不阻塞事件循环。
+    """
+    import time
+    from starlette.concurrency import run_in_threadpool
+    
+    root = Path(settings.ROOT_PATH).resolve()
+    resolved = _validate_path(request.path, root)
+    
+    if not resolved.is_dir():
+        raise HTTPException(status_code=400, detail="Path is not a directory")
+    if any(not p for p in request.patterns):
+        raise HTTPException(status_code=400, detail="Empty pattern")
+    
+    start_time = time.perf_counter()
+    # 禁止访问的目录在遍历时剪枝：既不读取其内容，也不计入扫描统计
+    exclude_paths, exclude_names = _forbidden_exclusions()
+    
+    try:
+        result = await run_in_threadpool(
+            fast_fs.search_content,
+            str(resolved),
+            request.patterns,
+            ignore_case=request.ignore_case,
+            max_matches_per_file=request.max_matches_per_file,
+            max_results=request.max_results,
+            max_file_size=request.max_file_size,
+            include_hidden=request.include_hidden,
+            exclude_paths=exclude_paths,
+            exclude_names=exclude_names,
+        )
+    except ValueError as e:
+        raise HTTPException(status_code=400, detail=str(e))
+    except Exception as e:
+        logger.error(f"内容搜索失败: {e}")
+        raise HTTPException(status_code=500, detail=str(e))
+    
+    duration_ms = (time.perf_counter() - start_time) * 1000
+    
+    # 转换为根目录相对路径，并过滤禁止访问的路径
+    matches = []
+    for match in result["matches"]:
+        try:
+            _check_path_scope(Path(match["path"]), root)
+            rel_path = "/" + str(Path(match["path"]).relative_to(root))
+        except (HTTPException, ValueError):
+            continue
+        matches.append({
+            "path": rel_path,
+            "line": match["line"],
+            "column": match["column"],
+            "offset": match["offset"],
+            "pattern": match["pattern"],
+            "text": match["text"],
+        })
+    
+    return {
+        "success": True,
+        "matches": matches,
+        "files_scanned": result["files_scanned"],
+        "files_matched": result["files_matched"],
+        "bytes_scanned": result["bytes_scanned"],
+        "truncated": result["truncated"],
+        "duration_ms": round(duration_ms, 2),
+    }
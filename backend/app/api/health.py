@@ -83,3 +83,23 @@ async def liveness_check() -> Dict[str, str]:
         存活状态
     """
     return {"status": "alive"}
+
+
+@router.get("/io")
+async def io_status() -> Dict[str, Any]:
+    """
+    I/O 调控状态
+    
+    按设备（st_dev）返回 fast_fs 的并发上限、在途操作数、
+    等待次数与 p99 延迟，用于观察网络挂载上的自适应回退；
+    profiles 为各设备自动调优选定的线程数与缓冲区大小（含校准结果）；
+    background 为后台任务限速器的实际速率与累计限速时间；
+    listings 为目录列表缓存的命中 / 失效统计。
+    
+    Returns:
+        {"available": bool, "devices": [...], "profiles": [...],
+         "background": {...} | None, "listings": {...} | None}
+    """
+    from app.core.dependencies import get_fast_fs
+    
+    return get_fast_fs().io_stats()
@@ -10,13 +10,19 @@ FluxFile - 核心配置模块
 3. 默认值
 """
 
+import os
 from functools import lru_cache
+from pathlib import Path
 from typing import List
 
 from pydantic import field_validator
 from pydantic_settings import BaseSettings, SettingsConfigDict
 
 
+# 本机索引缓存的默认位置：当前用户的 XDG 缓存目录，不放在所有用户可写的 /tmp
+_CACHE_DIR = Path(os.environ.get("XDG_CACHE_HOME") or Path.home() / ".cache") / "fluxfile"
+
+
 class Settings(BaseSettings):
     """
     应用配置类
@@ -161,12 +167,65 @@ class Settings(BaseSettings):
     # 使用 C++ fast_fs 扩展
     USE_FAST_FS: bool = True
     
-    # 并行哈希计算线程数（0 = 自动）
+    # 并行哈希计算线程数（0 = 按设备自动：机械盘少量线程，NVMe 按队列深度放大）
     HASH_THREADS: int = 0
     
     # 文件读取缓冲区大小
     READ_BUFFER_SIZE: int = 1024 * 1024  # 1MB
-
+    
+    # 大文本文件行索引目录（空字符串 = 只缓存在进程内；以 0700 权限创建）
+    LINE_INDEX_DIR: str = str(_CACHE_DIR / "line-index")
+    
+    # 行索引检查点间隔（行数）
+    LINE_INDEX_STRIDE: int = 1000
+    
+    # 文件名三元组索引（子串 / glob 文件名搜索）
+    NAME_INDEX_ENABLED: bool = True
+    NAME_INDEX_PATH: str = str(_CACHE_DIR / "names.idx")
+    
+    # 累积多少次增量更新后合并写回索引文件
+    NAME_INDEX_SAVE_THRESHOLD: int = 10000
+    
+    # 递归扫描不跨越文件系统（类似 find -xdev）
+    SCAN_ONE_FILE_SYSTEM: bool = False
+    
+    # 递归扫描不进入的文件系统类型（伪文件系统；可追加 nfs、cifs、fuse 等）
+    SCAN_SKIP_FS_TYPES: List[str] = [
+        "proc", "sysfs", "devpts", "devtmpfs", "cgroup", "cgroup2", "debugfs",
+        "tracefs", "securityfs", "pstore", "bpf", "mqueue", "hugetlbfs",
+        "autofs", "fusectl", "configfs", "binfmt_misc", "nsfs", "efivarfs",
+    ]
+    
+    # 按设备（st_dev）的 I/O 并发上限：并行遍历与批量哈希在同一网络 / FUSE 挂载上
+    # 同时在途的操作数（0 = 不限制；本地磁盘不受限）；自适应时从 4 起步，p99 延迟升高时回退
+    IO_DEVICE_CONCURRENCY: int = 32
+    IO_MIN_CONCURRENCY: int = 1
+    IO_ADAPTIVE_CONCURRENCY: bool = True
+    IO_BACKOFF_RATIO: float = 2.0
+    
+    # 固定上限的设备，格式 "路径=上限"，如 ["/mnt/nas=4"]
+    IO_DEVICE_LIMITS: List[str] = []
+    
+    # 后台任务（索引构建、批量哈希等）的令牌桶限速：字节/秒与 IOPS（0 = 不限制）
+    BACKGROUND_IO_BYTES_PER_SEC: int = 0
+    BACKGROUND_IO_IOPS: int = 0
+    
+    # 目录列表缓存：大目录翻页时复用扫描结果与排序（置换数组），
+    # 目录 mtime 变化或应用自身写操作时失效，TTL（秒）兜底子项内容变化。
+    # MAX_ENTRIES 是所有缓存目录的条目总数上限：每个条目约 300–400 字节
+    # （含各排序的置换数组），默认 200000 约合 60–80MB，内存充裕时可按比例调大
+    LISTING_CACHE_MAX_ENTRIES: int = 200000
+    LISTING_CACHE_MIN_ENTRIES: int = 1000
+    LISTING_CACHE_TTL: float = 60.0
+    
+    @field_validator("SCAN_SKIP_FS_TYPES", "IO_DEVICE_LIMITS", mode="before")
+    @classmethod
+    def parse_comma_lists(cls, v):
+        """解析逗号分隔的列表配置"""
+        if isinstance(v, str):
+            return [s.strip() for s in v.split(",") if s.strip()]
+        return v
+    
 
 @lru_cache()
 def get_settings() -> Settings:
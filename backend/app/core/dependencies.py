@@ -13,7 +13,7 @@ FluxFile - 依赖注入模块
 
 import threading
 from functools import lru_cache
-from typing import Optional, Type, TypeVar, Callable, Any
+from typing import Optional, Type, TypeVar, Callable, Any, Union
 
 from fastapi import Depends, Request
 
@@ -61,6 +61,21 @@ class SingletonMeta(type):
 # fast_fs 模块加载器
 # ============================================================================
 
+class _PythonTailSubscription:
+    """fast_fs 不可用时的 TailSubscription 降级实现（每次 read 轮询）"""
+    
+    def __init__(self, loader: "FastFSLoader", path: str):
+        self._loader = loader
+        self._path = path
+        self.closed = False
+    
+    def read(self, offset: int = 0, inode: int = 0, timeout: float = 30.0) -> dict:
+        return self._loader._python_tail_read(self._path, offset, inode, timeout)
+    
+    def close(self) -> None:
+        self.closed = True
+
+
 class FastFSLoader(metaclass=SingletonMeta):
     """
     fast_fs C++ 扩展模块的线程安全加载器
@@ -83,6 +98,8 @@ class FastFSLoader(metaclass=SingletonMeta):
         self._load_error: Optional[str] = None
         self._lock = threading.Lock()
         self._loaded = False
+        # 后台任务共享的限速器（首次使用时创建）
+        self._background_limiter = None
         
         # 立即尝试加载
         self._try_load()
@@ -149,6 +166,16 @@ class FastFSLoader(metaclass=SingletonMeta):
         path: str,
         max_depth: int = 0,
         include_hidden: bool = False,
+        include_owner: bool = False,
+        sort_by: str = "",
+        sort_desc: bool = False,
+        dirs_first: bool = False,
+        follow_symlinks: bool = False,
+        one_file_system: bool = False,
+        skip_fs_types: Optional[list] = None,
+        scope_roots: Optional[list] = None,
+        exclude_paths: Optional[list] = None,
+        exclude_names: Optional[list] = None,
     ) -> list:
         """
         调用 scandir_recursive，自动降级到 Python 实现
@@ -157,25 +184,111 @@ class FastFSLoader(metaclass=SingletonMeta):
             path: 扫描路径
             max_depth: 最大深度（0=无限）
             include_hidden: 是否包含隐藏文件
+            include_owner: 是否解析属主 / 属组名称
+            sort_by: 排序字段（""=遍历顺序 / name / size / mtime / type），
+                name 为自然排序（忽略大小写，file2 < file10）
+            sort_desc: 是否降序
+            dirs_first: 目录是否排在前面
+            follow_symlinks: 是否进入目录符号链接（环路检测），
+                并报告 link_target / link_broken / link_cycle 与目标元数据
+            one_file_system: 不进入其他文件系统（挂载点）
+            skip_fs_types: 不进入这些类型的文件系统；未进入的挂载点
+                以 mount_skipped=True 与 fstype 标记
+            scope_roots / exclude_paths / exclude_names: 跟随符号链接时允许的目标范围；
+                范围外的链接不报告目标、不进入，保留链接自身的 lstat 数据
             
         Returns:
             文件信息列表
         """
         if self._is_available:
             return self._module.scandir_recursive(
-                path, max_depth, include_hidden
+                path, max_depth, include_hidden, include_owner,
+                sort_by, sort_desc, dirs_first, follow_symlinks,
+                one_file_system, skip_fs_types or [],
+                scope_roots=scope_roots or [],
+                exclude_paths=exclude_paths or [],
+                exclude_names=exclude_names or [],
             )
         else:
             # 降级到 Python 实现
-            return self._python_scandir(path, max_depth, include_hidden)
+            link_scope = (scope_roots, exclude_paths or [], exclude_names or []) if scope_roots else None
+            results = self._python_scandir(
+                path, max_depth, include_hidden, include_owner, follow_symlinks,
+                one_file_system, skip_fs_types, link_scope,
+            )
+            return self._python_sort_entries(results, sort_by, sort_desc, dirs_first)
+    
+    def list_directory_json(
+        self,
+        path: str,
+        root: str,
+        display_path: str,
+        parent: Optional[str],
+        include_hidden: bool = False,
+        include_owner: bool = False,
+        sort_by: str = "name",
+        sort_desc: bool = False,
+        dirs_first: bool = True,
+        follow_symlinks: bool = False,
+        offset: int = 0,
+        limit: int = 0,
+        scope_roots: Optional[list] = None,
+        exclude_paths: Optional[list] = None,
+        exclude_names: Optional[list] = None,
+    ) -> Optional[bytes]:
+        """
+        /api/fs/list 的预序列化响应体（DirectoryListResponse 的 JSON bytes）
+        
+        Returns:
+            JSON bytes；fast_fs 不可用时返回 None，由调用方走模型序列化
+        """
+        if not self._is_available:
+            return None
+        return self._module.list_directory_json(
+            path, root, display_path, parent, include_hidden, include_owner,
+            sort_by, sort_desc, dirs_first, follow_symlinks, offset, limit,
+            scope_roots or [], exclude_paths or [], exclude_names or [],
+        )
+    
+    def list_directory_msgpack(
+        self,
+        path: str,
+        root: str,
+        display_path: str,
+        parent: Optional[str],
+        include_hidden: bool = False,
+        include_owner: bool = False,
+        sort_by: str = "name",
+        sort_desc: bool = False,
+        dirs_first: bool = True,
+        follow_symlinks: bool = False,
+        offset: int = 0,
+        limit: int = 0,
+        scope_roots: Optional[list] = None,
+        exclude_paths: Optional[list] = None,
+        exclude_names: Optional[list] = None,
+    ) -> Optional[bytes]:
+        """
+        /api/fs/list 的列式 MessagePack 响应体（格式见 fast_fs.list_directory_msgpack）
+        
+        Returns:
+            MessagePack bytes；fast_fs 不可用时返回 None，由调用方改用 JSON
+        """
+        if not self._is_available:
+            return None
+        return self._module.list_directory_msgpack(
+            path, root, display_path, parent, include_hidden, include_owner,
+            sort_by, sort_desc, dirs_first, follow_symlinks, offset, limit,
+            scope_roots or [], exclude_paths or [], exclude_names or [],
+        )
     
-    def calculate_blake3(self, path: str, chunk_size: int = 1048576) -> str:
+    def calculate_blake3(self, path: str, chunk_size: int = 0) -> str:
         """
         计算 BLAKE3 哈希，自动降级到 SHA256
         
         Args:
             path: 文件路径
-            chunk_size: 缓冲区大小
+            chunk_size: 缓冲区大小（0 = 按设备画像自动选择）
             
         Returns:
             哈希值（十六进制字符串）
@@ -189,10 +302,21 @@ class FastFSLoader(metaclass=SingletonMeta):
         self,
         paths: list,
         num_threads: int = 0,
+        priority: str = "interactive",
+        order: str = "auto",
     ) -> dict:
-        """批量计算哈希"""
+        """
+        批量计算哈希
+        
+        priority="background" 时工作线程使用 IDLE I/O 调度类，
+        并在数据块之间让出给进行中的交互操作（如目录浏览），
+        同时受后台限速器约束。
+        order="auto" 时机械盘上的文件按物理位置顺序读取（"physical" / "none" 强制）。
+        """
         if self._is_available:
-            return self._module.calculate_blake3_batch(paths, num_threads)
+            return self._module.calculate_blake3_batch(
+                paths, num_threads, priority, self.rate_limiter(priority), order
+            )
         else:
             return {p: self._python_hash(p) for p in paths}
     
@@ -203,6 +327,366 @@ class FastFSLoader(metaclass=SingletonMeta):
         else:
             return self._python_file_info(path)
     
+    def stat_batch(
+        self,
+        paths: list,
+        fields: Optional[list] = None,
+        follow_symlinks: bool = True,
+        num_threads: int = 0,
+    ) -> dict:
+        """
+        批量获取文件元数据（列式结果），自动降级到逐个 os.stat
+        
+        Args:
+            paths: 路径列表
+            fields: 字段列表（为空时为 type/size/mtime）
+            follow_symlinks: 是否跟随符号链接
+            num_threads: 线程数（0=自动）
+            
+        Returns:
+            {字段名: [值, ...], "error": [None 或错误信息, ...]}
+        """
+        if self._is_available:
+            return self._module.stat_batch(
+                paths, fields or [], follow_symlinks, num_threads
+            )
+        else:
+            return self._python_stat_batch(
+                paths, fields or ["type", "size", "mtime"], follow_symlinks
+            )
+    
+    def detect_types(self, paths: list, sniff_bytes: int = 4096) -> list:
+        """
+        基于文件头魔数批量探测 MIME 类型，降级时按扩展名猜测
+        
+        Returns:
+            与 paths 等长的 MIME 列表（无法判断时为 None）
+        """
+        if self._is_available:
+            return self._module.detect_types(paths, sniff_bytes)
+        else:
+            import mimetypes
+            return [mimetypes.guess_type(p)[0] for p in paths]
+    
+    def search_content(
+        self,
+        path: str,
+        patterns: list,
+        ignore_case: bool = False,
+        max_matches_per_file: int = 100,
+        max_results: int = 10000,
+        max_file_size: int = 0,
+        include_hidden: bool = False,
+        exclude_paths: Optional[list] = None,
+        exclude_names: Optional[list] = None,
+    ) -> dict:
+        """
+        在目录树中搜索文件内容（多模式字面量匹配），自动降级到 Python 实现
+        
+        exclude_paths / exclude_names 命中的目录在遍历时剪枝，内容不会被读取。
+        
+        Returns:
+            {"matches": [...], "files_scanned", "files_matched",
+             "bytes_scanned", "truncated", "errors"}
+        """
+        if self._is_available:
+            return self._module.search_content(
+                path, patterns, ignore_case, max_matches_per_file,
+                max_results, max_file_size, include_hidden,
+                exclude_paths=exclude_paths or [],
+                exclude_names=exclude_names or [],
+            )
+        else:
+            return self._python_search_content(
+                path, patterns, ignore_case, max_matches_per_file,
+                max_results, max_file_size, include_hidden,
+                exclude_paths or [], exclude_names or [],
+            )
+    
+    def read_lines(
+        self,
+        path: str,
+        first_line: int,
+        count: int,
+        index_path: str = "",
+        stride: int = 1000,
+    ) -> dict:
+        """
+        读取文本文件中的一段行（行号从 1 开始），自动降级到逐行读取
+        
+        Returns:
+            {"first_line", "lines", "offset", "total_lines", "indexed_size"}
+        """
+        if self._is_available:
+            return self._module.read_lines(path, first_line, count, index_path, stride)
+        else:
+            return self._python_read_lines(path, first_line, count)
+    
+    def tail_read(
+        self,
+        path: str,
+        offset: int = 0,
+        inode: int = 0,
+        timeout: float = 30.0,
+    ) -> dict:
+        """
+        读取文件在 offset 之后的新增内容，无新内容时等待（降级实现为轮询）
+        
+        Returns:
+            {"data", "offset", "inode", "size", "rotated", "truncated"}
+        """
+        if self._is_available:
+            return self._module.tail_read(path, offset, inode, timeout)
+        else:
+            return self._python_tail_read(path, offset, inode, timeout)
+    
+    def tail_subscribe(self, path: str):
+        """
+        订阅文件跟踪，返回带 read(offset, inode, timeout) / close() 的对象
+        
+        订阅期间保持 fd 与 inotify watch，长轮询超时后不会拆掉重建。
+        """
+        if self._is_available:
+            return self._module.TailSubscription(path)
+        else:
+            return _PythonTailSubscription(self, path)
+    
+    def read_range(self, path: str, offset: int, length: int) -> memoryview:
+        """
+        读取文件的一个字节范围，fast_fs 可用时为池化缓冲区上的只读 memoryview
+        """
+        if self._is_available:
+            return self._module.read_range(path, offset, length)
+        else:
+            with open(path, "rb") as f:
+                f.seek(offset)
+                return memoryview(f.read(length))
+    
+    def read_heads(self, paths: list, length: int = 4096) -> list:
+        """
+        批量读取多个文件的开头
+        
+        Returns:
+            与 paths 等长的列表，元素为 memoryview（无法读取时为 None）
+        """
+        if self._is_available:
+            return self._module.read_heads(paths, length)
+        else:
+            import os
+            
+            heads = []
+            for p in paths:
+                try:
+                    if not os.path.isfile(p):
+                        raise OSError
+                    with open(p, "rb") as f:
+                        heads.append(memoryview(f.read(length)))
+                except OSError:
+                    heads.append(None)
+            return heads
+    
+    def find(
+        self,
+        path: str,
+        query: Optional[dict] = None,
+        prune: Optional[dict] = None,
+        include_hidden: bool = False,
+        limit: int = 0,
+        one_file_system: bool = False,
+        skip_fs_types: Optional[list] = None,
+        priority: str = "interactive",
+        exclude_paths: Optional[list] = None,
+        exclude_names: Optional[list] = None,
+    ) -> dict:
+        """
+        按谓词查询目录树（查询语法见 fast_fs.find），自动降级到 Python 实现
+        
+        exclude_paths / exclude_names 命中的条目在遍历时剪枝，不计入 limit。
+        
+        Returns:
+            {"entries": [...], "truncated": bool, "errors": [...],
+             "skipped_mounts": [{"path", "fstype"}, ...]}
+        """
+        if self._is_available:
+            return self._module.find(
+                path, query, prune, include_hidden, limit, 0,
+                one_file_system, skip_fs_types or [], priority,
+                self.rate_limiter(priority),
+                exclude_paths or [], exclude_names or [],
+            )
+        else:
+            return self._python_find(
+                path, query, prune, include_hidden, limit, one_file_system, skip_fs_types,
+                exclude_paths or [], exclude_names or [],
+            )
+    
+    def top_files(
+        self,
+        path: str,
+        n: int,
+        key: str = "size",
+        include_hidden: bool = False,
+        priority: str = "interactive",
+        exclude_paths: Optional[list] = None,
+        exclude_names: Optional[list] = None,
+    ) -> list:
+        """
+        最大 / 最近修改的 n 个普通文件（按 key 降序），自动降级到 Python 实现
+        
+        exclude_paths / exclude_names 命中的条目在遍历时剪枝，不参与排名。
+        """
+        if self._is_available:
+            return self._module.top_files(
+                path, n, key, include_hidden, 0, priority, self.rate_limiter(priority),
+                exclude_paths or [], exclude_names or [],
+            )
+        else:
+            return self._python_top_files(
+                path, n, key, include_hidden, exclude_paths or [], exclude_names or []
+            )
+    
+    def scandir_arrow(
+        self,
+        path: str,
+        output_path: str = "",
+        max_depth: int = 0,
+        include_hidden: bool = False,
+        include_owner: bool = False,
+        one_file_system: bool = False,
+        skip_fs_types: Optional[list] = None,
+        priority: str = "background",
+    ) -> Union[bytes, int, None]:
+        """
+        整树扫描导出为 Arrow IPC 文件（列定义见 fast_fs.scandir_arrow），供分析任务
+        直接 pyarrow.memory_map 读取，不经过 list[dict]
+        
+        Returns:
+            output_path 为空时返回 bytes，否则返回写入的行数；fast_fs 不可用时返回 None
+        """
+        if not self._is_available:
+            return None
+        return self._module.scandir_arrow(
+            path, output_path, max_depth, include_hidden, include_owner,
+            "", False, False, False, one_file_system, skip_fs_types or [], priority,
+            self.rate_limiter(priority),
+        )
+    
+    def find_arrow(
+        self,
+        path: str,
+        query: Optional[dict] = None,
+        prune: Optional[dict] = None,
+        output_path: str = "",
+        include_hidden: bool = False,
+        limit: int = 0,
+        one_file_system: bool = False,
+        skip_fs_types: Optional[list] = None,
+        priority: str = "background",
+        exclude_paths: Optional[list] = None,
+        exclude_names: Optional[list] = None,
+    ) -> Union[bytes, int, None]:
+        """
+        按谓词查询并导出为 Arrow IPC 文件（查询语法见 fast_fs.find）
+        
+        Returns:
+            output_path 为空时返回 bytes，否则返回写入的行数；fast_fs 不可用时返回 None
+        """
+        if not self._is_available:
+            return None
+        return self._module.find_arrow(
+            path, query, prune, output_path, include_hidden, limit, 0,
+            one_file_system, skip_fs_types or [], priority,
+            self.rate_limiter(priority),
+            exclude_paths or [], exclude_names or [],
+        )
+    
+    def configure_io_governor(self) -> None:
+        """
+        按配置设置 fast_fs 的按设备 I/O 并发调控（fast_fs 不可用时无操作）
+        
+        IO_DEVICE_LIMITS 中的 "路径=上限" 固定对应设备的并发数；
+        路径不存在或格式错误时记录警告并跳过。
+        """
+        if not self._is_available:
+            return
+        self._module.configure_io_governor(
+            default_limit=settings.IO_DEVICE_CONCURRENCY,
+            min_limit=settings.IO_MIN_CONCURRENCY,
+            adaptive=settings.IO_ADAPTIVE_CONCURRENCY,
+            backoff_ratio=settings.IO_BACKOFF_RATIO,
+        )
+        for spec in settings.IO_DEVICE_LIMITS:
+            path, sep, limit = spec.rpartition("=")
+            try:
+                if not sep:
+                    raise ValueError("expected PATH=LIMIT")
+                self._module.set_device_io_limit(path, int(limit))
+            except (OSError, ValueError) as e:
+                logger.warning(f"忽略 IO_DEVICE_LIMITS 项 {spec!r}: {e}")
+    
+    def configure_listing_cache(self) -> None:
+        """按配置设置 fast_fs 的目录列表缓存（fast_fs 不可用时无操作）"""
+        if not self._is_available:
+            return
+        self._module.configure_listing_cache(
+            max_entries=settings.LISTING_CACHE_MAX_ENTRIES,
+            min_entries=settings.LISTING_CACHE_MIN_ENTRIES,
+            ttl=settings.LISTING_CACHE_TTL,
+        )
+    
+    def invalidate_listings(self, *paths: str) -> None:
+        """路径被创建 / 删除 / 移动 / 写入后，使其本身及父目录的缓存列表失效"""
+        if self._is_available:
+            import os
+            
+            # 缓存以解析后的绝对路径为键
+            self._module.invalidate_listings([os.path.realpath(str(p)) for p in paths])
+    
+    def rate_limiter(self, priority: str = "background"):
+        """
+        返回 priority 对应的限速器：后台任务共享一个 fast_fs.RateLimiter
+        （按 BACKGROUND_IO_* 配置首次创建），交互操作不限速（None）
+        """
+        if not self._is_available or priority != "background":
+            return None
+        if self._background_limiter is None:
+            with self._lock:
+                if self._background_limiter is None:
+                    self._background_limiter = self._module.RateLimiter(
+                        settings.BACKGROUND_IO_BYTES_PER_SEC,
+                        settings.BACKGROUND_IO_IOPS,
+                    )
+        return self._background_limiter
+    
+    def set_background_rate(
+        self,
+        bytes_per_sec: Optional[int] = None,
+        iops: Optional[int] = None,
+    ) -> None:
+        """
+        运行时调整后台限速（None 表示保持不变，0 表示不限制），
+        对正在执行的后台任务立即生效
+        """
+        limiter = self.rate_limiter("background")
+        if limiter is not None:
+            limiter.set_rates(bytes_per_sec, iops)
+    
+    def io_stats(self) -> dict:
+        """
+        按设备的 I/O 调控状态、自动调优画像、后台限速与目录列表缓存统计
+        （fast_fs 不可用时为空）
+        """
+        if not self._is_available:
+            return {"available": False, "devices": [], "profiles": [], "background": None,
+                    "listings": None}
+        return {
+            "available": True,
+            "devices": self._module.io_governor_stats(),
+            "profiles": self._module.device_profiles(),
+            "background": self.rate_limiter("background").stats(),
+            "listings": self._module.listing_cache_stats(),
+        }
+    
     # ========================================================================
     # Python 降级实现
     # ========================================================================
@@ -212,13 +696,24 @@ class FastFSLoader(metaclass=SingletonMeta):
         path: str,
         max_depth: int,
         include_hidden: bool,
+        include_owner: bool = False,
+        follow_symlinks: bool = False,
+        one_file_system: bool = False,
+        skip_fs_types: Optional[list] = None,
+        link_scope: Optional[tuple] = None,
     ) -> list:
-        """Python 原生 scandir 实现"""
+        """Python 原生 scandir 实现（link_scope 为 (roots, exclude_paths, exclude_names)）"""
         import os
         from pathlib import Path
         
         results = []
         root = Path(path)
+        skip_mount = FastFSLoader._python_mount_filter(path, one_file_system, skip_fs_types)
+        # 跟随符号链接时已进入目录的 (st_dev, st_ino)
+        visited = set()
+        if follow_symlinks:
+            root_stat = os.stat(path)
+            visited.add((root_stat.st_dev, root_stat.st_ino))
         
         def scan(current_path: Path, depth: int):
             if max_depth > 0 and depth >= max_depth:
@@ -229,18 +724,53 @@ class FastFSLoader(metaclass=SingletonMeta):
                     if not include_hidden and entry.name.startswith('.'):
                         continue
                     
+                    # 挂载表命中的挂载点在 stat 之前跳过
+                    if skip_mount and entry.is_dir(follow_symlinks=False):
+                        fstype = skip_mount(entry.path)
+                        if fstype is not None:
+                            results.append({
+                                'path': entry.path,
+                                'name': entry.name,
+                                'size': 0,
+                                'mtime': 0.0,
+                                'is_directory': True,
+                                'is_symlink': False,
+                                'uid': 0,
+                                'gid': 0,
+                                'mount_skipped': True,
+                                'fstype': fstype,
+                            })
+                            continue
+                    
                     try:
                         stat_info = entry.stat(follow_symlinks=False)
-                        results.append({
+                        item = {
                             'path': entry.path,
                             'name': entry.name,
                             'size': stat_info.st_size if not entry.is_dir() else 0,
                             'mtime': stat_info.st_mtime,
                             'is_directory': entry.is_dir(),
                             'is_symlink': entry.is_symlink(),
-                        })
+                            'uid': stat_info.st_uid,
+                            'gid': stat_info.st_gid,
+                        }
+                        if include_owner:
+                            item['owner'] = FastFSLoader._python_user_name(stat_info.st_uid)
+                            item['group'] = FastFSLoader._python_group_name(stat_info.st_gid)
+                        
+                        descend = entry.is_dir() and not entry.is_symlink()
+                        if follow_symlinks:
+                            descend = FastFSLoader._python_follow_entry(entry, item, visited, link_scope)
+                        if descend and skip_mount:
+                            dev = os.stat(entry.path).st_dev if entry.is_symlink() else stat_info.st_dev
+                            fstype = skip_mount(entry.path, dev)
+                            if fstype is not None:
+                                item['mount_skipped'] = True
+                                item['fstype'] = fstype
+                                descend = False
+                        results.append(item)
                         
-                        if entry.is_dir() and not entry.is_symlink():
+                        if descend:
                             scan(Path(entry.path), depth + 1)
                     except (PermissionError, OSError):
                         continue
@@ -250,6 +780,144 @@ class FastFSLoader(metaclass=SingletonMeta):
         scan(root, 0)
         return results
     
+    @staticmethod
+    def _python_mount_filter(
+        root: str, one_file_system: bool, skip_fs_types: Optional[list]
+    ) -> Optional[Callable]:
+        """
+        挂载点策略（与 fast_fs 一致），未启用时返回 None
+        
+        返回 skip(path, st_dev=None)：应跳过时返回文件系统类型（挂载表中查不到时
+        为空字符串）并记入 skip.skipped，否则返回 None。挂载表命中的路径无需
+        st_dev，不会 stat 失联的网络挂载。
+        """
+        import os
+        import re
+        
+        types = set(skip_fs_types or [])
+        if not one_file_system and not types:
+            return None
+        
+        real_root = os.path.realpath(root)
+        root_dev = os.stat(root).st_dev
+        mounts = {}
+        try:
+            with open("/proc/self/mountinfo") as f:
+                for line in f:
+                    fields = line.split()
+                    sep = fields.index("-")
+                    point = re.sub(r"\\([0-7]{3})", lambda m: chr(int(m.group(1), 8)), fields[4])
+                    mounts[point] = fields[sep + 1]
+        except (OSError, ValueError, IndexError):
+            pass
+        
+        def type_skipped(fstype: str) -> bool:
+            return fstype in types or fstype.split(".")[0] in types
+        
+        def skip(path: str, st_dev: Optional[int] = None) -> Optional[str]:
+            real = os.path.normpath(os.path.join(real_root, os.path.relpath(path, root)))
+            fstype = mounts.get(real)
+            if fstype is not None and real != real_root:
+                if not (one_file_system or type_skipped(fstype)):
+                    return None
+            elif st_dev is not None and st_dev != root_dev and one_file_system:
+                fstype = ""
+            else:
+                return None
+            skip.skipped.append({"path": path, "fstype": fstype})
+            return fstype
+        
+        skip.skipped = []
+        return skip
+    
+    @staticmethod
+    def _python_follow_entry(
+        entry, item: dict, visited: set, link_scope: Optional[tuple] = None
+    ) -> bool:
+        """
+        跟随符号链接模式下补全条目，返回是否进入该目录
+        
+        符号链接的 size / mtime / is_directory 取自目标，并附加 link_* 字段；
+        目标在 link_scope 之外时保留链接自身的数据，不附加 link_* 字段。
+        """
+        import os
+        import stat as stat_module
+        
+        if not entry.is_symlink():
+            if not entry.is_dir(follow_symlinks=False):
+                return False
+            st = entry.stat(follow_symlinks=False)
+            key = (st.st_dev, st.st_ino)
+            if key in visited:
+                return False
+            visited.add(key)
+            return True
+        
+        if link_scope and not FastFSLoader._python_in_scope(os.path.realpath(entry.path), *link_scope):
+            item['is_directory'] = False
+            item['size'] = entry.stat(follow_symlinks=False).st_size
+            return False
+        
+        item['link_target'] = os.readlink(entry.path)
+        item['link_broken'] = False
+        item['link_cycle'] = False
+        try:
+            target = os.stat(entry.path)
+        except OSError:
+            item['link_broken'] = True
+            item['is_directory'] = False
+            item['size'] = 0
+            return False
+        
+        item['is_directory'] = stat_module.S_ISDIR(target.st_mode)
+        item['size'] = target.st_size if stat_module.S_ISREG(target.st_mode) else 0
+        item['mtime'] = target.st_mtime
+        if not item['is_directory']:
+            return False
+        key = (target.st_dev, target.st_ino)
+        if key in visited:
+            item['link_cycle'] = True
+            return False
+        visited.add(key)
+        return True
+    
+    @staticmethod
+    def _python_in_scope(path: str, roots: list, exclude_paths: list, exclude_names: list) -> bool:
+        """已解析的绝对路径是否在范围内（与 fast_fs.PathScope 一致）"""
+        import os
+        
+        def under(base: str) -> bool:
+            base = base.rstrip("/") or "/"
+            return base == "/" or path == base or path.startswith(base + "/")
+        
+        if not any(under(root) for root in roots):
+            return False
+        if any(under(excluded) for excluded in exclude_paths):
+            return False
+        return not any(part in exclude_names for part in path.split(os.sep))
+    
+    @staticmethod
+    @lru_cache(maxsize=4096)
+    def _python_user_name(uid: int) -> str:
+        """Python uid -> 用户名（进程内缓存，无 TTL）"""
+        import pwd
+        
+        try:
+            return pwd.getpwuid(uid).pw_name
+        except KeyError:
+            return str(uid)
+    
+    @staticmethod
+    @lru_cache(maxsize=4096)
+    def _python_group_name(gid: int) -> str:
+        """Python gid -> 组名（进程内缓存，无 TTL）"""
+        import grp
+        
+        try:
+            return grp.getgrgid(gid).gr_name
+        except KeyError:
+            return str(gid)
+    
     @staticmethod
     def _python_hash(path: str) -> str:
         """Python SHA256 哈希实现"""
@@ -261,22 +929,522 @@ class FastFSLoader(metaclass=SingletonMeta):
                 hasher.update(chunk)
         return hasher.hexdigest()
     
+    @staticmethod
+    def _python_search_content(
+        root: str,
+        patterns: list,
+        ignore_case: bool,
+        max_matches_per_file: int,
+        max_results: int,
+        max_file_size: int,
+        include_hidden: bool,
+        exclude_paths: list,
+        exclude_names: list,
+    ) -> dict:
+        """Python 原生内容搜索实现（单线程，逐行匹配）"""
+        import os
+        import re
+        
+        if not patterns or any(not p for p in patterns):
+            raise ValueError("patterns must not be empty")
+        
+        flags = re.IGNORECASE if ignore_case else 0
+        regex = re.compile(
+            "|".join(re.escape(p) for p in sorted(patterns, key=len, reverse=True)).encode(),
+            flags,
+        )
+        canonical = {p.lower() if ignore_case else p: p for p in patterns}
+        
+        matches: list = []
+        errors: list = []
+        files_scanned = files_matched = bytes_scanned = 0
+        truncated = False
+        excluded_paths = {p.rstrip("/") or "/" for p in exclude_paths}
+        excluded_names = set(exclude_names)
+        
+        for dirpath, dirnames, filenames in os.walk(
+            root, onerror=lambda e: errors.append(f"{e.filename}: {e.strerror}")
+        ):
+            if not include_hidden:
+                dirnames[:] = [d for d in dirnames if not d.startswith(".")]
+            dirnames[:] = [
+                d for d in dirnames
+                if d not in excluded_names
+                and os.path.join(dirpath, d) not in excluded_paths
+            ]
+            dirnames.sort()
+            for name in sorted(filenames):
+                if not include_hidden and name.startswith("."):
+                    continue
+                file_path = os.path.join(dirpath, name)
+                if name in excluded_names or file_path in excluded_paths:
+                    continue
+                try:
+                    if os.path.islink(file_path) or not os.path.isfile(file_path):
+                        continue
+                    size = os.path.getsize(file_path)
+                    if size == 0 or (max_file_size and size > max_file_size):
+                        continue
+                    with open(file_path, "rb") as f:
+                        data = f.read()
+                except OSError:
+                    continue
+                
+                files_scanned += 1
+                if b"\0" in data[:8192]:
+                    continue
+                bytes_scanned += len(data)
+                
+                found = 0
+                for m in regex.finditer(data):
+                    line_start = data.rfind(b"\n", 0, m.start()) + 1
+                    line_end = data.find(b"\n", m.start())
+                    if line_end < 0:
+                        line_end = len(data)
+                    text = data[line_start:line_end].rstrip(b"\r")[:512]
+                    key = m.group().decode("utf-8", "replace")
+                    matches.append({
+                        "path": file_path,
+                        "line": data.count(b"\n", 0, m.start()) + 1,
+                        "column": m.start() - line_start,
+                        "offset": m.start(),
+                        "pattern": canonical.get(key.lower() if ignore_case else key, key),
+                        "text": text.decode("utf-8", "replace"),
+                    })
+                    found += 1
+                    if found >= max_matches_per_file:
+                        break
+                if found:
+                    files_matched += 1
+                if len(matches) >= max_results:
+                    del matches[max_results:]
+                    truncated = True
+                    break
+            if truncated:
+                break
+        
+        return {
+            "matches": matches,
+            "files_scanned": files_scanned,
+            "files_matched": files_matched,
+            "bytes_scanned": bytes_scanned,
+            "truncated": truncated,
+            "errors": errors,
+        }
+    
+    @staticmethod
+    def _python_read_lines(path: str, first_line: int, count: int) -> dict:
+        """Python 逐行读取实现（需从文件开头扫描）"""
+        first_line = max(first_line, 1)
+        lines = []
+        offset = 0
+        position = 0
+        total = 0
+        with open(path, "rb") as f:
+            for total, raw in enumerate(f, start=1):
+                if total == first_line:
+                    offset = position
+                if first_line <= total < first_line + count:
+                    lines.append(raw.rstrip(b"\n").rstrip(b"\r").decode("utf-8", "replace"))
+                position += len(raw)
+        return {
+            "first_line": first_line,
+            "lines": lines,
+            "offset": offset,
+            "total_lines": total,
+            "indexed_size": position,
+        }
+    
+    @staticmethod
+    def _python_tail_read(path: str, offset: int, inode: int, timeout: float) -> dict:
+        """Python 轮询实现的 tail_read"""
+        import os
+        import time
+        
+        deadline = time.monotonic() + max(timeout, 0.0)
+        rotated = truncated = False
+        first_pass = True
+        while True:
+            with open(path, "rb") as f:
+                st = os.fstat(f.fileno())
+                if first_pass:
+                    if inode and inode != st.st_ino:
+                        rotated, position = True, 0
+                    elif offset < 0:
+                        position = max(st.st_size + offset, 0)
+                    elif offset > st.st_size:
+                        truncated, position = True, 0
+                    else:
+                        position = offset
+                    first_pass = False
+                elif st.st_ino != read_inode:
+                    # 等待期间发生轮转：position 属于旧文件
+                    rotated, position = True, 0
+                elif position > st.st_size:
+                    truncated, position = True, 0
+                read_inode = st.st_ino
+                
+                if st.st_size > position:
+                    f.seek(position)
+                    data = f.read(min(st.st_size - position, 1024 * 1024))
+                    break
+            if rotated or truncated or time.monotonic() >= deadline:
+                data = b""
+                break
+            time.sleep(0.25)
+        
+        return {
+            "data": data,
+            "offset": position + len(data),
+            "inode": st.st_ino,
+            "size": st.st_size,
+            "rotated": rotated,
+            "truncated": truncated,
+        }
+    
+    @staticmethod
+    def _python_find(
+        root: str,
+        query: Optional[dict],
+        prune: Optional[dict],
+        include_hidden: bool,
+        limit: int,
+        one_file_system: bool = False,
+        skip_fs_types: Optional[list] = None,
+        exclude_paths: Optional[list] = None,
+        exclude_names: Optional[list] = None,
+    ) -> dict:
+        """Python 原生 find 实现（谓词语义与 fast_fs.find 一致）"""
+        import fnmatch
+        import os
+        import re
+        import stat as stat_module
+        
+        skip_mount = FastFSLoader._python_mount_filter(root, one_file_system, skip_fs_types)
+        excluded_paths = {p.rstrip("/") or "/" for p in exclude_paths or []}
+        excluded_names = set(exclude_names or [])
+        
+        type_modes = {
+            "file": stat_module.S_IFREG,
+            "directory": stat_module.S_IFDIR,
+            "symlink": stat_module.S_IFLNK,
+            "block": stat_module.S_IFBLK,
+            "char": stat_module.S_IFCHR,
+            "fifo": stat_module.S_IFIFO,
+            "socket": stat_module.S_IFSOCK,
+        }
+        
+        def in_range(value, spec) -> bool:
+            if not isinstance(spec, dict):
+                return value == spec
+            ops = {
+                "gt": lambda b: value > b,
+                "gte": lambda b: value >= b,
+                "min": lambda b: value >= b,
+                "lt": lambda b: value < b,
+                "lte": lambda b: value <= b,
+                "max": lambda b: value <= b,
+            }
+            for op, bound in spec.items():
+                if op not in ops:
+                    raise ValueError(f"Unknown range operator: {op}")
+                if not ops[op](bound):
+                    return False
+            return True
+        
+        def matches(q, name, rel_path, depth, st) -> bool:
+            if q is None:
+                return True
+            for key, value in q.items():
+                mode = stat_module.S_IFMT(st.st_mode)
+                if key == "and":
+                    ok = all(matches(c, name, rel_path, depth, st) for c in value)
+                elif key == "or":
+                    ok = any(matches(c, name, rel_path, depth, st) for c in value)
+                elif key == "not":
+                    ok = not matches(value, name, rel_path, depth, st)
+                elif key == "name":
+                    ok = fnmatch.fnmatchcase(name, value)
+                elif key == "iname":
+                    ok = fnmatch.fnmatchcase(name.lower(), value.lower())
+                elif key == "path":
+                    ok = fnmatch.fnmatchcase(rel_path, value)
+                elif key == "regex":
+                    ok = re.search(value, name) is not None
+                elif key == "ext":
+                    exts = [value] if isinstance(value, str) else value
+                    exts = {e.lstrip(".").lower() for e in exts}
+                    base, dot, ext = name.rpartition(".")
+                    ok = bool(dot and base) and mode == stat_module.S_IFREG and ext.lower() in exts
+                elif key == "size":
+                    ok = mode != stat_module.S_IFDIR and in_range(st.st_size, value)
+                elif key == "mtime":
+                    ok = in_range(st.st_mtime, value)
+                elif key == "depth":
+                    ok = in_range(depth, value)
+                elif key == "type":
+                    if value not in type_modes:
+                        raise ValueError(f"Unknown file type: {value}")
+                    ok = mode == type_modes[value]
+                else:
+                    raise ValueError(f"Unknown find predicate: {key}")
+                if not ok:
+                    return False
+            return True
+        
+        entries: list = []
+        errors: list = []
+        truncated = False
+        stack = [(root, 1)]
+        while stack and not truncated:
+            current, depth = stack.pop()
+            try:
+                it = os.scandir(current)
+            except OSError as e:
+                errors.append(f"{current}: {e.strerror}")
+                continue
+            with it:
+                for entry in it:
+                    if not include_hidden and entry.name.startswith("."):
+                        continue
+                    if entry.name in excluded_names or entry.path in excluded_paths:
+                        continue
+                    if (skip_mount and entry.is_dir(follow_symlinks=False)
+                            and skip_mount(entry.path) is not None):
+                        continue
+                    try:
+                        st = entry.stat(follow_symlinks=False)
+                    except OSError:
+                        continue
+                    rel_path = os.path.relpath(entry.path, root)
+                    is_dir = stat_module.S_ISDIR(st.st_mode)
+                    if is_dir and skip_mount and skip_mount(entry.path, st.st_dev) is not None:
+                        continue
+                    if matches(query, entry.name, rel_path, depth, st):
+                        if limit and len(entries) >= limit:
+                            truncated = True
+                            break
+                        is_link = stat_module.S_ISLNK(st.st_mode)
+                        entries.append({
+                            "path": entry.path,
+                            "name": entry.name,
+                            "size": 0 if is_dir or is_link else st.st_size,
+                            "mtime": float(int(st.st_mtime)),
+                            "is_directory": entry.is_dir(),
+                            "is_symlink": is_link,
+                            "uid": st.st_uid,
+                            "gid": st.st_gid,
+                        })
+                    if is_dir and not (
+                        prune and matches(prune, entry.name, rel_path, depth, st)
+                    ):
+                        stack.append((entry.path, depth + 1))
+        
+        entries.sort(key=lambda e: e["path"])
+        return {
+            "entries": entries,
+            "truncated": truncated,
+            "errors": errors,
+            "skipped_mounts": skip_mount.skipped if skip_mount else [],
+        }
+    
+    @staticmethod
+    def _python_top_files(
+        root: str,
+        n: int,
+        key: str,
+        include_hidden: bool,
+        exclude_paths: list,
+        exclude_names: list,
+    ) -> list:
+        """Python 原生 top_files 实现（heapq 有界堆）"""
+        import heapq
+        import os
+        import stat as stat_module
+        
+        if key not in ("size", "mtime"):
+            raise ValueError("key must be 'size' or 'mtime'")
+        excluded_paths = {p.rstrip("/") or "/" for p in exclude_paths}
+        excluded_names = set(exclude_names)
+        
+        def candidates():
+            stack = [root]
+            while stack:
+                current = stack.pop()
+                try:
+                    it = os.scandir(current)
+                except OSError:
+                    continue
+                with it:
+                    for entry in it:
+                        if not include_hidden and entry.name.startswith("."):
+                            continue
+                        if entry.name in excluded_names or entry.path in excluded_paths:
+                            continue
+                        try:
+                            st = entry.stat(follow_symlinks=False)
+                        except OSError:
+                            continue
+                        if stat_module.S_ISDIR(st.st_mode):
+                            stack.append(entry.path)
+                        elif stat_module.S_ISREG(st.st_mode):
+                            rank = st.st_size if key == "size" else st.st_mtime_ns
+                            yield rank, entry, st
+        
+        top = heapq.nlargest(n, candidates(), key=lambda c: c[0])
+        return [
+            {
+                "path": entry.path,
+                "name": entry.name,
+                "size": st.st_size,
+                "mtime": float(int(st.st_mtime)),
+                "is_directory": False,
+                "is_symlink": False,
+                "uid": st.st_uid,
+                "gid": st.st_gid,
+            }
+            for _, entry, st in top
+        ]
+    
+    @staticmethod
+    def _python_natural_key(name: str) -> tuple:
+        """自然排序键：忽略大小写，连续数字按数值比较（与 fast_fs 的排序一致）"""
+        import re
+        
+        parts = re.split(r"(\d+)", name)
+        folded = tuple(
+            int(part) if i % 2 else part.casefold() for i, part in enumerate(parts)
+        )
+        return folded, name
+    
+    @staticmethod
+    def _python_sort_entries(
+        entries: list,
+        sort_by: str,
+        sort_desc: bool,
+        dirs_first: bool,
+    ) -> list:
+        """按 scandir_recursive 的排序语义排序条目字典"""
+        if sort_by not in ("", "name", "size", "mtime", "type"):
+            raise ValueError(f"Unknown sort field: {sort_by}")
+        
+        natural_key = FastFSLoader._python_natural_key
+        type_rank = lambda e: 2 if e.get("is_symlink") else (0 if e["is_directory"] else 1)
+        if sort_by:
+            if sort_by == "name":
+                entries.sort(key=lambda e: natural_key(e["name"]), reverse=sort_desc)
+            else:
+                # 先按名称升序，再按主字段稳定排序（reverse=True 同样保持相等元素的顺序），
+                # 主字段相同时名称升序
+                primary = {
+                    "size": lambda e: e["size"],
+                    "mtime": lambda e: e["mtime"],
+                    "type": type_rank,
+                }[sort_by]
+                entries.sort(key=lambda e: natural_key(e["name"]))
+                entries.sort(key=primary, reverse=sort_desc)
+        if dirs_first:
+            entries.sort(key=lambda e: not (e["is_directory"] and not e.get("is_symlink")))
+        return entries
+    
+    @staticmethod
+    def _python_stat_batch(
+        paths: list,
+        fields: list,
+        follow_symlinks: bool,
+    ) -> dict:
+        """Python 原生批量 stat 实现"""
+        import os
+        import stat as stat_module
+        
+        type_names = {
+            stat_module.S_IFREG: "file",
+            stat_module.S_IFDIR: "directory",
+            stat_module.S_IFLNK: "symlink",
+            stat_module.S_IFBLK: "block",
+            stat_module.S_IFCHR: "char",
+            stat_module.S_IFIFO: "fifo",
+            stat_module.S_IFSOCK: "socket",
+        }
+        getters = {
+            "type": lambda st, p: type_names.get(stat_module.S_IFMT(st.st_mode), "unknown"),
+            "mode": lambda st, p: st.st_mode,
+            "size": lambda st, p: st.st_size,
+            "mtime": lambda st, p: st.st_mtime,
+            "atime": lambda st, p: st.st_atime,
+            "ctime": lambda st, p: st.st_ctime,
+            "btime": lambda st, p: getattr(st, "st_birthtime", None),
+            "uid": lambda st, p: st.st_uid,
+            "gid": lambda st, p: st.st_gid,
+            "ino": lambda st, p: st.st_ino,
+            "dev": lambda st, p: st.st_dev,
+            "nlink": lambda st, p: st.st_nlink,
+            "blocks": lambda st, p: getattr(st, "st_blocks", 0),
+            "realpath": lambda st, p: os.path.realpath(p),
+        }
+        for field in fields:
+            if field not in getters:
+                raise ValueError(f"Unknown stat field: {field}")
+        
+        columns: dict = {field: [] for field in fields}
+        errors = []
+        for p in paths:
+            try:
+                st = os.stat(p, follow_symlinks=follow_symlinks)
+                row = [getters[field](st, p) for field in fields]
+            except OSError as e:
+                for field in fields:
+                    columns[field].append(None)
+                errors.append(e.strerror)
+                continue
+            for field, value in zip(fields, row):
+                columns[field].append(value)
+            errors.append(None)
+        
+        columns["error"] = errors
+        return columns
+    
     @staticmethod
     def _python_file_info(path: str) -> dict:
-        """Python 文件信息获取"""
+        """Python 文件信息获取（字段与 fast_fs.get_file_info 一致）"""
         import os
+        import stat as stat_module
         from pathlib import Path
         
         p = Path(path)
-        stat_info = p.stat()
+        link_stat = p.lstat()
+        is_symlink = stat_module.S_ISLNK(link_stat.st_mode)
+        stat_info = p.stat() if is_symlink else link_stat
+        mode = stat_info.st_mode
         
+        # 与 fast_fs 一致按有效 uid/gid 判定（faccessat AT_EACCESS）
+        effective = os.access in os.supports_effective_ids
         return {
             'path': str(p),
             'name': p.name,
-            'size': stat_info.st_size if p.is_file() else 0,
+            'extension': p.suffix,
+            'parent': str(p.parent),
+            'is_regular_file': stat_module.S_ISREG(mode),
+            'is_directory': stat_module.S_ISDIR(mode),
+            'is_symlink': is_symlink,
+            'size': stat_info.st_size if stat_module.S_ISREG(mode) else 0,
             'mtime': stat_info.st_mtime,
-            'is_directory': p.is_dir(),
-            'is_symlink': p.is_symlink(),
+            'atime': stat_info.st_atime,
+            'ctime': stat_info.st_ctime,
+            'btime': getattr(stat_info, 'st_birthtime', None),
+            'permissions': stat_module.S_IMODE(mode),
+            'mode': mode,
+            'uid': stat_info.st_uid,
+            'gid': stat_info.st_gid,
+            'owner': FastFSLoader._python_user_name(stat_info.st_uid),
+            'group': FastFSLoader._python_group_name(stat_info.st_gid),
+            'inode': stat_info.st_ino,
+            'dev': stat_info.st_dev,
+            'nlink': stat_info.st_nlink,
+            'blocks': getattr(stat_info, 'st_blocks', 0),
+            'is_readable': os.access(p, os.R_OK, effective_ids=effective),
+            'is_writable': os.access(p, os.W_OK, effective_ids=effective),
+            'is_executable': os.access(p, os.X_OK, effective_ids=effective),
         }
 
 
@@ -416,6 +1584,24 @@ def get_filesystem_service():
     return service
 
 
+def get_name_index_service():
+    """
+    获取文件名索引服务
+    
+    延迟导入避免循环依赖
+    """
+    from app.services.name_index import NameIndexService
+    
+    container = get_service_container()
+    
+    service = container.get("name_index")
+    if service is None:
+        service = NameIndexService(container.fast_fs)
+        container.register("name_index", service)
+    
+    return service
+
+
 # ============================================================================
 # 通用依赖装饰器
 # ============================================================================
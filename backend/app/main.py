@@ -27,7 +27,7 @@ from app.api import files, health, signaling
 from app.api import fs as fs_api  # 新的文件系统 API
 from app.core.config import settings
 from app.core.logging import setup_logging
-from app.core.dependencies import get_service_container
+from app.core.dependencies import get_name_index_service, get_service_container
 
 # 设置日志
 logger = setup_logging()
@@ -42,9 +42,11 @@ async def lifespan(app: FastAPI) -> AsyncGenerator[None, None]:
     - 初始化 Redis 连接
     - 初始化 ClickHouse 连接
     - 加载 Casbin 策略
-    - 验证 fast_fs 扩展可用
+    - 验证 fast_fs 扩展可用，配置按设备的 I/O 并发调控
+    - 加载（或后台构建）文件名索引
     
     关闭时：
+    - 写回文件名索引
     - 关闭所有连接
     - 清理资源
     """
@@ -56,12 +58,17 @@ async def lifespan(app: FastAPI) -> AsyncGenerator[None, None]:
     # 验证 fast_fs 扩展
     if container.fast_fs.is_available:
         logger.info(f"fast_fs 扩展已加载 (版本: {container.fast_fs.module.__version__})")
+        container.fast_fs.configure_io_governor()
+        container.fast_fs.configure_listing_cache()
     else:
         logger.warning(
             f"fast_fs 扩展未安装: {container.fast_fs.load_error}. "
             "将使用 Python 原生实现。运行 'pip install -e .' 编译扩展。"
         )
     
+    # 文件名索引：mmap 加载，缺失时后台构建，不阻塞启动
+    get_name_index_service().start()
+    
     # TODO: 初始化 Redis
     # TODO: 初始化 ClickHouse
     # TODO: 初始化 Casbin
@@ -83,6 +90,7 @@ async def lifespan(app: FastAPI) -> AsyncGenerator[None, None]:
     
     # 关闭清理
     logger.info("FluxFile 正在关闭...")
+    get_name_index_service().save()
     # TODO: 关闭连接
     logger.info("FluxFile 已关闭")
 
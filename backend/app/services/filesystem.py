@@ -14,6 +14,7 @@ from pathlib import Path
 from typing import Any, Dict, List, Optional
 
 from app.core.config import settings
+from app.core.dependencies import FastFSLoader, get_fast_fs, get_name_index_service
 from app.core.logging import get_logger
 
 logger = get_logger(__name__)
@@ -143,13 +144,19 @@ class FileSystemService:
                     str(resolved),
                     max_depth=1,  # 只扫描当前目录
                     include_hidden=show_hidden,
+                    sort_by=sort_by,
+                    sort_desc=sort_desc,
+                    dirs_first=True,
                 )
             )
         else:
             # 使用 Python 原生实现
             files = await loop.run_in_executor(
                 _executor,
-                lambda: self._scandir_python(resolved, show_hidden)
+                lambda: FastFSLoader._python_sort_entries(
+                    self._scandir_python(resolved, show_hidden),
+                    sort_by, sort_desc, dirs_first=True,
+                )
             )
         
         # 过滤只保留直接子项
@@ -166,20 +173,7 @@ class FileSystemService:
                     "is_directory": f["is_directory"],
                     "is_symlink": f.get("is_symlink", False),
                 })
-        
-        # 排序
-        reverse = sort_desc
-        if sort_by == "name":
-            result_files.sort(key=lambda x: x["name"].lower(), reverse=reverse)
-        elif sort_by == "size":
-            result_files.sort(key=lambda x: x["size"], reverse=reverse)
-        elif sort_by == "mtime":
-            result_files.sort(key=lambda x: x["mtime"], reverse=reverse)
-        
-        # 目录始终在前面
-        dirs = [f for f in result_files if f["is_directory"]]
-        files_ = [f for f in result_files if not f["is_directory"]]
-        result_files = dirs + files_
+        # 已按 sort_by 自然排序，目录始终在前面
         
         # 计算父目录
         parent = None
@@ -352,6 +346,8 @@ class FileSystemService:
             _executor,
             lambda: target.mkdir(parents=parents, exist_ok=False)
         )
+        get_name_index_service().notify_created(str(target))
+        get_fast_fs().invalidate_listings(str(target))
     
     async def delete(self, path: str, recursive: bool = False):
         """删除文件或目录"""
@@ -375,6 +371,8 @@ class FileSystemService:
                 _executor,
                 lambda: resolved.unlink()
             )
+        get_name_index_service().notify_deleted(str(resolved))
+        get_fast_fs().invalidate_listings(str(resolved))
     
     async def move(self, source: str, destination: str, overwrite: bool = False):
         """移动/重命名"""
@@ -389,10 +387,12 @@ class FileSystemService:
             raise FileExistsError(f"目标已存在: {destination}")
         
         loop = asyncio.get_running_loop()
-        await loop.run_in_executor(
+        moved_to = await loop.run_in_executor(
             _executor,
             lambda: shutil.move(str(src_resolved), str(dst_path))
         )
+        get_name_index_service().notify_moved(str(src_resolved), str(moved_to))
+        get_fast_fs().invalidate_listings(str(src_resolved), str(moved_to))
     
     async def copy(self, source: str, destination: str, overwrite: bool = False):
         """复制文件"""
@@ -408,12 +408,36 @@ class FileSystemService:
         loop = asyncio.get_running_loop()
         
         if src_resolved.is_dir():
-            await loop.run_in_executor(
+            copied_to = await loop.run_in_executor(
                 _executor,
-                lambda: shutil.copytree(str(src_resolved), str(dst_path))
+                lambda: shutil.copytree(
+                    str(src_resolved),
+                    str(dst_path),
+                    copy_function=self._copy_file,
+                )
             )
         else:
-            await loop.run_in_executor(
+            copied_to = await loop.run_in_executor(
                 _executor,
-                lambda: shutil.copy2(str(src_resolved), str(dst_path))
+                lambda: self._copy_file(str(src_resolved), str(dst_path))
             )
+        get_name_index_service().notify_created(str(copied_to))
+        get_fast_fs().invalidate_listings(str(copied_to))
+    
+    def _copy_file(self, src: str, dst: str) -> str:
+        """
+        复制单个文件
+        
+        fast_fs 可用时只复制数据段，保留稀疏文件空洞（虚拟机镜像、数据库文件）；
+        否则降级到 shutil.copy2。签名与 copy2 一致，可用作 copytree 的 copy_function。
+        """
+        if self.use_fast_fs:
+            if os.path.isdir(dst):
+                dst = os.path.join(dst, os.path.basename(src))
+            # 与 copy2 一致：目标就是源文件（同路径 / 硬链接）时拒绝，
+            # 原生层打开目标后会再按 inode 复核一次
+            if os.path.exists(dst) and os.path.samefile(src, dst):
+                raise shutil.SameFileError(f"{src!r} and {dst!r} are the same file")
+            fast_fs.copy_file(src, dst)
+            return dst
+        return shutil.copy2(src, dst)
@@ -0,0 +1,260 @@
+"""
+FluxFile - 文件名索引服务
+=========================
+
+维护 ROOT_PATH 下的三元组文件名索引（fast_fs.FilenameIndex），
+为文件名子串 / glob 搜索提供毫秒级查询：
+
+- 启动时 mmap 加载 NAME_INDEX_PATH；文件缺失、损坏或根目录不符时后台重建
+- FileSystemService 的创建 / 删除 / 移动 / 复制通过 notify_* 增量更新索引
+- 累积 NAME_INDEX_SAVE_THRESHOLD 次增量更新后合并写回，关闭时也会写回
+- fast_fs 不可用或索引尚未就绪时，查询降级为 find 全量遍历
+"""
+
+import os
+import threading
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+from typing import List, Optional
+
+from app.core.config import settings
+from app.core.dependencies import FastFSLoader
+from app.core.logging import get_logger
+
+logger = get_logger(__name__)
+
+
+def _glob_escape(ch: str) -> str:
+    """转义 fnmatch 元字符"""
+    return f"[{ch}]" if ch in "*?[]" else ch
+
+
+def _subsequence_positions(text: str, query: str) -> Optional[List[int]]:
+    """在 text 中从末尾反向贪心匹配 query 子序列，返回匹配下标（偏向文件名部分）"""
+    case_sensitive = any(c.isupper() for c in query)
+    haystack = text if case_sensitive else text.lower()
+    positions = []
+    k = len(query) - 1
+    for i in range(len(haystack) - 1, -1, -1):
+        if k < 0:
+            break
+        if haystack[i] == query[k]:
+            positions.append(i)
+            k -= 1
+    if k >= 0:
+        return None
+    positions.reverse()
+    return positions
+
+
+class NameIndexService:
+    """
+    文件名索引服务
+
+    索引对象本身是线程安全的（查询共享锁、更新独占锁），
+    这里的锁只保护索引的替换与构建期间的事件缓冲。
+    """
+
+    def __init__(self, fast_fs: FastFSLoader):
+        self._fast_fs = fast_fs
+        self.root_path = str(Path(settings.ROOT_PATH).resolve())
+        self.index_path = settings.NAME_INDEX_PATH
+        self.enabled = settings.NAME_INDEX_ENABLED and fast_fs.is_available
+
+        self._lock = threading.Lock()
+        self._index = None
+        self._building = False
+        # 构建期间到达的变更事件，构建完成后重放（add / remove 均幂等）
+        self._pending_events: List[tuple] = []
+        self._unsaved = 0
+        # 增量更新在单线程中按序执行，不阻塞事件循环
+        self._updater = ThreadPoolExecutor(max_workers=1, thread_name_prefix="name-index")
+
+    @property
+    def ready(self) -> bool:
+        """索引是否可用"""
+        return self._index is not None
+
+    def start(self) -> None:
+        """加载或在后台构建索引（重复调用无副作用）"""
+        if not self.enabled:
+            return
+        with self._lock:
+            if self._index is not None or self._building:
+                return
+            self._building = True
+        threading.Thread(
+            target=self._load_or_build, name="name-index-build", daemon=True
+        ).start()
+
+    def _load_or_build(self) -> None:
+        module = self._fast_fs.module
+        index = None
+        try:
+            if os.path.exists(self.index_path):
+                try:
+                    index = module.FilenameIndex.load(self.index_path)
+                    if index.root != self.root_path:
+                        logger.info(f"文件名索引根目录不符 ({index.root})，重新构建")
+                        index = None
+                    elif index.include_hidden != settings.SHOW_HIDDEN_FILES:
+                        logger.info("文件名索引的隐藏文件设置已变更，重新构建")
+                        index = None
+                except (OSError, RuntimeError) as e:
+                    logger.warning(f"文件名索引加载失败，重新构建: {e}")
+                    index = None
+
+            if index is None:
+                index = module.FilenameIndex.build(
+                    self.root_path,
+                    include_hidden=settings.SHOW_HIDDEN_FILES,
+                    one_file_system=settings.SCAN_ONE_FILE_SYSTEM,
+                    skip_fs_types=settings.SCAN_SKIP_FS_TYPES,
+                    # 全量构建是后台任务，不与目录浏览争抢磁盘
+                    priority="background",
+                    limiter=self._fast_fs.rate_limiter("background"),
+                )
+                try:
+                    Path(self.index_path).parent.mkdir(mode=0o700, parents=True, exist_ok=True)
+                    index.save(self.index_path)
+                except OSError as e:
+                    logger.warning(f"文件名索引写入失败，仅保留在内存中: {e}")
+
+            with self._lock:
+                for kind, paths in self._pending_events:
+                    if kind == "add":
+                        index.add(paths)
+                    else:
+                        index.remove(paths)
+                self._unsaved = len(self._pending_events)
+                self._pending_events.clear()
+                self._index = index
+            logger.info(f"文件名索引就绪: {len(index)} 个条目")
+        except Exception as e:
+            logger.error(f"文件名索引构建失败: {e}")
+        finally:
+            with self._lock:
+                self._building = False
+
+    def save(self) -> None:
+        """合并增量更新并写回索引文件（没有未写回的更新时跳过）"""
+        index = self._index
+        if index is None or self._unsaved == 0:
+            return
+        try:
+            index.save(self.index_path)
+            self._unsaved = 0
+        except Exception as e:
+            logger.error(f"文件名索引写回失败: {e}")
+
+    # ========================================================================
+    # 查询
+    # ========================================================================
+
+    def search(
+        self, query: str, limit: int = 1000, glob: bool = False, under: str = ""
+    ) -> List[str]:
+        """
+        按文件名查询，返回绝对路径列表
+
+        Args:
+            query: 子串，或 glob=True 时的 fnmatch 模式
+            limit: 最大返回数
+            glob: 是否按 glob 模式匹配
+            under: 只返回该目录（绝对路径）下的条目，在索引内计入 limit 之前过滤
+        """
+        index = self._index
+        if index is not None:
+            if glob:
+                return index.glob(query, limit, under=under)
+            return index.search(query, limit, under=under)
+
+        # 降级：全量遍历（限定目录时只遍历该目录）
+        pattern = query if glob else f"*{query}*"
+        result = self._fast_fs.find(
+            under or self.root_path,
+            {"iname": pattern},
+            include_hidden=settings.SHOW_HIDDEN_FILES,
+            limit=limit,
+            one_file_system=settings.SCAN_ONE_FILE_SYSTEM,
+            skip_fs_types=settings.SCAN_SKIP_FS_TYPES,
+        )
+        return [item["path"] for item in result["entries"]]
+
+    def fuzzy(self, query: str, limit: int = 50) -> List[dict]:
+        """
+        模糊匹配路径（quick-open）
+
+        Returns:
+            [{"path": 绝对路径, "score": int, "positions": [匹配字符下标, ...]}, ...]
+        """
+        index = self._index
+        if index is not None:
+            return index.fuzzy(query, limit)
+
+        # 降级：按子序列 glob 遍历（含 "/" 时匹配相对路径），再用简单规则排序
+        pattern = "*" + "*".join(_glob_escape(ch) for ch in query) + "*"
+        result = self._fast_fs.find(
+            self.root_path,
+            {"path" if "/" in query else "iname": pattern},
+            include_hidden=settings.SHOW_HIDDEN_FILES,
+            limit=limit * 20,
+            one_file_system=settings.SCAN_ONE_FILE_SYSTEM,
+            skip_fs_types=settings.SCAN_SKIP_FS_TYPES,
+        )
+        matches = []
+        for item in result["entries"]:
+            positions = _subsequence_positions(item["path"], query)
+            if positions is None:
+                continue
+            span = positions[-1] - positions[0]
+            matches.append({
+                "path": item["path"],
+                "score": len(query) * 16 - span - len(item["path"]) // 16,
+                "positions": positions,
+            })
+        matches.sort(key=lambda m: (-m["score"], len(m["path"]), m["path"]))
+        return matches[:limit]
+
+    # ========================================================================
+    # 变更事件
+    # ========================================================================
+
+    def notify_created(self, *paths: str) -> None:
+        """新建 / 复制 / 移入的路径（目录递归加入）"""
+        self._submit("add", paths)
+
+    def notify_deleted(self, *paths: str) -> None:
+        """删除 / 移出的路径（目录连同其子孙）"""
+        self._submit("remove", paths)
+
+    def notify_moved(self, source: str, destination: str) -> None:
+        """移动 / 重命名"""
+        self.notify_deleted(source)
+        self.notify_created(destination)
+
+    def _submit(self, kind: str, paths) -> None:
+        if not self.enabled:
+            return
+        # 索引中的路径是规范化的绝对路径
+        self._updater.submit(self._apply, kind, [os.path.realpath(str(p)) for p in paths])
+
+    def _apply(self, kind: str, paths: List[str]) -> None:
+        with self._lock:
+            index = self._index
+            if index is None:
+                if self._building:
+                    self._pending_events.append((kind, paths))
+                return
+        try:
+            if kind == "add":
+                index.add(paths)
+            else:
+                index.remove(paths)
+        except Exception as e:
+            logger.warning(f"文件名索引增量更新失败: {e}")
+            return
+
+        self._unsaved += 1
+        if self._unsaved >= settings.NAME_INDEX_SAVE_THRESHOLD:
+            self.save()
@@ -446,6 +446,26 @@ class RangeFileResponse(ZeroCopyFileResponse):
                     remaining -= len(chunk)
 
 
+# ============================================================================
+# 缓冲区响应
+# ============================================================================
+
+class BufferResponse(Response):
+    """
+    以缓冲区对象（bytes 或 memoryview）作为响应体
+    
+    Starlette 的 Response 会把非 bytes 内容 encode 成 bytes；
+    这里原样保留缓冲区，由 ASGI 服务器直接写入 socket，不复制。
+    """
+    
+    media_type = "application/octet-stream"
+    
+    def render(self, content: Any) -> Any:
+        if isinstance(content, (bytes, memoryview)):
+            return content
+        return super().render(content)
+
+
 # ============================================================================
 # 目录打包响应
 # ============================================================================
@@ -0,0 +1,68 @@
+"""
+测试公共配置
+
+fast_fs 扩展需要先编译（pip install -e . 或 cpp_src 下 cmake 构建后把 .so 放到
+PYTHONPATH），未编译时依赖扩展的测试自动跳过；API 测试在两种实现下都会运行。
+"""
+
+import os
+import sys
+from pathlib import Path
+
+import pytest
+
+BACKEND_DIR = Path(__file__).resolve().parent.parent
+if str(BACKEND_DIR) not in sys.path:
+    sys.path.insert(0, str(BACKEND_DIR))
+
+
+@pytest.fixture(scope="session")
+def fast_fs():
+    """编译好的 fast_fs 扩展；未编译时跳过测试"""
+    return pytest.importorskip("fast_fs")
+
+
+@pytest.fixture
+def tree(tmp_path: Path) -> Path:
+    """
+    一个小目录树：
+
+        root/
+          a.txt, b.py, data.json, config.ini, image.png, empty, file2.txt, file10.txt
+          .hidden/e.txt
+          sub/c.log
+          sub/deep/d.bin
+    """
+    root = tmp_path / "root"
+    (root / "sub" / "deep").mkdir(parents=True)
+    (root / ".hidden").mkdir()
+
+    (root / "a.txt").write_text("hello world\nsecond line\n")
+    (root / "b.py").write_text("#!/usr/bin/env python\nprint('hello')\n")
+    (root / "data.json").write_text('{"key": [1, 2, 3]}\n')
+    (root / "config.ini").write_text("[section]\nkey = value\n")
+    (root / "image.png").write_bytes(b"\x89PNG\r\n\x1a\n" + b"\0" * 64)
+    (root / "empty").write_bytes(b"")
+    (root / "file2.txt").write_text("2\n")
+    (root / "file10.txt").write_text("10\n")
+    (root / ".hidden" / "e.txt").write_text("hidden hello\n")
+    (root / "sub" / "c.log").write_text("".join(f"log line {i}\n" for i in range(100)))
+    (root / "sub" / "deep" / "d.bin").write_bytes(os.urandom(10000))
+    return root
+
+
+@pytest.fixture
+def walk_paths():
+    """os.walk 得到的全部条目（不含根目录本身），作为遍历类接口的参照"""
+
+    def walk(root: Path, include_hidden: bool = False) -> set:
+        result = set()
+        for dirpath, dirnames, filenames in os.walk(root):
+            if not include_hidden:
+                dirnames[:] = [d for d in dirnames if not d.startswith(".")]
+                filenames = [f for f in filenames if not f.startswith(".")]
+            for name in dirnames + filenames:
+                result.add(os.path.join(dirpath, name))
+        return result
+
+    return walk
@@ -0,0 +1,180 @@
+"""
+fast_fs 单文件类接口：copy_file、stat_batch、get_file_info、resolve_id_names、detect_types、read_range / read_heads
+"""
+
+import os
+import pwd
+import stat
+
+import pytest
+
+
+def _make_sparse(path, size=8 << 20, data=b"payload"):
+    with open(path, "wb") as f:
+        f.truncate(size)
+        f.seek(size // 2)
+        f.write(data)
+
+
+class TestCopyFile:
+    def test_sparse_copy_matches_source(self, fast_fs, tmp_path):
+        src, dst = tmp_path / "sparse.img", tmp_path / "copy.img"
+        _make_sparse(src)
+
+        result = fast_fs.copy_file(str(src), str(dst))
+
+        assert result["size"] == src.stat().st_size
+        assert dst.read_bytes() == src.read_bytes()
+        assert result["bytes_copied"] + result["holes_skipped"] >= result["size"] - 4096
+        assert fast_fs.calculate_blake3(str(dst)) == fast_fs.calculate_blake3(str(src))
+
+    def test_preserves_mode_and_mtime(self, fast_fs, tmp_path):
+        src, dst = tmp_path / "src", tmp_path / "dst"
+        src.write_bytes(b"x" * 100)
+        os.chmod(src, 0o640)
+        os.utime(src, ns=(1_600_000_000_123_456_789, 1_600_000_000_987_654_321))
+
+        fast_fs.copy_file(str(src), str(dst))
+
+        st = dst.stat()
+        assert stat.S_IMODE(st.st_mode) == 0o640
+        assert st.st_mtime_ns == 1_600_000_000_987_654_321
+
+    def test_copies_xattrs_like_copy2(self, fast_fs, tmp_path):
+        src, dst = tmp_path / "src", tmp_path / "dst"
+        src.write_bytes(b"data")
+        try:
+            os.setxattr(src, "user.fluxfile", b"tag")
+        except OSError:
+            pytest.skip("文件系统不支持 user.* 扩展属性")
+
+        fast_fs.copy_file(str(src), str(dst))
+
+        assert os.getxattr(dst, "user.fluxfile") == b"tag"
+
+    def test_refuses_to_copy_onto_itself(self, fast_fs, tmp_path):
+        src = tmp_path / "same"
+        src.write_bytes(b"keep me")
+        os.link(src, tmp_path / "hardlink")
+
+        with pytest.raises(RuntimeError):
+            fast_fs.copy_file(str(src), str(tmp_path / "hardlink"))
+        assert src.read_bytes() == b"keep me"
+
+
+def test_sparse_hash_matches_reference(fast_fs, tmp_path):
+    blake3 = pytest.importorskip("blake3")
+    path = tmp_path / "sparse.img"
+    _make_sparse(path)
+
+    # 空洞以零页参与哈希：摘要与逐字节读取一致
+    expected = blake3.blake3(path.read_bytes()).hexdigest()
+    assert fast_fs.calculate_blake3(str(path)) == expected
+    assert fast_fs.calculate_blake3_batch([str(path)])[str(path)] == expected
+
+
+class TestStatBatch:
+    def test_matches_os_stat(self, fast_fs, tree):
+        paths = [str(tree / "a.txt"), str(tree / "sub"), str(tree / "missing")]
+
+        result = fast_fs.stat_batch(paths, ["type", "size", "mtime", "ino", "realpath"])
+
+        a = os.stat(paths[0])
+        assert result["type"][:2] == ["file", "directory"]
+        assert result["size"][0] == a.st_size
+        assert result["mtime"][0] == pytest.approx(a.st_mtime)
+        assert result["ino"][0] == a.st_ino
+        assert result["realpath"][1] == os.path.realpath(paths[1])
+        assert result["error"][:2] == [None, None]
+        assert result["error"][2] is not None
+        assert result["size"][2] is None
+
+    def test_unknown_field(self, fast_fs, tree):
+        with pytest.raises(ValueError):
+            fast_fs.stat_batch([str(tree)], ["no_such_field"])
+
+
+class TestFileInfo:
+    def test_access_matches_os_access(self, fast_fs, tree):
+        for path in (tree / "a.txt", tree / "sub", tree / "b.py"):
+            info = fast_fs.get_file_info(str(path))
+            assert info["is_readable"] == os.access(path, os.R_OK, effective_ids=True)
+            assert info["is_writable"] == os.access(path, os.W_OK, effective_ids=True)
+            assert info["is_executable"] == os.access(path, os.X_OK, effective_ids=True)
+
+    def test_owner_names(self, fast_fs, tree):
+        info = fast_fs.get_file_info(str(tree / "a.txt"))
+        uid = os.stat(tree / "a.txt").st_uid
+        assert info["uid"] == uid
+        assert info["owner"] == pwd.getpwuid(uid).pw_name
+
+    def test_missing_path(self, fast_fs, tree):
+        with pytest.raises(OSError):
+            fast_fs.get_file_info(str(tree / "missing"))
+
+
+def test_resolve_id_names(fast_fs):
+    uid = os.getuid()
+    names = fast_fs.resolve_id_names([uid, 4_000_000_000], [])
+    assert names["users"][uid] == pwd.getpwuid(uid).pw_name
+    # 无法解析的 id 返回数字字符串（与 ls 一致）
+    assert names["users"][4_000_000_000] == "4000000000"
+
+
+class TestDetectTypes:
+    def test_magic_and_text(self, fast_fs, tree):
+        names = ["image.png", "b.py", "data.json", "a.txt", "empty", "sub", "missing"]
+        types = fast_fs.detect_types([str(tree / n) for n in names])
+        assert types == [
+            "image/png",
+            "text/x-python",
+            "application/json",
+            "text/plain",
+            "inode/x-empty",
+            "inode/directory",
+            None,
+        ]
+
+    def test_ini_and_toml_are_not_json(self, fast_fs, tree, tmp_path):
+        toml = tmp_path / "pyproject"
+        toml.write_text('[[servers]]\nname = "a"\n')
+        types = fast_fs.detect_types([str(tree / "config.ini"), str(toml)])
+        assert types == ["text/plain", "text/plain"]
+
+    def test_svg_only_at_root_element(self, fast_fs, tmp_path):
+        svg = tmp_path / "icon"
+        svg.write_text('<?xml version="1.0"?>\n<!-- icon -->\n<svg xmlns="http://www.w3.org/2000/svg"/>\n')
+        html = tmp_path / "page"
+        html.write_text("<html><body><svg></svg></body></html>\n")
+        xml = tmp_path / "doc"
+        xml.write_text('<?xml version="1.0"?>\n<root><svg/></root>\n')
+
+        types = fast_fs.detect_types([str(svg), str(html), str(xml)])
+
+        assert types == ["image/svg+xml", "text/html", "application/xml"]
+
+
+class TestRangeReads:
+    def test_read_range(self, fast_fs, tree):
+        content = (tree / "a.txt").read_bytes()
+        view = fast_fs.read_range(str(tree / "a.txt"), 6, 5)
+        assert isinstance(view, memoryview) and view.readonly
+        assert view == content[6:11]
+        assert fast_fs.read_range(str(tree / "a.txt"), 6, 1 << 20) == content[6:]
+        assert fast_fs.read_range(str(tree / "a.txt"), len(content) + 10, 5) == b""
+
+    def test_read_range_errors(self, fast_fs, tree):
+        with pytest.raises(OSError):
+            fast_fs.read_range(str(tree / "missing"), 0, 10)
+        with pytest.raises(RuntimeError):
+            fast_fs.read_range(str(tree / "sub"), 0, 10)
+
+    def test_read_heads(self, fast_fs, tree):
+        paths = [str(tree / "a.txt"), str(tree / "missing"), str(tree / "sub/c.log")]
+
+        heads = fast_fs.read_heads(paths, 8)
+
+        assert bytes(heads[0]) == b"hello wo"
+        assert heads[1] is None
+        assert bytes(heads[2]) == b"log line"
+        assert heads[0].readonly
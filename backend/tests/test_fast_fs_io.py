@@ -0,0 +1,89 @@
+"""
+fast_fs I/O 调度接口：calculate_blake3_batch、RateLimiter、I/O 调控、设备画像
+"""
+
+import hashlib
+
+import pytest
+
+
+def _files(tree):
+    return [str(tree / n) for n in ("a.txt", "b.py", "sub/c.log", "sub/deep/d.bin")]
+
+
+class TestBlake3Batch:
+    @pytest.mark.parametrize("order", ["auto", "physical", "none"])
+    def test_matches_single_file_hash(self, fast_fs, tree, order):
+        paths = _files(tree) + [str(tree / "missing")]
+
+        result = fast_fs.calculate_blake3_batch(paths, order=order)
+
+        for path in paths[:-1]:
+            assert result[path] == fast_fs.calculate_blake3(path)
+        assert "error" in result[paths[-1]]
+
+    def test_unknown_order(self, fast_fs, tree):
+        with pytest.raises(ValueError):
+            fast_fs.calculate_blake3_batch(_files(tree), order="random")
+
+
+class TestRateLimiter:
+    def test_stats_account_for_batch(self, fast_fs, tree):
+        limiter = fast_fs.RateLimiter()
+        paths = _files(tree)
+
+        fast_fs.calculate_blake3_batch(paths, priority="background", limiter=limiter)
+
+        stats = limiter.stats()
+        assert stats["bytes"] >= sum((tree / p).stat().st_size for p in ("a.txt", "sub/c.log", "sub/deep/d.bin"))
+        assert stats["ops"] >= len(paths)
+        assert stats["limit_bytes_per_sec"] == 0
+
+    def test_set_rates(self, fast_fs):
+        limiter = fast_fs.RateLimiter(bytes_per_sec=1 << 20)
+        limiter.set_rates(iops=100)
+        assert limiter.bytes_per_sec == 1 << 20
+        assert limiter.iops == 100
+
+
+class TestIoGovernor:
+    def test_configure_round_trip(self, fast_fs):
+        saved = fast_fs.configure_io_governor()
+        try:
+            config = fast_fs.configure_io_governor(default_limit=8, backoff_ratio=3.0)
+            assert config["default_limit"] == 8
+            assert config["backoff_ratio"] == 3.0
+            assert config["min_limit"] == saved["min_limit"]
+        finally:
+            fast_fs.configure_io_governor(**saved)
+
+    def test_stats_after_walk(self, fast_fs, tree):
+        fast_fs.find(str(tree))
+        for device in fast_fs.io_governor_stats():
+            assert {"dev", "device", "limit", "in_flight", "governed", "ops", "p99_ms"} <= set(device)
+
+
+class TestDeviceProfile:
+    def test_profile_fields(self, fast_fs, tree):
+        profile = fast_fs.device_profile(str(tree / "a.txt"))
+        assert profile["threads"] >= 1
+        assert profile["buffer_size"] > 0
+        assert profile["device"].count(":") == 1
+
+    def test_calibration_on_large_file(self, fast_fs, tmp_path):
+        big = tmp_path / "probe.bin"
+        with open(big, "wb") as f:
+            chunk = hashlib.sha256(b"probe").digest() * (1 << 15)
+            for _ in range(16):  # 16MB：校准要求的最小文件
+                f.write(chunk)
+
+        profile = fast_fs.device_profile(str(big))
+
+        assert profile["calibrated"]
+        assert 0 <= profile["calibration_age_s"] < 600
+        assert isinstance(profile["direct_io"], bool)
+        assert profile["dev"] in {p["dev"] for p in fast_fs.device_profiles()}
+
+    def test_missing_path(self, fast_fs, tmp_path):
+        with pytest.raises(OSError):
+            fast_fs.device_profile(str(tmp_path / "missing"))
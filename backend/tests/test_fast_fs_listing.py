@@ -0,0 +1,78 @@
+"""
+fast_fs 目录列表接口：list_directory_json、list_directory_msgpack、列表缓存
+"""
+
+import json
+
+import pytest
+
+
+@pytest.fixture
+def listing_cache(fast_fs):
+    """测试结束后恢复列表缓存配置"""
+    saved = fast_fs.configure_listing_cache()
+    yield fast_fs
+    fast_fs.configure_listing_cache(saved["max_entries"], saved["min_entries"], saved["ttl"])
+
+
+def _list_json(fast_fs, tree, **kwargs):
+    return json.loads(fast_fs.list_directory_json(str(tree), str(tree), "/", **kwargs))
+
+
+class TestListDirectoryJson:
+    def test_counts_and_natural_order(self, fast_fs, tree):
+        body = _list_json(fast_fs, tree)
+
+        names = [e["name"] for e in body["entries"]]
+        assert body["success"]
+        assert body["totalCount"] == len(names) == 9
+        assert body["directoryCount"] == 1
+        assert names[:2] == ["sub", "a.txt"]  # 目录优先
+        assert names.index("file2.txt") < names.index("file10.txt")
+        assert body["entries"][1]["path"] == "/a.txt"
+        assert body["entries"][1]["type"] == "file"
+
+    def test_paging(self, fast_fs, tree):
+        full = _list_json(fast_fs, tree)["entries"]
+        page = _list_json(fast_fs, tree, offset=3, limit=4)
+
+        assert page["totalCount"] == len(full)
+        assert [e["name"] for e in page["entries"]] == [e["name"] for e in full[3:7]]
+
+    def test_exclusions(self, fast_fs, tree):
+        body = _list_json(fast_fs, tree, exclude_names=["sub"], exclude_paths=[str(tree / "b.py")])
+        names = {e["name"] for e in body["entries"]}
+        assert "sub" not in names and "b.py" not in names
+
+
+def test_msgpack_matches_json(fast_fs, tree):
+    msgpack = pytest.importorskip("msgpack")
+
+    body = msgpack.unpackb(fast_fs.list_directory_msgpack(str(tree), str(tree), "/"))
+    expected = _list_json(fast_fs, tree)
+
+    assert body["v"] == 1
+    assert body["totalCount"] == expected["totalCount"]
+    assert body["names"] == [e["name"] for e in expected["entries"]]
+    assert [body["base"] + name for name in body["names"]] == [e["path"] for e in expected["entries"]]
+    assert body["sizes"] == [e["size"] for e in expected["entries"]]
+
+
+class TestListingCache:
+    def test_default_budget(self, listing_cache):
+        assert listing_cache.configure_listing_cache()["max_entries"] == 200000
+
+    def test_hits_and_invalidation(self, listing_cache, tree):
+        listing_cache.configure_listing_cache(min_entries=1)
+        listing_cache.invalidate_listings([str(tree)])
+
+        first = _list_json(listing_cache, tree)
+        hits = listing_cache.listing_cache_stats()["hits"]
+        second = _list_json(listing_cache, tree)
+
+        assert second == first
+        assert listing_cache.listing_cache_stats()["hits"] == hits + 1
+
+        assert listing_cache.invalidate_listings([str(tree / "a.txt")]) >= 1
+        (tree / "new.txt").write_text("")
+        assert "new.txt" in {e["name"] for e in _list_json(listing_cache, tree)["entries"]}
@@ -0,0 +1,153 @@
+"""
+fast_fs 文本类接口：search_content、build_line_index / read_lines、tail_read、TailSubscription
+"""
+
+import pytest
+
+
+class TestSearchContent:
+    def test_matches_naive_search(self, fast_fs, tree):
+        result = fast_fs.search_content(str(tree), ["hello", "line 42"])
+
+        found = {(m["path"], m["line"], m["pattern"]) for m in result["matches"]}
+        assert found == {
+            (str(tree / "a.txt"), 1, "hello"),
+            (str(tree / "b.py"), 2, "hello"),
+            (str(tree / "sub/c.log"), 43, "line 42"),
+        }
+        assert not result["truncated"]
+
+    def test_ignore_case_and_hidden(self, fast_fs, tree):
+        result = fast_fs.search_content(str(tree), ["HELLO"], ignore_case=True, include_hidden=True)
+        paths = {m["path"] for m in result["matches"]}
+        assert str(tree / ".hidden/e.txt") in paths
+
+    def test_match_across_chunk_boundary(self, fast_fs, tmp_path):
+        # 扫描按 1MB 分块读取：跨块的匹配不能丢
+        big = tmp_path / "big.txt"
+        big.write_bytes(b"x" * ((1 << 20) - 3) + b"NEEDLE\n")
+
+        result = fast_fs.search_content(str(tmp_path), ["NEEDLE"])
+
+        assert [m["offset"] for m in result["matches"]] == [(1 << 20) - 3]
+
+    def test_exclusions_prune_before_reading(self, fast_fs, tree):
+        result = fast_fs.search_content(
+            str(tree), ["hello", "log line"],
+            exclude_paths=[str(tree / "b.py")], exclude_names=["sub"],
+        )
+        assert {m["path"] for m in result["matches"]} == {str(tree / "a.txt")}
+
+    def test_rejects_empty_patterns(self, fast_fs, tree):
+        with pytest.raises(ValueError):
+            fast_fs.search_content(str(tree), [])
+        with pytest.raises(ValueError):
+            fast_fs.search_content(str(tree), ["hello", ""])
+
+    def test_rejects_pattern_longer_than_overlap(self, fast_fs, tree):
+        with pytest.raises(ValueError):
+            fast_fs.search_content(str(tree), ["a" * (512 * 1024 + 1)])
+
+    def test_rejects_patterns_over_total_budget(self, fast_fs, tree):
+        # 每个模式都不超过重叠上限，但总长超过 64KB 的自动机预算
+        with pytest.raises(ValueError):
+            fast_fs.search_content(str(tree), [f"{i:04d}" + "a" * 1020 for i in range(65)])
+
+
+class TestReadLines:
+    def test_random_access(self, fast_fs, tree):
+        path = tree / "sub/c.log"
+        lines = path.read_text().splitlines()
+        fast_fs.build_line_index(str(path), stride=10)
+
+        result = fast_fs.read_lines(str(path), 50, 5, stride=10)
+
+        assert result["lines"] == lines[49:54]
+        assert result["first_line"] == 50
+        assert result["total_lines"] == 100
+        assert result["offset"] == sum(len(line) + 1 for line in lines[:49])
+
+    def test_persistent_index_file(self, fast_fs, tree, tmp_path):
+        path, index = tree / "sub/c.log", tmp_path / "c.idx"
+        built = fast_fs.build_line_index(str(path), str(index), 10)
+        assert built["total_lines"] == 100
+        assert index.exists()
+
+        fast_fs.clear_line_index_cache()
+        result = fast_fs.read_lines(str(path), 100, 10, str(index), 10)
+        assert result["lines"] == ["log line 99"]
+
+    def test_long_lines_are_truncated(self, fast_fs, tmp_path):
+        path = tmp_path / "long.txt"
+        path.write_bytes(b"a" * 100_000 + b"\r\nshort\r\n")
+
+        result = fast_fs.read_lines(str(path), 1, 2, max_line_length=10)
+
+        assert result["lines"] == ["a" * 10, "short"]
+
+    def test_past_end(self, fast_fs, tree):
+        result = fast_fs.read_lines(str(tree / "a.txt"), 10, 5)
+        assert result["lines"] == []
+        assert result["total_lines"] == 2
+
+
+class TestTail:
+    def test_offsets(self, fast_fs, tmp_path):
+        path = tmp_path / "app.log"
+        path.write_bytes(b"first\nsecond\n")
+
+        whole = fast_fs.tail_read(str(path), 0, 0, 0)
+        assert whole["data"] == b"first\nsecond\n"
+        assert whole["offset"] == 13
+
+        assert fast_fs.tail_read(str(path), -7, 0, 0)["data"] == b"second\n"
+
+    def test_most_negative_offset(self, fast_fs, tmp_path):
+        path = tmp_path / "app.log"
+        path.write_bytes(b"first\nsecond\n")
+        # INT64_MIN：比文件还长的倒数偏移从头开始，不能溢出
+        assert fast_fs.tail_read(str(path), -(2 ** 63), 0, 0)["data"] == b"first\nsecond\n"
+
+    def test_truncate_and_rotate(self, fast_fs, tmp_path):
+        path = tmp_path / "app.log"
+        path.write_bytes(b"0123456789")
+        inode = fast_fs.tail_read(str(path), 0, 0, 0)["inode"]
+
+        path.write_bytes(b"abc")
+        truncated = fast_fs.tail_read(str(path), 10, inode, 0)
+        assert truncated["truncated"]
+        assert truncated["data"] == b"abc"
+
+        path.rename(tmp_path / "app.log.1")
+        path.write_bytes(b"new")
+        rotated = fast_fs.tail_read(str(path), 3, inode, 0)
+        assert rotated["rotated"]
+        assert rotated["data"] == b"new"
+
+    def test_subscription_follows_appends(self, fast_fs, tmp_path):
+        path = tmp_path / "app.log"
+        path.write_bytes(b"start\n")
+
+        sub = fast_fs.TailSubscription(str(path))
+        try:
+            first = sub.read(0, 0, 0)
+            assert first["data"] == b"start\n"
+
+            with open(path, "ab") as f:
+                f.write(b"more\n")
+            second = sub.read(first["offset"], first["inode"], 5.0)
+            assert second["data"] == b"more\n"
+
+            idle = sub.read(second["offset"], second["inode"], 0.05)
+            assert idle["data"] == b""
+        finally:
+            sub.close()
+
+        assert sub.closed
+        sub.close()  # 可重复调用
+        with pytest.raises(RuntimeError):
+            sub.read(0, 0, 0)
+
+    def test_subscription_missing_file(self, fast_fs, tmp_path):
+        with pytest.raises(OSError):
+            fast_fs.TailSubscription(str(tmp_path / "missing.log"))
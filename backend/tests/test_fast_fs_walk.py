@@ -0,0 +1,258 @@
+"""
+fast_fs 遍历类接口：find、top_files、scandir_recursive、scandir_arrow / find_arrow、FilenameIndex
+"""
+
+import os
+
+import pytest
+
+
+def _regular_files(root, include_hidden=False):
+    """os.walk 得到的普通文件 (size, path)，作为 top_files 的参照"""
+    result = []
+    for dirpath, dirnames, filenames in os.walk(root):
+        if not include_hidden:
+            dirnames[:] = [d for d in dirnames if not d.startswith(".")]
+            filenames = [f for f in filenames if not f.startswith(".")]
+        for name in filenames:
+            path = os.path.join(dirpath, name)
+            result.append((os.lstat(path).st_size, path))
+    return result
+
+
+class TestFind:
+    def test_matches_os_walk(self, fast_fs, tree, walk_paths):
+        result = fast_fs.find(str(tree))
+
+        paths = [e["path"] for e in result["entries"]]
+        assert set(paths) == walk_paths(tree)
+        assert paths == sorted(paths)
+        assert not result["truncated"]
+
+    def test_include_hidden(self, fast_fs, tree, walk_paths):
+        result = fast_fs.find(str(tree), include_hidden=True)
+        assert {e["path"] for e in result["entries"]} == walk_paths(tree, include_hidden=True)
+
+    def test_predicates(self, fast_fs, tree):
+        by_ext = fast_fs.find(str(tree), {"ext": "txt"})
+        assert {e["name"] for e in by_ext["entries"]} == {"a.txt", "file2.txt", "file10.txt"}
+
+        dirs = fast_fs.find(str(tree), {"type": "directory"})
+        assert {e["path"] for e in dirs["entries"]} == {str(tree / "sub"), str(tree / "sub/deep")}
+
+        large = fast_fs.find(str(tree), {"size": {"gt": 5000}, "type": "file"})
+        assert [e["name"] for e in large["entries"]] == ["d.bin"]
+
+    def test_prune(self, fast_fs, tree):
+        pruned = fast_fs.find(str(tree), None, {"name": "deep"})
+        assert str(tree / "sub/deep/d.bin") not in {e["path"] for e in pruned["entries"]}
+
+    def test_exclusions(self, fast_fs, tree):
+        excluded = fast_fs.find(str(tree), exclude_paths=[str(tree / "sub")], exclude_names=["b.py"])
+        paths = {e["path"] for e in excluded["entries"]}
+        assert not any(p == str(tree / "sub") or p.startswith(str(tree / "sub") + "/") for p in paths)
+        assert str(tree / "b.py") not in paths
+        assert str(tree / "a.txt") in paths
+
+    def test_limit(self, fast_fs, tree):
+        result = fast_fs.find(str(tree), limit=2)
+        assert len(result["entries"]) == 2
+        assert result["truncated"]
+
+    def test_invalid_query(self, fast_fs, tree):
+        with pytest.raises(ValueError):
+            fast_fs.find(str(tree), {"no_such_key": 1})
+
+
+class TestTopFiles:
+    def test_matches_sorted_walk(self, fast_fs, tree):
+        expected = [path for _, path in sorted(_regular_files(tree), reverse=True)[:3]]
+
+        result = fast_fs.top_files(str(tree), 3)
+
+        assert [e["path"] for e in result] == expected
+
+    def test_exclusions_do_not_take_a_slot(self, fast_fs, tree):
+        result = fast_fs.top_files(str(tree), 1, exclude_names=["deep"])
+        assert [e["path"] for e in result] == [str(tree / "sub/c.log")]
+
+
+class TestScandirRecursive:
+    def test_matches_os_walk(self, fast_fs, tree, walk_paths):
+        entries = fast_fs.scandir_recursive(str(tree))
+        assert {e["path"] for e in entries} == walk_paths(tree)
+
+    def test_natural_sort(self, fast_fs, tree):
+        entries = fast_fs.scandir_recursive(str(tree), max_depth=1, sort_by="name")
+        names = [e["name"] for e in entries]
+        assert names.index("file2.txt") < names.index("file10.txt")
+
+    def test_follow_symlinks_detects_cycles(self, fast_fs, tree):
+        os.symlink(tree, tree / "sub/loop")
+
+        entries = fast_fs.scandir_recursive(str(tree), follow_symlinks=True)
+
+        loop = next(e for e in entries if e["path"] == str(tree / "sub/loop"))
+        assert loop["link_cycle"]
+        assert loop["link_target"] == str(tree)
+        assert not any(e["path"].startswith(str(tree / "sub/loop") + "/") for e in entries)
+
+    def test_follow_symlinks_respects_scope(self, fast_fs, tree, tmp_path):
+        outside = tmp_path / "outside"
+        outside.mkdir()
+        (outside / "secret.txt").write_text("secret\n")
+        os.symlink(outside, tree / "out")
+
+        unscoped = fast_fs.scandir_recursive(str(tree), follow_symlinks=True)
+        assert str(tree / "out/secret.txt") in {e["path"] for e in unscoped}
+
+        scoped = fast_fs.scandir_recursive(str(tree), follow_symlinks=True, scope_roots=[str(tree)])
+        link = next(e for e in scoped if e["path"] == str(tree / "out"))
+        # 范围外的目标：不报告、不进入，保留链接自身的 lstat 数据
+        assert "link_target" not in link
+        assert not link["is_directory"]
+        assert link["is_symlink"]
+        assert link["size"] == os.lstat(tree / "out").st_size
+        assert not any(e["path"].startswith(str(tree / "out") + "/") for e in scoped)
+
+
+class TestArrow:
+    @pytest.fixture
+    def ipc(self):
+        pa = pytest.importorskip("pyarrow")
+        import pyarrow.ipc
+
+        return pa, pyarrow.ipc
+
+    def test_scandir_arrow_round_trip(self, fast_fs, tree, ipc):
+        pa, pa_ipc = ipc
+
+        data = fast_fs.scandir_arrow(str(tree))
+        table = pa_ipc.open_file(pa.py_buffer(data)).read_all()
+
+        entries = {e["path"]: e for e in fast_fs.scandir_recursive(str(tree))}
+        assert set(table.column("path").to_pylist()) == set(entries)
+        for row in table.to_pylist():
+            entry = entries[row["path"]]
+            assert row["name"] == entry["name"]
+            assert row["size"] == entry["size"]
+            assert row["is_directory"] == entry["is_directory"]
+        by_name = {row["name"]: row for row in table.to_pylist()}
+        assert by_name["b.py"]["extension"] == "py"
+        assert by_name["empty"]["extension"] == ""
+        assert by_name["sub"]["extension"] is None
+
+    def test_scandir_arrow_to_file(self, fast_fs, tree, tmp_path, ipc, walk_paths):
+        pa, pa_ipc = ipc
+        output = tmp_path / "scan.arrow"
+
+        rows = fast_fs.scandir_arrow(str(tree), str(output))
+
+        table = pa_ipc.open_file(pa.memory_map(str(output))).read_all()
+        assert rows == table.num_rows == len(walk_paths(tree))
+
+    def test_scandir_arrow_error_metadata(self, fast_fs, tree, ipc):
+        pa, pa_ipc = ipc
+
+        metadata = pa_ipc.open_file(pa.py_buffer(fast_fs.scandir_arrow(str(tree)))).read_all().schema.metadata
+
+        assert metadata[b"fluxfile.errors"] == b"0"
+        assert metadata[b"fluxfile.error_list"] == b"[]"
+
+    def test_scandir_arrow_records_errors(self, fast_fs, tree, ipc):
+        if os.geteuid() == 0:
+            pytest.skip("root 不受目录权限限制")
+        pa, pa_ipc = ipc
+        locked = tree / "sub/deep"
+        locked.chmod(0)
+        try:
+            data = fast_fs.scandir_arrow(str(tree))
+        finally:
+            locked.chmod(0o755)
+
+        metadata = pa_ipc.open_file(pa.py_buffer(data)).read_all().schema.metadata
+        assert int(metadata[b"fluxfile.errors"]) >= 1
+        assert str(locked).encode() in metadata[b"fluxfile.error_list"]
+
+    def test_find_arrow(self, fast_fs, tree, ipc):
+        pa, pa_ipc = ipc
+
+        full = pa_ipc.open_file(pa.py_buffer(fast_fs.find_arrow(str(tree), {"ext": "txt"}))).read_all()
+        assert full.column("name").to_pylist() == sorted(["a.txt", "file10.txt", "file2.txt"])
+        assert full.schema.metadata[b"fluxfile.truncated"] == b"false"
+
+        limited = pa_ipc.open_file(pa.py_buffer(fast_fs.find_arrow(str(tree), limit=1))).read_all()
+        assert limited.num_rows == 1
+        assert limited.schema.metadata[b"fluxfile.truncated"] == b"true"
+
+
+class TestFilenameIndex:
+    def test_search_and_glob(self, fast_fs, tree):
+        index = fast_fs.FilenameIndex.build(str(tree))
+
+        assert set(index.search("file")) == {str(tree / "file2.txt"), str(tree / "file10.txt")}
+        assert set(index.glob("*.txt")) == {
+            str(tree / "a.txt"), str(tree / "file2.txt"), str(tree / "file10.txt"),
+        }
+        assert index.search("e.txt") == []  # 隐藏目录未索引
+        assert index.root == str(tree)
+
+    def test_under_filters_before_limit(self, fast_fs, tree):
+        for i in range(20):
+            (tree / f"match_{i}").write_text("")
+        (tree / "sub/match_sub").write_text("")
+        index = fast_fs.FilenameIndex.build(str(tree))
+
+        assert index.search("match", limit=5, under=str(tree / "sub")) == [str(tree / "sub/match_sub")]
+        assert index.glob("match_*", limit=5, under=str(tree / "sub")) == [str(tree / "sub/match_sub")]
+        assert len(index.search("match", limit=5, under=str(tree))) == 5
+
+    def test_save_and_load(self, fast_fs, tree, tmp_path):
+        index = fast_fs.FilenameIndex.build(str(tree))
+        path = tmp_path / "names.idx"
+
+        index.save(str(path))
+        loaded = fast_fs.FilenameIndex.load(str(path))
+
+        assert len(loaded) == len(index)
+        assert sorted(loaded.search("log")) == sorted(index.search("log"))
+        assert loaded.include_hidden == index.include_hidden is False
+
+    def test_incremental_updates(self, fast_fs, tree):
+        index = fast_fs.FilenameIndex.build(str(tree))
+        before = len(index)
+
+        new_dir = tree / "added"
+        new_dir.mkdir()
+        (new_dir / "fresh.md").write_text("")
+        assert index.add([str(new_dir)]) == 2
+        assert index.search("fresh") == [str(new_dir / "fresh.md")]
+
+        assert index.remove([str(new_dir)]) == 2
+        assert index.search("fresh") == []
+        assert len(index) == before
+
+    def test_add_follows_include_hidden(self, fast_fs, tree):
+        index = fast_fs.FilenameIndex.build(str(tree))
+        new_dir = tree / "added"
+        (new_dir / ".cache").mkdir(parents=True)
+        (new_dir / ".cache" / "fresh.md").write_text("")
+        (new_dir / ".fresh.md").write_text("")
+
+        # 构建时不含隐藏条目：增量加入同样跳过
+        assert index.add([str(new_dir), str(tree / ".hidden")]) == 1
+        assert index.search("fresh") == []
+
+        hidden = fast_fs.FilenameIndex.build(str(tree), include_hidden=True)
+        assert hidden.add([str(new_dir)]) == 4
+        assert len(hidden.search("fresh")) == 2
+
+    def test_fuzzy(self, fast_fs, tree):
+        index = fast_fs.FilenameIndex.build(str(tree))
+
+        results = index.fuzzy("file10")
+
+        assert str(tree / "file10.txt") in [r["path"] for r in results[:3]]
+        top = results[0]
+        assert len(top["positions"]) == len("file10")
+        assert [top["path"][i].lower() for i in top["positions"]] == list("file10")
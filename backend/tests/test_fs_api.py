@@ -0,0 +1,140 @@
+"""
+/api/fs 接口：路径范围、符号链接与禁止路径的处理
+
+使用 fast_fs 扩展或 Python 降级实现均可运行（取决于扩展是否已编译）。
+"""
+
+import os
+
+import pytest
+from fastapi.testclient import TestClient
+
+from app.api import fs as fs_api
+from app.core.config import settings
+from app.core.dependencies import get_fast_fs
+from app.services.name_index import NameIndexService
+
+
+@pytest.fixture
+def client(tree, tmp_path, monkeypatch):
+    """ROOT_PATH 指向测试目录树；tree/private 为禁止访问的目录"""
+    (tree / "private").mkdir()
+    (tree / "private" / "huge.bin").write_bytes(b"\0" * 100_000)
+
+    monkeypatch.setattr(settings, "ROOT_PATH", str(tree))
+    monkeypatch.setattr(settings, "ALLOWED_PATHS", [])
+    monkeypatch.setattr(settings, "FORBIDDEN_PATHS", ["/proc", "/sys", "/dev", "/.git", "private"])
+    # 名称索引服务在创建时记录 ROOT_PATH：每个测试用新的实例（未构建索引，走遍历降级）
+    monkeypatch.setattr(fs_api, "get_name_index_service", lambda: NameIndexService(get_fast_fs()))
+
+    from app.main import app
+
+    return TestClient(app)
+
+
+@pytest.fixture
+def outside(tmp_path):
+    """根目录之外的目录"""
+    path = tmp_path / "outside"
+    path.mkdir()
+    (path / "secret.txt").write_text("secret\n")
+    return path
+
+
+def test_list_hides_out_of_scope_link_targets(client, tree, outside):
+    os.symlink(outside, tree / "out")
+    os.symlink(tree / "sub", tree / "inside")
+
+    response = client.get("/api/fs/list", params={"path": str(tree), "follow_symlinks": True})
+
+    assert response.status_code == 200
+    entries = {e["name"]: e for e in response.json()["entries"]}
+    assert entries["out"]["linkTarget"] is None
+    assert entries["out"]["linkBroken"] is None
+    assert entries["inside"]["linkTarget"] == str(tree / "sub")
+    assert entries["inside"]["linkBroken"] is False
+
+
+def test_list_reports_link_size_for_out_of_scope_targets(client, tree, outside):
+    os.symlink(outside, tree / "out")
+
+    response = client.get("/api/fs/list", params={"path": str(tree), "follow_symlinks": True})
+
+    entries = {e["name"]: e for e in response.json()["entries"]}
+    # 不跟随范围外的目标：大小取链接自身的 lstat
+    assert entries["out"]["size"] == os.lstat(tree / "out").st_size
+
+
+def test_list_rejects_paths_outside_root(client, outside):
+    response = client.get("/api/fs/list", params={"path": str(outside)})
+    assert response.status_code == 403
+
+
+def test_hash_batch_does_not_leak_out_of_scope_existence(client, tree, outside):
+    os.symlink(outside / "missing", tree / "broken_out")
+    os.symlink(outside / "secret.txt", tree / "link_out")
+    os.symlink(tree / "missing", tree / "broken_in")
+    paths = [str(tree / n) for n in ("a.txt", "broken_out", "link_out", "broken_in")]
+
+    response = client.post("/api/fs/hash/batch", json={"paths": paths + [str(outside / "secret.txt")]})
+
+    body = response.json()
+    assert list(body["results"]) == ["/a.txt"]
+    scope_error = body["errors"][str(outside / "secret.txt")]
+    # 指向范围外的链接：无论目标是否存在都报告同一个范围错误
+    assert body["errors"][paths[1]] == scope_error
+    assert body["errors"][paths[2]] == scope_error
+    assert body["errors"][paths[3]] != scope_error
+
+
+def test_top_prunes_forbidden_directories(client, tree):
+    response = client.get("/api/fs/top", params={"path": str(tree), "n": 1})
+
+    assert response.status_code == 200
+    assert [item["path"] for item in response.json()["items"]] == ["/sub/deep/d.bin"]
+
+
+def test_find_prunes_forbidden_directories(client, tree):
+    params = {"path": str(tree), "limit": 2, "min_size": 1000, "type": "file"}
+
+    body = client.get("/api/fs/find", params=params).json()
+
+    # 禁止目录中的匹配不占 limit
+    assert sorted(item["path"] for item in body["items"]) == ["/sub/c.log", "/sub/deep/d.bin"]
+
+
+def test_names_scoped_to_directory(client, tree):
+    for i in range(20):
+        (tree / f"log_{i}.txt").write_text("")
+
+    response = client.get("/api/fs/names", params={"q": "log", "path": str(tree / "sub"), "limit": 5})
+
+    assert [item["path"] for item in response.json()["items"]] == ["/sub/c.log"]
+
+
+def test_search_rejects_long_patterns(client, tree):
+    response = client.post("/api/fs/search", json={"path": str(tree), "patterns": ["a" * 1025]})
+    assert response.status_code == 422
+
+
+def test_search_skips_forbidden_directories(client, tree):
+    (tree / "private" / "notes.txt").write_text("hello private\n")
+
+    response = client.post("/api/fs/search", json={"path": str(tree), "patterns": ["hello"]})
+
+    assert response.status_code == 200
+    paths = {m["path"] for m in response.json()["matches"]}
+    assert paths == {"/a.txt", "/b.py"}
+
+
+def test_preview_range_and_batch(client, tree):
+    response = client.get("/api/fs/preview", params={"path": str(tree / "a.txt"), "offset": 6, "length": 5})
+    assert response.content == b"world"
+    assert response.headers["X-Range-Length"] == "5"
+
+    batch = client.post(
+        "/api/fs/preview/batch",
+        json={"paths": [str(tree / "a.txt"), str(tree / "sub/deep/d.bin"), str(tree / "missing")], "length": 5},
+    ).json()
+    assert batch["previews"][str(tree / "a.txt")] == {"binary": False, "text": "hello", "length": 5}
+    assert str(tree / "missing") in batch["errors"]
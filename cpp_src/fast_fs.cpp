@@ -8,7 +8,15 @@
  * 核心功能：
  * 1. scandir_recursive - 递归目录扫描，支持 10 万+ 文件
  * 2. calculate_blake3 - BLAKE3 并行哈希计算
- * 3. fs_watch - 文件系统变更监听 (TODO)
+ * 3. copy_file - 稀疏文件感知的文件复制（保留空洞）
+ * 4. search_content - 多线程多模式内容搜索
+ * 5. read_lines - 基于稀疏行索引的大文件随机行读取
+ * 6. tail_read - 基于 inotify 的共享实时跟踪（tail -f）
+ * 7. read_range / read_heads - pread 到池化缓冲区的范围读取（只读 memoryview）
+ * 8. find - 编译谓词查询，在遍历线程中求值并剪枝
+ * 9. top_files - 最大 / 最近修改的 N 个文件（每线程有界堆）
+ * 10. FilenameIndex - 持久化三元组文件名索引（子串 / glob / 模糊路径查询）
+ * 11. fs_watch - 文件系统变更监听 (TODO)
  *
  * @author FluxFile Team
  * @date 2026-02-05
@@ -18,13 +26,65 @@
 #include <pybind11/stl.h> // 自动转换 STL 容器到 Python 对象
 
 #include <filesystem>
-#include <fstream>
 #include <vector>
 #include <string>
 #include <chrono>
 #include <stdexcept>
 #include <cstring>
+#include <cerrno>
 #include <thread>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <cctype>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <queue>
+#include <regex>
+#include <limits>
+#include <sstream>
+#include <cstdio>
+#include <charconv>
+#include <cmath>
+#include <ctime>
+#include <optional>
+#include <type_traits>
+
+// POSIX 文件 IO（pread / lseek SEEK_DATA/SEEK_HOLE / copy_file_range）
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <pwd.h>
+#include <grp.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <fnmatch.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h> // AVX2 换行统计
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h> // SIMD 字节比较（内容搜索预过滤）
+#endif
+
+#ifdef __linux__
+#include <sys/sysmacros.h> // makedev / major / minor
+#include <sys/vfs.h>        // statfs（文件系统类型魔数）
+#include <sys/inotify.h>   // 实时跟踪（tail -f）
+#include <sys/syscall.h>   // ioprio_set / ioprio_get（后台任务的 I/O 调度类）
+#include <sys/ioctl.h>
+#include <linux/fs.h>      // FS_IOC_FIEMAP
+#include <linux/fiemap.h>  // 数据块的物理位置（机械盘上按物理顺序读取）
+#include <sys/xattr.h>     // 扩展属性（copy_file 与 shutil.copy2 一致地复制）
+#endif
 
 // BLAKE3 头文件 (需要添加到 third_party/)
 // 这里使用 BLAKE3 的 C 实现
@@ -50,8 +110,23 @@ struct FileInfo
     std::string name;  // 文件名
     uint64_t size;     // 文件大小 (bytes)
     double mtime;      // 修改时间 (Unix timestamp)
+    int64_t mtime_ns = 0; // 修改时间（纳秒，Arrow 导出用）
     bool is_directory; // 是否为目录
     bool is_symlink;   // 是否为符号链接
+    uint32_t uid = 0;  // 属主 uid
+    uint32_t gid = 0;  // 属组 gid
+    std::string owner; // 属主名（仅 include_owner 时填充）
+    std::string group; // 属组名（仅 include_owner 时填充）
+
+    // 符号链接解析结果（仅 follow_symlinks 时填充）
+    bool link_resolved = false;
+    std::string link_target; // readlink 原文
+    bool link_broken = false; // 目标不存在或不可访问
+    bool link_cycle = false;  // 指向已访问过的目录，未进入
+
+    // 未进入的挂载点（one_file_system / skip_fs_types）
+    bool mount_skipped = false;
+    std::string fstype;
 
     // 转换为 Python 字典
     py::dict to_dict() const
@@ -63,6 +138,24 @@ struct FileInfo
         d["mtime"] = mtime;
         d["is_directory"] = is_directory;
         d["is_symlink"] = is_symlink;
+        d["uid"] = uid;
+        d["gid"] = gid;
+        if (!owner.empty())
+        {
+            d["owner"] = owner;
+            d["group"] = group;
+        }
+        if (link_resolved)
+        {
+            d["link_target"] = link_target;
+            d["link_broken"] = link_broken;
+            d["link_cycle"] = link_cycle;
+        }
+        if (mount_skipped)
+        {
+            d["mount_skipped"] = true;
+            d["fstype"] = fstype;
+        }
         return d;
     }
 };
@@ -85,272 +178,390 @@ struct FileInfo
  */
 
 // ============================================================================
-// 核心函数实现
+// I/O 优先级（交互 / 后台）
 // ============================================================================
 
+static inline uint64_t monotonic_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
 /**
- * @brief 递归扫描目录，返回所有文件信息
+ * @brief 操作的优先级类别
  *
- * 使用 C++17 std::filesystem 进行高性能目录遍历。
- *
- * 内存安全策略：
- * - 使用 std::vector 自动管理内存
- * - 异常安全：使用 RAII 和智能指针
- * - 路径字符串使用 UTF-8 编码
- *
- * GIL 释放策略：
- * - 在目录遍历期间释放 GIL，允许其他 Python 线程执行
- * - 返回结果前重新获取 GIL（由 pybind11 自动处理）
- *
- * @param root_path 要扫描的根目录路径
- * @param max_depth 最大递归深度 (0 = 无限制)
- * @param include_hidden 是否包含隐藏文件
- * @return Python 列表，包含所有文件信息字典
- * @throws std::runtime_error 如果路径不存在或无权限访问
+ * - Interactive：用户正在等待的操作（目录浏览、搜索），默认
+ * - Background：批量任务（批量哈希、索引构建）。工作线程的 I/O 调度类设为
+ *   IOPRIO_CLASS_IDLE，在设备槽位上让交互操作先行，并在数据块 / 目录之间
+ *   让出给正在进行的交互操作
  */
-py::list scandir_recursive(
-    const std::string &root_path,
-    int max_depth = 0,
-    bool include_hidden = false)
+enum class IoPriority
 {
-    // 首先验证路径（在持有 GIL 时进行，以便抛出 Python 异常）
-    fs::path root(root_path);
-    if (!fs::exists(root))
-    {
-        throw std::runtime_error("Path does not exist: " + root_path);
-    }
-    if (!fs::is_directory(root))
+    Interactive,
+    Background
+};
+
+static IoPriority parse_io_priority(const std::string &value)
+{
+    if (value.empty() || value == "interactive")
+        return IoPriority::Interactive;
+    if (value == "background")
+        return IoPriority::Background;
+    throw std::invalid_argument("priority must be 'interactive' or 'background'");
+}
+
+static thread_local IoPriority t_io_priority = IoPriority::Interactive;
+
+/**
+ * @brief 正在进行的交互操作计数；后台线程在让出点等待其归零
+ */
+struct InteractiveGate
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<int> active{0};
+
+    static InteractiveGate &instance()
     {
-        throw std::runtime_error("Path is not a directory: " + root_path);
+        static InteractiveGate gate;
+        return gate;
     }
+};
 
-    // 存储结果的容器（在 C++ 堆上分配）
-    std::vector<FileInfo> results;
-    results.reserve(10000); // 预分配空间，减少重新分配
+/**
+ * @brief 当前线程的优先级
+ */
+static inline IoPriority current_io_priority()
+{
+    return t_io_priority;
+}
 
-    // 错误信息收集（用于记录无法访问的路径）
-    std::vector<std::string> errors;
+/**
+ * @brief 后台任务的让出点（数据块 / 目录之间调用）
+ *
+ * 当前线程为后台优先级且有交互操作进行时等待其结束，
+ * 单次最多等待 kMaxYieldMs，持续的交互负载下后台任务仍能缓慢推进。
+ */
+static void io_yield_point()
+{
+    static constexpr int kMaxYieldMs = 50;
+    if (t_io_priority != IoPriority::Background)
+        return;
+    InteractiveGate &gate = InteractiveGate::instance();
+    if (gate.active.load(std::memory_order_relaxed) == 0)
+        return;
+    std::unique_lock<std::mutex> lock(gate.mutex);
+    gate.cv.wait_for(lock, std::chrono::milliseconds(kMaxYieldMs),
+                     [&] { return gate.active.load() == 0; });
+}
 
-    // ========================================================================
-    // 关键：释放 GIL 进行耗时的目录遍历操作
-    // ========================================================================
+/**
+ * @brief 在当前线程上设置操作优先级（RAII，析构时恢复）
+ *
+ * 顶层入口以 count_interactive=true 创建，交互操作计入 InteractiveGate；
+ * parallel_for / parallel_walk 的工作线程以 false 继承调用线程的优先级。
+ * 后台优先级在 Linux 上通过 ioprio_set 把本线程设为 IOPRIO_CLASS_IDLE，
+ * 析构时恢复原值（Python 线程池的线程会被复用）。
+ */
+class IoPriorityScope
+{
+public:
+    explicit IoPriorityScope(IoPriority priority, bool count_interactive = true)
+        : previous_(t_io_priority),
+          counted_(count_interactive && priority == IoPriority::Interactive)
     {
-        // RAII: 构造时释放 GIL，析构时自动重新获取
-        py::gil_scoped_release release;
-
-        try
+        t_io_priority = priority;
+        if (counted_)
+            InteractiveGate::instance().active.fetch_add(1);
+#ifdef __linux__
+        if (priority == IoPriority::Background && previous_ != IoPriority::Background)
         {
-            // 使用递归目录迭代器
-            // std::filesystem::directory_options::skip_permission_denied
-            // 可以跳过无权限的目录而不抛出异常
-            auto options = fs::directory_options::skip_permission_denied;
+            saved_ioprio_ = static_cast<int>(::syscall(SYS_ioprio_get, kIoprioWhoProcess, 0));
+            ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioIdle);
+        }
+#endif
+    }
 
-            for (auto it = fs::recursive_directory_iterator(root, options);
-                 it != fs::recursive_directory_iterator();
-                 ++it)
+    ~IoPriorityScope()
+    {
+        if (counted_)
+        {
+            InteractiveGate &gate = InteractiveGate::instance();
+            if (gate.active.fetch_sub(1) == 1)
             {
+                std::lock_guard<std::mutex> lock(gate.mutex);
+                gate.cv.notify_all();
+            }
+        }
+#ifdef __linux__
+        if (saved_ioprio_ >= 0)
+            ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, saved_ioprio_);
+#endif
+        t_io_priority = previous_;
+    }
 
-                try
-                {
-                    const auto &entry = *it;
-                    const auto &path = entry.path();
+    IoPriorityScope(const IoPriorityScope &) = delete;
+    IoPriorityScope &operator=(const IoPriorityScope &) = delete;
 
-                    // 检查递归深度
-                    if (max_depth > 0 && it.depth() >= max_depth)
-                    {
-                        it.disable_recursion_pending(); // 不再深入此目录
-                        continue;
-                    }
+private:
+#ifdef __linux__
+    // <linux/ioprio.h> 并非所有发行版的头文件都提供，这里直接使用 ABI 常量
+    static constexpr int kIoprioWhoProcess = 1; // IOPRIO_WHO_PROCESS（who=0 即当前线程）
+    static constexpr int kIoprioIdle = 3 << 13; // IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0)
+#endif
+    IoPriority previous_;
+    bool counted_;
+    int saved_ioprio_ = -1;
+};
 
-                    // 检查是否为隐藏文件 (以 . 开头)
-                    std::string filename = path.filename().string();
-                    if (!include_hidden && !filename.empty() && filename[0] == '.')
-                    {
-                        if (entry.is_directory())
-                        {
-                            it.disable_recursion_pending(); // 跳过隐藏目录
-                        }
-                        continue;
-                    }
+// ============================================================================
+// 令牌桶限速
+// ============================================================================
 
-                    // 收集文件信息
-                    FileInfo info;
-                    info.path = path.string();
-                    info.name = filename;
-                    info.is_symlink = entry.is_symlink();
+/**
+ * @brief 字节 / 操作数双令牌桶，可附加到任意批量任务上限制其带宽与 IOPS
+ *
+ * 采用预约（透支）方式：领取令牌时直接扣减，余额为负则按当前速率
+ * 计算需要等待的时长，因此一次大于桶容量的读取也能通过，长期速率不变。
+ * 速率可在任务运行期间调整，正在等待的线程会在 100ms 内察觉并按新速率继续。
+ * 空闲时桶内最多积累 burst_seconds 秒的令牌。
+ */
+class RateLimiter
+{
+public:
+    struct Stats
+    {
+        uint64_t bytes;
+        uint64_t ops;
+        uint64_t elapsed_ns;   // 第一次领取至今
+        uint64_t throttled_ns; // 各线程累计等待时长
+        uint64_t waits;
+    };
 
-                    // 对于符号链接，获取链接本身的信息而非目标
-                    if (info.is_symlink)
-                    {
-                        info.is_directory = entry.is_directory();
-                        // 符号链接大小为 0（或获取链接目标大小）
-                        info.size = 0;
-                    }
-                    else
-                    {
-                        info.is_directory = entry.is_directory();
-                        info.size = info.is_directory ? 0 : entry.file_size();
-                    }
+    RateLimiter(double bytes_per_sec, double iops, double burst_seconds)
+    {
+        if (burst_seconds <= 0)
+            throw std::invalid_argument("burst_seconds must be positive");
+        burst_seconds_ = burst_seconds;
+        set_rates(bytes_per_sec, iops);
+    }
 
-                    // 获取修改时间
-                    auto ftime = entry.last_write_time();
-                    // 转换为 Unix 时间戳 - 同时捕获两个时钟以减小竞态误差
-                    auto file_clock_now = fs::file_time_type::clock::now();
-                    auto sys_clock_now = std::chrono::system_clock::now();
-                    auto sctp = std::chrono::time_point_cast<std::chrono::seconds>(
-                        sys_clock_now + (ftime - file_clock_now));
-                    info.mtime = static_cast<double>(sctp.time_since_epoch().count());
+    /**
+     * @brief 调整速率（<= 0 表示不限制）
+     */
+    void set_rates(double bytes_per_sec, double iops)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint64_t now = monotonic_ns();
+        reset_bucket(bytes_, bytes_per_sec, now);
+        reset_bucket(ops_, iops, now);
+        generation_ += 1;
+    }
 
-                    results.push_back(std::move(info));
-                }
-                catch (const fs::filesystem_error &e)
-                {
-                    // 记录错误但继续扫描
-                    errors.push_back(e.what());
-                }
-            }
+    double bytes_per_sec() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytes_.rate;
+    }
+
+    double iops() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return ops_.rate;
+    }
+
+    /**
+     * @brief 预约 bytes 字节与 ops 次操作，返回应等待的纳秒数（不阻塞）
+     */
+    uint64_t reserve(uint64_t bytes, uint64_t ops)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint64_t now = monotonic_ns();
+        if (start_ns_ == 0)
+            start_ns_ = now;
+        total_bytes_ += bytes;
+        total_ops_ += ops;
+        return std::max(take(bytes_, static_cast<double>(bytes), now),
+                        take(ops_, static_cast<double>(ops), now));
+    }
+
+    /**
+     * @brief 等待 reserve 返回的时长（调用方已释放 GIL 且不持有设备槽位）
+     *
+     * 以不超过 100ms 的片段睡眠；期间速率被调整时提前结束，
+     * 之后的预约按新速率计算。
+     */
+    void wait(uint64_t wait_ns)
+    {
+        if (wait_ns == 0)
+            return;
+        uint64_t generation;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            generation = generation_;
+            waits_ += 1;
         }
-        catch (const fs::filesystem_error &e)
+        const uint64_t start = monotonic_ns();
+        const uint64_t deadline = start + wait_ns;
+        while (true)
         {
-            // 严重错误，需要在重新获取 GIL 后抛出
-            // 注意：这里我们在 GIL 释放期间，需要先存储错误信息
-            errors.push_back(std::string("Fatal error: ") + e.what());
+            const uint64_t now = monotonic_ns();
+            if (now >= deadline)
+                break;
+            std::this_thread::sleep_for(
+                std::chrono::nanoseconds(std::min<uint64_t>(deadline - now, 100000000)));
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (generation_ != generation)
+                break;
         }
+        std::lock_guard<std::mutex> lock(mutex_);
+        throttled_ns_ += monotonic_ns() - start;
     }
-    // GIL 已自动重新获取（RAII）
 
-    // 检查是否有致命错误
-    for (const auto &err : errors)
+    Stats stats() const
     {
-        if (err.find("Fatal error:") == 0)
-        {
-            throw std::runtime_error(err);
-        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        return {total_bytes_, total_ops_, start_ns_ ? monotonic_ns() - start_ns_ : 0,
+                throttled_ns_, waits_};
     }
 
-    // 转换结果为 Python 列表
-    py::list py_results;
-    for (const auto &info : results)
+    void reset_stats()
     {
-        py_results.append(info.to_dict());
+        std::lock_guard<std::mutex> lock(mutex_);
+        total_bytes_ = total_ops_ = throttled_ns_ = waits_ = 0;
+        start_ns_ = 0;
     }
 
-    return py_results;
-}
+private:
+    struct Bucket
+    {
+        double rate = 0;     // 每秒令牌数，0 = 不限制
+        double capacity = 0; // 空闲时的积累上限
+        double tokens = 0;   // 可为负（透支）
+        uint64_t last_ns = 0;
+    };
 
-/**
- * @brief 计算文件的 BLAKE3 哈希值
- *
- * BLAKE3 是一种现代加密哈希算法，具有以下优势：
- * - 比 SHA-256 快 5-10 倍
- * - 原生支持并行计算
- * - 安全性与 SHA-3 相当
- *
- * 内存安全策略：
- * - 使用固定大小的栈上缓冲区读取文件
- * - 哈希状态在栈上分配
- * - 文件句柄使用 RAII (ifstream 自动关闭)
- *
- * GIL 释放策略：
- * - 文件读取和哈希计算期间释放 GIL
- * - 这允许其他 Python 线程在等待 IO 时执行
- *
- * @param file_path 要计算哈希的文件路径
- * @param chunk_size 读取缓冲区大小 (默认 1MB)
- * @return 64 字符的十六进制哈希字符串
- * @throws std::runtime_error 如果文件无法打开或读取错误
- */
-std::string calculate_blake3(
-    const std::string &file_path,
-    size_t chunk_size = 1024 * 1024 // 1MB 缓冲区
-)
-{
-    // 验证文件存在
-    if (!fs::exists(file_path))
+    void reset_bucket(Bucket &bucket, double rate, uint64_t now)
     {
-        throw std::runtime_error("File does not exist: " + file_path);
+        bucket.rate = rate > 0 ? rate : 0;
+        bucket.capacity = bucket.rate * burst_seconds_;
+        bucket.tokens = std::min(bucket.tokens, bucket.capacity);
+        bucket.last_ns = now;
     }
-    if (!fs::is_regular_file(file_path))
+
+    static uint64_t take(Bucket &bucket, double amount, uint64_t now)
     {
-        throw std::runtime_error("Path is not a regular file: " + file_path);
+        if (bucket.rate <= 0 || amount <= 0)
+            return 0;
+        bucket.tokens = std::min(bucket.capacity,
+                                 bucket.tokens + bucket.rate * static_cast<double>(now - bucket.last_ns) / 1e9);
+        bucket.last_ns = now;
+        bucket.tokens -= amount;
+        if (bucket.tokens >= 0)
+            return 0;
+        return static_cast<uint64_t>(-bucket.tokens / bucket.rate * 1e9);
     }
 
-    // 分配读取缓冲区（使用 unique_ptr 确保内存安全）
-    std::unique_ptr<uint8_t[]> buffer(new uint8_t[chunk_size]);
+    mutable std::mutex mutex_;
+    double burst_seconds_ = 1.0;
+    Bucket bytes_;
+    Bucket ops_;
+    uint64_t generation_ = 0;
+    uint64_t start_ns_ = 0;
+    uint64_t total_bytes_ = 0;
+    uint64_t total_ops_ = 0;
+    uint64_t throttled_ns_ = 0;
+    uint64_t waits_ = 0;
+};
 
-    // BLAKE3 输出长度 (32 bytes = 256 bits)
-    uint8_t output[BLAKE3_OUT_LEN];
+static thread_local RateLimiter *t_rate_limiter = nullptr;
 
-    // 结果存储
-    std::string hex_result;
-    hex_result.reserve(BLAKE3_OUT_LEN * 2);
+/**
+ * @brief 当前线程上尚未结算的用量（在检查点统一预约，避免持锁等待）
+ */
+struct PendingCharge
+{
+    uint64_t bytes = 0;
+    uint64_t ops = 0;
+};
+static thread_local PendingCharge t_pending_charge;
 
-    // ========================================================================
-    // 关键：释放 GIL 进行耗时的文件读取和哈希计算
-    // ========================================================================
+/**
+ * @brief 在当前线程上附加限速器（RAII，析构时恢复）
+ *
+ * 与 IoPriorityScope 一样，parallel_for / parallel_walk 的工作线程继承调用线程的限速器。
+ */
+class RateLimitScope
+{
+public:
+    explicit RateLimitScope(RateLimiter *limiter) : previous_(t_rate_limiter)
     {
-        py::gil_scoped_release release;
-
-        // 初始化 BLAKE3 hasher（栈上分配）
-        blake3_hasher hasher;
-        blake3_hasher_init(&hasher);
-
-        // 打开文件进行二进制读取
-        std::ifstream file(file_path, std::ios::binary);
-        if (!file.is_open())
-        {
-            // 注意：我们需要在重新获取 GIL 后抛出异常
-            // 但这里直接抛出也是安全的，因为 pybind11 会处理
-            throw std::runtime_error("Cannot open file: " + file_path);
-        }
+        t_rate_limiter = limiter;
+    }
+    ~RateLimitScope()
+    {
+        t_rate_limiter = previous_;
+        if (!previous_)
+            t_pending_charge = PendingCharge();
+    }
 
-        // 循环读取文件并更新哈希
-        while (file)
-        {
-            file.read(reinterpret_cast<char *>(buffer.get()), chunk_size);
-            std::streamsize bytes_read = file.gcount();
+    RateLimitScope(const RateLimitScope &) = delete;
+    RateLimitScope &operator=(const RateLimitScope &) = delete;
 
-            if (bytes_read > 0)
-            {
-                // 更新哈希状态
-                blake3_hasher_update(&hasher, buffer.get(), static_cast<size_t>(bytes_read));
-            }
-        }
+private:
+    RateLimiter *previous_;
+};
 
-        // 检查是否因为错误而停止（而非 EOF）
-        if (file.bad())
-        {
-            throw std::runtime_error("Error reading file: " + file_path);
-        }
+static inline RateLimiter *current_rate_limiter()
+{
+    return t_rate_limiter;
+}
 
-        // 完成哈希计算
-        blake3_hasher_finalize(&hasher, output, BLAKE3_OUT_LEN);
+/**
+ * @brief 记录用量（不阻塞，可在持有设备槽位时调用），在下一个检查点结算
+ */
+static inline void io_charge(uint64_t bytes, uint64_t ops)
+{
+    if (!t_rate_limiter)
+        return;
+    t_pending_charge.bytes += bytes;
+    t_pending_charge.ops += ops;
+}
 
-        // 转换为十六进制字符串
-        static const char hex_chars[] = "0123456789abcdef";
-        for (size_t i = 0; i < BLAKE3_OUT_LEN; ++i)
-        {
-            hex_result.push_back(hex_chars[(output[i] >> 4) & 0x0F]);
-            hex_result.push_back(hex_chars[output[i] & 0x0F]);
-        }
-    }
-    // GIL 已自动重新获取
+/**
+ * @brief 预约当前线程未结算的用量，返回应等待的纳秒数
+ */
+static uint64_t io_reserve_pending()
+{
+    if (!t_rate_limiter || (t_pending_charge.bytes == 0 && t_pending_charge.ops == 0))
+        return 0;
+    const uint64_t wait = t_rate_limiter->reserve(t_pending_charge.bytes, t_pending_charge.ops);
+    t_pending_charge = PendingCharge();
+    return wait;
+}
 
-    return hex_result;
+/**
+ * @brief 批量任务的检查点：后台让出 + 结算限速（调用方不能持有设备槽位）
+ */
+static void io_checkpoint()
+{
+    io_yield_point();
+    if (uint64_t wait = io_reserve_pending())
+        t_rate_limiter->wait(wait);
 }
 
+// ============================================================================
+// 并行执行辅助
+// ============================================================================
+
 /**
- * @brief 批量计算多个文件的 BLAKE3 哈希
- *
- * 使用多线程并行计算多个文件的哈希值。
+ * @brief 解析线程数参数
  *
- * @param file_paths 文件路径列表
- * @param num_threads 线程数 (默认为 CPU 核心数)
- * @return Python 字典，key 为路径，value 为哈希值
+ * @param num_threads 用户指定的线程数，<= 0 表示使用 CPU 核心数
+ * @return 实际使用的线程数（至少为 1）
  */
-py::dict calculate_blake3_batch(
-    const std::vector<std::string> &file_paths,
-    int num_threads = 0)
+static int resolve_thread_count(int num_threads)
 {
     if (num_threads <= 0)
     {
@@ -358,208 +569,9701 @@ py::dict calculate_blake3_batch(
         if (num_threads <= 0)
             num_threads = 4; // 回退默认值
     }
+    return num_threads;
+}
 
-    // 存储结果
-    std::vector<std::pair<std::string, std::string>> results(file_paths.size());
-    std::vector<std::string> errors(file_paths.size());
-
-    // ========================================================================
-    // 释放 GIL 进行多线程哈希计算
-    // ========================================================================
+/**
+ * @brief 在工作线程中并行处理 [0, count) 的每个下标
+ *
+ * 工作线程通过原子计数器领取任务（动态负载均衡），线程数不超过任务数；
+ * 只有一个任务或一个线程时直接在调用线程中执行。
+ * 工作线程继承调用线程的 IoPriority 与 RateLimiter，每个任务之前经过检查点。
+ * body 抛出异常时记录第一个异常，其余线程不再领取新任务，join 后在调用线程重新抛出。
+ *
+ * 注意：调用前必须已经释放 GIL，body 中不能触碰任何 Python 对象。
+ *
+ * @param count 任务数量
+ * @param num_threads 线程数（<= 0 表示 CPU 核心数）
+ * @param body 任务函数，签名 void(size_t index, size_t worker_id)
+ */
+template <typename Body>
+static void parallel_for(size_t count, int num_threads, Body &&body)
+{
+    size_t workers = std::min<size_t>(static_cast<size_t>(resolve_thread_count(num_threads)), count);
+    if (workers <= 1)
     {
-        py::gil_scoped_release release;
-
-        // 使用简单的线程池模式
-        std::vector<std::thread> threads;
-        std::atomic<size_t> next_index{0};
-
-        auto worker = [&]()
+        for (size_t i = 0; i < count; ++i)
         {
-            // 每个线程的缓冲区
-            const size_t chunk_size = 1024 * 1024;
-            std::unique_ptr<uint8_t[]> buffer(new uint8_t[chunk_size]);
-            uint8_t output[BLAKE3_OUT_LEN];
+            io_checkpoint();
+            body(i, 0);
+        }
+        return;
+    }
 
-            while (true)
+    std::atomic<size_t> next_index{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr first_error; // 异常不能逃出线程函数（否则 std::terminate）
+    std::mutex error_mutex;
+    const IoPriority priority = current_io_priority();
+    RateLimiter *limiter = current_rate_limiter();
+    auto worker = [&](size_t worker_id)
+    {
+        // 继承调用线程的优先级与限速器
+        IoPriorityScope scope(priority, false);
+        RateLimitScope limit_scope(limiter);
+        try
+        {
+            while (!failed.load(std::memory_order_relaxed))
             {
                 size_t idx = next_index.fetch_add(1);
-                if (idx >= file_paths.size())
+                if (idx >= count)
                     break;
+                io_checkpoint();
+                body(idx, worker_id);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!first_error)
+                first_error = std::current_exception();
+            failed.store(true);
+        }
+    };
 
-                const auto &path = file_paths[idx];
-
-                try
-                {
-                    blake3_hasher hasher;
-                    blake3_hasher_init(&hasher);
-
-                    std::ifstream file(path, std::ios::binary);
-                    if (!file.is_open())
-                    {
-                        errors[idx] = "Cannot open file";
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (size_t w = 0; w < workers; ++w)
+    {
+        threads.emplace_back(worker, w);
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+    if (first_error)
+        std::rethrow_exception(first_error);
+}
+
+// ============================================================================
+// 元数据 (statx) 辅助
+// ============================================================================
+
+/**
+ * @brief 携带 errno 的文件系统异常
+ *
+ * 通过模块注册的异常转换器映射为 Python OSError(errno, strerror, filename)，
+ * Python 会据此自动实例化 FileNotFoundError / PermissionError 等子类。
+ */
+class FsError : public std::runtime_error
+{
+public:
+    FsError(int code, const std::string &path)
+        : std::runtime_error(std::strerror(code)), code_(code), path_(path) {}
+
+    int code() const { return code_; }
+    const std::string &path() const { return path_; }
+
+private:
+    int code_;
+    std::string path_;
+};
+
+/**
+ * @struct FileStat
+ * @brief 平台无关的 stat 结果
+ *
+ * Linux 上由 statx 填充（可获得 btime），其他平台退回 fstatat。
+ * 时间戳统一为纳秒精度的 Unix 时间。
+ */
+struct FileStat
+{
+    uint32_t mode = 0;
+    uint32_t uid = 0;
+    uint32_t gid = 0;
+    uint64_t ino = 0;
+    uint64_t dev = 0;
+    uint64_t nlink = 0;
+    uint64_t size = 0;
+    uint64_t blocks = 0; // 512 字节块数
+    int64_t atime_ns = 0;
+    int64_t mtime_ns = 0;
+    int64_t ctime_ns = 0;
+    int64_t btime_ns = 0;
+    bool has_btime = false;
+};
+
+static inline int64_t timespec_to_ns(int64_t sec, int64_t nsec)
+{
+    return sec * 1000000000LL + nsec;
+}
+
+static void fill_from_stat(const struct stat &st, FileStat &out)
+{
+    out.mode = static_cast<uint32_t>(st.st_mode);
+    out.uid = static_cast<uint32_t>(st.st_uid);
+    out.gid = static_cast<uint32_t>(st.st_gid);
+    out.ino = static_cast<uint64_t>(st.st_ino);
+    out.dev = static_cast<uint64_t>(st.st_dev);
+    out.nlink = static_cast<uint64_t>(st.st_nlink);
+    out.size = static_cast<uint64_t>(st.st_size);
+    out.blocks = static_cast<uint64_t>(st.st_blocks);
+#ifdef __APPLE__
+    out.atime_ns = timespec_to_ns(st.st_atimespec.tv_sec, st.st_atimespec.tv_nsec);
+    out.mtime_ns = timespec_to_ns(st.st_mtimespec.tv_sec, st.st_mtimespec.tv_nsec);
+    out.ctime_ns = timespec_to_ns(st.st_ctimespec.tv_sec, st.st_ctimespec.tv_nsec);
+    out.btime_ns = timespec_to_ns(st.st_birthtimespec.tv_sec, st.st_birthtimespec.tv_nsec);
+    out.has_btime = true;
+#else
+    out.atime_ns = timespec_to_ns(st.st_atim.tv_sec, st.st_atim.tv_nsec);
+    out.mtime_ns = timespec_to_ns(st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+    out.ctime_ns = timespec_to_ns(st.st_ctim.tv_sec, st.st_ctim.tv_nsec);
+    out.has_btime = false;
+#endif
+}
+
+/**
+ * @brief 单次系统调用获取文件元数据
+ *
+ * Linux 上使用 statx，并只请求 mask 中的字段（网络文件系统上可以少取属性）；
+ * 内核不支持 statx 时退回 fstatat。
+ *
+ * @param dirfd 相对路径的基准目录（AT_FDCWD 表示当前目录）
+ * @param path 文件路径
+ * @param follow_symlinks 是否跟随符号链接
+ * @param out 输出结果
+ * @param mask statx 字段掩码（非 Linux 平台忽略）
+ * @return 成功返回 0，失败返回 errno
+ */
+static int stat_path(int dirfd, const char *path, bool follow_symlinks, FileStat &out,
+                     unsigned int mask = 0)
+{
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+    static std::atomic<bool> statx_unsupported{false};
+    if (!statx_unsupported.load(std::memory_order_relaxed))
+    {
+        struct statx stx;
+        int flags = AT_STATX_SYNC_AS_STAT | (follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW);
+        if (mask == 0)
+            mask = STATX_BASIC_STATS | STATX_BTIME;
+        if (::statx(dirfd, path, flags, mask, &stx) == 0)
+        {
+            out.mode = stx.stx_mode;
+            out.uid = stx.stx_uid;
+            out.gid = stx.stx_gid;
+            out.ino = stx.stx_ino;
+            out.dev = static_cast<uint64_t>(makedev(stx.stx_dev_major, stx.stx_dev_minor));
+            out.nlink = stx.stx_nlink;
+            out.size = stx.stx_size;
+            out.blocks = stx.stx_blocks;
+            out.atime_ns = timespec_to_ns(stx.stx_atime.tv_sec, stx.stx_atime.tv_nsec);
+            out.mtime_ns = timespec_to_ns(stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec);
+            out.ctime_ns = timespec_to_ns(stx.stx_ctime.tv_sec, stx.stx_ctime.tv_nsec);
+            out.has_btime = (stx.stx_mask & STATX_BTIME) != 0;
+            out.btime_ns = out.has_btime
+                               ? timespec_to_ns(stx.stx_btime.tv_sec, stx.stx_btime.tv_nsec)
+                               : 0;
+            return 0;
+        }
+        if (errno != ENOSYS)
+            return errno;
+        statx_unsupported.store(true, std::memory_order_relaxed);
+    }
+#else
+    (void)mask;
+#endif
+
+    struct stat st;
+    if (::fstatat(dirfd, path, &st, follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW) != 0)
+        return errno;
+    fill_from_stat(st, out);
+    return 0;
+}
+
+/**
+ * @brief 读取符号链接目标（readlinkat，按需扩大缓冲区）
+ * @return 成功返回 0，失败返回 errno
+ */
+static int read_link(int dirfd, const char *path, std::string &target)
+{
+    std::vector<char> buffer(256);
+    while (true)
+    {
+        ssize_t n = ::readlinkat(dirfd, path, buffer.data(), buffer.size());
+        if (n < 0)
+            return errno;
+        if (static_cast<size_t>(n) < buffer.size())
+        {
+            target.assign(buffer.data(), static_cast<size_t>(n));
+            return 0;
+        }
+        buffer.resize(buffer.size() * 2);
+    }
+}
+
+/** @brief (st_dev, st_ino) 二元组的哈希，用于已访问目录集合 */
+struct DevInoHash
+{
+    size_t operator()(const std::pair<uint64_t, uint64_t> &key) const
+    {
+        return std::hash<uint64_t>()(key.first * 0x9E3779B97F4A7C15ULL ^ key.second);
+    }
+};
+
+/**
+ * @brief 将 st_mode 的文件类型转换为字符串
+ */
+static const char *file_type_name(uint32_t mode)
+{
+    switch (mode & S_IFMT)
+    {
+    case S_IFREG:
+        return "file";
+    case S_IFDIR:
+        return "directory";
+    case S_IFLNK:
+        return "symlink";
+    case S_IFBLK:
+        return "block";
+    case S_IFCHR:
+        return "char";
+    case S_IFIFO:
+        return "fifo";
+    case S_IFSOCK:
+        return "socket";
+    default:
+        return "unknown";
+    }
+}
+
+// ============================================================================
+// 按设备的 I/O 并发调控
+// ============================================================================
+
+/**
+ * @brief 按 st_dev 限制同时在途的 I/O 操作数，并依据延迟自适应调整上限
+ *
+ * 批量任务的工作线程在每次 I/O 前领取所在设备的槽位，槽位用尽时等待，
+ * 因此几百个线程也不会同时压向同一个 NFS / SMB 挂载。
+ * 每个设备维护一个延迟样本窗口（类似 TCP 拥塞控制）：
+ * - 上限从 kInitialLimit 起步，槽位用尽且延迟平稳时翻倍（慢启动），
+ *   首次回退后改为每个窗口加 1，均不超过 default_limit
+ * - 窗口 p99 超过基线 p99 的 backoff_ratio 倍（且至少高出 kNoiseFloorNs）时
+ *   上限乘以 3/4，不低于 min_limit
+ * 基线取历史窗口 p99 的最小值并缓慢上移，以跟随设备负载的长期变化。
+ * 慢启动保证基线在低并发下测得：若一开始就满并发，过载时的延迟会被当作基线。
+ *
+ * 只调控网络 / FUSE 文件系统上的设备（按 /proc/self/mountinfo 中的类型判断）：
+ * 本地块设备已由内核块层排队，从 4 个并发慢启动只会压低 NVMe 的队列深度，
+ * 因此本地设备不领取槽位、不受上限约束（set_limit 固定上限的设备除外）。
+ * default_limit <= 0 时完全关闭调控。
+ */
+class IoGovernor
+{
+    struct Device;
+
+public:
+    struct Config
+    {
+        int default_limit = 32;     // 新设备的初始上限，也是自适应增长的上限
+        int min_limit = 1;          // 自适应回退的下限
+        bool adaptive = true;       // 是否依据延迟调整
+        double backoff_ratio = 2.0; // p99 超过基线多少倍时回退
+    };
+
+    struct DeviceStats
+    {
+        uint64_t dev;
+        int limit;
+        int in_flight;
+        bool governed; // 网络 / FUSE 设备或已固定上限：领取槽位
+        bool pinned;   // 上限由 set_limit 固定，不参与自适应
+        uint64_t ops;
+        uint64_t background_ops;
+        uint64_t waits;
+        uint64_t wait_ns;
+        uint64_t p99_ns;
+        uint64_t baseline_p99_ns;
+        uint64_t backoffs;
+    };
+
+    /**
+     * @brief 设备槽位（RAII），析构时归还并提交延迟样本
+     *
+     * 调用方可用 record() 记录具体操作的延迟（样本取均值），
+     * 未记录时以持有时长作为样本。
+     */
+    class Slot
+    {
+    public:
+        Slot() = default;
+        Slot(const Slot &) = delete;
+        Slot &operator=(const Slot &) = delete;
+        Slot(Slot &&other) noexcept
+            : governor_(other.governor_), device_(other.device_), start_ns_(other.start_ns_),
+              op_ns_(other.op_ns_), op_count_(other.op_count_)
+        {
+            other.device_ = nullptr;
+        }
+        Slot &operator=(Slot &&other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                governor_ = other.governor_;
+                device_ = other.device_;
+                start_ns_ = other.start_ns_;
+                op_ns_ = other.op_ns_;
+                op_count_ = other.op_count_;
+                other.device_ = nullptr;
+            }
+            return *this;
+        }
+        ~Slot() { release(); }
+
+        bool active() const { return device_ != nullptr; }
+
+        /**
+         * @brief 持有槽位时的检查点（见 io_checkpoint）
+         *
+         * 需要让出给交互操作或等待限速时先归还槽位，之后重新领取，
+         * 被限速的任务不会占着设备槽位睡眠。
+         */
+        void checkpoint();
+
+        void record(uint64_t latency_ns)
+        {
+            op_ns_ += latency_ns;
+            op_count_ += 1;
+        }
+
+        void release()
+        {
+            if (!device_)
+                return;
+            uint64_t sample = op_count_ > 0 ? op_ns_ / op_count_ : monotonic_ns() - start_ns_;
+            governor_->release(*device_, sample);
+            device_ = nullptr;
+        }
+
+    private:
+        friend class IoGovernor;
+        Slot(IoGovernor *governor, Device *device)
+            : governor_(governor), device_(device), start_ns_(monotonic_ns()) {}
+
+        IoGovernor *governor_ = nullptr;
+        Device *device_ = nullptr;
+        uint64_t start_ns_ = 0;
+        uint64_t op_ns_ = 0;
+        uint64_t op_count_ = 0;
+    };
+
+    static IoGovernor &instance()
+    {
+        static IoGovernor governor;
+        return governor;
+    }
+
+    /**
+     * @brief 领取设备槽位，槽位用尽时阻塞（调用方已释放 GIL）
+     *
+     * 按当前线程的 IoPriority 排队：有交互操作在等待时后台操作不会领到槽位，
+     * 且后台操作最多占用 limit - 1 个槽位，交互操作总有一个槽位可用。
+     * 调控关闭时返回空槽位。
+     */
+    Slot acquire(uint64_t dev)
+    {
+        Device *device = find_device(dev);
+        if (!device)
+            return Slot();
+
+        const bool background = current_io_priority() == IoPriority::Background;
+        auto can_run = [&]
+        {
+            if (!background)
+                return device->in_flight < device->limit;
+            const int cap = device->limit > 1 ? device->limit - 1 : 1;
+            return device->interactive_waiting == 0 && device->in_flight < cap;
+        };
+
+        std::unique_lock<std::mutex> lock(device->mutex);
+        if (!device->remote && !device->pinned)
+            return Slot();
+        device->ops += 1;
+        if (background)
+            device->background_ops += 1;
+        if (!can_run())
+        {
+            device->saturated = true;
+            device->waits += 1;
+            if (!background)
+                device->interactive_waiting += 1;
+            const uint64_t wait_start = monotonic_ns();
+            device->cv.wait(lock, can_run);
+            device->wait_ns += monotonic_ns() - wait_start;
+            if (!background)
+                device->interactive_waiting -= 1;
+        }
+        device->in_flight += 1;
+        if (device->in_flight >= device->limit)
+            device->saturated = true;
+        return Slot(this, device);
+    }
+
+    void configure(const Config &config)
+    {
+        if (config.min_limit < 1)
+            throw std::invalid_argument("min_limit must be >= 1");
+        if (config.backoff_ratio <= 1.0)
+            throw std::invalid_argument("backoff_ratio must be > 1");
+
+        std::unique_lock<std::shared_mutex> lock(devices_mutex_);
+        config_ = config;
+        for (auto &item : devices_)
+        {
+            Device &device = *item.second;
+            std::lock_guard<std::mutex> device_lock(device.mutex);
+            if (!device.pinned)
+            {
+                device.limit = initial_limit(config_);
+                device.slow_start = true;
+            }
+            device.cv.notify_all();
+        }
+    }
+
+    Config config() const
+    {
+        std::shared_lock<std::shared_mutex> lock(devices_mutex_);
+        return config_;
+    }
+
+    /**
+     * @brief 固定某个设备的上限（limit <= 0 恢复为自适应）
+     */
+    void set_limit(uint64_t dev, int limit)
+    {
+        Device *device = ensure_device(dev);
+        const Config config = this->config();
+        std::lock_guard<std::mutex> lock(device->mutex);
+        device->pinned = limit > 0;
+        device->limit = limit > 0 ? limit : initial_limit(config);
+        device->slow_start = limit <= 0;
+        device->cv.notify_all();
+    }
+
+    std::vector<DeviceStats> stats() const
+    {
+        std::shared_lock<std::shared_mutex> lock(devices_mutex_);
+        std::vector<DeviceStats> out;
+        out.reserve(devices_.size());
+        for (const auto &item : devices_)
+        {
+            const Device &device = *item.second;
+            std::lock_guard<std::mutex> device_lock(device.mutex);
+            out.push_back({device.dev, device.limit, device.in_flight,
+                           device.remote || device.pinned, device.pinned, device.ops,
+                           device.background_ops, device.waits, device.wait_ns, device.last_p99_ns,
+                           device.baseline_p99_ns, device.backoffs});
+        }
+        std::sort(out.begin(), out.end(), [](const DeviceStats &a, const DeviceStats &b)
+                  { return a.dev < b.dev; });
+        return out;
+    }
+
+private:
+    static constexpr size_t kWindow = 128;              // 每个窗口的样本数
+    static constexpr int kInitialLimit = 4;             // 慢启动的初始上限
+    static constexpr uint64_t kNoiseFloorNs = 1000000;  // p99 至少高出基线 1ms 才回退
+
+    struct Device
+    {
+        uint64_t dev = 0;
+        mutable std::mutex mutex;
+        std::condition_variable cv;
+        int limit = 1;
+        int in_flight = 0;
+        bool remote = false;     // 网络 / FUSE 文件系统（创建后不变）
+        bool pinned = false;
+        bool saturated = false;  // 当前窗口内槽位是否曾经用尽
+        bool slow_start = true;  // 尚未回退过：用尽时上限翻倍
+        int interactive_waiting = 0; // 正在等待槽位的交互操作数
+        std::vector<uint64_t> window;
+        uint64_t last_p99_ns = 0;
+        uint64_t baseline_p99_ns = 0;
+        uint64_t ops = 0;
+        uint64_t background_ops = 0;
+        uint64_t waits = 0;
+        uint64_t wait_ns = 0;
+        uint64_t backoffs = 0;
+    };
+
+    IoGovernor() = default;
+
+    static int initial_limit(const Config &config)
+    {
+        const int ceiling = std::max(config.min_limit, config.default_limit);
+        if (!config.adaptive)
+            return ceiling;
+        return std::min(ceiling, std::max(config.min_limit, kInitialLimit));
+    }
+
+    Device *find_device(uint64_t dev)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(devices_mutex_);
+            if (config_.default_limit <= 0)
+                return nullptr;
+            auto it = devices_.find(dev);
+            if (it != devices_.end())
+                return it->second.get();
+        }
+        return ensure_device(dev);
+    }
+
+    /**
+     * @brief 设备上的文件系统是否为网络 / FUSE 类型（读取 /proc/self/mountinfo）
+     *
+     * fuseblk（ntfs-3g 等本地块设备上的 FUSE）视为本地。
+     * 非 Linux 无法判断，一律视为需要调控。
+     */
+    static bool is_remote_device(uint64_t dev)
+    {
+#ifdef __linux__
+        static const std::unordered_set<std::string> kRemoteTypes = {
+            "nfs", "nfs4", "cifs", "smb3", "smbfs", "9p", "ceph", "glusterfs",
+            "afs", "lustre", "gpfs", "beegfs", "davfs", "fuse",
+        };
+        FILE *file = std::fopen("/proc/self/mountinfo", "re");
+        if (!file)
+            return false;
+        const std::string devno = std::to_string(major(dev)) + ":" + std::to_string(minor(dev));
+        bool remote = false;
+        char *line = nullptr;
+        size_t capacity = 0;
+        while (::getline(&line, &capacity, file) > 0)
+        {
+            // 格式：id parent major:minor root mount_point options [optional...] - fstype ...
+            std::istringstream fields(line);
+            std::string id, parent, number, token;
+            fields >> id >> parent >> number;
+            if (number != devno)
+                continue;
+            while (fields >> token && token != "-")
+                ;
+            std::string fstype;
+            fields >> fstype;
+            remote = kRemoteTypes.count(fstype.substr(0, fstype.find('.'))) > 0;
+            break;
+        }
+        std::free(line);
+        std::fclose(file);
+        return remote;
+#else
+        (void)dev;
+        return true;
+#endif
+    }
+
+    Device *ensure_device(uint64_t dev)
+    {
+        std::unique_lock<std::shared_mutex> lock(devices_mutex_);
+        auto &slot = devices_[dev];
+        if (!slot)
+        {
+            slot.reset(new Device());
+            slot->dev = dev;
+            slot->remote = is_remote_device(dev);
+            slot->limit = initial_limit(config_);
+            slot->window.reserve(kWindow);
+        }
+        return slot.get();
+    }
+
+    void release(Device &device, uint64_t sample_ns)
+    {
+        Config config;
+        {
+            std::shared_lock<std::shared_mutex> lock(devices_mutex_);
+            config = config_;
+        }
+
+        std::lock_guard<std::mutex> lock(device.mutex);
+        device.in_flight -= 1;
+        device.window.push_back(sample_ns);
+        if (device.window.size() >= kWindow)
+        {
+            auto p99 = device.window.begin() + (kWindow * 99 + 99) / 100 - 1;
+            std::nth_element(device.window.begin(), p99, device.window.end());
+            device.last_p99_ns = *p99;
+            device.window.clear();
+
+            // 基线：历史最小 p99，缓慢上移（每个窗口 1/32）
+            if (device.baseline_p99_ns == 0 || device.last_p99_ns < device.baseline_p99_ns)
+                device.baseline_p99_ns = device.last_p99_ns;
+            else
+                device.baseline_p99_ns += (device.last_p99_ns - device.baseline_p99_ns) / 32;
+
+            if (config.adaptive && !device.pinned)
+            {
+                const int ceiling = std::max(config.min_limit, config.default_limit);
+                const uint64_t p99 = device.last_p99_ns;
+                const uint64_t baseline = device.baseline_p99_ns;
+                if (p99 > baseline * config.backoff_ratio && p99 > baseline + kNoiseFloorNs)
+                {
+                    device.slow_start = false;
+                    int reduced = std::max(config.min_limit, device.limit * 3 / 4);
+                    if (reduced == device.limit && device.limit > config.min_limit)
+                        reduced -= 1;
+                    if (reduced < device.limit)
+                        device.backoffs += 1;
+                    device.limit = reduced;
+                }
+                else if (device.saturated && device.limit < ceiling)
+                {
+                    device.limit = std::min(ceiling, device.slow_start ? device.limit * 2
+                                                                       : device.limit + 1);
+                }
+            }
+            device.saturated = false;
+        }
+        // 等待者的条件因优先级而异，逐个唤醒可能叫醒一个仍不能运行的后台线程
+        device.cv.notify_all();
+    }
+
+    mutable std::shared_mutex devices_mutex_;
+    Config config_;
+    std::unordered_map<uint64_t, std::unique_ptr<Device>> devices_;
+};
+
+inline void IoGovernor::Slot::checkpoint()
+{
+    const bool yield = current_io_priority() == IoPriority::Background &&
+                       InteractiveGate::instance().active.load(std::memory_order_relaxed) > 0;
+    const uint64_t wait = io_reserve_pending();
+    if (!yield && wait == 0)
+        return;
+
+    IoGovernor *governor = governor_;
+    Device *device = device_;
+    if (device)
+        release();
+    if (yield)
+        io_yield_point();
+    if (wait)
+        current_rate_limiter()->wait(wait);
+    if (device)
+        *this = governor->acquire(device->dev);
+}
+
+/**
+ * @brief 调整 IoGovernor 的全局配置（None 表示保持不变）
+ * @return 调整后的配置
+ */
+py::dict configure_io_governor(const py::object &default_limit, const py::object &min_limit,
+                               const py::object &adaptive, const py::object &backoff_ratio)
+{
+    IoGovernor &governor = IoGovernor::instance();
+    IoGovernor::Config config = governor.config();
+    if (!default_limit.is_none())
+        config.default_limit = default_limit.cast<int>();
+    if (!min_limit.is_none())
+        config.min_limit = min_limit.cast<int>();
+    if (!adaptive.is_none())
+        config.adaptive = adaptive.cast<bool>();
+    if (!backoff_ratio.is_none())
+        config.backoff_ratio = backoff_ratio.cast<double>();
+    governor.configure(config);
+
+    py::dict result;
+    result["default_limit"] = config.default_limit;
+    result["min_limit"] = config.min_limit;
+    result["adaptive"] = config.adaptive;
+    result["backoff_ratio"] = config.backoff_ratio;
+    return result;
+}
+
+/**
+ * @brief 固定 path 所在设备的并发上限（limit <= 0 恢复自适应）
+ */
+void set_device_io_limit(const std::string &path, int limit)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0)
+        throw FsError(errno, path);
+    IoGovernor::instance().set_limit(static_cast<uint64_t>(st.st_dev), limit);
+}
+
+/**
+ * @brief 各设备的调控状态
+ */
+py::list io_governor_stats()
+{
+    py::list result;
+    for (const auto &s : IoGovernor::instance().stats())
+    {
+        py::dict d;
+        d["dev"] = s.dev;
+#ifdef __linux__
+        d["device"] = std::to_string(major(s.dev)) + ":" + std::to_string(minor(s.dev));
+#endif
+        d["limit"] = s.limit;
+        d["in_flight"] = s.in_flight;
+        d["governed"] = s.governed;
+        d["pinned"] = s.pinned;
+        d["ops"] = s.ops;
+        d["background_ops"] = s.background_ops;
+        d["waits"] = s.waits;
+        d["wait_ms"] = static_cast<double>(s.wait_ns) / 1e6;
+        d["p99_ms"] = static_cast<double>(s.p99_ns) / 1e6;
+        d["baseline_p99_ms"] = static_cast<double>(s.baseline_p99_ns) / 1e6;
+        d["backoffs"] = s.backoffs;
+        result.append(d);
+    }
+    return result;
+}
+
+// ============================================================================
+// 设备画像与自动调优
+// ============================================================================
+
+/**
+ * @brief 按设备（st_dev）选择工作线程数与读取缓冲区大小
+ *
+ * 首次遇到某个设备时通过 /sys/dev/block/<maj>:<min> 找到块设备（分区取其父设备），
+ * 读取 queue/rotational、queue/nr_requests 与 slaves/（md / dm 的成员盘）：
+ * - 机械盘：每个成员盘 kRotationalThreads 个线程，避免多个读取流互相寻道
+ * - 固态盘：nr_requests / 4，介于核心数与 4 倍核心数（且不超过 kMaxThreads）之间，
+ *   让 NVMe 上有足够多的读请求在途
+ * - 没有块设备（NFS / overlay / tmpfs / btrfs 等匿名设备）：核心数，
+ *   实际并发交给 IoGovernor 依据延迟调控
+ *
+ * 缓冲区大小由首次使用时的一次简短校准决定：在该设备上第一个不小于
+ * kCalibrationMinSize 的文件里做 kProbeReads 次 4KB 随机读（中位延迟 L）
+ * 和一段 kSequentialBytes 的顺序读（带宽 B），取 L × B × 4 向下对齐到 2 的幂，
+ * 限制在 [kMinBuffer, kMaxBuffer] 内，使每次读取的传输时间约为定位时间的 4 倍。
+ * 校准读取绕过页缓存：优先以 O_DIRECT 重新打开文件，文件系统不支持时
+ * 先对要读的区间 POSIX_FADV_DONTNEED，避免缓存命中把设备测成"零延迟"。
+ * 校准之前使用 kDefaultBuffer。结果按设备缓存，超过 kCalibrationTtlNs 后
+ * 由下一个足够大的文件重新校准（期间继续使用旧结果）；校准按设备加锁，
+ * 不同设备可并行校准。
+ */
+class DeviceTuner
+{
+public:
+    struct Profile
+    {
+        uint64_t dev = 0;
+        std::string block_device;      // 块设备名（如 sda、nvme0n1），无块设备时为空
+        int rotational = -1;           // 1 机械盘 / 0 固态盘 / -1 未知
+        int nr_requests = 0;
+        int members = 1;               // md / dm 的成员盘数
+        int threads = 0;
+        size_t buffer_size = 0;
+        bool calibrated = false;
+        uint64_t calibrated_at_ns = 0; // 校准完成时刻（monotonic_ns）
+        bool direct_io = false;        // 校准是否使用了 O_DIRECT
+        uint64_t probe_latency_ns = 0; // 校准：随机读中位延迟
+        double read_bytes_per_sec = 0; // 校准：顺序读带宽
+    };
+
+    static constexpr uint64_t kCalibrationMinSize = 16ull << 20;
+    static constexpr uint64_t kCalibrationTtlNs = 600ull * 1000000000ull;
+
+    static DeviceTuner &instance()
+    {
+        static DeviceTuner tuner;
+        return tuner;
+    }
+
+    /**
+     * @brief 设备画像（首次调用时读取 sysfs，不校准）
+     */
+    Profile profile(uint64_t dev)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entry(dev);
+    }
+
+    /**
+     * @brief 设备画像；尚未校准（或校准已过期）且 fd 足够大时先用它校准
+     *
+     * 每个设备各有一把校准锁：首次校准时同一设备上并发到达的调用者等待其完成；
+     * 过期后的重新校准只由一个调用者执行，其余调用者直接使用旧结果。
+     */
+    Profile profile(uint64_t dev, int fd, uint64_t size)
+    {
+        std::shared_ptr<std::mutex> device_lock;
+        bool have_result = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const Profile &p = entry(dev);
+            if (fresh(p) || size < kCalibrationMinSize)
+                return p;
+            have_result = p.calibrated;
+            auto &slot = calibrate_locks_[dev];
+            if (!slot)
+                slot = std::make_shared<std::mutex>();
+            device_lock = slot;
+        }
+
+        std::unique_lock<std::mutex> calibrate_lock(*device_lock, std::defer_lock);
+        if (have_result)
+        {
+            if (!calibrate_lock.try_lock())
+                return profile(dev);
+        }
+        else
+        {
+            calibrate_lock.lock();
+        }
+
+        Profile measured;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            measured = entry(dev);
+        }
+        if (!fresh(measured) && calibrate(fd, size, measured))
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            profiles_[dev] = measured;
+        }
+        return measured;
+    }
+
+    struct BatchPlan
+    {
+        int threads = 0;         // 工作线程数
+        bool rotational = false; // 批次中是否有机械盘上的文件
+    };
+
+    /**
+     * @brief 一批路径的执行计划：抽样最多 kSamplePaths 个路径，线程数取各设备的最小值
+     *
+     * 偏向较小值，混合了机械盘的批次不会以固态盘的并发去读机械盘。
+     */
+    BatchPlan plan_for(const std::vector<std::string> &paths)
+    {
+        BatchPlan plan;
+        const size_t step = std::max<size_t>(1, paths.size() / kSamplePaths);
+        for (size_t i = 0; i < paths.size(); i += step)
+        {
+            struct stat st;
+            if (::stat(paths[i].c_str(), &st) != 0)
+                continue;
+            const Profile p = profile(static_cast<uint64_t>(st.st_dev));
+            plan.threads = plan.threads == 0 ? p.threads : std::min(plan.threads, p.threads);
+            plan.rotational = plan.rotational || p.rotational == 1;
+        }
+        if (plan.threads <= 0)
+            plan.threads = resolve_thread_count(0);
+        return plan;
+    }
+
+    std::vector<Profile> profiles() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<Profile> out;
+        out.reserve(profiles_.size());
+        for (const auto &item : profiles_)
+            out.push_back(item.second);
+        std::sort(out.begin(), out.end(), [](const Profile &a, const Profile &b)
+                  { return a.dev < b.dev; });
+        return out;
+    }
+
+private:
+    static constexpr int kRotationalThreads = 2;
+    static constexpr int kMaxThreads = 64;
+    static constexpr size_t kSamplePaths = 16;
+    static constexpr size_t kDefaultBuffer = 1 << 20;
+    static constexpr size_t kMinBuffer = 256 << 10;
+    static constexpr size_t kMaxBuffer = 8 << 20;
+    static constexpr int kProbeReads = 9;
+    static constexpr size_t kProbeBytes = 4096;
+    static constexpr size_t kSequentialBytes = 4 << 20;
+
+    DeviceTuner() = default;
+
+    static bool fresh(const Profile &p)
+    {
+        return p.calibrated && monotonic_ns() - p.calibrated_at_ns < kCalibrationTtlNs;
+    }
+
+    /// 调用方持有 mutex_
+    const Profile &entry(uint64_t dev)
+    {
+        auto it = profiles_.find(dev);
+        if (it == profiles_.end())
+            it = profiles_.emplace(dev, detect(dev)).first;
+        return it->second;
+    }
+
+    static long read_sysfs_long(const std::string &path, long fallback)
+    {
+        FILE *file = std::fopen(path.c_str(), "re");
+        if (!file)
+            return fallback;
+        long value = fallback;
+        if (std::fscanf(file, "%ld", &value) != 1)
+            value = fallback;
+        std::fclose(file);
+        return value;
+    }
+
+    static Profile detect(uint64_t dev)
+    {
+        Profile p;
+        p.dev = dev;
+        p.buffer_size = kDefaultBuffer;
+        const int cores = resolve_thread_count(0);
+        p.threads = cores;
+
+#ifdef __linux__
+        const std::string link = "/sys/dev/block/" + std::to_string(major(dev)) + ":" +
+                                 std::to_string(minor(dev));
+        char *resolved = ::realpath(link.c_str(), nullptr);
+        if (!resolved)
+            return p;
+        std::string dir(resolved);
+        std::free(resolved);
+
+        // 分区没有 queue/，取父目录对应的整盘
+        struct stat st;
+        if (::stat((dir + "/partition").c_str(), &st) == 0)
+            dir = dir.substr(0, dir.rfind('/'));
+
+        p.block_device = dir.substr(dir.rfind('/') + 1);
+        p.rotational = static_cast<int>(read_sysfs_long(dir + "/queue/rotational", -1));
+        p.nr_requests = static_cast<int>(read_sysfs_long(dir + "/queue/nr_requests", 0));
+
+        if (DIR *slaves = ::opendir((dir + "/slaves").c_str()))
+        {
+            int count = 0;
+            while (struct dirent *e = ::readdir(slaves))
+            {
+                if (e->d_name[0] != '.')
+                    ++count;
+            }
+            ::closedir(slaves);
+            p.members = std::max(1, count);
+        }
+
+        if (p.rotational == 1)
+            p.threads = std::min(kMaxThreads, kRotationalThreads * p.members);
+        else if (p.rotational == 0 && p.nr_requests > 0)
+            p.threads = std::max(cores, std::min({p.nr_requests / 4, cores * 4, kMaxThreads}));
+#endif
+        return p;
+    }
+
+    static ssize_t timed_pread(int fd, uint8_t *buffer, size_t length, uint64_t offset,
+                               uint64_t &elapsed_ns)
+    {
+        const uint64_t start = monotonic_ns();
+        ssize_t n;
+        do
+        {
+            n = ::pread(fd, buffer, length, static_cast<off_t>(offset));
+        } while (n < 0 && errno == EINTR);
+        elapsed_ns = monotonic_ns() - start;
+        return n;
+    }
+
+    /**
+     * @brief 以 O_DIRECT 重新打开 fd 指向的文件（不支持时返回 -1）
+     */
+    static int reopen_direct(int fd)
+    {
+#if defined(__linux__) && defined(O_DIRECT)
+        const std::string self = "/proc/self/fd/" + std::to_string(fd);
+        return ::open(self.c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+#else
+        (void)fd;
+        return -1;
+#endif
+    }
+
+    /**
+     * @brief 校准：随机小块读的中位延迟 + 顺序读带宽 → 缓冲区大小
+     *
+     * 读取绕过页缓存（O_DIRECT，或预先 DONTNEED 要读的区间），
+     * 否则缓存中的文件会让延迟接近零、缓冲区被压到下限。
+     *
+     * @return 读取失败时返回 false（保留原状态，等待下一个文件）
+     */
+    static bool calibrate(int fd, uint64_t size, Profile &p)
+    {
+        // O_DIRECT 要求缓冲区、偏移和长度按逻辑块对齐；kProbeBytes 对齐足以覆盖常见设备
+        void *memory = nullptr;
+        if (::posix_memalign(&memory, kProbeBytes, kSequentialBytes) != 0)
+            return false;
+        std::unique_ptr<uint8_t, void (*)(void *)> buffer(static_cast<uint8_t *>(memory), std::free);
+
+        const int direct_fd = reopen_direct(fd);
+        struct DirectCloser
+        {
+            int fd;
+            ~DirectCloser()
+            {
+                if (fd >= 0)
+                    ::close(fd);
+            }
+        } direct_closer{direct_fd};
+        const int read_fd = direct_fd >= 0 ? direct_fd : fd;
+
+        // 随机读：偏移按 4KB 对齐并分布在整个文件中（线性同余，结果可复现）
+        std::vector<uint64_t> offsets;
+        uint64_t state = size;
+        const uint64_t slots = (size - kProbeBytes) / kProbeBytes;
+        for (int i = 0; i < kProbeReads; ++i)
+        {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            offsets.push_back(((state >> 17) % slots) * kProbeBytes);
+        }
+        // 顺序读：从文件中部读 kSequentialBytes（避开刚才可能读到的开头）
+        const uint64_t sequential_offset = (size / 2) & ~static_cast<uint64_t>(kProbeBytes - 1);
+
+        if (direct_fd < 0)
+        {
+            // 文件系统不支持 O_DIRECT：只把要测的区间逐出页缓存（脏页不受影响）
+            for (uint64_t offset : offsets)
+                ::posix_fadvise(fd, static_cast<off_t>(offset), kProbeBytes, POSIX_FADV_DONTNEED);
+            ::posix_fadvise(fd, static_cast<off_t>(sequential_offset), kSequentialBytes, POSIX_FADV_DONTNEED);
+        }
+
+        std::vector<uint64_t> latencies;
+        for (uint64_t offset : offsets)
+        {
+            uint64_t elapsed = 0;
+            if (timed_pread(read_fd, buffer.get(), kProbeBytes, offset, elapsed) <= 0)
+                return false;
+            latencies.push_back(elapsed);
+        }
+        std::nth_element(latencies.begin(), latencies.begin() + kProbeReads / 2, latencies.end());
+        const uint64_t latency = latencies[kProbeReads / 2];
+
+        uint64_t elapsed = 0;
+        const ssize_t n = timed_pread(read_fd, buffer.get(), kSequentialBytes, sequential_offset, elapsed);
+        if (n <= 0)
+            return false;
+        io_charge(static_cast<uint64_t>(n) + kProbeReads * kProbeBytes, kProbeReads + 1);
+
+        const double bandwidth = static_cast<double>(n) * 1e9 / static_cast<double>(std::max<uint64_t>(elapsed, 1));
+        const double target = static_cast<double>(latency) / 1e9 * bandwidth * 4;
+        size_t buffer_size = kMinBuffer;
+        while (buffer_size < kMaxBuffer && static_cast<double>(buffer_size * 2) <= target)
+            buffer_size *= 2;
+
+        p.calibrated = true;
+        p.calibrated_at_ns = monotonic_ns();
+        p.direct_io = direct_fd >= 0;
+        p.probe_latency_ns = latency;
+        p.read_bytes_per_sec = bandwidth;
+        p.buffer_size = buffer_size;
+        return true;
+    }
+
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, std::shared_ptr<std::mutex>> calibrate_locks_; // 受 mutex_ 保护
+    std::unordered_map<uint64_t, Profile> profiles_;
+};
+
+static py::dict device_profile_to_dict(const DeviceTuner::Profile &p)
+{
+    py::dict d;
+    d["dev"] = p.dev;
+#ifdef __linux__
+    d["device"] = std::to_string(major(p.dev)) + ":" + std::to_string(minor(p.dev));
+#endif
+    d["block_device"] = p.block_device.empty() ? py::object(py::none()) : py::object(py::str(p.block_device));
+    d["rotational"] = p.rotational < 0 ? py::object(py::none()) : py::object(py::bool_(p.rotational == 1));
+    d["nr_requests"] = p.nr_requests;
+    d["members"] = p.members;
+    d["threads"] = p.threads;
+    d["buffer_size"] = p.buffer_size;
+    d["calibrated"] = p.calibrated;
+    d["calibration_age_s"] = p.calibrated ? py::cast(static_cast<double>(monotonic_ns() - p.calibrated_at_ns) / 1e9)
+                                          : py::object(py::none());
+    d["direct_io"] = p.direct_io;
+    d["probe_latency_ms"] = static_cast<double>(p.probe_latency_ns) / 1e6;
+    d["read_mb_per_sec"] = p.read_bytes_per_sec / 1e6;
+    return d;
+}
+
+/**
+ * @brief path 所在设备的画像；path 是足够大的普通文件且设备尚未校准时用它校准
+ */
+py::dict device_profile(const std::string &path)
+{
+    DeviceTuner::Profile profile;
+    {
+        py::gil_scoped_release release;
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || ::fstat(fd, &st) != 0)
+        {
+            const int err = errno;
+            if (fd >= 0)
+                ::close(fd);
+            throw FsError(err, path);
+        }
+        profile = S_ISREG(st.st_mode)
+                      ? DeviceTuner::instance().profile(st.st_dev, fd, static_cast<uint64_t>(st.st_size))
+                      : DeviceTuner::instance().profile(st.st_dev);
+        ::close(fd);
+    }
+    return device_profile_to_dict(profile);
+}
+
+/**
+ * @brief 已缓存的全部设备画像
+ */
+py::list device_profiles()
+{
+    py::list result;
+    for (const auto &p : DeviceTuner::instance().profiles())
+        result.append(device_profile_to_dict(p));
+    return result;
+}
+
+// ============================================================================
+// uid / gid 名称缓存
+// ============================================================================
+
+/**
+ * @class IdNameCache
+ * @brief 线程安全的 uid/gid -> 名称缓存（带 TTL）
+ *
+ * 通过 NSS（getpwuid_r / getgrgid_r）解析名称，可能经由 LDAP / SSSD，
+ * 单次查询可达毫秒级，不适合在每个目录条目上调用。
+ *
+ * 策略：
+ * - 读多写少，使用 shared_mutex：命中时只持有共享锁
+ * - 未命中时在锁外执行 NSS 查询，避免慢查询阻塞其他线程
+ * - 查不到的 id 也缓存（名称为数字本身，与 ls 一致），避免反复查询
+ * - 条目在 TTL 到期后惰性刷新
+ */
+class IdNameCache
+{
+public:
+    static IdNameCache &instance()
+    {
+        static IdNameCache cache;
+        return cache;
+    }
+
+    std::string user_name(uint32_t uid) { return lookup(users_, uid, &IdNameCache::resolve_user); }
+    std::string group_name(uint32_t gid) { return lookup(groups_, gid, &IdNameCache::resolve_group); }
+
+    void set_ttl(double seconds)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        ttl_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(std::max(0.0, seconds)));
+    }
+
+    void clear()
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        users_.clear();
+        groups_.clear();
+    }
+
+private:
+    struct Entry
+    {
+        std::string name;
+        std::chrono::steady_clock::time_point expires;
+    };
+    using Map = std::unordered_map<uint32_t, Entry>;
+
+    IdNameCache() : ttl_(std::chrono::minutes(5)) {}
+
+    std::string lookup(Map &map, uint32_t id, std::string (*resolve)(uint32_t))
+    {
+        auto now = std::chrono::steady_clock::now();
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = map.find(id);
+            if (it != map.end() && it->second.expires > now)
+                return it->second.name;
+        }
+
+        // 锁外解析：NSS 可能访问网络
+        std::string name = resolve(id);
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        map[id] = Entry{name, now + ttl_};
+        return name;
+    }
+
+    static size_t initial_buffer_size(int which)
+    {
+        long size = ::sysconf(which);
+        return size > 0 ? static_cast<size_t>(size) : 16384;
+    }
+
+    static std::string resolve_user(uint32_t uid)
+    {
+        std::vector<char> buffer(initial_buffer_size(_SC_GETPW_R_SIZE_MAX));
+        struct passwd pwd;
+        struct passwd *result = nullptr;
+        int rc;
+        while ((rc = ::getpwuid_r(static_cast<uid_t>(uid), &pwd, buffer.data(),
+                                  buffer.size(), &result)) == ERANGE &&
+               buffer.size() < (1u << 20))
+        {
+            buffer.resize(buffer.size() * 2);
+        }
+        if (rc == 0 && result && result->pw_name)
+            return result->pw_name;
+        return std::to_string(uid);
+    }
+
+    static std::string resolve_group(uint32_t gid)
+    {
+        std::vector<char> buffer(initial_buffer_size(_SC_GETGR_R_SIZE_MAX));
+        struct group grp;
+        struct group *result = nullptr;
+        int rc;
+        while ((rc = ::getgrgid_r(static_cast<gid_t>(gid), &grp, buffer.data(),
+                                  buffer.size(), &result)) == ERANGE &&
+               buffer.size() < (1u << 20))
+        {
+            buffer.resize(buffer.size() * 2);
+        }
+        if (rc == 0 && result && result->gr_name)
+            return result->gr_name;
+        return std::to_string(gid);
+    }
+
+    mutable std::shared_mutex mutex_;
+    std::chrono::steady_clock::duration ttl_;
+    Map users_;
+    Map groups_;
+};
+
+// ============================================================================
+// 自然排序键
+// ============================================================================
+
+static inline unsigned char fold_ascii(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + 32) : c;
+}
+
+/**
+ * @brief 双字节 UTF-8 范围内的简单大小写折叠（拉丁补充 / 扩展 A、希腊、西里尔字母）
+ */
+static uint32_t fold_code_point(uint32_t cp)
+{
+    if ((cp >= 0x00C0 && cp <= 0x00DE && cp != 0x00D7) ||
+        (cp >= 0x0391 && cp <= 0x03AB && cp != 0x03A2) ||
+        (cp >= 0x0410 && cp <= 0x042F))
+        return cp + 0x20;
+    if (cp >= 0x0400 && cp <= 0x040F)
+        return cp + 0x50;
+    if (cp == 0x0178)
+        return 0x00FF;
+    if ((cp >= 0x0100 && cp <= 0x0137) || (cp >= 0x014A && cp <= 0x0177) ||
+        (cp >= 0x0460 && cp <= 0x0481) || (cp >= 0x048A && cp <= 0x04BF))
+        return cp | 1; // 大写在偶数位
+    if ((cp >= 0x0139 && cp <= 0x0148) || (cp >= 0x0179 && cp <= 0x017E))
+        return (cp & 1) ? cp + 1 : cp; // 大写在奇数位
+    return cp;
+}
+
+/**
+ * @brief 生成可直接按字节比较（memcmp）的自然排序键
+ *
+ * - 字母折叠大小写：ASCII 与常见双字节 UTF-8 字母
+ * - 连续数字按数值比较：编码为 '0' 标记 + 有效位数（1 字节）+ 去掉前导零的数字，
+ *   位数多的数值大，位数相同时逐字节比较即数值比较，因此 file2 < file10
+ * - 末尾追加 '\0' 与原始文件名，使 "a" / "A"、"01" / "1" 等折叠后相同的名字也有确定顺序
+ */
+static void append_natural_sort_key(std::string_view name, std::string &key)
+{
+    key.reserve(key.size() + name.size() * 2 + 4);
+    size_t i = 0;
+    while (i < name.size())
+    {
+        unsigned char c = static_cast<unsigned char>(name[i]);
+        if (c >= '0' && c <= '9')
+        {
+            size_t start = i;
+            while (i < name.size() && name[i] >= '0' && name[i] <= '9')
+                ++i;
+            while (start + 1 < i && name[start] == '0')
+                ++start;
+            size_t digits = i - start;
+            key.push_back('0');
+            key.push_back(static_cast<char>(std::min<size_t>(digits, 255)));
+            key.append(name.data() + start, digits);
+        }
+        else if (c < 0x80)
+        {
+            key.push_back(static_cast<char>(fold_ascii(c)));
+            ++i;
+        }
+        else if (c >= 0xC2 && c <= 0xDF && i + 1 < name.size() &&
+                 (static_cast<unsigned char>(name[i + 1]) & 0xC0) == 0x80)
+        {
+            uint32_t cp = ((c & 0x1Fu) << 6) | (static_cast<unsigned char>(name[i + 1]) & 0x3Fu);
+            cp = fold_code_point(cp);
+            key.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            key.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            i += 2;
+        }
+        else
+        {
+            key.push_back(static_cast<char>(c));
+            ++i;
+        }
+    }
+    key.push_back('\0');
+    key.append(name);
+}
+
+enum class SortField
+{
+    None,
+    Name,
+    Size,
+    Mtime,
+    Type
+};
+
+static SortField parse_sort_field(const std::string &value)
+{
+    if (value.empty())
+        return SortField::None;
+    if (value == "name")
+        return SortField::Name;
+    if (value == "size")
+        return SortField::Size;
+    if (value == "mtime")
+        return SortField::Mtime;
+    if (value == "type")
+        return SortField::Type;
+    throw std::invalid_argument("Unknown sort field: " + value);
+}
+
+/**
+ * @brief 排序后的下标序列（置换数组），infos 本身不动
+ *
+ * 比较时只做自然排序键的字节比较（keys 与 infos 一一对应，见 append_natural_sort_key）。
+ * 非名称字段相同时按名称升序；dirs_first 时目录（不含指向目录的符号链接）在前。
+ * type 的顺序为 directory < file < symlink。
+ */
+static std::vector<uint32_t> sort_permutation(const std::vector<FileInfo> &infos,
+                                              const std::vector<std::string> &keys,
+                                              SortField field, bool descending, bool dirs_first)
+{
+    const size_t count = infos.size();
+    std::vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; ++i)
+        order[i] = static_cast<uint32_t>(i);
+    if (field == SortField::None && !dirs_first)
+        return order;
+
+    auto type_rank = [](const FileInfo &info)
+    {
+        return info.is_symlink ? 2 : (info.is_directory ? 0 : 1);
+    };
+
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+    {
+        const FileInfo &x = infos[a];
+        const FileInfo &y = infos[b];
+        if (dirs_first)
+        {
+            bool dx = x.is_directory && !x.is_symlink;
+            bool dy = y.is_directory && !y.is_symlink;
+            if (dx != dy)
+                return dx;
+        }
+
+        int c = 0;
+        switch (field)
+        {
+        case SortField::Size:
+            c = x.size < y.size ? -1 : (x.size > y.size ? 1 : 0);
+            break;
+        case SortField::Mtime:
+            c = x.mtime < y.mtime ? -1 : (x.mtime > y.mtime ? 1 : 0);
+            break;
+        case SortField::Type:
+            c = type_rank(x) - type_rank(y);
+            break;
+        case SortField::Name:
+            c = keys[a].compare(keys[b]);
+            break;
+        case SortField::None:
+            return a < b; // 仅目录优先：保持原有顺序
+        }
+        if (c != 0)
+            return descending ? c > 0 : c < 0;
+        return keys[a] < keys[b];
+    });
+    return order;
+}
+
+/**
+ * @brief 按排序字段重排 FileInfo（原地），每个条目只计算一次自然排序键
+ */
+static void sort_file_infos(std::vector<FileInfo> &infos, SortField field, bool descending, bool dirs_first)
+{
+    if (field == SortField::None && !dirs_first)
+        return;
+
+    const size_t count = infos.size();
+    std::vector<std::string> keys(count);
+    for (size_t i = 0; i < count; ++i)
+        append_natural_sort_key(infos[i].name, keys[i]);
+
+    const std::vector<uint32_t> order = sort_permutation(infos, keys, field, descending, dirs_first);
+    std::vector<FileInfo> sorted;
+    sorted.reserve(count);
+    for (uint32_t idx : order)
+        sorted.push_back(std::move(infos[idx]));
+    infos.swap(sorted);
+}
+
+// ============================================================================
+// 挂载点感知
+// ============================================================================
+
+/**
+ * @brief statfs f_type 魔数 -> 文件系统类型名（与 /proc/self/mountinfo 中的名称一致）
+ */
+static std::string fs_type_name(uint64_t magic)
+{
+    static const std::pair<uint64_t, const char *> kTypes[] = {
+        {0xEF53, "ext4"}, {0x58465342, "xfs"}, {0x9123683E, "btrfs"}, {0x2FC12FC1, "zfs"},
+        {0x01021994, "tmpfs"}, {0x858458F6, "ramfs"}, {0x794C7630, "overlay"},
+        {0x73717368, "squashfs"}, {0x9660, "iso9660"}, {0x4D44, "vfat"}, {0x2011BAB0, "exfat"},
+        {0x5346544E, "ntfs"}, {0x6969, "nfs"}, {0x517B, "smb"}, {0xFF534D42, "cifs"},
+        {0xFE534D42, "smb2"}, {0x00C36400, "ceph"}, {0x65735546, "fuse"}, {0x65735543, "fusectl"},
+        {0x9FA0, "proc"}, {0x62656572, "sysfs"}, {0x1CD1, "devpts"}, {0x27E0EB, "cgroup"},
+        {0x63677270, "cgroup2"}, {0x64626720, "debugfs"}, {0x74726163, "tracefs"},
+        {0x73636673, "securityfs"}, {0x6165676C, "pstore"}, {0xCAFE4A11, "bpf"},
+        {0x19800202, "mqueue"}, {0x958458F6, "hugetlbfs"}, {0x0187, "autofs"},
+        {0x62656570, "configfs"}, {0x42494E4D, "binfmt_misc"}, {0x6E736673, "nsfs"},
+        {0xDE5E81E4, "efivarfs"},
+    };
+    for (const auto &type : kTypes)
+    {
+        if (type.first == magic)
+            return type.second;
+    }
+    char buffer[24];
+    std::snprintf(buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(magic));
+    return buffer;
+}
+
+/** @brief 还原 mountinfo 中的八进制转义（\040 空格等） */
+static std::string unescape_mount_path(const std::string &raw)
+{
+    std::string out;
+    out.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); ++i)
+    {
+        if (raw[i] == '\\' && i + 3 < raw.size() && std::isdigit(static_cast<unsigned char>(raw[i + 1])))
+        {
+            out.push_back(static_cast<char>(((raw[i + 1] - '0') << 6) | ((raw[i + 2] - '0') << 3) | (raw[i + 3] - '0')));
+            i += 3;
+        }
+        else
+        {
+            out.push_back(raw[i]);
+        }
+    }
+    return out;
+}
+
+/**
+ * @class MountFilter
+ * @brief 遍历时的挂载点策略：one_file_system / 按文件系统类型跳过，并记录未进入的挂载点
+ *
+ * 两道检查：
+ * 1. 挂载表（Linux 读取 /proc/self/mountinfo）：在 stat 之前按路径命中挂载点，
+ *    被跳过的挂载点完全不会被访问（失联的 NFS 不会卡住遍历）
+ * 2. st_dev 与根目录不同（挂载表缺失、或经符号链接到达的路径）：
+ *    以 statfs 魔数确定类型，结果按设备号缓存
+ *
+ * 类型匹配支持 "fuse" 匹配 "fuse.sshfs" 这类带子类型的名称。
+ * 多个遍历线程可并发调用。
+ */
+class MountFilter
+{
+public:
+    struct Skipped
+    {
+        std::string path;
+        std::string fstype;
+    };
+
+    MountFilter(const std::string &root, bool one_file_system, const std::vector<std::string> &skip_types)
+        : one_file_system_(one_file_system), skip_types_(skip_types.begin(), skip_types.end())
+    {
+        if (!active())
+            return;
+        FileStat st;
+        if (stat_path(AT_FDCWD, root.c_str(), true, st) == 0)
+            root_dev_ = st.dev;
+        load_mount_table(root);
+    }
+
+    bool active() const { return one_file_system_ || !skip_types_.empty(); }
+
+    /**
+     * @brief stat 之前：path 是挂载表中的挂载点且应跳过时返回 true
+     * @param fstype 可选输出：被跳过挂载点的类型
+     */
+    bool skip_mount_point(const std::string &path, std::string *fstype = nullptr)
+    {
+        auto it = mounts_.find(path);
+        if (it == mounts_.end())
+            return false;
+        if (!one_file_system_ && !type_skipped(it->second))
+            return false;
+        record(path, it->second);
+        if (fstype)
+            *fstype = it->second;
+        return true;
+    }
+
+    /**
+     * @brief stat 之后：目录位于与根不同的设备上且应跳过时返回 true
+     */
+    bool skip_device(const std::string &path, uint64_t dev, std::string *fstype = nullptr)
+    {
+        if (dev == root_dev_ || dev == 0)
+            return false;
+        if (!one_file_system_ && skip_types_.empty())
+            return false;
+        std::string type = type_of_device(path, dev);
+        if (!one_file_system_ && !type_skipped(type))
+            return false;
+        record(path, type);
+        if (fstype)
+            *fstype = type;
+        return true;
+    }
+
+    std::vector<Skipped> skipped() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return skipped_;
+    }
+
+private:
+    void load_mount_table(const std::string &root)
+    {
+#ifdef __linux__
+        FILE *file = std::fopen("/proc/self/mountinfo", "re");
+        if (!file)
+            return;
+
+        // 挂载表中是规范路径；root 含符号链接时换算为遍历时看到的路径
+        std::string real_root = root;
+        if (char *resolved = ::realpath(root.c_str(), nullptr))
+        {
+            real_root = resolved;
+            std::free(resolved);
+        }
+        std::string root_prefix = real_root == "/" ? "/" : real_root + "/";
+        std::string walk_prefix = root.back() == '/' ? root : root + "/";
+
+        char *line = nullptr;
+        size_t capacity = 0;
+        while (::getline(&line, &capacity, file) > 0)
+        {
+            // 格式：id parent major:minor root mount_point options [optional...] - fstype source super_options
+            std::istringstream fields(line);
+            std::string id, parent, devno, mount_root, mount_point, token;
+            fields >> id >> parent >> devno >> mount_root >> mount_point;
+            while (fields >> token && token != "-")
+                ;
+            std::string fstype;
+            fields >> fstype;
+            if (fstype.empty())
+                continue;
+
+            mount_point = unescape_mount_path(mount_point);
+            if (mount_point.size() <= root_prefix.size() ||
+                mount_point.compare(0, root_prefix.size(), root_prefix) != 0)
+                continue;
+            mounts_[walk_prefix + mount_point.substr(root_prefix.size())] = fstype;
+        }
+        std::free(line);
+        std::fclose(file);
+#else
+        (void)root;
+#endif
+    }
+
+    bool type_skipped(const std::string &fstype) const
+    {
+        if (skip_types_.count(fstype))
+            return true;
+        size_t dot = fstype.find('.');
+        return dot != std::string::npos && skip_types_.count(fstype.substr(0, dot));
+    }
+
+    std::string type_of_device(const std::string &path, uint64_t dev)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = dev_types_.find(dev);
+            if (it != dev_types_.end())
+                return it->second;
+        }
+        std::string fstype = "unknown";
+#ifdef __linux__
+        struct statfs sfs;
+        if (::statfs(path.c_str(), &sfs) == 0)
+            fstype = fs_type_name(static_cast<uint64_t>(sfs.f_type));
+#endif
+        std::lock_guard<std::mutex> lock(mutex_);
+        dev_types_.emplace(dev, fstype);
+        return fstype;
+    }
+
+    void record(const std::string &path, const std::string &fstype)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (skipped_.size() < 10000)
+            skipped_.push_back({path, fstype});
+    }
+
+    bool one_file_system_;
+    std::unordered_set<std::string> skip_types_;
+    uint64_t root_dev_ = 0;
+    std::unordered_map<std::string, std::string> mounts_; // 遍历路径 -> 类型（只读）
+    std::unordered_map<uint64_t, std::string> dev_types_;
+    std::vector<Skipped> skipped_;
+    mutable std::mutex mutex_;
+};
+
+static py::list skipped_mounts_to_list(const MountFilter &filter)
+{
+    py::list result;
+    for (const auto &item : filter.skipped())
+    {
+        py::dict d;
+        d["path"] = item.path;
+        d["fstype"] = item.fstype;
+        result.append(d);
+    }
+    return result;
+}
+
+// ============================================================================
+// 核心函数实现
+// ============================================================================
+
+/**
+ * @class PathScope
+ * @brief 允许访问的路径范围，判定规则与 Python 侧 _check_path_scope 一致
+ *
+ * 路径位于某个 roots 之下、不在任何 exclude_paths 之下、且没有路径组件等于
+ * exclude_names 中的名字时在范围内。roots 为空表示不做限制。
+ * 跟随符号链接时用它判定链接目标：范围外的目标既不报告也不进入。
+ */
+class PathScope
+{
+public:
+    PathScope() = default;
+
+    PathScope(const std::vector<std::string> &roots, const std::vector<std::string> &exclude_paths,
+              const std::vector<std::string> &exclude_names)
+        : roots_(normalized(roots)), exclude_paths_(normalized(exclude_paths)),
+          exclude_names_(exclude_names.begin(), exclude_names.end())
+    {
+    }
+
+    bool active() const { return !roots_.empty(); }
+
+    /**
+     * @brief 已解析（无符号链接、无 ..）的绝对路径是否在范围内
+     */
+    bool contains(const std::string &path) const
+    {
+        if (!active())
+            return true;
+        if (std::none_of(roots_.begin(), roots_.end(),
+                         [&](const std::string &root) { return is_under(path, root); }))
+            return false;
+        for (const auto &excluded : exclude_paths_)
+        {
+            if (is_under(path, excluded))
+                return false;
+        }
+        if (!exclude_names_.empty())
+        {
+            size_t start = 0;
+            while (start < path.size())
+            {
+                size_t slash = path.find('/', start);
+                if (slash == std::string::npos)
+                    slash = path.size();
+                if (slash > start && exclude_names_.count(path.substr(start, slash - start)))
+                    return false;
+                start = slash + 1;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief 符号链接 link_path（内容为 target）的目标是否在范围内
+     *
+     * 优先按 realpath 判定；目标不存在时按词法规范化后的路径判定，
+     * 范围外的失效链接与范围外的有效链接表现相同，不暴露目标是否存在。
+     */
+    bool contains_link_target(const std::string &link_path, const std::string &target) const
+    {
+        if (!active())
+            return true;
+        if (char *real = ::realpath(link_path.c_str(), nullptr))
+        {
+            std::string resolved(real);
+            std::free(real);
+            return contains(resolved);
+        }
+        fs::path lexical = fs::path(target).is_absolute() ? fs::path(target)
+                                                          : fs::path(link_path).parent_path() / target;
+        std::string normal = lexical.lexically_normal().string();
+        while (normal.size() > 1 && normal.back() == '/')
+            normal.pop_back();
+        return contains(normal);
+    }
+
+    /// 缓存键的一部分：范围不同的列表不共享缓存
+    std::string fingerprint() const
+    {
+        std::string key;
+        for (const auto *list : {&roots_, &exclude_paths_})
+        {
+            for (const auto &path : *list)
+                key.append(path).push_back('\0');
+            key.push_back('\1');
+        }
+        std::vector<std::string> names(exclude_names_.begin(), exclude_names_.end());
+        std::sort(names.begin(), names.end());
+        for (const auto &name : names)
+            key.append(name).push_back('\0');
+        return key;
+    }
+
+private:
+    static bool is_under(const std::string &path, const std::string &base)
+    {
+        if (base == "/")
+            return !path.empty() && path[0] == '/';
+        return path.compare(0, base.size(), base) == 0 &&
+               (path.size() == base.size() || path[base.size()] == '/');
+    }
+
+    static std::vector<std::string> normalized(const std::vector<std::string> &paths)
+    {
+        std::vector<std::string> result;
+        for (std::string path : paths)
+        {
+            while (path.size() > 1 && path.back() == '/')
+                path.pop_back();
+            if (!path.empty())
+                result.push_back(std::move(path));
+        }
+        return result;
+    }
+
+    std::vector<std::string> roots_;
+    std::vector<std::string> exclude_paths_;
+    std::unordered_set<std::string> exclude_names_;
+};
+
+/**
+ * @brief 扫描目录树，收集 FileInfo（调用方已释放 GIL）
+ *
+ * scandir_recursive 与 list_directory_json 共用，参数语义见 scandir_recursive。
+ * 致命错误以 "Fatal error:" 前缀记录在 errors 中，由调用方在重新获取 GIL 后抛出。
+ */
+static void collect_file_infos(const std::string &root_path, int max_depth, bool include_hidden,
+                               bool include_owner, bool follow_symlinks, bool one_file_system,
+                               const std::vector<std::string> &skip_fs_types,
+                               std::vector<FileInfo> &results, std::vector<std::string> &errors,
+                               const PathScope &link_scope = PathScope())
+{
+    fs::path root(root_path);
+    try
+    {
+        // 使用递归目录迭代器
+        // std::filesystem::directory_options::skip_permission_denied
+        // 可以跳过无权限的目录而不抛出异常
+        auto options = fs::directory_options::skip_permission_denied;
+        if (follow_symlinks)
+            options |= fs::directory_options::follow_directory_symlink;
+
+        // 挂载点策略：未进入的挂载点作为带 mount_skipped 标记的条目返回
+        MountFilter mounts(root_path, one_file_system, skip_fs_types);
+
+        // 跟随符号链接时记录已进入的目录，链接指回祖先或重复目录时不再进入
+        std::unordered_set<std::pair<uint64_t, uint64_t>, DevInoHash> visited;
+        if (follow_symlinks)
+        {
+            FileStat root_stat;
+            if (stat_path(AT_FDCWD, root.c_str(), true, root_stat) == 0)
+                visited.insert({root_stat.dev, root_stat.ino});
+        }
+
+        for (auto it = fs::recursive_directory_iterator(root, options);
+             it != fs::recursive_directory_iterator();
+             ++it)
+        {
+
+            try
+            {
+                // 后台让出 + 结算限速（调用线程附加了 RateLimiter 时）
+                io_checkpoint();
+
+                const auto &entry = *it;
+                const auto &path = entry.path();
+
+                // 检查递归深度
+                if (max_depth > 0 && it.depth() >= max_depth)
+                {
+                    it.disable_recursion_pending(); // 不再深入此目录
+                    continue;
+                }
+
+                // 检查是否为隐藏文件 (以 . 开头)
+                std::string filename = path.filename().string();
+                if (!include_hidden && !filename.empty() && filename[0] == '.')
+                {
+                    if (entry.is_directory())
+                    {
+                        it.disable_recursion_pending(); // 跳过隐藏目录
+                    }
+                    continue;
+                }
+
+                // 挂载表命中的挂载点在 stat 之前跳过（失联的网络挂载不会卡住扫描）
+                FileInfo skipped_mount;
+                if (mounts.active() && mounts.skip_mount_point(path.string(), &skipped_mount.fstype))
+                {
+                    it.disable_recursion_pending();
+                    skipped_mount.path = path.string();
+                    skipped_mount.name = filename;
+                    skipped_mount.size = 0;
+                    skipped_mount.mtime = 0;
+                    skipped_mount.is_directory = true;
+                    skipped_mount.is_symlink = false;
+                    skipped_mount.mount_skipped = true;
+                    results.push_back(std::move(skipped_mount));
+                    continue;
+                }
+
+                // 收集文件信息：一次 lstat 取得类型、大小、时间和属主，
+                // 代替 file_size() / last_write_time() 各自的 stat 调用
+                FileStat st;
+                int err = stat_path(AT_FDCWD, path.c_str(), false, st);
+                io_charge(0, 1);
+                if (err != 0)
+                {
+                    errors.push_back(path.string() + ": " + std::strerror(err));
+                    continue;
+                }
+
+                FileInfo info;
+                info.path = path.string();
+                info.name = filename;
+                info.is_symlink = S_ISLNK(st.mode);
+
+                std::string link_text;
+                if (info.is_symlink && follow_symlinks)
+                    read_link(AT_FDCWD, path.c_str(), link_text);
+
+                if (info.is_symlink && follow_symlinks &&
+                    !link_scope.contains_link_target(path.string(), link_text))
+                {
+                    // 目标在允许范围之外：不报告目标、不进入，保留链接自身的 lstat 数据
+                    it.disable_recursion_pending();
+                    info.is_directory = false;
+                    info.size = st.size;
+                }
+                else if (info.is_symlink && follow_symlinks)
+                {
+                    // 报告链接目标与目标的元数据；失效链接只做标记
+                    info.link_resolved = true;
+                    info.link_target = std::move(link_text);
+                    FileStat target;
+                    if (stat_path(AT_FDCWD, path.c_str(), true, target) != 0)
+                    {
+                        info.link_broken = true;
+                        info.is_directory = false;
+                        info.size = 0;
+                    }
+                    else
+                    {
+                        info.is_directory = S_ISDIR(target.mode);
+                        info.size = S_ISREG(target.mode) ? target.size : 0;
+                        st.mtime_ns = target.mtime_ns;
+                        if (info.is_directory && mounts.active() &&
+                            mounts.skip_device(path.string(), target.dev, &info.fstype))
+                        {
+                            info.mount_skipped = true;
+                            it.disable_recursion_pending();
+                        }
+                        else if (info.is_directory && !visited.insert({target.dev, target.ino}).second)
+                        {
+                            info.link_cycle = true;
+                            it.disable_recursion_pending();
+                        }
+                    }
+                }
+                else if (info.is_symlink)
+                {
+                    // 对于符号链接，获取链接本身的信息而非目标
+                    info.is_directory = entry.is_directory();
+                    // 符号链接大小为 0（或获取链接目标大小）
+                    info.size = 0;
+                }
+                else
+                {
+                    info.is_directory = S_ISDIR(st.mode);
+                    info.size = info.is_directory ? 0 : st.size;
+                    if (info.is_directory && mounts.active() &&
+                        mounts.skip_device(path.string(), st.dev, &info.fstype))
+                    {
+                        info.mount_skipped = true;
+                        it.disable_recursion_pending();
+                    }
+                    // 已经经由符号链接进入过的目录不再重复进入
+                    else if (follow_symlinks && info.is_directory &&
+                             !visited.insert({st.dev, st.ino}).second)
+                        it.disable_recursion_pending();
+                }
+
+                // 修改时间（取整到秒）
+                info.mtime = static_cast<double>(st.mtime_ns / 1000000000LL);
+                info.mtime_ns = st.mtime_ns;
+
+                info.uid = st.uid;
+                info.gid = st.gid;
+                if (include_owner)
+                {
+                    info.owner = IdNameCache::instance().user_name(st.uid);
+                    info.group = IdNameCache::instance().group_name(st.gid);
+                }
+
+                results.push_back(std::move(info));
+            }
+            catch (const fs::filesystem_error &e)
+            {
+                // 记录错误但继续扫描
+                errors.push_back(e.what());
+            }
+        }
+    }
+    catch (const fs::filesystem_error &e)
+    {
+        // 严重错误，需要在重新获取 GIL 后抛出
+        // 注意：这里我们在 GIL 释放期间，需要先存储错误信息
+        errors.push_back(std::string("Fatal error: ") + e.what());
+    }
+}
+
+/**
+ * @brief 递归扫描目录，返回所有文件信息
+ *
+ * 使用 C++17 std::filesystem 进行高性能目录遍历。
+ *
+ * 内存安全策略：
+ * - 使用 std::vector 自动管理内存
+ * - 异常安全：使用 RAII 和智能指针
+ * - 路径字符串使用 UTF-8 编码
+ *
+ * GIL 释放策略：
+ * - 在目录遍历期间释放 GIL，允许其他 Python 线程执行
+ * - 返回结果前重新获取 GIL（由 pybind11 自动处理）
+ *
+ * @param root_path 要扫描的根目录路径
+ * @param max_depth 最大递归深度 (0 = 无限制)
+ * @param include_hidden 是否包含隐藏文件
+ * @param include_owner 是否解析属主 / 属组名称（经 IdNameCache 缓存）
+ * @param sort_by 排序字段：""（遍历顺序）/ name / size / mtime / type
+ * @param sort_desc 是否降序
+ * @param dirs_first 目录是否排在前面
+ * @param follow_symlinks 是否进入指向目录的符号链接；
+ *        以已访问目录的 (st_dev, st_ino) 集合检测环路，每个物理目录只进入一次
+ * @param one_file_system 不进入其他文件系统（挂载点）
+ * @param skip_fs_types 不进入这些类型的文件系统（如 proc、nfs）
+ * @param priority 优先级："interactive"（默认）或 "background"
+ * @param scope_roots 跟随符号链接时允许的目标范围（为空不限制）；目标在范围外或位于
+ *        exclude_paths / exclude_names 下的链接不报告目标、不进入，保留链接自身的 lstat 数据
+ * @return Python 列表，包含所有文件信息字典
+ * @throws std::runtime_error 如果路径不存在或无权限访问
+ */
+py::list scandir_recursive(
+    const std::string &root_path,
+    int max_depth = 0,
+    bool include_hidden = false,
+    bool include_owner = false,
+    const std::string &sort_by = "",
+    bool sort_desc = false,
+    bool dirs_first = false,
+    bool follow_symlinks = false,
+    bool one_file_system = false,
+    const std::vector<std::string> &skip_fs_types = {},
+    const std::string &priority = "interactive",
+    const std::vector<std::string> &scope_roots = {},
+    const std::vector<std::string> &exclude_paths = {},
+    const std::vector<std::string> &exclude_names = {})
+{
+    const SortField sort_field = parse_sort_field(sort_by);
+    const IoPriority io_priority = parse_io_priority(priority);
+    const PathScope link_scope(scope_roots, exclude_paths, exclude_names);
+
+    // 首先验证路径（在持有 GIL 时进行，以便抛出 Python 异常）
+    fs::path root(root_path);
+    if (!fs::exists(root))
+    {
+        throw std::runtime_error("Path does not exist: " + root_path);
+    }
+    if (!fs::is_directory(root))
+    {
+        throw std::runtime_error("Path is not a directory: " + root_path);
+    }
+
+    // 存储结果的容器（在 C++ 堆上分配）
+    std::vector<FileInfo> results;
+    results.reserve(10000); // 预分配空间，减少重新分配
+
+    // 错误信息收集（用于记录无法访问的路径）
+    std::vector<std::string> errors;
+
+    // ========================================================================
+    // 关键：释放 GIL 进行耗时的目录遍历操作
+    // ========================================================================
+    {
+        // RAII: 构造时释放 GIL，析构时自动重新获取
+        py::gil_scoped_release release;
+        IoPriorityScope priority_scope(io_priority);
+
+        collect_file_infos(root_path, max_depth, include_hidden, include_owner, follow_symlinks,
+                           one_file_system, skip_fs_types, results, errors, link_scope);
+
+        sort_file_infos(results, sort_field, sort_desc, dirs_first);
+    }
+    // GIL 已自动重新获取（RAII）
+
+    // 检查是否有致命错误
+    for (const auto &err : errors)
+    {
+        if (err.find("Fatal error:") == 0)
+        {
+            throw std::runtime_error(err);
+        }
+    }
+
+    // 转换结果为 Python 列表
+    py::list py_results;
+    for (const auto &info : results)
+    {
+        py_results.append(info.to_dict());
+    }
+
+    return py_results;
+}
+
+// ============================================================================
+// 目录列表缓存（排序物化）
+// ============================================================================
+
+/**
+ * @brief 一个目录的物化列表：扫描结果 + 各排序方式的置换数组
+ *
+ * 条目与排序键构建后不再修改；某种排序第一次被请求时生成置换数组并保留，
+ * 之后取一页只需按置换数组读取 [offset, offset + limit) 的条目。
+ */
+struct DirectoryListing
+{
+    std::vector<FileInfo> infos;   // 扫描顺序
+    std::vector<std::string> keys; // 自然排序键，与 infos 一一对应
+    uint64_t directory_count = 0;  // 不含指向目录的符号链接
+    uint64_t total_size = 0;
+
+    // 扫描前目录自身的状态，用于判断缓存是否仍然有效
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+    int64_t mtime_ns = 0;
+    int64_t ctime_ns = 0;
+    std::chrono::steady_clock::time_point scanned_at;
+
+    /// 排序方式对应的置换数组（首次请求时构建，之后只读）
+    const std::vector<uint32_t> &order(SortField field, bool descending, bool dirs_first) const
+    {
+        const size_t slot = (static_cast<size_t>(field) * 2 + descending) * 2 + dirs_first;
+        std::lock_guard<std::mutex> lock(orders_mutex_);
+        auto &order = orders_[slot];
+        if (!order)
+            order = std::make_unique<const std::vector<uint32_t>>(
+                sort_permutation(infos, keys, field, descending, dirs_first));
+        return *order;
+    }
+
+private:
+    mutable std::mutex orders_mutex_;
+    mutable std::unique_ptr<const std::vector<uint32_t>> orders_[5 * 2 * 2]; // SortField × 升降序 × 目录优先
+};
+
+/**
+ * @class ListingCache
+ * @brief 进程内目录列表缓存：大目录分页时不再每页重新扫描、排序
+ *
+ * 以 (目录, include_hidden, include_owner, follow_symlinks) 为键，命中条件：
+ * - 目录的 dev / ino / mtime / ctime 与扫描前一致（增删、改名都会更新目录 mtime）
+ * - 未超过 ttl：子项内容变化不会更新目录 mtime，由 ttl 兜底（0 = 不限）
+ * - 没有被 invalidate 显式失效（应用自身的写操作）
+ * 扫描开始时目录 mtime 距当前不足 2 秒的不缓存：同一时间戳粒度内的后续修改无法从 mtime 察觉。
+ * 只缓存不少于 min_entries 个条目的目录（小目录重新扫描更便宜），
+ * 缓存的总条目数超过 max_entries 时淘汰最久未使用的目录。
+ * 每个条目约占 300–400 字节（FileInfo 本身加上已生成的各排序置换数组），
+ * 默认 200000 个条目约合 60–80MB。
+ */
+class ListingCache
+{
+public:
+    struct Config
+    {
+        size_t max_entries = 200000;
+        size_t min_entries = 1000;
+        double ttl_seconds = 60.0;
+    };
+
+    struct Stats
+    {
+        size_t directories = 0;
+        size_t entries = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t invalidations = 0;
+    };
+
+    static ListingCache &instance()
+    {
+        static ListingCache cache;
+        return cache;
+    }
+
+    Config config() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return config_;
+    }
+
+    void configure(const Config &config)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        config_ = config;
+        evict_locked();
+    }
+
+    /**
+     * @brief 取目录列表：缓存有效时直接返回，否则扫描一层（调用方已释放 GIL）
+     *
+     * 致命错误以 "Fatal error:" 前缀记录在 errors 中，此时结果不缓存。
+     */
+    std::shared_ptr<const DirectoryListing> get(const std::string &dir_path, bool include_hidden,
+                                                bool include_owner, bool follow_symlinks,
+                                                const PathScope &link_scope,
+                                                std::vector<std::string> &errors)
+    {
+        std::string key = dir_path;
+        key.push_back('\0');
+        key.push_back(static_cast<char>('0' + (include_hidden ? 1 : 0) + (include_owner ? 2 : 0) +
+                                        (follow_symlinks ? 4 : 0)));
+        if (follow_symlinks)
+            key.append(link_scope.fingerprint());
+
+        FileStat st;
+        const bool has_stat = stat_path(AT_FDCWD, dir_path.c_str(), true, st) == 0;
+        if (has_stat)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = entries_.find(key);
+            if (it != entries_.end())
+            {
+                const DirectoryListing &cached = *it->second.listing;
+                const bool fresh = config_.ttl_seconds <= 0 ||
+                                   std::chrono::steady_clock::now() - cached.scanned_at <
+                                       std::chrono::duration<double>(config_.ttl_seconds);
+                if (fresh && cached.dev == st.dev && cached.ino == st.ino &&
+                    cached.mtime_ns == st.mtime_ns && cached.ctime_ns == st.ctime_ns)
+                {
+                    lru_.splice(lru_.begin(), lru_, it->second.lru);
+                    ++hits_;
+                    return it->second.listing;
+                }
+                erase_locked(it);
+            }
+            ++misses_;
+        }
+
+        auto listing = std::make_shared<DirectoryListing>();
+        listing->scanned_at = std::chrono::steady_clock::now();
+        if (has_stat)
+        {
+            listing->dev = st.dev;
+            listing->ino = st.ino;
+            listing->mtime_ns = st.mtime_ns;
+            listing->ctime_ns = st.ctime_ns;
+        }
+        collect_file_infos(dir_path, 1, include_hidden, include_owner, follow_symlinks,
+                           false, {}, listing->infos, errors, link_scope);
+
+        listing->keys.resize(listing->infos.size());
+        for (size_t i = 0; i < listing->infos.size(); ++i)
+        {
+            const FileInfo &info = listing->infos[i];
+            append_natural_sort_key(info.name, listing->keys[i]);
+            if (info.is_directory && !info.is_symlink)
+                ++listing->directory_count;
+            listing->total_size += info.size;
+        }
+
+        bool fatal = false;
+        for (const auto &err : errors)
+            fatal = fatal || err.find("Fatal error:") == 0;
+        const int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch())
+                                   .count();
+        const bool racy = now_ns - std::max(st.mtime_ns, st.ctime_ns) < 2000000000LL;
+        if (has_stat && !fatal && !racy)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (listing->infos.size() >= config_.min_entries && listing->infos.size() <= config_.max_entries)
+            {
+                auto it = entries_.find(key);
+                if (it != entries_.end())
+                    erase_locked(it);
+                lru_.push_front(key);
+                entries_.emplace(std::move(key), Entry{listing, lru_.begin()});
+                total_entries_ += listing->infos.size();
+                evict_locked();
+            }
+        }
+        return listing;
+    }
+
+    /**
+     * @brief path 本身及其父目录的列表失效（path 被创建、删除、改名或内容被修改后调用）
+     * @return 失效的缓存项数
+     */
+    size_t invalidate(const std::string &path)
+    {
+        std::string_view target(path);
+        while (target.size() > 1 && target.back() == '/')
+            target.remove_suffix(1);
+        const size_t slash = target.rfind('/');
+        const std::string_view parent = slash == std::string_view::npos
+                                            ? std::string_view()
+                                            : target.substr(0, slash == 0 ? 1 : slash);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t removed = 0;
+        for (auto it = entries_.begin(); it != entries_.end();)
+        {
+            const std::string_view dir(it->first.data(), it->first.size() - 2);
+            if (dir == target || (!parent.empty() && dir == parent))
+            {
+                erase_locked(it++);
+                ++removed;
+            }
+            else
+                ++it;
+        }
+        invalidations_ += removed;
+        return removed;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        invalidations_ += entries_.size();
+        entries_.clear();
+        lru_.clear();
+        total_entries_ = 0;
+    }
+
+    Stats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return {entries_.size(), total_entries_, hits_, misses_, invalidations_};
+    }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const DirectoryListing> listing;
+        std::list<std::string>::iterator lru;
+    };
+    using EntryMap = std::unordered_map<std::string, Entry>;
+
+    void erase_locked(EntryMap::iterator it)
+    {
+        total_entries_ -= it->second.listing->infos.size();
+        lru_.erase(it->second.lru);
+        entries_.erase(it);
+    }
+
+    void evict_locked()
+    {
+        while (total_entries_ > config_.max_entries && !lru_.empty())
+            erase_locked(entries_.find(lru_.back()));
+    }
+
+    mutable std::mutex mutex_;
+    Config config_;
+    EntryMap entries_;
+    std::list<std::string> lru_; // 最近使用的在前
+    size_t total_entries_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t invalidations_ = 0;
+};
+
+/**
+ * @brief 一页目录列表：共享的物化列表、所用排序的置换数组与当前页范围
+ */
+struct ListingPage
+{
+    std::shared_ptr<const DirectoryListing> listing;
+    const std::vector<uint32_t> *order = nullptr;
+    size_t begin = 0;
+    size_t end = 0;
+
+    /// 目录中的条目总数
+    size_t size() const { return listing->infos.size(); }
+
+    /// 排序后的第 i 个条目
+    const FileInfo &operator[](size_t i) const { return listing->infos[(*order)[i]]; }
+};
+
+/**
+ * @brief 取目录列表（经 ListingCache）并计算分页范围（调用方已释放 GIL）
+ *
+ * 分页语义同 Python 切片：limit > 0 时为 [offset, offset + limit)，否则为 [offset, 末尾)。
+ * 缓存命中且该排序的置换数组已存在时，开销只与页大小有关。
+ */
+static void build_listing_page(const std::string &dir_path, bool include_hidden, bool include_owner,
+                               SortField sort_field, bool sort_desc, bool dirs_first,
+                               bool follow_symlinks, const PathScope &link_scope, size_t offset, size_t limit,
+                               ListingPage &page, std::vector<std::string> &errors)
+{
+    page.listing = ListingCache::instance().get(dir_path, include_hidden, include_owner, follow_symlinks,
+                                                link_scope, errors);
+    page.order = &page.listing->order(sort_field, sort_desc, dirs_first);
+    page.begin = std::min(offset, page.size());
+    page.end = limit > 0 ? std::min(page.size(), page.begin + limit) : page.size();
+}
+
+/**
+ * @brief 调整目录列表缓存的配置（None 表示保持不变）
+ * @return 调整后的配置
+ */
+py::dict configure_listing_cache(const py::object &max_entries, const py::object &min_entries,
+                                 const py::object &ttl)
+{
+    ListingCache &cache = ListingCache::instance();
+    ListingCache::Config config = cache.config();
+    if (!max_entries.is_none())
+        config.max_entries = max_entries.cast<size_t>();
+    if (!min_entries.is_none())
+        config.min_entries = min_entries.cast<size_t>();
+    if (!ttl.is_none())
+        config.ttl_seconds = ttl.cast<double>();
+    cache.configure(config);
+
+    py::dict result;
+    result["max_entries"] = config.max_entries;
+    result["min_entries"] = config.min_entries;
+    result["ttl"] = config.ttl_seconds;
+    return result;
+}
+
+/**
+ * @brief 使路径本身及其父目录的缓存列表失效
+ * @return 失效的缓存项数
+ */
+size_t invalidate_listings(const std::vector<std::string> &paths)
+{
+    size_t removed = 0;
+    for (const auto &path : paths)
+        removed += ListingCache::instance().invalidate(path);
+    return removed;
+}
+
+/**
+ * @brief 目录列表缓存的统计
+ */
+py::dict listing_cache_stats()
+{
+    const ListingCache::Stats s = ListingCache::instance().stats();
+    py::dict result;
+    result["directories"] = s.directories;
+    result["entries"] = s.entries;
+    result["hits"] = s.hits;
+    result["misses"] = s.misses;
+    result["invalidations"] = s.invalidations;
+    return result;
+}
+
+// ============================================================================
+// 目录列表 JSON 预序列化
+// ============================================================================
+
+/**
+ * @brief 紧凑 JSON 输出，与 json.dumps(ensure_ascii=False, separators=(",", ":")) 逐字节一致
+ *
+ * - 字符串只转义 "、\ 与控制字符（\b \f \n \r \t，其余为 \u00XX），非 ASCII 原样输出；
+ *   无效的 UTF-8 字节替换为 U+FFFD（同样的名称经 pybind11 转成 str 时会直接报错）
+ * - 数字使用 std::to_chars；浮点数格式同 Python repr：最短往返表示，
+ *   [1e-4, 1e16) 内为定点（整数值带 ".0"），其余为科学计数法
+ */
+class JsonWriter
+{
+public:
+    explicit JsonWriter(std::string &out) : out_(out) {}
+
+    void raw(std::string_view text) { out_.append(text); }
+
+    /// 写入 "name":（name 为不需要转义的 ASCII 键名）
+    void key(std::string_view name)
+    {
+        out_.push_back('"');
+        out_.append(name);
+        out_.append("\":", 2);
+    }
+
+    void null() { out_.append("null", 4); }
+
+    void boolean(bool value) { value ? out_.append("true", 4) : out_.append("false", 5); }
+
+    template <typename Int>
+    void integer(Int value)
+    {
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out_.append(buffer, result.ptr);
+    }
+
+    void number(double value)
+    {
+        if (!std::isfinite(value))
+        {
+            null(); // json.dumps(allow_nan=False) 会报错，这里退化为 null
+            return;
+        }
+        char buffer[32];
+        const double magnitude = std::fabs(value);
+        std::to_chars_result result;
+        if (value == 0 || (magnitude >= 1e-4 && magnitude < 1e16))
+        {
+            result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed);
+            out_.append(buffer, result.ptr);
+            if (std::memchr(buffer, '.', static_cast<size_t>(result.ptr - buffer)) == nullptr)
+                out_.append(".0", 2);
+        }
+        else
+        {
+            result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::scientific);
+            out_.append(buffer, result.ptr);
+        }
+    }
+
+    void string(std::string_view value)
+    {
+        static const char hex[] = "0123456789abcdef";
+        out_.push_back('"');
+        const auto *p = reinterpret_cast<const unsigned char *>(value.data());
+        const auto *end = p + value.size();
+        while (p < end)
+        {
+            const unsigned char c = *p;
+            if (c >= 0x80)
+            {
+                const size_t length = utf8_sequence_length(p, end);
+                if (length == 0)
+                {
+                    out_.append("\xEF\xBF\xBD", 3);
+                    ++p;
+                }
+                else
+                {
+                    out_.append(reinterpret_cast<const char *>(p), length);
+                    p += length;
+                }
+                continue;
+            }
+            switch (c)
+            {
+            case '"':
+                out_.append("\\\"", 2);
+                break;
+            case '\\':
+                out_.append("\\\\", 2);
+                break;
+            case '\b':
+                out_.append("\\b", 2);
+                break;
+            case '\f':
+                out_.append("\\f", 2);
+                break;
+            case '\n':
+                out_.append("\\n", 2);
+                break;
+            case '\r':
+                out_.append("\\r", 2);
+                break;
+            case '\t':
+                out_.append("\\t", 2);
+                break;
+            default:
+                if (c < 0x20)
+                {
+                    const char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F]};
+                    out_.append(escaped, 6);
+                }
+                else
+                {
+                    out_.push_back(static_cast<char>(c));
+                }
+            }
+            ++p;
+        }
+        out_.push_back('"');
+    }
+
+    /**
+     * @brief 写入本地时间的 ISO-8601 字符串，同 datetime.fromtimestamp(ts).isoformat()
+     *
+     * 微秒按 round-half-even 取整（与 CPython 相同），为 0 时省略小数部分；
+     * 年份超出 [1, 9999]（Python 侧会抛出 ValueError）时写入 null。
+     */
+    void local_isoformat(double timestamp)
+    {
+        double whole;
+        double micros = std::nearbyint(std::modf(timestamp, &whole) * 1e6);
+        if (micros >= 1e6)
+        {
+            micros -= 1e6;
+            whole += 1;
+        }
+        else if (micros < 0)
+        {
+            micros += 1e6;
+            whole -= 1;
+        }
+
+        const time_t seconds = static_cast<time_t>(whole);
+        struct tm local;
+        if (!::localtime_r(&seconds, &local) || local.tm_year + 1900 < 1 || local.tm_year + 1900 > 9999)
+        {
+            null();
+            return;
+        }
+        char buffer[40];
+        int n = std::snprintf(buffer, sizeof(buffer), "\"%04d-%02d-%02dT%02d:%02d:%02d",
+                              local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+                              local.tm_hour, local.tm_min, local.tm_sec);
+        if (micros > 0)
+            n += std::snprintf(buffer + n, sizeof(buffer) - n, ".%06d", static_cast<int>(micros));
+        buffer[n++] = '"';
+        out_.append(buffer, static_cast<size_t>(n));
+    }
+
+    /// 合法 UTF-8 序列的长度（拒绝过长编码、代理区与超出 U+10FFFF），非法时返回 0
+    static size_t utf8_sequence_length(const unsigned char *p, const unsigned char *end)
+    {
+        const unsigned char c = *p;
+        size_t length;
+        uint32_t min_code;
+        uint32_t code;
+        if ((c & 0xE0) == 0xC0)
+        {
+            length = 2;
+            min_code = 0x80;
+            code = c & 0x1F;
+        }
+        else if ((c & 0xF0) == 0xE0)
+        {
+            length = 3;
+            min_code = 0x800;
+            code = c & 0x0F;
+        }
+        else if ((c & 0xF8) == 0xF0)
+        {
+            length = 4;
+            min_code = 0x10000;
+            code = c & 0x07;
+        }
+        else
+        {
+            return 0;
+        }
+        if (static_cast<size_t>(end - p) < length)
+            return 0;
+        for (size_t i = 1; i < length; ++i)
+        {
+            if ((p[i] & 0xC0) != 0x80)
+                return 0;
+            code = (code << 6) | (p[i] & 0x3F);
+        }
+        if (code < min_code || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))
+            return 0;
+        return length;
+    }
+
+private:
+    std::string &out_;
+};
+
+/**
+ * @brief "/" + path.relative_to(root)；path 不在 root 之下时原样返回
+ *
+ * 根目录为 "/" 时相对路径就是绝对路径；path 等于 root 时返回 "/"。
+ */
+static std::string_view root_relative(std::string_view path, std::string_view root)
+{
+    if (root == "/")
+        return path;
+    if (path == root)
+        return "/";
+    if (path.size() > root.size() && path.compare(0, root.size(), root) == 0 && path[root.size()] == '/')
+        return path.substr(root.size());
+    return path;
+}
+
+/**
+ * @brief 生成 /api/fs/list 的完整响应体（DirectoryListResponse 的 camelCase JSON）
+ *
+ * 与 Python 侧逐条构造 FileEntry 模型再由 FastAPI 编码的结果逐字节一致：
+ * 字段顺序、null 字段、相对路径（"/" + relative_to(root)，不在 root 下时为绝对路径）、
+ * mtimeIso（本地时间）、type / extension（仅普通文件，Path.suffix 语义）/ isHidden。
+ * 扫描、排序、统计与分页都在释放 GIL 后完成，Python 侧直接作为 Response 返回。
+ *
+ * @param dir_path 目录的绝对路径（已解析）
+ * @param root_path 根目录的绝对路径（已解析）
+ * @param display_path 响应中的 path 字段
+ * @param parent 响应中的 parent 字段（None 或字符串）
+ * @param include_hidden / include_owner / sort_by / sort_desc / dirs_first / follow_symlinks
+ *        同 scandir_recursive（max_depth 固定为 1）
+ * @param offset 分页偏移
+ * @param limit 每页条目数（0 = 不限）
+ * @param scope_roots / exclude_paths / exclude_names 同 scandir_recursive
+ * @return UTF-8 编码的 JSON
+ */
+py::bytes list_directory_json(
+    const std::string &dir_path,
+    const std::string &root_path,
+    const std::string &display_path,
+    const py::object &parent,
+    bool include_hidden = false,
+    bool include_owner = false,
+    const std::string &sort_by = "name",
+    bool sort_desc = false,
+    bool dirs_first = true,
+    bool follow_symlinks = false,
+    size_t offset = 0,
+    size_t limit = 0,
+    const std::vector<std::string> &scope_roots = {},
+    const std::vector<std::string> &exclude_paths = {},
+    const std::vector<std::string> &exclude_names = {})
+{
+    const SortField sort_field = parse_sort_field(sort_by);
+    const bool has_parent = !parent.is_none();
+    const std::string parent_path = has_parent ? parent.cast<std::string>() : std::string();
+
+    if (!fs::is_directory(dir_path))
+    {
+        throw std::runtime_error("Path is not a directory: " + dir_path);
+    }
+
+    const PathScope link_scope(scope_roots, exclude_paths, exclude_names);
+    std::string body;
+    std::vector<std::string> errors;
+    {
+        py::gil_scoped_release release;
+
+        ListingPage page;
+        build_listing_page(dir_path, include_hidden, include_owner, sort_field, sort_desc, dirs_first,
+                           follow_symlinks, link_scope, offset, limit, page, errors);
+        const size_t begin = page.begin, end = page.end;
+        const uint64_t directory_count = page.listing->directory_count;
+        const uint64_t total_size = page.listing->total_size;
+
+        body.reserve(256 + (end - begin) * 256);
+        JsonWriter json(body);
+        json.raw("{\"success\":true,");
+        json.key("path");
+        json.string(display_path);
+        json.raw(",");
+        json.key("parent");
+        if (has_parent)
+            json.string(parent_path);
+        else
+            json.null();
+        json.raw(",\"entries\":[");
+        for (size_t i = begin; i < end; ++i)
+        {
+            const FileInfo &info = page[i];
+            if (i > begin)
+                json.raw(",");
+
+            json.raw("{");
+            json.key("name");
+            json.string(info.name);
+            json.raw(",");
+            json.key("path");
+            json.string(root_relative(info.path, root_path));
+            json.raw(",\"absolutePath\":null,");
+            json.key("size");
+            json.integer(info.size);
+            json.raw(",");
+            json.key("mtime");
+            json.number(info.mtime);
+            json.raw(",");
+            json.key("mtimeIso");
+            json.local_isoformat(info.mtime);
+            json.raw(",");
+            json.key("type");
+            const bool is_file = !info.is_symlink && !info.is_directory;
+            json.raw(info.is_symlink ? "\"symlink\"" : (info.is_directory ? "\"directory\"" : "\"file\""));
+            json.raw(",");
+            json.key("isHidden");
+            json.boolean(!info.name.empty() && info.name[0] == '.');
+            json.raw(",\"permissions\":null,");
+            json.key("extension");
+            if (is_file)
+            {
+                const size_t dot = info.name.rfind('.');
+                if (dot != std::string::npos && dot > 0 && dot + 1 < info.name.size())
+                    json.string(std::string_view(info.name).substr(dot + 1));
+                else
+                    json.raw("\"\"");
+            }
+            else
+            {
+                json.null();
+            }
+            json.raw(",");
+            json.key("owner");
+            info.owner.empty() ? json.null() : json.string(info.owner);
+            json.raw(",");
+            json.key("group");
+            info.owner.empty() ? json.null() : json.string(info.group);
+            json.raw(",\"mimeType\":null,");
+            json.key("linkTarget");
+            info.link_resolved ? json.string(info.link_target) : json.null();
+            json.raw(",");
+            json.key("linkBroken");
+            info.link_resolved ? json.boolean(info.link_broken) : json.null();
+            json.raw("}");
+        }
+        json.raw("],");
+        json.key("totalCount");
+        json.integer(page.size());
+        json.raw(",");
+        json.key("directoryCount");
+        json.integer(directory_count);
+        json.raw(",");
+        json.key("fileCount");
+        json.integer(page.size() - directory_count);
+        json.raw(",");
+        json.key("totalSize");
+        json.integer(total_size);
+        json.raw("}");
+    }
+
+    for (const auto &err : errors)
+    {
+        if (err.find("Fatal error:") == 0)
+        {
+            throw std::runtime_error(err);
+        }
+    }
+    return py::bytes(body);
+}
+
+// ============================================================================
+// 目录列表二进制编码 (MessagePack)
+// ============================================================================
+
+/**
+ * @brief 最小的 MessagePack 编码器（只含目录列表用到的类型，整数取最短编码）
+ */
+class MsgPackWriter
+{
+public:
+    explicit MsgPackWriter(std::string &out) : out_(out) {}
+
+    void nil() { out_.push_back(static_cast<char>(0xc0)); }
+
+    void boolean(bool value) { out_.push_back(static_cast<char>(value ? 0xc3 : 0xc2)); }
+
+    void uint(uint64_t value)
+    {
+        if (value < 0x80)
+            out_.push_back(static_cast<char>(value));
+        else if (value <= 0xff)
+            header(0xcc, value, 1);
+        else if (value <= 0xffff)
+            header(0xcd, value, 2);
+        else if (value <= 0xffffffffULL)
+            header(0xce, value, 4);
+        else
+            header(0xcf, value, 8);
+    }
+
+    void integer(int64_t value)
+    {
+        if (value >= 0)
+            uint(static_cast<uint64_t>(value));
+        else if (value >= -32)
+            out_.push_back(static_cast<char>(value)); // negative fixint
+        else if (value >= INT8_MIN)
+            header(0xd0, static_cast<uint64_t>(value), 1);
+        else if (value >= INT16_MIN)
+            header(0xd1, static_cast<uint64_t>(value), 2);
+        else if (value >= INT32_MIN)
+            header(0xd2, static_cast<uint64_t>(value), 4);
+        else
+            header(0xd3, static_cast<uint64_t>(value), 8);
+    }
+
+    /// 名称按原字节输出；无效的 UTF-8 由解码端替换（TextDecoder 默认行为）
+    void string(std::string_view value)
+    {
+        const size_t n = value.size();
+        if (n < 32)
+            out_.push_back(static_cast<char>(0xa0 | n));
+        else if (n <= 0xff)
+            header(0xd9, n, 1);
+        else if (n <= 0xffff)
+            header(0xda, n, 2);
+        else
+            header(0xdb, n, 4);
+        out_.append(value);
+    }
+
+    void array(size_t n)
+    {
+        if (n < 16)
+            out_.push_back(static_cast<char>(0x90 | n));
+        else if (n <= 0xffff)
+            header(0xdc, n, 2);
+        else
+            header(0xdd, n, 4);
+    }
+
+    void map(size_t n)
+    {
+        if (n < 16)
+            out_.push_back(static_cast<char>(0x80 | n));
+        else if (n <= 0xffff)
+            header(0xde, n, 2);
+        else
+            header(0xdf, n, 4);
+    }
+
+private:
+    /// 类型字节 + width 字节大端整数
+    void header(uint8_t type, uint64_t value, int width)
+    {
+        out_.push_back(static_cast<char>(type));
+        for (int shift = (width - 1) * 8; shift >= 0; shift -= 8)
+            out_.push_back(static_cast<char>((value >> shift) & 0xff));
+    }
+
+    std::string &out_;
+};
+
+/**
+ * @brief 字符串表：相同字符串只存一次，条目记录下标 + 1（0 表示 null）
+ */
+class StringTable
+{
+public:
+    uint32_t index(std::string_view value)
+    {
+        auto [it, inserted] = lookup_.try_emplace(value, static_cast<uint32_t>(values_.size()));
+        if (inserted)
+            values_.push_back(value);
+        return it->second + 1;
+    }
+
+    const std::vector<std::string_view> &values() const { return values_; }
+
+private:
+    std::unordered_map<std::string_view, uint32_t> lookup_;
+    std::vector<std::string_view> values_;
+};
+
+/**
+ * @brief 生成 /api/fs/list 的 MessagePack 响应体（列式，application/x-msgpack）
+ *
+ * 一个 map，页内条目按列存储，同一目录的重复信息只出现一次：
+ * - v: 格式版本（1）；path / parent / totalCount / directoryCount / fileCount / totalSize
+ *   同 JSON 响应；offset 为当前页第一个条目在整目录中的序号
+ * - base: 条目相对路径的公共前缀，条目 path = base + name
+ * - names / sizes: 逐条目
+ * - types: 0 = file，1 = directory，2 = symlink
+ * - mtimes: 整数秒，第一个为绝对值，其后为与前一条目的差值（排序后相邻条目差值通常很小）
+ * - extensions + extIndex: 扩展名字符串表；extIndex 为表下标 + 1，0 表示 null（非普通文件），
+ *   无扩展名的普通文件对应表中的 ""
+ * - owners + ownerIndex / groups + groupIndex: 仅 include_owner 时出现，编码同扩展名
+ * - linkTargets / linkBroken: 仅 follow_symlinks 时出现，未解析的条目为 nil
+ *
+ * isHidden、mtimeIso 由客户端从 name、mtime 推导；absolutePath、permissions、mimeType 总为 null，不编码。
+ * 参数同 list_directory_json。
+ */
+py::bytes list_directory_msgpack(
+    const std::string &dir_path,
+    const std::string &root_path,
+    const std::string &display_path,
+    const py::object &parent,
+    bool include_hidden = false,
+    bool include_owner = false,
+    const std::string &sort_by = "name",
+    bool sort_desc = false,
+    bool dirs_first = true,
+    bool follow_symlinks = false,
+    size_t offset = 0,
+    size_t limit = 0,
+    const std::vector<std::string> &scope_roots = {},
+    const std::vector<std::string> &exclude_paths = {},
+    const std::vector<std::string> &exclude_names = {})
+{
+    const SortField sort_field = parse_sort_field(sort_by);
+    const bool has_parent = !parent.is_none();
+    const std::string parent_path = has_parent ? parent.cast<std::string>() : std::string();
+
+    if (!fs::is_directory(dir_path))
+    {
+        throw std::runtime_error("Path is not a directory: " + dir_path);
+    }
+
+    const PathScope link_scope(scope_roots, exclude_paths, exclude_names);
+    std::string body;
+    std::vector<std::string> errors;
+    {
+        py::gil_scoped_release release;
+
+        ListingPage page;
+        build_listing_page(dir_path, include_hidden, include_owner, sort_field, sort_desc, dirs_first,
+                           follow_symlinks, link_scope, offset, limit, page, errors);
+        const size_t begin = page.begin, end = page.end, count = end - begin;
+
+        // 同一目录下的条目共享父路径：取第一个条目的相对路径去掉名称
+        std::string_view base;
+        if (count > 0)
+        {
+            const std::string_view first = root_relative(page[begin].path, root_path);
+            base = first.substr(0, first.size() - std::min(first.size(), page[begin].name.size()));
+        }
+
+        StringTable extensions, owners, groups;
+        std::vector<uint32_t> ext_index(count), owner_index, group_index;
+        if (include_owner)
+        {
+            owner_index.resize(count);
+            group_index.resize(count);
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            const FileInfo &info = page[begin + i];
+            if (!info.is_symlink && !info.is_directory)
+            {
+                const size_t dot = info.name.rfind('.');
+                const bool has_ext = dot != std::string::npos && dot > 0 && dot + 1 < info.name.size();
+                ext_index[i] = extensions.index(has_ext ? std::string_view(info.name).substr(dot + 1)
+                                                        : std::string_view());
+            }
+            if (include_owner && !info.owner.empty())
+            {
+                owner_index[i] = owners.index(info.owner);
+                group_index[i] = groups.index(info.group);
+            }
+        }
+
+        body.reserve(256 + count * 48);
+        MsgPackWriter pack(body);
+        auto key = [&](std::string_view name) { pack.string(name); };
+        auto string_table = [&](std::string_view table_key, const StringTable &table,
+                                std::string_view index_key, const std::vector<uint32_t> &index) {
+            key(table_key);
+            pack.array(table.values().size());
+            for (const auto &value : table.values())
+                pack.string(value);
+            key(index_key);
+            pack.array(index.size());
+            for (uint32_t idx : index)
+                pack.uint(idx);
+        };
+
+        pack.map(15 + (include_owner ? 4 : 0) + (follow_symlinks ? 2 : 0));
+        key("v");
+        pack.uint(1);
+        key("path");
+        pack.string(display_path);
+        key("parent");
+        if (has_parent)
+            pack.string(parent_path);
+        else
+            pack.nil();
+        key("totalCount");
+        pack.uint(page.size());
+        key("directoryCount");
+        pack.uint(page.listing->directory_count);
+        key("fileCount");
+        pack.uint(page.size() - page.listing->directory_count);
+        key("totalSize");
+        pack.uint(page.listing->total_size);
+        key("offset");
+        pack.uint(begin);
+        key("base");
+        pack.string(base);
+
+        key("names");
+        pack.array(count);
+        for (size_t i = begin; i < end; ++i)
+            pack.string(page[i].name);
+        key("types");
+        pack.array(count);
+        for (size_t i = begin; i < end; ++i)
+            pack.uint(page[i].is_symlink ? 2 : (page[i].is_directory ? 1 : 0));
+        key("sizes");
+        pack.array(count);
+        for (size_t i = begin; i < end; ++i)
+            pack.uint(page[i].size);
+        key("mtimes");
+        pack.array(count);
+        int64_t previous = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const auto mtime = static_cast<int64_t>(page[i].mtime);
+            pack.integer(mtime - previous);
+            previous = mtime;
+        }
+        string_table("extensions", extensions, "extIndex", ext_index);
+
+        if (include_owner)
+        {
+            string_table("owners", owners, "ownerIndex", owner_index);
+            string_table("groups", groups, "groupIndex", group_index);
+        }
+        if (follow_symlinks)
+        {
+            key("linkTargets");
+            pack.array(count);
+            for (size_t i = begin; i < end; ++i)
+                page[i].link_resolved ? pack.string(page[i].link_target) : pack.nil();
+            key("linkBroken");
+            pack.array(count);
+            for (size_t i = begin; i < end; ++i)
+                page[i].link_resolved ? pack.boolean(page[i].link_broken) : pack.nil();
+        }
+    }
+
+    for (const auto &err : errors)
+    {
+        if (err.find("Fatal error:") == 0)
+        {
+            throw std::runtime_error(err);
+        }
+    }
+    return py::bytes(body);
+}
+
+// ============================================================================
+// 稀疏文件支持 (SEEK_DATA / SEEK_HOLE)
+// ============================================================================
+
+/**
+ * @brief 共享零页
+ *
+ * 位于 .bss 段，不占用物理内存。哈希遇到空洞时直接把它喂给 hasher，
+ * 空洞区域不产生任何磁盘 IO，摘要与逐字节读取完全一致。
+ */
+alignas(64) static const uint8_t kZeroPage[64 * 1024] = {};
+
+/**
+ * @brief 文件描述符 RAII 包装
+ */
+class FdGuard
+{
+public:
+    explicit FdGuard(int fd = -1) : fd_(fd) {}
+    ~FdGuard()
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+    FdGuard(const FdGuard &) = delete;
+    FdGuard &operator=(const FdGuard &) = delete;
+
+    int get() const { return fd_; }
+    bool valid() const { return fd_ >= 0; }
+
+private:
+    int fd_;
+};
+
+/**
+ * @brief 将 BLAKE3 摘要转换为十六进制字符串
+ */
+static std::string digest_to_hex(const uint8_t *digest, size_t len)
+{
+    static const char hex_chars[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(len * 2);
+    for (size_t i = 0; i < len; ++i)
+    {
+        hex.push_back(hex_chars[(digest[i] >> 4) & 0x0F]);
+        hex.push_back(hex_chars[digest[i] & 0x0F]);
+    }
+    return hex;
+}
+
+/**
+ * @brief 读取顺序的排序键：同一设备上按第一个数据块的物理位置排列
+ *
+ * 第一个数据块通过 FS_IOC_FIEMAP 查询（不带 FIEMAP_FLAG_SYNC，不触发回写）；
+ * 文件系统不支持（tmpfs / NFS 等）或数据尚未分配（延迟分配）时退回 inode 号，
+ * 多数文件系统按 inode 号分组分配数据块，两者大致同序。
+ * 没有数据的文件（空文件 / 全空洞 / 内联数据）排在最前，打不开的文件排在最后。
+ */
+struct LayoutKey
+{
+    uint64_t dev = 0;
+    int kind = 3;          // 0 无数据 / 1 物理位置 / 2 inode 号 / 3 无法打开
+    uint64_t position = 0;
+
+    bool operator<(const LayoutKey &other) const
+    {
+        if (dev != other.dev)
+            return dev < other.dev;
+        if (kind != other.kind)
+            return kind < other.kind;
+        return position < other.position;
+    }
+};
+
+static LayoutKey layout_key(int fd, const struct stat &st)
+{
+    LayoutKey key;
+    key.dev = static_cast<uint64_t>(st.st_dev);
+    key.kind = 2;
+    key.position = static_cast<uint64_t>(st.st_ino);
+    if (st.st_size == 0)
+    {
+        key.kind = 0;
+        return key;
+    }
+#ifdef __linux__
+    // struct fiemap 以柔性数组结尾，请求缓冲区容纳一个 extent
+    alignas(struct fiemap) uint8_t request[sizeof(struct fiemap) + sizeof(struct fiemap_extent)] = {};
+    auto *map = reinterpret_cast<struct fiemap *>(request);
+    map->fm_start = 0;
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_extent_count = 1;
+    if (::ioctl(fd, FS_IOC_FIEMAP, map) == 0)
+    {
+        const struct fiemap_extent &extent = map->fm_extents[0];
+        if (map->fm_mapped_extents == 0 || (extent.fe_flags & FIEMAP_EXTENT_DATA_INLINE))
+        {
+            key.kind = 0;
+        }
+        else if (!(extent.fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC)))
+        {
+            key.kind = 1;
+            key.position = extent.fe_physical;
+        }
+    }
+#else
+    (void)fd;
+#endif
+    return key;
+}
+
+/**
+ * @brief 按数据段 / 空洞段遍历文件 [0, size)
+ *
+ * 使用 lseek(SEEK_DATA/SEEK_HOLE) 枚举数据区间，空洞区间交给 on_hole，
+ * 数据区间交给 on_data。文件系统不支持时（EINVAL / EOPNOTSUPP），
+ * 整个剩余范围视为一个数据段，行为退化为普通顺序读取。
+ *
+ * 回调签名：bool(uint64_t offset, uint64_t length)，返回 false 表示中止。
+ *
+ * @return 成功遍历返回 true；lseek 出错或回调中止返回 false
+ */
+template <typename DataFn, typename HoleFn>
+static bool for_each_extent(int fd, uint64_t size, DataFn &&on_data, HoleFn &&on_hole)
+{
+    uint64_t offset = 0;
+
+    while (offset < size)
+    {
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+        off_t data = ::lseek(fd, static_cast<off_t>(offset), SEEK_DATA);
+        if (data < 0)
+        {
+            if (errno == ENXIO)
+            {
+                // offset 之后全部是空洞
+                return on_hole(offset, size - offset);
+            }
+            if (errno == EINVAL || errno == EOPNOTSUPP)
+            {
+                return on_data(offset, size - offset);
+            }
+            return false;
+        }
+
+        uint64_t data_start = std::min<uint64_t>(static_cast<uint64_t>(data), size);
+        if (data_start > offset && !on_hole(offset, data_start - offset))
+            return false;
+        if (data_start >= size)
+            break;
+
+        off_t hole = ::lseek(fd, static_cast<off_t>(data_start), SEEK_HOLE);
+        uint64_t data_end = hole < 0 ? size : std::min<uint64_t>(static_cast<uint64_t>(hole), size);
+        if (!on_data(data_start, data_end - data_start))
+            return false;
+        offset = data_end;
+#else
+        return on_data(offset, size - offset);
+#endif
+    }
+    return true;
+}
+
+/**
+ * @brief 使用 pread 完整读取 [offset, offset + length)
+ *
+ * @return 实际读取的字节数；遇到 EOF 时可能小于 length，出错返回 -1
+ */
+static ssize_t pread_full(int fd, uint8_t *buffer, size_t length, uint64_t offset)
+{
+    size_t total = 0;
+    while (total < length)
+    {
+        ssize_t n = ::pread(fd, buffer + total, length - total,
+                            static_cast<off_t>(offset + total));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (n == 0)
+            break;
+        total += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(total);
+}
+
+/**
+ * @brief 原子写入整个文件：同目录临时文件 → fsync → rename → fsync 目录
+ *
+ * 临时文件由 mkostemp 以随机名 + O_EXCL 创建：不会跟随他人预先放置的符号链接，
+ * 同一进程内对同一目标的并发写入也各用各的临时文件，不会 rename 出半截内容。
+ *
+ * @param path 目标文件路径
+ * @param data 完整文件内容
+ * @param mode 目标文件权限位
+ * @throws FsError 创建、写入或 rename 失败（临时文件已删除）
+ */
+static void atomic_write_file(const std::string &path, std::string_view data, mode_t mode)
+{
+    std::string tmp_path = path + ".XXXXXX";
+    FdGuard fd(::mkostemp(&tmp_path[0], O_CLOEXEC));
+    if (!fd.valid())
+        throw FsError(errno, path);
+
+    int err = 0;
+    size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t n = ::write(fd.get(), data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            err = n < 0 ? errno : EIO;
+            break;
+        }
+        written += static_cast<size_t>(n);
+    }
+    if (err == 0 && (::fchmod(fd.get(), mode) != 0 || ::fsync(fd.get()) != 0))
+        err = errno;
+    if (err == 0 && ::rename(tmp_path.c_str(), path.c_str()) != 0)
+        err = errno;
+    if (err != 0)
+    {
+        ::unlink(tmp_path.c_str());
+        throw FsError(err, path);
+    }
+
+    // rename 本身也要落盘，否则掉电后目录里可能仍是旧文件
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    FdGuard dir_fd(::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (dir_fd.valid())
+        ::fsync(dir_fd.get());
+}
+
+/**
+ * @brief 对已打开的文件计算 BLAKE3（空洞感知）
+ *
+ * 数据段通过 pread 读入 buffer，空洞段从 kZeroPage 直接喂给 hasher。
+ * 给定 IoGovernor 槽位时，每次 pread 的延迟作为该设备的延迟样本。
+ * 每个数据块计入限速用量，读取之前经过检查点（等待期间归还槽位）。
+ *
+ * @return 成功返回 true；读取错误返回 false（errno 保留）
+ */
+static bool blake3_hash_fd(int fd, uint64_t size, uint8_t *buffer, size_t chunk_size,
+                           uint8_t output[BLAKE3_OUT_LEN], IoGovernor::Slot *slot = nullptr)
+{
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+
+    auto on_data = [&](uint64_t offset, uint64_t length) -> bool
+    {
+        uint64_t end = offset + length;
+        while (offset < end)
+        {
+            if (slot)
+                slot->checkpoint();
+            else
+                io_checkpoint();
+            size_t want = static_cast<size_t>(std::min<uint64_t>(chunk_size, end - offset));
+            const uint64_t start = slot ? monotonic_ns() : 0;
+            ssize_t n = pread_full(fd, buffer, want, offset);
+            if (slot)
+                slot->record(monotonic_ns() - start);
+            if (n < 0)
+                return false;
+            if (n == 0)
+                break; // 文件在哈希期间被截断
+            io_charge(static_cast<uint64_t>(n), 1);
+            blake3_hasher_update(&hasher, buffer, static_cast<size_t>(n));
+            offset += static_cast<uint64_t>(n);
+        }
+        return true;
+    };
+
+    auto on_hole = [&](uint64_t, uint64_t length) -> bool
+    {
+        while (length > 0)
+        {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(sizeof(kZeroPage), length));
+            blake3_hasher_update(&hasher, kZeroPage, n);
+            length -= n;
+        }
+        return true;
+    };
+
+    if (!for_each_extent(fd, size, on_data, on_hole))
+        return false;
+
+    blake3_hasher_finalize(&hasher, output, BLAKE3_OUT_LEN);
+    return true;
+}
+
+/**
+ * @brief 计算文件的 BLAKE3 哈希值
+ *
+ * BLAKE3 是一种现代加密哈希算法，具有以下优势：
+ * - 比 SHA-256 快 5-10 倍
+ * - 原生支持并行计算
+ * - 安全性与 SHA-3 相当
+ *
+ * 稀疏文件：
+ * - 通过 SEEK_DATA/SEEK_HOLE 跳过空洞，空洞部分以共享零页参与哈希
+ * - 摘要与逐字节读取完全一致，但空洞不产生任何 IO
+ *
+ * 内存安全策略：
+ * - 读取缓冲区由 unique_ptr 管理
+ * - 哈希状态在栈上分配
+ * - 文件描述符使用 RAII (FdGuard 自动关闭)
+ *
+ * GIL 释放策略：
+ * - 文件读取和哈希计算期间释放 GIL
+ * - 这允许其他 Python 线程在等待 IO 时执行
+ *
+ * @param file_path 要计算哈希的文件路径
+ * @param chunk_size 读取缓冲区大小（0 = 按设备画像自动选择）
+ * @param priority 优先级："interactive"（默认）或 "background"
+ * @param limiter 可选的 RateLimiter（字节 / IOPS 限速）
+ * @return 64 字符的十六进制哈希字符串
+ * @throws std::runtime_error 如果文件无法打开或读取错误
+ */
+std::string calculate_blake3(
+    const std::string &file_path,
+    size_t chunk_size = 0,
+    const std::string &priority = "interactive",
+    std::shared_ptr<RateLimiter> limiter = nullptr)
+{
+    const IoPriority io_priority = parse_io_priority(priority);
+
+    // BLAKE3 输出长度 (32 bytes = 256 bits)
+    uint8_t output[BLAKE3_OUT_LEN];
+
+    // ========================================================================
+    // 关键：释放 GIL 进行耗时的文件读取和哈希计算
+    // ========================================================================
+    {
+        py::gil_scoped_release release;
+        IoPriorityScope priority_scope(io_priority);
+        RateLimitScope limit_scope(limiter.get());
+
+        // 打开文件后用 fstat 校验类型，避免 exists + is_regular_file 的额外 stat
+        FdGuard fd(::open(file_path.c_str(), O_RDONLY | O_CLOEXEC));
+        if (!fd.valid())
+        {
+            if (errno == ENOENT)
+                throw std::runtime_error("File does not exist: " + file_path);
+            throw std::runtime_error("Cannot open file: " + file_path);
+        }
+
+        struct stat st;
+        if (::fstat(fd.get(), &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            throw std::runtime_error("Path is not a regular file: " + file_path);
+        }
+
+        if (chunk_size == 0)
+        {
+            chunk_size = DeviceTuner::instance()
+                             .profile(st.st_dev, fd.get(), static_cast<uint64_t>(st.st_size))
+                             .buffer_size;
+        }
+
+        // 分配读取缓冲区（使用 unique_ptr 确保内存安全）
+        std::unique_ptr<uint8_t[]> buffer(new uint8_t[chunk_size]);
+
+        if (!blake3_hash_fd(fd.get(), static_cast<uint64_t>(st.st_size),
+                            buffer.get(), chunk_size, output))
+        {
+            throw std::runtime_error("Error reading file: " + file_path);
+        }
+    }
+    // GIL 已自动重新获取
+
+    return digest_to_hex(output, BLAKE3_OUT_LEN);
+}
+
+/**
+ * @brief 批量计算多个文件的 BLAKE3 哈希
+ *
+ * 使用多线程并行计算多个文件的哈希值（同样跳过稀疏文件空洞）。
+ * 每个文件的读取占用所在设备的一个 IoGovernor 槽位，
+ * 同一网络挂载上同时在读的文件数受设备上限约束。
+ * 线程数与每个文件的读取缓冲区大小取自 DeviceTuner 的设备画像。
+ *
+ * 按物理布局排序（order="physical"，或 "auto" 且批次中有机械盘上的文件）：
+ * 先逐个查询文件第一个数据块的物理位置（LayoutKey），再按设备、位置的顺序
+ * 领取文件，磁头大致单向扫过磁盘，而不是按名称顺序来回寻道。
+ * 排序只改变读取顺序，结果与不排序时相同。
+ *
+ * @param file_paths 文件路径列表
+ * @param num_threads 线程数（0 = 按设备画像自动选择）
+ * @param priority 优先级："interactive"（默认）或 "background"
+ * @param limiter 可选的 RateLimiter（字节 / IOPS 限速）
+ * @param order 读取顺序："auto"（默认）/ "physical" / "none"
+ * @return Python 字典，key 为路径，value 为哈希值
+ * @throws std::invalid_argument order 无效
+ */
+py::dict calculate_blake3_batch(
+    const std::vector<std::string> &file_paths,
+    int num_threads = 0,
+    const std::string &priority = "interactive",
+    std::shared_ptr<RateLimiter> limiter = nullptr,
+    const std::string &order = "auto")
+{
+    const IoPriority io_priority = parse_io_priority(priority);
+    if (order != "auto" && order != "physical" && order != "none")
+        throw std::invalid_argument("order must be 'auto', 'physical' or 'none'");
+
+    // 存储结果
+    std::vector<std::string> results(file_paths.size());
+    std::vector<std::string> errors(file_paths.size());
+
+    // ========================================================================
+    // 释放 GIL 进行多线程哈希计算
+    // ========================================================================
+    {
+        py::gil_scoped_release release;
+        IoPriorityScope priority_scope(io_priority);
+        RateLimitScope limit_scope(limiter.get());
+
+        DeviceTuner &tuner = DeviceTuner::instance();
+        const DeviceTuner::BatchPlan plan = tuner.plan_for(file_paths);
+        const int threads = num_threads > 0 ? num_threads : plan.threads;
+
+        // 读取顺序：默认按输入顺序，机械盘上按物理位置
+        std::vector<size_t> sequence(file_paths.size());
+        for (size_t i = 0; i < sequence.size(); ++i)
+            sequence[i] = i;
+        if (file_paths.size() > 1 && (order == "physical" || (order == "auto" && plan.rotational)))
+        {
+            std::vector<LayoutKey> keys(file_paths.size());
+            parallel_for(file_paths.size(), threads, [&](size_t idx, size_t)
+            {
+                FdGuard fd(::open(file_paths[idx].c_str(), O_RDONLY | O_CLOEXEC));
+                struct stat st;
+                if (fd.valid() && ::fstat(fd.get(), &st) == 0)
+                    keys[idx] = layout_key(fd.get(), st);
+                io_charge(0, 1);
+            });
+            std::stable_sort(sequence.begin(), sequence.end(), [&](size_t a, size_t b)
+                             { return keys[a] < keys[b]; });
+        }
+
+        // 每个工作线程一个读取缓冲区（按需分配，设备需要更大的缓冲区时重新分配）
+        std::vector<std::unique_ptr<uint8_t[]>> buffers(static_cast<size_t>(threads));
+        std::vector<size_t> buffer_sizes(buffers.size(), 0);
+
+        parallel_for(file_paths.size(), threads, [&](size_t position, size_t worker_id)
+        {
+            const size_t idx = sequence[position];
+            auto &buffer = buffers[worker_id];
+            const auto &path = file_paths[idx];
+            uint8_t output[BLAKE3_OUT_LEN];
+
+            try
+            {
+                FdGuard fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+                if (!fd.valid())
+                {
+                    errors[idx] = "Cannot open file";
+                    return;
+                }
+
+                struct stat st;
+                if (::fstat(fd.get(), &st) != 0 || !S_ISREG(st.st_mode))
+                {
+                    errors[idx] = "Not a regular file";
+                    return;
+                }
+
+                const size_t chunk_size =
+                    tuner.profile(st.st_dev, fd.get(), static_cast<uint64_t>(st.st_size)).buffer_size;
+                if (buffer_sizes[worker_id] < chunk_size)
+                {
+                    buffer.reset(new uint8_t[chunk_size]);
+                    buffer_sizes[worker_id] = chunk_size;
+                }
+
+                IoGovernor::Slot slot = IoGovernor::instance().acquire(st.st_dev);
+                if (!blake3_hash_fd(fd.get(), static_cast<uint64_t>(st.st_size),
+                                    buffer.get(), chunk_size, output,
+                                    slot.active() ? &slot : nullptr))
+                {
+                    errors[idx] = "Error reading file";
+                    return;
+                }
+
+                results[idx] = digest_to_hex(output, BLAKE3_OUT_LEN);
+            }
+            catch (const std::exception &e)
+            {
+                errors[idx] = e.what();
+            }
+        });
+    }
+    // GIL 已重新获取
+
+    // 构建返回结果
+    py::dict py_results;
+    for (size_t i = 0; i < file_paths.size(); ++i)
+    {
+        if (errors[i].empty() && !results[i].empty())
+        {
+            py_results[py::str(file_paths[i])] = results[i];
+        }
+        else
+        {
+            // 包含错误信息
+            py::dict error_info;
+            error_info["error"] = errors[i].empty() ? "Unknown error" : errors[i];
+            py_results[py::str(file_paths[i])] = error_info;
+        }
+    }
+
+    return py_results;
+}
+
+/**
+ * @brief 复制扩展属性，语义同 shutil._copyxattr
+ *
+ * 逐个 fgetxattr / fsetxattr；源或目标文件系统不支持、没有权限设置
+ * （如非 root 写 trusted.* / security.*）或属性在列举后消失时跳过该属性，
+ * 其他错误抛出 FsError。非 Linux 平台无操作。
+ */
+static void copy_xattrs(int src_fd, int dst_fd, const std::string &dst_path)
+{
+#ifdef __linux__
+    auto ignorable = [](int err)
+    { return err == ENOTSUP || err == EOPNOTSUPP || err == ENODATA || err == EPERM || err == EINVAL || err == EACCES; };
+
+    std::string names;
+    while (true)
+    {
+        ssize_t n = ::flistxattr(src_fd, nullptr, 0);
+        if (n < 0)
+        {
+            if (ignorable(errno))
+                return;
+            throw FsError(errno, dst_path);
+        }
+        if (n == 0)
+            return;
+        names.resize(static_cast<size_t>(n));
+        n = ::flistxattr(src_fd, &names[0], names.size());
+        if (n >= 0)
+        {
+            names.resize(static_cast<size_t>(n));
+            break;
+        }
+        if (errno != ERANGE) // 两次调用之间列表变长时重试
+        {
+            if (ignorable(errno))
+                return;
+            throw FsError(errno, dst_path);
+        }
+    }
+
+    std::string value;
+    for (size_t pos = 0; pos < names.size();)
+    {
+        const char *name = names.c_str() + pos;
+        pos += std::strlen(name) + 1;
+
+        ssize_t n;
+        while (true)
+        {
+            n = ::fgetxattr(src_fd, name, nullptr, 0);
+            if (n <= 0)
+                break;
+            value.resize(static_cast<size_t>(n));
+            n = ::fgetxattr(src_fd, name, &value[0], value.size());
+            if (n >= 0 || errno != ERANGE)
+                break;
+        }
+        if (n < 0)
+        {
+            if (ignorable(errno))
+                continue;
+            throw FsError(errno, dst_path);
+        }
+        value.resize(static_cast<size_t>(n));
+        if (::fsetxattr(dst_fd, name, value.data(), value.size(), 0) != 0 && !ignorable(errno))
+            throw FsError(errno, dst_path);
+    }
+#else
+    (void)src_fd;
+    (void)dst_fd;
+    (void)dst_path;
+#endif
+}
+
+/**
+ * @brief 复制单个文件，保留稀疏空洞
+ *
+ * 与 shutil.copy2 逐字节复制不同，这里先把目标文件 ftruncate 到源文件大小
+ * （全部为空洞），再只复制 SEEK_DATA 枚举出的数据段：
+ * - 空洞既不读取也不写入，目标文件保持同样的稀疏布局
+ * - Linux 上数据段使用 copy_file_range（同一文件系统可走 reflink / 服务端复制）
+ * - copy_file_range 不可用时退回 pread/pwrite
+ *
+ * @param src_path 源文件路径
+ * @param dst_path 目标文件路径（已存在时会被截断覆盖）
+ * @param preserve_metadata 是否保留扩展属性、权限位与访问/修改时间（同 copy2）
+ * @return Python 字典：size / bytes_copied / holes_skipped
+ * @throws std::runtime_error 如果源文件不是普通文件、目标与源是同一文件或读写失败
+ */
+py::dict copy_file(
+    const std::string &src_path,
+    const std::string &dst_path,
+    bool preserve_metadata = true)
+{
+    uint64_t size = 0, bytes_copied = 0, holes_skipped = 0;
+
+    {
+        py::gil_scoped_release release;
+
+        FdGuard src(::open(src_path.c_str(), O_RDONLY | O_CLOEXEC));
+        if (!src.valid())
+        {
+            throw std::runtime_error("Cannot open source file: " + src_path);
+        }
+
+        struct stat st;
+        if (::fstat(src.get(), &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            throw std::runtime_error("Source is not a regular file: " + src_path);
+        }
+        size = static_cast<uint64_t>(st.st_size);
+
+        // 不带 O_TRUNC 打开：目标可能就是源文件本身（同一路径、硬链接，
+        // 或 copytree 拼出的同目录路径），必须先比较 inode 再截断
+        FdGuard dst(::open(dst_path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC,
+                           st.st_mode & 07777));
+        if (!dst.valid())
+        {
+            throw std::runtime_error("Cannot open destination file: " + dst_path);
+        }
+
+        struct stat dst_st;
+        if (::fstat(dst.get(), &dst_st) != 0)
+        {
+            throw FsError(errno, dst_path);
+        }
+        if (dst_st.st_dev == st.st_dev && dst_st.st_ino == st.st_ino)
+        {
+            throw std::runtime_error("'" + src_path + "' and '" + dst_path +
+                                     "' are the same file");
+        }
+
+        // 先清空再扩展到完整大小：未写入的区域天然就是空洞，
+        // 不会残留目标旧内容
+        if (::ftruncate(dst.get(), 0) != 0 ||
+            ::ftruncate(dst.get(), static_cast<off_t>(size)) != 0)
+        {
+            throw std::runtime_error("Cannot resize destination file: " + dst_path);
+        }
+
+        const size_t chunk_size = 1024 * 1024;
+        std::unique_ptr<uint8_t[]> buffer;
+#ifdef __linux__
+        bool use_copy_range = true;
+#endif
+
+        auto on_data = [&](uint64_t offset, uint64_t length) -> bool
+        {
+            uint64_t end = offset + length;
+            while (offset < end)
+            {
+                size_t want = static_cast<size_t>(std::min<uint64_t>(chunk_size, end - offset));
+#ifdef __linux__
+                if (use_copy_range)
+                {
+                    loff_t in_off = static_cast<loff_t>(offset);
+                    loff_t out_off = static_cast<loff_t>(offset);
+                    ssize_t n = ::copy_file_range(src.get(), &in_off, dst.get(), &out_off, want, 0);
+                    if (n > 0)
+                    {
+                        offset += static_cast<uint64_t>(n);
+                        bytes_copied += static_cast<uint64_t>(n);
+                        continue;
+                    }
+                    if (n == 0)
+                        break; // 源文件被截断
+                    if (errno == EINTR)
+                        continue;
+                    if (errno != EXDEV && errno != ENOSYS && errno != EINVAL &&
+                        errno != EOPNOTSUPP && errno != EBADF)
+                        return false;
+                    use_copy_range = false; // 跨文件系统等情况，退回 pread/pwrite
+                }
+#endif
+                if (!buffer)
+                    buffer.reset(new uint8_t[chunk_size]);
+
+                ssize_t n = pread_full(src.get(), buffer.get(), want, offset);
+                if (n < 0)
+                    return false;
+                if (n == 0)
+                    break;
+
+                size_t written = 0;
+                while (written < static_cast<size_t>(n))
+                {
+                    ssize_t w = ::pwrite(dst.get(), buffer.get() + written,
+                                         static_cast<size_t>(n) - written,
+                                         static_cast<off_t>(offset + written));
+                    if (w < 0)
+                    {
+                        if (errno == EINTR)
+                            continue;
+                        return false;
+                    }
+                    written += static_cast<size_t>(w);
+                }
+                offset += static_cast<uint64_t>(n);
+                bytes_copied += static_cast<uint64_t>(n);
+            }
+            return true;
+        };
+
+        auto on_hole = [&](uint64_t, uint64_t length) -> bool
+        {
+            holes_skipped += length;
+            return true;
+        };
+
+        if (!for_each_extent(src.get(), size, on_data, on_hole))
+        {
+            throw std::runtime_error("Error copying " + src_path + " -> " + dst_path +
+                                     ": " + std::strerror(errno));
+        }
+
+        if (preserve_metadata)
+        {
+            // 与 shutil.copy2 一致：保留扩展属性、权限位和 atime/mtime（纳秒精度）；
+            // 先复制扩展属性：user.* 需要写权限，目标 fchmod 成只读后会失败
+            copy_xattrs(src.get(), dst.get(), dst_path);
+            ::fchmod(dst.get(), st.st_mode & 07777);
+            struct timespec times[2] = {st.st_atim, st.st_mtim};
+            ::futimens(dst.get(), times);
+        }
+    }
+
+    py::dict result;
+    result["size"] = size;
+    result["bytes_copied"] = bytes_copied;
+    result["holes_skipped"] = holes_skipped;
+    return result;
+}
+
+/**
+ * @brief 根据 stat 结果的属主 / 属组 / 权限位推导访问权限
+ *
+ * 不考虑 ACL、只读挂载等，仅作为 faccessat 不可用时的降级。
+ * root 用户可读写，只要任一执行位存在（或是目录）即可执行。
+ */
+static void mode_access(const FileStat &st, bool &readable, bool &writable, bool &executable)
+{
+    // 进程的附加组在运行期间基本不变，只获取一次
+    static const std::vector<gid_t> supplementary_groups = []()
+    {
+        std::vector<gid_t> groups;
+        int count = ::getgroups(0, nullptr);
+        if (count > 0)
+        {
+            groups.resize(static_cast<size_t>(count));
+            count = ::getgroups(count, groups.data());
+            groups.resize(count > 0 ? static_cast<size_t>(count) : 0);
+        }
+        return groups;
+    }();
+
+    const uid_t euid = ::geteuid();
+    const uint32_t mode = st.mode;
+
+    if (euid == 0)
+    {
+        readable = true;
+        writable = true;
+        executable = S_ISDIR(mode) || (mode & (S_IXUSR | S_IXGRP | S_IXOTH)) != 0;
+        return;
+    }
+
+    uint32_t shift = 0; // 其他用户
+    if (st.uid == euid)
+    {
+        shift = 6;
+    }
+    else if (st.gid == ::getegid() ||
+             std::find(supplementary_groups.begin(), supplementary_groups.end(),
+                       static_cast<gid_t>(st.gid)) != supplementary_groups.end())
+    {
+        shift = 3;
+    }
+
+    readable = ((mode >> shift) & 04) != 0;
+    writable = ((mode >> shift) & 02) != 0;
+    executable = ((mode >> shift) & 01) != 0;
+}
+
+/**
+ * @brief 计算当前进程对文件的有效访问权限
+ *
+ * 使用 faccessat(AT_EACCESS) 由内核判定，ACL、只读挂载、不可变属性等
+ * 都会被计入（与原先 Python 侧 os.access 的结果一致）。
+ * 内核明确拒绝（EACCES / EPERM / EROFS / ETXTBSY）即为不可访问；
+ * 其他错误（如不支持 AT_EACCESS）时该项退回权限位推导。
+ */
+static void effective_access(const char *path, const FileStat &st,
+                             bool &readable, bool &writable, bool &executable)
+{
+    mode_access(st, readable, writable, executable);
+
+    auto check = [path](int mode, bool &result)
+    {
+        if (::faccessat(AT_FDCWD, path, mode, AT_EACCESS) == 0)
+            result = true;
+        else if (errno == EACCES || errno == EPERM || errno == EROFS || errno == ETXTBSY)
+            result = false;
+    };
+    check(R_OK, readable);
+    check(W_OK, writable);
+    check(X_OK, executable);
+}
+
+/**
+ * @brief 获取文件详细信息
+ *
+ * 基于一次 statx(AT_SYMLINK_NOFOLLOW) 获取全部元数据；
+ * 仅当条目是符号链接时再对目标发起一次 statx。
+ * 类型、大小、时间、权限均以链接目标为准（与原 fs::status 语义一致），
+ * is_symlink 以链接本身为准。
+ *
+ * 额外返回 uid / gid / inode / nlink / blocks / btime 以及有效访问权限
+ * （faccessat 判定），Python 层无需再调用 stat() 和 os.access()。属主 / 属组名称经 IdNameCache 解析。
+ *
+ * @param file_path 文件路径
+ * @return Python 字典包含详细文件信息
+ * @throws FsError 如果路径不存在或无法访问（映射为 Python OSError）
+ */
+py::dict get_file_info(const std::string &file_path)
+{
+    fs::path path(file_path);
+
+    // 在 C++ 结构中收集数据，避免在 GIL 释放期间操作 Python 对象
+    FileStat link_stat, st;
+    std::string owner, group;
+    bool is_symlink_val = false;
+    bool is_readable = false, is_writable = false, is_executable = false;
+    int err = 0;
+
+    {
+        py::gil_scoped_release release;
+
+        err = stat_path(AT_FDCWD, file_path.c_str(), false, link_stat);
+        if (err == 0)
+        {
+            is_symlink_val = S_ISLNK(link_stat.mode);
+            if (is_symlink_val)
+                err = stat_path(AT_FDCWD, file_path.c_str(), true, st);
+            else
+                st = link_stat;
+        }
+        if (err == 0)
+        {
+            effective_access(file_path.c_str(), st, is_readable, is_writable, is_executable);
+            owner = IdNameCache::instance().user_name(st.uid);
+            group = IdNameCache::instance().group_name(st.gid);
+        }
+    }
+    // GIL 已重新获取，现在安全地构建 Python 字典
+
+    if (err != 0)
+    {
+        throw FsError(err, file_path);
+    }
+
+    // 名称、扩展名、父目录都是纯字符串运算，不涉及系统调用
+    py::dict info;
+    info["path"] = path.string();
+    info["name"] = path.filename().string();
+    info["extension"] = path.extension().string();
+    info["parent"] = path.parent_path().string();
+    info["is_regular_file"] = S_ISREG(st.mode);
+    info["is_directory"] = S_ISDIR(st.mode);
+    info["is_symlink"] = is_symlink_val;
+    info["is_block_file"] = S_ISBLK(st.mode);
+    info["is_character_file"] = S_ISCHR(st.mode);
+    info["is_fifo"] = S_ISFIFO(st.mode);
+    info["is_socket"] = S_ISSOCK(st.mode);
+    info["size"] = S_ISREG(st.mode) ? st.size : 0;
+    info["mtime"] = static_cast<double>(st.mtime_ns) / 1e9;
+    info["atime"] = static_cast<double>(st.atime_ns) / 1e9;
+    info["ctime"] = static_cast<double>(st.ctime_ns) / 1e9;
+    if (st.has_btime)
+        info["btime"] = static_cast<double>(st.btime_ns) / 1e9;
+    else
+        info["btime"] = py::none();
+    info["permissions"] = st.mode & 07777;
+    info["mode"] = st.mode;
+    info["uid"] = st.uid;
+    info["gid"] = st.gid;
+    info["owner"] = owner;
+    info["group"] = group;
+    info["inode"] = st.ino;
+    info["dev"] = st.dev;
+    info["nlink"] = st.nlink;
+    info["blocks"] = st.blocks;
+    info["is_readable"] = is_readable;
+    info["is_writable"] = is_writable;
+    info["is_executable"] = is_executable;
+
+    return info;
+}
+
+/**
+ * @brief stat_batch 支持的字段
+ */
+enum class StatField
+{
+    Type,
+    Mode,
+    Size,
+    Mtime,
+    Atime,
+    Ctime,
+    Btime,
+    Uid,
+    Gid,
+    Ino,
+    Dev,
+    Nlink,
+    Blocks,
+    Realpath,
+};
+
+/**
+ * @brief 解析字段名，同时累积对应的 statx 掩码
+ *
+ * @throws std::invalid_argument 如果字段名未知
+ */
+static StatField parse_stat_field(const std::string &name, unsigned int &mask)
+{
+    struct Entry
+    {
+        const char *name;
+        StatField field;
+        unsigned int mask;
+    };
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+    static const Entry table[] = {
+        {"type", StatField::Type, STATX_TYPE},
+        {"mode", StatField::Mode, STATX_TYPE | STATX_MODE},
+        {"size", StatField::Size, STATX_SIZE},
+        {"mtime", StatField::Mtime, STATX_MTIME},
+        {"atime", StatField::Atime, STATX_ATIME},
+        {"ctime", StatField::Ctime, STATX_CTIME},
+        {"btime", StatField::Btime, STATX_BTIME},
+        {"uid", StatField::Uid, STATX_UID},
+        {"gid", StatField::Gid, STATX_GID},
+        {"ino", StatField::Ino, STATX_INO},
+        {"dev", StatField::Dev, 0},
+        {"nlink", StatField::Nlink, STATX_NLINK},
+        {"blocks", StatField::Blocks, STATX_BLOCKS},
+        {"realpath", StatField::Realpath, 0},
+    };
+#else
+    static const Entry table[] = {
+        {"type", StatField::Type, 0},
+        {"mode", StatField::Mode, 0},
+        {"size", StatField::Size, 0},
+        {"mtime", StatField::Mtime, 0},
+        {"atime", StatField::Atime, 0},
+        {"ctime", StatField::Ctime, 0},
+        {"btime", StatField::Btime, 0},
+        {"uid", StatField::Uid, 0},
+        {"gid", StatField::Gid, 0},
+        {"ino", StatField::Ino, 0},
+        {"dev", StatField::Dev, 0},
+        {"nlink", StatField::Nlink, 0},
+        {"blocks", StatField::Blocks, 0},
+        {"realpath", StatField::Realpath, 0},
+    };
+#endif
+    for (const auto &entry : table)
+    {
+        if (name == entry.name)
+        {
+            mask |= entry.mask;
+            return entry.field;
+        }
+    }
+    throw std::invalid_argument("Unknown stat field: " + name);
+}
+
+/**
+ * @brief 批量获取文件元数据（列式结果）
+ *
+ * 在工作线程池中并行对每个路径发起一次 statx（只请求所需字段），
+ * 将数百次串行的 Python stat 调用合并为一次并行调用。
+ *
+ * 返回列式字典：每个请求字段对应一个与 paths 等长的列表，
+ * 另有 "error" 列（成功为 None，失败为错误信息），失败行的其他列为 None。
+ *
+ * @param paths 路径列表
+ * @param fields 字段列表（type/mode/size/mtime/atime/ctime/btime/uid/gid/
+ *               ino/dev/nlink/blocks/realpath），为空时返回 type/size/mtime
+ * @param follow_symlinks 是否跟随符号链接（默认 True，同 os.stat）
+ * @param num_threads 线程数（0 = CPU 核心数）
+ * @return 列式字典
+ * @throws std::invalid_argument 如果包含未知字段
+ */
+py::dict stat_batch(
+    const std::vector<std::string> &paths,
+    const std::vector<std::string> &fields = {},
+    bool follow_symlinks = true,
+    int num_threads = 0)
+{
+    std::vector<std::string> field_names = fields;
+    if (field_names.empty())
+        field_names = {"type", "size", "mtime"};
+
+    unsigned int mask = 0;
+    std::vector<StatField> parsed;
+    parsed.reserve(field_names.size());
+    bool want_stat = false, want_realpath = false;
+    for (const auto &name : field_names)
+    {
+        StatField field = parse_stat_field(name, mask);
+        parsed.push_back(field);
+        if (field == StatField::Realpath)
+            want_realpath = true;
+        else
+            want_stat = true;
+    }
+#if defined(__linux__) && defined(STATX_TYPE)
+    mask |= STATX_TYPE; // 始终需要类型信息
+#endif
+
+    std::vector<FileStat> stats(paths.size());
+    std::vector<std::string> realpaths(want_realpath ? paths.size() : 0);
+    std::vector<int> errnos(paths.size(), 0);
+
+    {
+        py::gil_scoped_release release;
+
+        parallel_for(paths.size(), num_threads, [&](size_t idx, size_t)
+        {
+            const char *path = paths[idx].c_str();
+            if (want_stat)
+            {
+                int err = stat_path(AT_FDCWD, path, follow_symlinks, stats[idx], mask);
+                if (err != 0)
+                {
+                    errnos[idx] = err;
+                    return;
+                }
+            }
+            if (want_realpath)
+            {
+                char *resolved = ::realpath(path, nullptr);
+                if (!resolved)
+                {
+                    errnos[idx] = errno;
+                    return;
+                }
+                realpaths[idx] = resolved;
+                ::free(resolved);
+            }
+        });
+    }
+
+    // 构建列式结果
+    std::vector<py::list> columns(parsed.size());
+    py::list error_column;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (errnos[i] != 0)
+        {
+            for (auto &column : columns)
+                column.append(py::none());
+            error_column.append(std::string(std::strerror(errnos[i])));
+            continue;
+        }
+
+        const FileStat &st = stats[i];
+        for (size_t f = 0; f < parsed.size(); ++f)
+        {
+            auto &column = columns[f];
+            switch (parsed[f])
+            {
+            case StatField::Type:
+                column.append(file_type_name(st.mode));
+                break;
+            case StatField::Mode:
+                column.append(st.mode);
+                break;
+            case StatField::Size:
+                column.append(st.size);
+                break;
+            case StatField::Mtime:
+                column.append(static_cast<double>(st.mtime_ns) / 1e9);
+                break;
+            case StatField::Atime:
+                column.append(static_cast<double>(st.atime_ns) / 1e9);
+                break;
+            case StatField::Ctime:
+                column.append(static_cast<double>(st.ctime_ns) / 1e9);
+                break;
+            case StatField::Btime:
+                if (st.has_btime)
+                    column.append(static_cast<double>(st.btime_ns) / 1e9);
+                else
+                    column.append(py::none());
+                break;
+            case StatField::Uid:
+                column.append(st.uid);
+                break;
+            case StatField::Gid:
+                column.append(st.gid);
+                break;
+            case StatField::Ino:
+                column.append(st.ino);
+                break;
+            case StatField::Dev:
+                column.append(st.dev);
+                break;
+            case StatField::Nlink:
+                column.append(st.nlink);
+                break;
+            case StatField::Blocks:
+                column.append(st.blocks);
+                break;
+            case StatField::Realpath:
+                column.append(realpaths[i]);
+                break;
+            }
+        }
+        error_column.append(py::none());
+    }
+
+    py::dict result;
+    for (size_t f = 0; f < parsed.size(); ++f)
+    {
+        result[py::str(field_names[f])] = columns[f];
+    }
+    result["error"] = error_column;
+    return result;
+}
+
+/**
+ * @brief 批量解析 uid / gid 名称
+ *
+ * 供 Python 层为已有的 uid / gid 列（如 stat_batch 结果）补充名称，
+ * 解析结果进入进程级缓存，后续扫描直接命中。
+ *
+ * @param uids uid 列表
+ * @param gids gid 列表
+ * @return 字典 {"users": {uid: name}, "groups": {gid: name}}
+ */
+py::dict resolve_id_names(
+    const std::vector<uint32_t> &uids,
+    const std::vector<uint32_t> &gids)
+{
+    std::vector<std::string> user_names(uids.size()), group_names(gids.size());
+    {
+        py::gil_scoped_release release;
+        auto &cache = IdNameCache::instance();
+        for (size_t i = 0; i < uids.size(); ++i)
+            user_names[i] = cache.user_name(uids[i]);
+        for (size_t i = 0; i < gids.size(); ++i)
+            group_names[i] = cache.group_name(gids[i]);
+    }
+
+    py::dict users, groups;
+    for (size_t i = 0; i < uids.size(); ++i)
+        users[py::int_(uids[i])] = user_names[i];
+    for (size_t i = 0; i < gids.size(); ++i)
+        groups[py::int_(gids[i])] = group_names[i];
+
+    py::dict result;
+    result["users"] = users;
+    result["groups"] = groups;
+    return result;
+}
+
+// ============================================================================
+// MIME 类型探测（魔数签名）
+// ============================================================================
+
+/**
+ * @struct MagicSignature
+ * @brief 文件头魔数签名
+ *
+ * pattern 按原始字节匹配；mask 非空时与 pattern 等长，其中 '?' 位置
+ * 匹配任意字节（如 RIFF????WAVE 中的长度字段）。
+ * offset 为签名在文件中的起始偏移。
+ */
+struct MagicSignature
+{
+    size_t offset;
+    std::string pattern;
+    const char *mime;
+    const char *mask = "";
+};
+
+/**
+ * @brief 内置签名表
+ *
+ * 同一前缀下更长（更具体）的签名优先，例如 ????ftypqt 优先于 ????ftyp。
+ */
+static const std::vector<MagicSignature> &magic_signatures()
+{
+    using namespace std::string_literals;
+    static const std::vector<MagicSignature> table = {
+        // 图像
+        {0, "\x89PNG\r\n\x1a\n"s, "image/png"},
+        {0, "\xFF\xD8\xFF"s, "image/jpeg"},
+        {0, "GIF87a"s, "image/gif"},
+        {0, "GIF89a"s, "image/gif"},
+        {0, "BM\0\0\0\0\0\0\0\0"s, "image/bmp", "xx????xxxx"},
+        {0, "II*\0"s, "image/tiff"},
+        {0, "MM\0*"s, "image/tiff"},
+        {0, "\0\0\1\0"s, "image/x-icon"},
+        {0, "8BPS"s, "image/vnd.adobe.photoshop"},
+        {0, "RIFF\0\0\0\0WEBP"s, "image/webp", "xxxx????xxxx"},
+        {0, "\0\0\0\0ftypheic"s, "image/heic", "????xxxxxxxx"},
+        {0, "\0\0\0\0ftypheix"s, "image/heic", "????xxxxxxxx"},
+        {0, "\0\0\0\0ftypmif1"s, "image/heif", "????xxxxxxxx"},
+        {0, "\0\0\0\0ftypavif"s, "image/avif", "????xxxxxxxx"},
+        // 音视频
+        {0, "RIFF\0\0\0\0WAVE"s, "audio/wav", "xxxx????xxxx"},
+        {0, "RIFF\0\0\0\0AVI "s, "video/x-msvideo", "xxxx????xxxx"},
+        {0, "ID3"s, "audio/mpeg"},
+        {0, "\xFF\xFB"s, "audio/mpeg"},
+        {0, "\xFF\xF3"s, "audio/mpeg"},
+        {0, "fLaC"s, "audio/flac"},
+        {0, "OggS"s, "audio/ogg"},
+        {0, "\0\0\0\0ftyp"s, "video/mp4", "????xxxx"},
+        {0, "\0\0\0\0ftypqt  "s, "video/quicktime", "????xxxxxxxx"},
+        {0, "\0\0\0\0ftypM4A "s, "audio/mp4", "????xxxxxxxx"},
+        {0, "\x1A\x45\xDF\xA3"s, "video/x-matroska"},
+        {0, "FLV"s, "video/x-flv"},
+        // 文档
+        {0, "%PDF-"s, "application/pdf"},
+        {0, "%!PS"s, "application/postscript"},
+        {0, "{\\rtf"s, "application/rtf"},
+        {0, "\xD0\xCF\x11\xE0\xA1\xB1\x1A\xE1"s, "application/x-ole-storage"},
+        {0, "<?xml"s, "application/xml"},
+        {0, "\xEF\xBB\xBF"s, "text/plain"},
+        {0, "\xFF\xFE"s, "text/plain"},
+        {0, "\xFE\xFF"s, "text/plain"},
+        // 压缩与归档
+        {0, "PK\x03\x04"s, "application/zip"},
+        {0, "PK\x05\x06"s, "application/zip"},
+        {0, "\x1F\x8B"s, "application/gzip"},
+        {0, "BZh"s, "application/x-bzip2"},
+        {0, "\xFD" "7zXZ\0"s, "application/x-xz"},
+        {0, "\x28\xB5\x2F\xFD"s, "application/zstd"},
+        {0, "7z\xBC\xAF\x27\x1C"s, "application/x-7z-compressed"},
+        {0, "Rar!\x1A\x07"s, "application/vnd.rar"},
+        {257, "ustar"s, "application/x-tar"},
+        // 可执行文件与数据
+        {0, "\x7F" "ELF"s, "application/x-executable"},
+        {0, "MZ"s, "application/vnd.microsoft.portable-executable"},
+        {0, "\xFE\xED\xFA\xCE"s, "application/x-mach-binary"},
+        {0, "\xFE\xED\xFA\xCF"s, "application/x-mach-binary"},
+        {0, "\xCE\xFA\xED\xFE"s, "application/x-mach-binary"},
+        {0, "\xCF\xFA\xED\xFE"s, "application/x-mach-binary"},
+        {0, "\xCA\xFE\xBA\xBE"s, "application/java-vm"},
+        {0, "\0asm"s, "application/wasm"},
+        {0, "SQLite format 3\0"s, "application/vnd.sqlite3"},
+        // 字体
+        {0, "wOFF"s, "font/woff"},
+        {0, "wOF2"s, "font/woff2"},
+        {0, "\0\1\0\0\0"s, "font/ttf"},
+        {0, "OTTO"s, "font/otf"},
+    };
+    return table;
+}
+
+/**
+ * @class MagicTrie
+ * @brief 由签名表编译而成的前缀树
+ *
+ * 每个节点保存按字节排序的出边和一条可选的通配边（mask 中的 '?'）。
+ * 匹配时沿文件头逐字节下降，同时探索精确边和通配边，
+ * 返回最深（最具体）的命中。所有签名共享前缀，
+ * 因此一次下降即可同时比较整张签名表。
+ */
+class MagicTrie
+{
+public:
+    static const MagicTrie &instance()
+    {
+        static const MagicTrie trie;
+        return trie;
+    }
+
+    /**
+     * @brief 匹配文件头
+     * @return MIME 类型，未命中返回 nullptr
+     */
+    const char *match(const uint8_t *data, size_t len) const
+    {
+        const char *best = nullptr;
+        size_t best_depth = 0;
+        for (const auto &root : roots_)
+        {
+            if (root.first < len)
+                descend(root.second, data + root.first, len - root.first, 0, best, best_depth);
+        }
+        return best;
+    }
+
+private:
+    struct Node
+    {
+        std::vector<std::pair<uint8_t, int32_t>> edges; // 按字节排序
+        int32_t wildcard = -1;
+        const char *mime = nullptr;
+    };
+
+    MagicTrie()
+    {
+        for (const auto &sig : magic_signatures())
+        {
+            const size_t mask_len = std::strlen(sig.mask);
+            int32_t node = root_for(sig.offset);
+            for (size_t i = 0; i < sig.pattern.size(); ++i)
+            {
+                bool any = i < mask_len && sig.mask[i] == '?';
+                node = any ? wildcard_child(node) : child(node, static_cast<uint8_t>(sig.pattern[i]));
+            }
+            nodes_[node].mime = sig.mime;
+        }
+    }
+
+    int32_t new_node()
+    {
+        nodes_.emplace_back();
+        return static_cast<int32_t>(nodes_.size() - 1);
+    }
+
+    int32_t root_for(size_t offset)
+    {
+        for (const auto &root : roots_)
+            if (root.first == offset)
+                return root.second;
+        int32_t node = new_node();
+        roots_.emplace_back(offset, node);
+        return node;
+    }
+
+    int32_t child(int32_t node, uint8_t byte)
+    {
+        auto &edges = nodes_[node].edges;
+        auto it = std::lower_bound(edges.begin(), edges.end(), std::make_pair(byte, INT32_MIN));
+        if (it != edges.end() && it->first == byte)
+            return it->second;
+        int32_t next = new_node();
+        // new_node 可能使引用失效，重新获取
+        auto &fresh = nodes_[node].edges;
+        it = std::lower_bound(fresh.begin(), fresh.end(), std::make_pair(byte, INT32_MIN));
+        fresh.insert(it, {byte, next});
+        return next;
+    }
+
+    int32_t wildcard_child(int32_t node)
+    {
+        if (nodes_[node].wildcard < 0)
+        {
+            int32_t next = new_node();
+            nodes_[node].wildcard = next;
+        }
+        return nodes_[node].wildcard;
+    }
+
+    void descend(int32_t node, const uint8_t *data, size_t len, size_t depth,
+                 const char *&best, size_t &best_depth) const
+    {
+        const Node &n = nodes_[node];
+        if (n.mime && depth >= best_depth)
+        {
+            best = n.mime;
+            best_depth = depth;
+        }
+        if (depth >= len)
+            return;
+
+        auto it = std::lower_bound(n.edges.begin(), n.edges.end(),
+                                   std::make_pair(data[depth], INT32_MIN));
+        if (it != n.edges.end() && it->first == data[depth])
+            descend(it->second, data, len, depth + 1, best, best_depth);
+        if (n.wildcard >= 0)
+            descend(n.wildcard, data, len, depth + 1, best, best_depth);
+    }
+
+    std::vector<Node> nodes_;
+    std::vector<std::pair<size_t, int32_t>> roots_; // (偏移, 根节点)
+};
+
+static size_t skip_space(const std::string &s, size_t pos)
+{
+    while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\r' || s[pos] == '\n'))
+        ++pos;
+    return pos;
+}
+
+/**
+ * @brief 判断 pos 处是否为合法 JSON 值的开头
+ *
+ * 只检查第一个记号：对象需以 "key": 或 } 开始，数组递归检查首元素。
+ * 这样 INI 的 [section] 和 TOML 的 [[table]] 不会被识别为 JSON。
+ */
+static bool json_value_start(const std::string &s, size_t pos, int depth = 0)
+{
+    pos = skip_space(s, pos);
+    if (pos >= s.size() || depth > 8)
+        return false;
+    char c = s[pos];
+    if (c == '{')
+    {
+        pos = skip_space(s, pos + 1);
+        if (pos >= s.size())
+            return false;
+        if (s[pos] == '}')
+            return true;
+        if (s[pos] != '"')
+            return false;
+        for (++pos; pos < s.size() && s[pos] != '"'; ++pos)
+        {
+            if (s[pos] == '\\')
+                ++pos;
+        }
+        pos = skip_space(s, pos + 1);
+        return pos < s.size() && s[pos] == ':';
+    }
+    if (c == '[')
+    {
+        size_t next = skip_space(s, pos + 1);
+        return next < s.size() && (s[next] == ']' || json_value_start(s, next, depth + 1));
+    }
+    if (c == '"' || c == '-' || (c >= '0' && c <= '9'))
+        return true;
+    return s.compare(pos, 4, "true") == 0 || s.compare(pos, 5, "false") == 0 ||
+           s.compare(pos, 4, "null") == 0;
+}
+
+/**
+ * @brief 判断根元素是否为 <svg
+ *
+ * 允许前面出现 XML 声明、处理指令、注释和 DOCTYPE；
+ * 正文中内嵌的 <svg（如 HTML 或其他 XML）不算。
+ *
+ * @param lower 已转为小写的文件头
+ */
+static bool svg_root(const std::string &lower)
+{
+    size_t pos = 0;
+    if (lower.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        pos = 3;
+    while (true)
+    {
+        pos = skip_space(lower, pos);
+        if (lower.compare(pos, 2, "<?") == 0)
+            pos = lower.find("?>", pos);
+        else if (lower.compare(pos, 4, "<!--") == 0)
+            pos = lower.find("-->", pos);
+        else if (lower.compare(pos, 9, "<!doctype") == 0)
+            pos = lower.find('>', pos);
+        else
+            break;
+        if (pos == std::string::npos)
+            return false;
+        pos = lower.find('>', pos) + 1;
+    }
+    if (lower.compare(pos, 4, "<svg") != 0)
+        return false;
+    pos += 4;
+    return pos < lower.size() && (lower[pos] == '>' || lower[pos] == '/' ||
+                                  lower[pos] == ' ' || lower[pos] == '\t' ||
+                                  lower[pos] == '\r' || lower[pos] == '\n');
+}
+
+static std::string lowercase_head(const uint8_t *data, size_t len)
+{
+    std::string lower(reinterpret_cast<const char *>(data), std::min<size_t>(len, 512));
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return lower;
+}
+
+/**
+ * @brief 判断文件头是否为文本，并识别常见文本子类型
+ *
+ * 无 NUL 字节且控制字符比例很低时视为文本；
+ * 再根据 shebang / HTML / SVG / JSON 特征细化。
+ *
+ * @return MIME 类型，非文本返回 nullptr
+ */
+static const char *sniff_text(const uint8_t *data, size_t len)
+{
+    size_t control = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        uint8_t c = data[i];
+        if (c == 0)
+            return nullptr;
+        if (c < 0x20 && c != '\n' && c != '\r' && c != '\t' && c != '\f' && c != 0x1B)
+            ++control;
+    }
+    if (control * 32 > len)
+        return nullptr;
+
+    // 跳过前导空白后再判断结构
+    size_t start = 0;
+    while (start < len && (data[start] == ' ' || data[start] == '\t' ||
+                           data[start] == '\r' || data[start] == '\n'))
+        ++start;
+
+    std::string head(reinterpret_cast<const char *>(data) + start,
+                     std::min<size_t>(len - start, 512));
+    std::string lower = lowercase_head(data + start, len - start);
+
+    if (head.compare(0, 2, "#!") == 0)
+    {
+        std::string line = head.substr(0, head.find('\n'));
+        if (line.find("python") != std::string::npos)
+            return "text/x-python";
+        if (line.find("node") != std::string::npos)
+            return "text/javascript";
+        if (line.find("perl") != std::string::npos)
+            return "text/x-perl";
+        return "text/x-shellscript";
+    }
+    if (lower.compare(0, 14, "<!doctype html") == 0 || lower.compare(0, 5, "<html") == 0)
+        return "text/html";
+    if (svg_root(lower))
+        return "image/svg+xml";
+    if (!head.empty() && (head[0] == '{' || head[0] == '[') && json_value_start(head, 0))
+        return "application/json";
+    return "text/plain";
+}
+
+/**
+ * @brief 根据文件头探测 MIME 类型
+ */
+static const char *sniff_mime(const uint8_t *data, size_t len)
+{
+    if (len == 0)
+        return "inode/x-empty";
+
+    const char *mime = MagicTrie::instance().match(data, len);
+    if (mime)
+    {
+        // XML 可能是 SVG（仅当根元素为 <svg）
+        if (std::strcmp(mime, "application/xml") == 0 && svg_root(lowercase_head(data, len)))
+            return "image/svg+xml";
+        return mime;
+    }
+
+    const char *text = sniff_text(data, len);
+    return text ? text : "application/octet-stream";
+}
+
+/**
+ * @brief 批量探测文件 MIME 类型
+ *
+ * 在工作线程池中并行 pread 每个文件的前 sniff_bytes 字节，
+ * 通过 MagicTrie 一次下降匹配整张签名表，未命中时再做文本启发式判断。
+ * 对无扩展名的文件也能给出可靠结果。
+ *
+ * @param paths 路径列表
+ * @param sniff_bytes 每个文件读取的字节数（默认 4KB）
+ * @param num_threads 线程数（0 = CPU 核心数）
+ * @return 与 paths 等长的列表：MIME 字符串；目录为 "inode/directory"；
+ *         无法打开的路径为 None
+ */
+py::list detect_types(
+    const std::vector<std::string> &paths,
+    size_t sniff_bytes = 4096,
+    int num_threads = 0)
+{
+    if (sniff_bytes == 0)
+        sniff_bytes = 4096;
+
+    std::vector<const char *> mimes(paths.size(), nullptr);
+
+    {
+        py::gil_scoped_release release;
+
+        // 签名树在释放 GIL 后、进入工作线程前构建
+        MagicTrie::instance();
+
+        std::vector<std::unique_ptr<uint8_t[]>> buffers(
+            static_cast<size_t>(resolve_thread_count(num_threads)));
+
+        parallel_for(paths.size(), num_threads, [&](size_t idx, size_t worker_id)
+        {
+            auto &buffer = buffers[worker_id];
+            if (!buffer)
+                buffer.reset(new uint8_t[sniff_bytes]);
+
+            FdGuard fd(::open(paths[idx].c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK));
+            if (!fd.valid())
+                return;
+
+            struct stat st;
+            if (::fstat(fd.get(), &st) != 0)
+                return;
+            if (S_ISDIR(st.st_mode))
+            {
+                mimes[idx] = "inode/directory";
+                return;
+            }
+            if (!S_ISREG(st.st_mode))
+            {
+                mimes[idx] = "inode/x-special";
+                return;
+            }
+
+            ssize_t n = pread_full(fd.get(), buffer.get(), sniff_bytes, 0);
+            if (n < 0)
+                return;
+            mimes[idx] = sniff_mime(buffer.get(), static_cast<size_t>(n));
+        });
+    }
+
+    py::list result;
+    for (const char *mime : mimes)
+    {
+        if (mime)
+            result.append(mime);
+        else
+            result.append(py::none());
+    }
+    return result;
+}
+
+// ============================================================================
+// 并行目录遍历
+// ============================================================================
+
+/**
+ * @struct WalkOptions
+ * @brief parallel_walk 的遍历选项
+ */
+struct WalkOptions
+{
+    int max_depth = 0;           // 最大深度，0 = 无限制（与 scandir_recursive 一致）
+    bool include_hidden = false; // 是否包含以 . 开头的条目
+    bool stat_entries = true;    // 是否对每个条目 lstat；false 时只依赖 d_type
+    int num_threads = 0;         // 线程数，0 = CPU 核心数
+    MountFilter *mounts = nullptr; // 可选的挂载点策略；被跳过的挂载点不交给 visitor
+};
+
+/**
+ * @struct WalkEntry
+ * @brief 遍历到的单个条目（仅在 visitor 调用期间有效）
+ */
+struct WalkEntry
+{
+    const std::string &path; // 完整路径
+    const char *name;        // 文件名
+    int depth;               // 深度，根目录的直接子项为 0
+    int dirfd;               // 所在目录的 fd，可配合 openat 使用
+    const FileStat &st;      // lstat 结果（stat_entries=false 时只有 mode 有效）
+    IoGovernor::Slot &slot;  // 所在目录持有的设备槽位：visitor 做大量 IO 时用它做检查点
+};
+
+/**
+ * @class WalkExclusions
+ * @brief 遍历时剪枝的路径与文件名（调用方传入的禁止访问列表）
+ *
+ * visitor 对命中的条目返回 false：目录不会被展开，文件不会被处理。
+ */
+class WalkExclusions
+{
+public:
+    WalkExclusions(const std::vector<std::string> &paths, const std::vector<std::string> &names)
+        : names_(names.begin(), names.end())
+    {
+        for (std::string path : paths)
+        {
+            while (path.size() > 1 && path.back() == '/')
+                path.pop_back();
+            paths_.insert(std::move(path));
+        }
+    }
+
+    bool empty() const { return paths_.empty() && names_.empty(); }
+
+    bool excluded(const WalkEntry &entry) const
+    {
+        return names_.count(entry.name) || paths_.count(entry.path);
+    }
+
+private:
+    std::unordered_set<std::string> paths_;
+    std::unordered_set<std::string> names_;
+};
+
+/**
+ * @brief 将 d_type 转换为 st_mode 的类型位
+ * @return 未知类型（DT_UNKNOWN）返回 0
+ */
+static uint32_t dtype_to_mode(unsigned char d_type)
+{
+    switch (d_type)
+    {
+    case DT_REG:
+        return S_IFREG;
+    case DT_DIR:
+        return S_IFDIR;
+    case DT_LNK:
+        return S_IFLNK;
+    case DT_BLK:
+        return S_IFBLK;
+    case DT_CHR:
+        return S_IFCHR;
+    case DT_FIFO:
+        return S_IFIFO;
+    case DT_SOCK:
+        return S_IFSOCK;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief 多线程并行遍历目录树
+ *
+ * 工作线程从共享队列领取目录，用 openat + fdopendir 读取，
+ * 并以目录 fd 为基准 fstatat 每个条目（避免内核重复解析完整路径）。
+ * 发现的子目录批量放回队列，由空闲线程继续处理。
+ * 符号链接不会被跟随。
+ * 每个目录的读取占用所在设备的一个 IoGovernor 槽位（含 visitor 调用期间），
+ * 样本为 open 与各条目 stat 的平均延迟；visitor 不能再领取槽位。
+ * 工作线程继承调用线程的 IoPriority 与 RateLimiter：每次 open / stat 计为一次操作，
+ * 在目录之间的检查点结算（后台遍历同时在此让出）；visitor 自己做大量 IO 时
+ * 应在数据块之间调用 entry.slot.checkpoint()。
+ * 机械盘上需要 stat 条目时，先读完整个目录再按 inode 号顺序 stat（同一目录内）。
+ *
+ * visitor 签名：bool(const WalkEntry &entry, size_t worker_id)
+ * - 在工作线程中调用（GIL 已释放，不可触碰 Python 对象）
+ * - 对目录返回 false 表示剪枝，不再进入该目录；对其他条目返回值被忽略
+ * - visitor 可通过 stop 标志提前结束整个遍历
+ * - visitor 抛出的异常：记录第一个并结束整个遍历，join 后在调用线程重新抛出
+ *
+ * @param root 根目录
+ * @param options 遍历选项
+ * @param visit 条目回调
+ * @param errors 输出：无法读取的目录（最多记录 1000 条）
+ * @param stop 可选的提前终止标志
+ */
+template <typename Visitor>
+static void parallel_walk(const std::string &root, const WalkOptions &options,
+                          Visitor &&visit, std::vector<std::string> &errors,
+                          const std::atomic<bool> *stop = nullptr)
+{
+    struct DirTask
+    {
+        std::string path;
+        int depth;    // 该目录中条目的深度
+        uint64_t dev; // 所在设备（未 stat 的子目录沿用父目录的设备）
+    };
+
+    IoGovernor &governor = IoGovernor::instance();
+    FileStat root_stat;
+    stat_path(AT_FDCWD, root.c_str(), true, root_stat);
+    const DeviceTuner::Profile root_profile = DeviceTuner::instance().profile(root_stat.dev);
+    const bool root_rotational = root_profile.rotational == 1;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<DirTask> queue;
+    size_t active = 0; // 队列中 + 正在处理的目录数
+    std::mutex error_mutex;
+    std::atomic<bool> failed{false};
+    std::exception_ptr first_error; // 由 mutex 保护，join 后重新抛出
+    auto stopped = [&]
+    {
+        return failed.load(std::memory_order_relaxed) ||
+               (stop && stop->load(std::memory_order_relaxed));
+    };
+
+    queue.push_back({root, 0, root_stat.dev});
+    active = 1;
+
+    auto record_error = [&](const std::string &message)
+    {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (errors.size() < 1000)
+            errors.push_back(message);
+    };
+
+    auto process_dir = [&](const DirTask &task, size_t worker_id, std::vector<DirTask> &found)
+    {
+        IoGovernor::Slot slot = governor.acquire(task.dev);
+        const bool timed = slot.active();
+        uint64_t start = timed ? monotonic_ns() : 0;
+        int dirfd = ::open(task.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (timed)
+            slot.record(monotonic_ns() - start);
+        io_charge(0, 1);
+        if (dirfd < 0)
+        {
+            record_error(task.path + ": " + std::strerror(errno));
+            return;
+        }
+        DIR *dir = ::fdopendir(dirfd);
+        if (!dir)
+        {
+            record_error(task.path + ": " + std::strerror(errno));
+            ::close(dirfd);
+            return;
+        }
+        // visitor 可能抛出异常：目录（连同 dirfd）在任何退出路径上关闭
+        struct DirCloser
+        {
+            DIR *dir;
+            ~DirCloser() { ::closedir(dir); }
+        } closer{dir};
+
+        const bool descend = options.max_depth <= 0 || task.depth + 1 < options.max_depth;
+        std::string prefix = task.path;
+        if (prefix.empty() || prefix.back() != '/')
+            prefix.push_back('/');
+
+        std::string child_path;
+        FileStat st;
+        auto handle_entry = [&](const char *name, unsigned char d_type)
+        {
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                return;
+            if (!options.include_hidden && name[0] == '.')
+                return;
+
+            st = FileStat();
+            uint32_t type = dtype_to_mode(d_type);
+            child_path.assign(prefix).append(name);
+            const bool check_mounts = options.mounts && (type == S_IFDIR || type == 0);
+            if (check_mounts && options.mounts->skip_mount_point(child_path))
+                return;
+
+            // 有挂载点策略时目录总是 stat，以便比较 st_dev
+            if (options.stat_entries || type == 0 || check_mounts)
+            {
+                if (timed)
+                    start = monotonic_ns();
+                const int stat_err = stat_path(dirfd, name, false, st);
+                if (timed)
+                    slot.record(monotonic_ns() - start);
+                io_charge(0, 1);
+                if (stat_err != 0)
+                    return; // 条目在读取期间被删除
+                if (check_mounts && S_ISDIR(st.mode) && options.mounts->skip_device(child_path, st.dev))
+                    return;
+            }
+            else
+            {
+                st.mode = type;
+            }
+
+            WalkEntry entry{child_path, name, task.depth, dirfd, st, slot};
+            bool keep = visit(entry, worker_id);
+
+            if (S_ISDIR(st.mode) && keep && descend)
+                found.push_back({child_path, task.depth + 1, st.dev != 0 ? st.dev : task.dev});
+        };
+
+        const bool will_stat = options.stat_entries || options.mounts;
+        const bool rotational = task.dev == root_stat.dev
+                                    ? root_rotational
+                                    : DeviceTuner::instance().profile(task.dev).rotational == 1;
+        if (will_stat && rotational)
+        {
+            // 机械盘：先读完目录，再按 inode 号 stat。inode 表按号存放，
+            // 按号访问把对 inode 表的随机读变成一次大致顺序的扫描
+            struct PendingEntry
+            {
+                ino_t ino;
+                unsigned char type;
+                std::string name;
+            };
+            std::vector<PendingEntry> pending;
+            while (struct dirent *ent = ::readdir(dir))
+            {
+                if (stopped())
+                    break;
+                pending.push_back({ent->d_ino, ent->d_type, ent->d_name});
+            }
+            std::sort(pending.begin(), pending.end(), [](const PendingEntry &a, const PendingEntry &b)
+                      { return a.ino < b.ino; });
+            for (const auto &p : pending)
+            {
+                if (stopped())
+                    break;
+                handle_entry(p.name.c_str(), p.type);
+            }
+        }
+        else
+        {
+            while (struct dirent *ent = ::readdir(dir))
+            {
+                if (stopped())
+                    break;
+                handle_entry(ent->d_name, ent->d_type);
+            }
+        }
+    };
+
+    const IoPriority priority = current_io_priority();
+    RateLimiter *limiter = current_rate_limiter();
+    auto worker = [&](size_t worker_id)
+    {
+        // 继承调用线程的优先级与限速器
+        IoPriorityScope scope(priority, false);
+        RateLimitScope limit_scope(limiter);
+        std::vector<DirTask> found;
+        while (true)
+        {
+            DirTask task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return !queue.empty() || active == 0 || first_error; });
+                if (queue.empty() || first_error)
+                    return; // active == 0：全部完成；或其他线程失败
+                task = std::move(queue.back()); // LIFO：深度优先，队列更短
+                queue.pop_back();
+            }
+
+            found.clear();
+            try
+            {
+                io_checkpoint(); // 此时不持有设备槽位
+                if (!stopped())
+                    process_dir(task, worker_id, found);
+            }
+            catch (...)
+            {
+                // 不再计数 active：等待中的线程由 first_error 唤醒并退出
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!first_error)
+                        first_error = std::current_exception();
+                    failed.store(true);
+                }
+                cv.notify_all();
+                return;
+            }
+
+            bool finished;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto &dir : found)
+                    queue.push_back(std::move(dir));
+                active += found.size();
+                active -= 1;
+                finished = active == 0; // active 只能在锁内读取
+            }
+            if (finished || found.size() > 1)
+                cv.notify_all();
+            else if (found.size() == 1)
+                cv.notify_one();
+        }
+    };
+
+    // 未指定线程数时按根目录所在设备收紧（机械盘上大量并发 stat 只会加剧寻道）；
+    // 调用方按 resolve_thread_count 分配每线程状态，这里只减不增
+    size_t workers = static_cast<size_t>(resolve_thread_count(options.num_threads));
+    if (options.num_threads <= 0)
+        workers = std::min<size_t>(workers, static_cast<size_t>(root_profile.threads));
+    if (workers <= 1)
+    {
+        worker(0);
+    }
+    else
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(workers);
+        for (size_t w = 0; w < workers; ++w)
+            threads.emplace_back(worker, w);
+        for (auto &t : threads)
+            t.join();
+    }
+    if (first_error)
+        std::rethrow_exception(first_error);
+}
+
+/**
+ * @brief 由遍历条目构造 FileInfo（字段语义与 scandir_recursive 一致）
+ *
+ * 符号链接的 is_directory 取决于目标，size 为 0。
+ */
+static FileInfo make_file_info(const WalkEntry &entry, const FileStat &st)
+{
+    FileInfo info;
+    info.path = entry.path;
+    info.name = entry.name;
+    info.is_symlink = S_ISLNK(st.mode);
+    if (info.is_symlink)
+    {
+        FileStat target;
+        info.is_directory = stat_path(entry.dirfd, entry.name, true, target) == 0 &&
+                            S_ISDIR(target.mode);
+        info.size = 0;
+    }
+    else
+    {
+        info.is_directory = S_ISDIR(st.mode);
+        info.size = info.is_directory ? 0 : st.size;
+    }
+    info.mtime = static_cast<double>(st.mtime_ns / 1000000000LL);
+    info.mtime_ns = st.mtime_ns;
+    info.uid = st.uid;
+    info.gid = st.gid;
+    return info;
+}
+
+// ============================================================================
+// 内容搜索（多模式字面量匹配）
+// ============================================================================
+
+/**
+ * @class LiteralMatcher
+ * @brief 多模式字面量匹配器：Aho-Corasick DFA + SIMD 首字节预过滤
+ *
+ * - 所有模式编译为一个完全展开的 DFA（每个状态 256 条转移），
+ *   扫描时每字节一次查表，与模式数量无关
+ * - 自动机处于根状态时，用 SIMD 跳到下一个可能作为模式首字节的位置：
+ *   单个首字节走 memchr，2~4 个首字节走 SSE2 并行比较，
+ *   这样文件中的大部分字节根本不进入 DFA
+ * - ignore_case 仅折叠 ASCII 字母
+ */
+class LiteralMatcher
+{
+public:
+    LiteralMatcher(const std::vector<std::string> &patterns, bool ignore_case)
+        : patterns_(patterns)
+    {
+        for (int c = 0; c < 256; ++c)
+            fold_[c] = static_cast<uint8_t>(ignore_case ? std::tolower(c) : c);
+
+        // 构建 trie
+        new_state();
+        for (size_t p = 0; p < patterns_.size(); ++p)
+        {
+            int32_t state = 0;
+            for (unsigned char c : patterns_[p])
+            {
+                uint8_t b = fold_[c];
+                int32_t next = delta_[static_cast<size_t>(state) * 256 + b];
+                if (next <= 0)
+                {
+                    next = new_state();
+                    delta_[static_cast<size_t>(state) * 256 + b] = next;
+                }
+                state = next;
+            }
+            outputs_[state].push_back(static_cast<uint32_t>(p));
+        }
+
+        // BFS 计算失败链接并展开为完整 DFA
+        std::vector<int32_t> fail(outputs_.size(), 0);
+        std::deque<int32_t> bfs;
+        for (int c = 0; c < 256; ++c)
+        {
+            int32_t next = delta_[c];
+            if (next > 0)
+            {
+                fail[next] = 0;
+                bfs.push_back(next);
+            }
+            else
+            {
+                delta_[c] = 0;
+            }
+        }
+        while (!bfs.empty())
+        {
+            int32_t state = bfs.front();
+            bfs.pop_front();
+            const auto &inherited = outputs_[fail[state]];
+            outputs_[state].insert(outputs_[state].end(), inherited.begin(), inherited.end());
+            for (int c = 0; c < 256; ++c)
+            {
+                size_t slot = static_cast<size_t>(state) * 256 + c;
+                int32_t next = delta_[slot];
+                int32_t via_fail = delta_[static_cast<size_t>(fail[state]) * 256 + c];
+                if (next > 0)
+                {
+                    fail[next] = via_fail;
+                    bfs.push_back(next);
+                }
+                else
+                {
+                    delta_[slot] = via_fail;
+                }
+            }
+        }
+
+        // 预过滤：收集所有可能的首字节（忽略大小写时两种写法都要）
+        bool seen[256] = {};
+        for (const auto &pattern : patterns_)
+        {
+            if (pattern.empty())
+                continue;
+            unsigned char c = static_cast<unsigned char>(pattern[0]);
+            int variants[2] = {c, c};
+            if (ignore_case)
+            {
+                variants[0] = std::tolower(c);
+                variants[1] = std::toupper(c);
+            }
+            for (int v : variants)
+            {
+                if (!seen[v])
+                {
+                    seen[v] = true;
+                    start_bytes_.push_back(static_cast<uint8_t>(v));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief 扫描缓冲区
+     *
+     * on_match 签名：bool(size_t start, size_t pattern_index)，返回 false 停止扫描。
+     */
+    template <typename OnMatch>
+    void scan(const uint8_t *data, size_t len, OnMatch &&on_match) const
+    {
+        int32_t state = 0;
+        size_t i = 0;
+        const bool prefilter = !start_bytes_.empty() && start_bytes_.size() <= 4;
+        while (i < len)
+        {
+            if (state == 0 && prefilter)
+            {
+                i = next_candidate(data, len, i);
+                if (i >= len)
+                    return;
+            }
+            state = delta_[static_cast<size_t>(state) * 256 + fold_[data[i]]];
+            const auto &out = outputs_[state];
+            for (uint32_t p : out)
+            {
+                size_t start = i + 1 - patterns_[p].size();
+                if (!on_match(start, p))
+                    return;
+            }
+            ++i;
+        }
+    }
+
+    const std::string &pattern(size_t index) const { return patterns_[index]; }
+
+    /** @brief 最长模式的字节数（分块扫描时块间重叠 max_length() - 1 字节） */
+    size_t max_length() const
+    {
+        size_t length = 0;
+        for (const auto &pattern : patterns_)
+            length = std::max(length, pattern.size());
+        return length;
+    }
+
+private:
+    int32_t new_state()
+    {
+        delta_.resize(delta_.size() + 256, -1);
+        outputs_.emplace_back();
+        return static_cast<int32_t>(outputs_.size() - 1);
+    }
+
+    /**
+     * @brief 从 pos 起查找下一个等于任一首字节的位置
+     */
+    size_t next_candidate(const uint8_t *data, size_t len, size_t pos) const
+    {
+        if (start_bytes_.size() == 1)
+        {
+            const void *hit = std::memchr(data + pos, start_bytes_[0], len - pos);
+            return hit ? static_cast<size_t>(static_cast<const uint8_t *>(hit) - data) : len;
+        }
+#if defined(__SSE2__)
+        __m128i needles[4];
+        size_t count = start_bytes_.size();
+        for (size_t k = 0; k < 4; ++k)
+            needles[k] = _mm_set1_epi8(static_cast<char>(start_bytes_[k < count ? k : 0]));
+        while (pos + 16 <= len)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+            __m128i eq = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(block, needles[0]), _mm_cmpeq_epi8(block, needles[1])),
+                _mm_or_si128(_mm_cmpeq_epi8(block, needles[2]), _mm_cmpeq_epi8(block, needles[3])));
+            int mask = _mm_movemask_epi8(eq);
+            if (mask != 0)
+                return pos + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+            pos += 16;
+        }
+#endif
+        for (; pos < len; ++pos)
+        {
+            for (uint8_t b : start_bytes_)
+                if (data[pos] == b)
+                    return pos;
+        }
+        return len;
+    }
+
+    std::vector<std::string> patterns_;
+    std::vector<int32_t> delta_;               // 状态 * 256 + 字节 -> 下一状态
+    std::vector<std::vector<uint32_t>> outputs_; // 状态 -> 在此结束的模式
+    std::vector<uint8_t> start_bytes_;
+    uint8_t fold_[256];
+};
+
+/**
+ * @struct ContentMatch
+ * @brief 一次内容匹配
+ */
+struct ContentMatch
+{
+    std::string path;
+    uint64_t line;   // 行号（从 1 开始）
+    uint64_t column; // 列（字节，从 0 开始）
+    uint64_t offset; // 文件内字节偏移
+    uint32_t pattern;
+    std::string text; // 所在行内容（截断到 512 字节）
+};
+
+/**
+ * @struct ContentScanState
+ * @brief 分块扫描单个文件时跨块保留的状态
+ *
+ * 相邻块重叠 max_length() - 1 字节，跨块的匹配在后一块中完整出现；
+ * 结束位置不超过 reported_end 的匹配已在前一块报告过，跳过。
+ */
+struct ContentScanState
+{
+    static const size_t kMaxLineText = 512;
+
+    uint64_t base = 0;        // 当前块在文件中的偏移
+    uint64_t line = 1;        // 块首所在的行号
+    uint64_t line_offset = 0; // 块首所在行的行首偏移（<= base）
+    std::string line_head;    // 该行位于块首之前的部分（至多 kMaxLineText 字节）
+    uint64_t reported_end = 0;
+    uint64_t last_start = UINT64_MAX; // 上一次报告的匹配起点（同一起点只报告一次）
+    size_t found = 0;
+    std::vector<size_t> pending; // 所在行延伸到块尾、文本待下一块补全的匹配（out 下标）
+
+    /**
+     * @brief 下一块从 next 开始：把 [base, next) 中的换行与行首计入状态
+     */
+    void advance(const uint8_t *data, size_t len, uint64_t next)
+    {
+        const size_t consumed = static_cast<size_t>(next - base);
+        line += static_cast<uint64_t>(std::count(data, data + consumed, '\n'));
+        const void *nl = ::memrchr(data, '\n', consumed);
+        size_t head_from = 0;
+        if (nl)
+        {
+            head_from = static_cast<size_t>(static_cast<const uint8_t *>(nl) - data) + 1;
+            line_offset = base + head_from;
+            line_head.clear();
+        }
+        if (line_head.size() < kMaxLineText)
+            line_head.append(reinterpret_cast<const char *>(data) + head_from,
+                             std::min(consumed - head_from, kMaxLineText - line_head.size()));
+        reported_end = base + len;
+        base = next;
+    }
+
+    /**
+     * @brief 用新块开头（reported_end 之后）补全跨块行的文本
+     */
+    void complete_lines(const uint8_t *data, size_t len, std::vector<ContentMatch> &out)
+    {
+        if (pending.empty())
+            return;
+        const size_t from = static_cast<size_t>(reported_end - base);
+        const void *nl = std::memchr(data + from, '\n', len - from);
+        size_t end = nl ? static_cast<size_t>(static_cast<const uint8_t *>(nl) - data) : len;
+        for (size_t index : pending)
+        {
+            std::string &text = out[index].text;
+            if (text.size() < kMaxLineText)
+                text.append(reinterpret_cast<const char *>(data) + from,
+                            std::min(end - from, kMaxLineText - text.size()));
+            if (nl)
+                trim_cr(out[index], base + end);
+        }
+        if (nl)
+            pending.clear();
+    }
+
+    /**
+     * @brief 文件在 file_end 结束：补全的行没有换行，按行尾处理
+     */
+    void finish(std::vector<ContentMatch> &out, uint64_t file_end)
+    {
+        for (size_t index : pending)
+            trim_cr(out[index], file_end);
+        pending.clear();
+    }
+
+    /**
+     * @brief 行在 line_end 结束且文本未被截断时，去掉行尾的 CR（与块内行一致）
+     */
+    static void trim_cr(ContentMatch &match, uint64_t line_end)
+    {
+        const uint64_t line_start = match.offset - match.column;
+        if (match.text.size() == line_end - line_start && !match.text.empty() &&
+            match.text.back() == '\r')
+            match.text.pop_back();
+    }
+};
+
+/**
+ * @brief 在文件的一块内容中搜索并记录匹配（data 从 state.base 开始）
+ *
+ * @return 达到 max_per_file 时返回 false
+ */
+static bool search_buffer(const LiteralMatcher &matcher, const std::string &path,
+                          const uint8_t *data, size_t len, size_t max_per_file,
+                          ContentScanState &state, std::vector<ContentMatch> &out)
+{
+    static const size_t kMaxLineText = ContentScanState::kMaxLineText;
+    uint64_t line = state.line;
+    size_t line_start = 0;
+    bool line_in_head = state.line_offset < state.base; // 所在行始于块首之前
+    size_t counted = 0; // [0, counted) 的换行已计入 line
+    bool more = state.found < max_per_file;
+    state.complete_lines(data, len, out);
+
+    matcher.scan(data, len, [&](size_t start, size_t pattern) -> bool
+    {
+        const uint64_t offset = state.base + start;
+        // 重叠区内的匹配已在前一块报告过；同一起点可能被多个模式命中，只报告一次
+        if (offset + matcher.pattern(pattern).size() <= state.reported_end ||
+            offset == state.last_start)
+            return true;
+        state.last_start = offset;
+
+        // 匹配按结束位置上报，长模式的起点可能早于已统计位置：回退
+        if (start < counted)
+        {
+            line -= static_cast<uint64_t>(std::count(data + start, data + counted, '\n'));
+            counted = start;
+            const void *prev = ::memrchr(data, '\n', start);
+            line_start = prev ? static_cast<size_t>(static_cast<const uint8_t *>(prev) - data) + 1 : 0;
+            line_in_head = !prev && state.line_offset < state.base;
+        }
+        // 增量统计换行，定位行号与行首
+        while (counted < start)
+        {
+            const void *nl = std::memchr(data + counted, '\n', start - counted);
+            if (!nl)
+            {
+                counted = start;
+                break;
+            }
+            size_t pos = static_cast<size_t>(static_cast<const uint8_t *>(nl) - data);
+            ++line;
+            line_start = pos + 1;
+            line_in_head = false;
+            counted = pos + 1;
+        }
+        // 行延伸到块尾时文本由下一块补全（complete_lines），CR 在确定行尾后再去掉
+        const void *nl = std::memchr(data + line_start, '\n', len - line_start);
+        size_t line_end = nl ? static_cast<size_t>(static_cast<const uint8_t *>(nl) - data) : len;
+
+        ContentMatch match;
+        match.path = path;
+        match.line = line;
+        match.offset = offset;
+        match.pattern = static_cast<uint32_t>(pattern);
+        if (line_in_head)
+        {
+            // 超长行：行首在前面的块中，文本由保存的行首与本块开头拼成
+            match.column = offset - state.line_offset;
+            match.text = state.line_head;
+            size_t room = kMaxLineText - std::min(kMaxLineText, match.text.size());
+            match.text.append(reinterpret_cast<const char *>(data), std::min(line_end, room));
+        }
+        else
+        {
+            match.column = start - line_start;
+            match.text.assign(reinterpret_cast<const char *>(data) + line_start,
+                              std::min(line_end - line_start, kMaxLineText));
+        }
+        if (nl)
+            ContentScanState::trim_cr(match, state.base + line_end);
+        else
+            state.pending.push_back(out.size());
+        out.push_back(std::move(match));
+        more = ++state.found < max_per_file;
+        return more;
+    });
+    return more;
+}
+
+/**
+ * @brief 在目录树中并行搜索文件内容
+ *
+ * 基于 parallel_walk：遍历线程发现普通文件后立即在本线程内搜索，
+ * 全部 CPU 核心同时参与 IO 与匹配。
+ * - 按 1MB 分块 pread 到线程缓冲区，块间重叠（最长模式 - 1）字节；
+ *   扫描期间文件被截断只会提前读到 EOF，不会像 mmap 那样触发 SIGBUS
+ * - 前 8KB 含 NUL 字节的文件视为二进制并跳过（与 grep 一致）
+ * - exclude_paths / exclude_names 命中的目录在遍历时剪枝，内容不会被读取
+ * - 每个文件最多记录 max_matches_per_file 条，总数达到 max_results 后提前结束
+ *
+ * @param root_path 搜索根目录
+ * @param patterns 字面量模式列表（任一命中即匹配）
+ * @param ignore_case 是否忽略 ASCII 大小写
+ * @param max_matches_per_file 单文件匹配上限
+ * @param max_results 总匹配上限
+ * @param max_file_size 跳过大于此大小的文件（0 = 不限制）
+ * @param include_hidden 是否搜索隐藏文件 / 目录
+ * @param max_depth 最大深度（0 = 无限制）
+ * @param num_threads 线程数（0 = CPU 核心数）
+ * @param priority 优先级："interactive"（默认）或 "background"
+ * @param limiter 可选的 RateLimiter（字节 / IOPS 限速）
+ * @param exclude_paths 不进入的绝对路径（自身及其下所有条目）
+ * @param exclude_names 不进入 / 不搜索的文件名（任意层级的同名目录与文件）
+ * @return 字典：matches（按路径、偏移排序）、files_scanned、files_matched、
+ *         bytes_scanned、truncated、errors
+ */
+py::dict search_content(
+    const std::string &root_path,
+    const std::vector<std::string> &patterns,
+    bool ignore_case = false,
+    size_t max_matches_per_file = 100,
+    size_t max_results = 10000,
+    uint64_t max_file_size = 0,
+    bool include_hidden = false,
+    int max_depth = 0,
+    int num_threads = 0,
+    const std::string &priority = "interactive",
+    std::shared_ptr<RateLimiter> limiter = nullptr,
+    const std::vector<std::string> &exclude_paths = {},
+    const std::vector<std::string> &exclude_names = {})
+{
+    // 分块读取：块间重叠（最长模式 - 1）字节，重叠不超过半块，
+    // 更长的模式无法保证跨块匹配被发现，直接拒绝而不是静默漏报
+    static const size_t kChunk = 1024 * 1024;
+    static const size_t kMaxPatternLength = kChunk / 2;
+    // DFA 每个状态 256 条转移（约 1KB），状态数上限为模式总字节数：
+    // 总量限制在 64KB（与 API 的 64 个 × 1KB 一致），自动机不超过约 64MB
+    static const size_t kMaxPatternBytes = 64 * 1024;
+
+    const IoPriority io_priority = parse_io_priority(priority);
+    if (patterns.empty())
+        throw std::invalid_argument("patterns must not be empty");
+    size_t total_pattern_bytes = 0;
+    for (const auto &pattern : patterns)
+    {
+        if (pattern.empty())
+            throw std::invalid_argument("patterns must not contain empty strings");
+        if (pattern.size() > kMaxPatternLength)
+            throw std::invalid_argument("pattern longer than " + std::to_string(kMaxPatternLength) + " bytes");
+        total_pattern_bytes += pattern.size();
+    }
+    if (total_pattern_bytes > kMaxPatternBytes)
+        throw std::invalid_argument("patterns longer than " + std::to_string(kMaxPatternBytes) + " bytes in total");
+    if (max_matches_per_file == 0)
+        max_matches_per_file = 1;
+
+    FileStat root_stat;
+    int err = stat_path(AT_FDCWD, root_path.c_str(), true, root_stat);
+    if (err != 0)
+        throw FsError(err, root_path);
+    if (!S_ISDIR(root_stat.mode))
+        throw std::runtime_error("Path is not a directory: " + root_path);
+
+    const size_t workers = static_cast<size_t>(resolve_thread_count(num_threads));
+    std::vector<std::vector<ContentMatch>> per_worker(workers);
+    std::vector<std::string> errors;
+    std::atomic<size_t> total_matches{0};
+    std::atomic<uint64_t> files_scanned{0}, files_matched{0}, bytes_scanned{0};
+    std::atomic<bool> stop{false};
+
+    {
+        py::gil_scoped_release release;
+        IoPriorityScope priority_scope(io_priority);
+        RateLimitScope limit_scope(limiter.get());
+
+        LiteralMatcher matcher(patterns, ignore_case);
+        static const size_t kBinaryProbe = 8192;
+        const size_t overlap = matcher.max_length() - 1;
+        std::vector<std::unique_ptr<uint8_t[]>> buffers(workers);
+
+        const WalkExclusions exclusions(exclude_paths, exclude_names);
+
+        WalkOptions options;
+        options.max_depth = max_depth;
+        options.include_hidden = include_hidden;
+        options.num_threads = num_threads;
+
+        auto visit = [&](const WalkEntry &entry, size_t worker_id) -> bool
+        {
+            // 排除项在遍历时剪枝：返回 false 的目录不会被展开
+            if (exclusions.excluded(entry))
+                return false;
+            if (!S_ISREG(entry.st.mode) || entry.st.size == 0)
+                return true;
+            if (max_file_size > 0 && entry.st.size > max_file_size)
+                return true;
+
+            FdGuard fd(::openat(entry.dirfd, entry.name, O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+            if (!fd.valid())
+                return true;
+            auto &buffer = buffers[worker_id];
+            if (!buffer)
+                buffer.reset(new uint8_t[kChunk]);
+            if (entry.st.size > kChunk)
+                ::posix_fadvise(fd.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+            // 分块 pread：文件在扫描中被截断时只会提前读到 EOF
+            ContentScanState state;
+            size_t keep = 0; // 缓冲区开头保留的上一块尾部（重叠区）
+            bool first = true;
+            auto &out = per_worker[worker_id];
+            for (;;)
+            {
+                // 每块一次检查点：大文件的读取也能及时让出与限速（先归还目录的槽位）
+                entry.slot.checkpoint();
+                ssize_t n = pread_full(fd.get(), buffer.get() + keep, kChunk - keep,
+                                       static_cast<off_t>(state.base + keep));
+                if (n < 0 || (n == 0 && first))
+                    break;
+                const size_t len = keep + static_cast<size_t>(n);
+                if (first)
+                {
+                    files_scanned.fetch_add(1, std::memory_order_relaxed);
+                    if (std::memchr(buffer.get(), 0, std::min(len, kBinaryProbe)) != nullptr)
+                        break;
+                    first = false;
+                }
+                bytes_scanned.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+                io_charge(static_cast<uint64_t>(n), 1);
+                if (!search_buffer(matcher, entry.path, buffer.get(), len,
+                                   max_matches_per_file, state, out))
+                    break;
+                if (len < kChunk)
+                {
+                    state.finish(out, state.base + len); // EOF（含扫描中被截断）
+                    break;
+                }
+                if (stop.load(std::memory_order_relaxed))
+                    break;
+                keep = std::min(overlap, len);
+                state.advance(buffer.get(), len, state.base + len - keep);
+                std::memmove(buffer.get(), buffer.get() + len - keep, keep);
+            }
+
+            if (state.found > 0)
+            {
+                files_matched.fetch_add(1, std::memory_order_relaxed);
+                if (total_matches.fetch_add(state.found) + state.found >= max_results)
+                    stop.store(true);
+            }
+            return true;
+        };
+
+        parallel_walk(root_path, options, visit, errors, &stop);
+    }
+
+    // 合并各线程结果并排序，保证输出稳定
+    std::vector<ContentMatch> all;
+    for (auto &part : per_worker)
+    {
+        all.insert(all.end(), std::make_move_iterator(part.begin()),
+                   std::make_move_iterator(part.end()));
+    }
+    std::sort(all.begin(), all.end(), [](const ContentMatch &a, const ContentMatch &b)
+              { return a.path != b.path ? a.path < b.path : a.offset < b.offset; });
+    bool truncated = stop.load();
+    if (all.size() > max_results)
+    {
+        all.resize(max_results);
+        truncated = true;
+    }
+
+    py::list matches;
+    for (const auto &match : all)
+    {
+        py::dict d;
+        d["path"] = match.path;
+        d["line"] = match.line;
+        d["column"] = match.column;
+        d["offset"] = match.offset;
+        d["pattern"] = patterns[match.pattern];
+        // 行内容可能不是合法 UTF-8（或在多字节字符中间被截断），替换非法字节
+        d["text"] = py::bytes(match.text).attr("decode")("utf-8", "replace");
+        matches.append(d);
+    }
+
+    py::dict result;
+    result["matches"] = matches;
+    result["files_scanned"] = files_scanned.load();
+    result["files_matched"] = files_matched.load();
+    result["bytes_scanned"] = bytes_scanned.load();
+    result["truncated"] = truncated;
+    result["errors"] = errors;
+    return result;
+}
+
+// ============================================================================
+// 大文本文件行索引
+// ============================================================================
+
+/**
+ * @brief 计算 64 字节块中换行符的位掩码（第 i 位对应 p[i]）
+ *
+ * AVX2 两次 32 字节比较，SSE2 四次 16 字节比较，否则逐字节。
+ */
+static inline uint64_t newline_mask64(const uint8_t *p)
+{
+#if defined(__AVX2__)
+    const __m256i nl = _mm256_set1_epi8('\n');
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32));
+    uint64_t m0 = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, nl)));
+    uint64_t m1 = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, nl)));
+    return m0 | (m1 << 32);
+#elif defined(__SSE2__)
+    const __m128i nl = _mm_set1_epi8('\n');
+    uint64_t mask = 0;
+    for (int k = 0; k < 4; ++k)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + k * 16));
+        uint64_t m = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, nl)));
+        mask |= m << (k * 16);
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; ++i)
+        mask |= static_cast<uint64_t>(p[i] == '\n') << i;
+    return mask;
+#endif
+}
+
+/**
+ * @struct LineIndex
+ * @brief 稀疏行偏移索引
+ *
+ * checkpoints[k] 为第 k * stride 行（从 0 开始）的起始字节偏移，
+ * 因此定位任意行最多需要跳过 stride - 1 行。
+ * tail 保存 indexed_size 之前的最后若干字节，用于判断文件是否只是追加增长
+ * （截断或重写后指纹不再匹配，索引整体重建）。
+ */
+struct LineIndex
+{
+    static const uint32_t kTailBytes = 64;
+
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+    uint32_t stride = 0;
+    uint64_t indexed_size = 0;    // 已扫描的字节数
+    uint64_t newlines = 0;        // [0, indexed_size) 中的换行数
+    uint64_t last_line_start = 0; // 最后一个换行之后的偏移
+    std::vector<uint64_t> checkpoints;
+    uint32_t tail_len = 0;
+    uint8_t tail[kTailBytes] = {};
+
+    void reset(uint64_t new_dev, uint64_t new_ino, uint32_t new_stride)
+    {
+        *this = LineIndex();
+        dev = new_dev;
+        ino = new_ino;
+        stride = new_stride;
+        checkpoints.push_back(0);
+    }
+
+    /** 总行数：末尾没有换行的残行也算一行 */
+    uint64_t total_lines() const
+    {
+        return newlines + (indexed_size > last_line_start ? 1 : 0);
+    }
+
+    /**
+     * @brief 扫描 [base, base + len) 的内容，追加换行统计与检查点
+     */
+    void scan(const uint8_t *data, size_t len, uint64_t base)
+    {
+        size_t i = 0;
+        for (; i + 64 <= len; i += 64)
+        {
+            uint64_t mask = newline_mask64(data + i);
+            if (mask == 0)
+                continue;
+            consume_mask(mask, base + i);
+        }
+        if (i < len)
+        {
+            uint64_t mask = 0;
+            for (size_t j = 0; i + j < len; ++j)
+                mask |= static_cast<uint64_t>(data[i + j] == '\n') << j;
+            if (mask != 0)
+                consume_mask(mask, base + i);
+        }
+        indexed_size = base + len;
+    }
+
+private:
+    void consume_mask(uint64_t mask, uint64_t block_offset)
+    {
+        uint64_t count = static_cast<uint64_t>(__builtin_popcountll(mask));
+        last_line_start = block_offset + (63 - __builtin_clzll(mask)) + 1;
+        // 块内不会跨越下一个检查点：只累加计数
+        if (newlines % stride + count < stride)
+        {
+            newlines += count;
+            return;
+        }
+        while (mask != 0)
+        {
+            uint64_t bit = static_cast<uint64_t>(__builtin_ctzll(mask));
+            mask &= mask - 1;
+            if (++newlines % stride == 0)
+                checkpoints.push_back(block_offset + bit + 1);
+        }
+    }
+};
+
+/**
+ * @brief 从索引文件加载行索引
+ *
+ * 文件格式（本机字节序，仅作本机缓存）：
+ * "FFLIDX01" | stride u32 | tail_len u32 | dev | ino | indexed_size |
+ * newlines | last_line_start | checkpoint 数 (u64 ×6) | tail[64] | checkpoints
+ *
+ * 索引文件不可信：所有计数与偏移都先校验（与文件大小、彼此之间）再使用。
+ *
+ * @return 格式不符、校验失败或读取失败返回 false
+ */
+static bool load_line_index(const std::string &index_path, LineIndex &out)
+{
+    FdGuard fd(::open(index_path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!fd.valid())
+        return false;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t stride;
+        uint32_t tail_len;
+        uint64_t dev, ino, indexed_size, newlines, last_line_start, count;
+        uint8_t tail[LineIndex::kTailBytes];
+    } header;
+
+    if (pread_full(fd.get(), reinterpret_cast<uint8_t *>(&header), sizeof(header), 0) !=
+            static_cast<ssize_t>(sizeof(header)) ||
+        std::memcmp(header.magic, "FFLIDX01", 8) != 0 || header.stride == 0 ||
+        header.tail_len > LineIndex::kTailBytes || header.count == 0)
+        return false;
+
+    LineIndex index;
+    index.dev = header.dev;
+    index.ino = header.ino;
+    index.stride = header.stride;
+    index.indexed_size = header.indexed_size;
+    index.newlines = header.newlines;
+    index.last_line_start = header.last_line_start;
+    index.tail_len = header.tail_len;
+    std::memcpy(index.tail, header.tail, sizeof(index.tail));
+
+    // 检查点数必须与换行数一致，且恰好填满文件剩余部分（先于分配内存校验）
+    struct stat file_st;
+    if (::fstat(fd.get(), &file_st) != 0 || file_st.st_size < static_cast<off_t>(sizeof(header)))
+        return false;
+    const uint64_t payload = static_cast<uint64_t>(file_st.st_size) - sizeof(header);
+    if (header.count != header.newlines / header.stride + 1 ||
+        payload % sizeof(uint64_t) != 0 || header.count != payload / sizeof(uint64_t))
+        return false;
+    if (header.newlines > header.indexed_size || header.last_line_start > header.indexed_size ||
+        header.tail_len > header.indexed_size)
+        return false;
+    index.checkpoints.resize(header.count);
+    size_t bytes = header.count * sizeof(uint64_t);
+    if (pread_full(fd.get(), reinterpret_cast<uint8_t *>(index.checkpoints.data()), bytes,
+                   sizeof(header)) != static_cast<ssize_t>(bytes))
+        return false;
+
+    // 检查点是严格递增的行首偏移：首个为 0，且都不超过已索引范围
+    if (index.checkpoints[0] != 0)
+        return false;
+    for (size_t k = 1; k < index.checkpoints.size(); ++k)
+    {
+        if (index.checkpoints[k] <= index.checkpoints[k - 1] ||
+            index.checkpoints[k] > index.last_line_start)
+            return false;
+    }
+
+    out = std::move(index);
+    return true;
+}
+
+/**
+ * @brief 原子写入索引文件（atomic_write_file），失败时静默忽略
+ */
+static void save_line_index(const std::string &index_path, const LineIndex &index)
+{
+    std::string buffer("FFLIDX01", 8);
+    auto put = [&buffer](const void *data, size_t len)
+    { buffer.append(static_cast<const char *>(data), len); };
+    uint64_t count = index.checkpoints.size();
+    put(&index.stride, sizeof(index.stride));
+    put(&index.tail_len, sizeof(index.tail_len));
+    for (uint64_t value : {index.dev, index.ino, index.indexed_size, index.newlines,
+                           index.last_line_start, count})
+        put(&value, sizeof(value));
+    put(index.tail, sizeof(index.tail));
+    put(index.checkpoints.data(), count * sizeof(uint64_t));
+
+    try
+    {
+        atomic_write_file(index_path, buffer, 0600);
+    }
+    catch (const FsError &)
+    {
+    }
+}
+
+/**
+ * @class LineIndexCache
+ * @brief 进程内行索引缓存
+ *
+ * 每个文件一个条目，条目自带互斥锁：同一文件的并发请求串行更新索引，
+ * 不同文件互不影响。超过容量时淘汰最久未使用的条目。
+ */
+class LineIndexCache
+{
+public:
+    struct Entry
+    {
+        std::mutex mutex;
+        LineIndex index;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    static LineIndexCache &instance()
+    {
+        static LineIndexCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<Entry> acquire(const std::string &path)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+        auto it = entries_.find(path);
+        if (it != entries_.end())
+        {
+            it->second->last_used = now;
+            return it->second;
+        }
+        if (entries_.size() >= kCapacity)
+        {
+            auto oldest = std::min_element(entries_.begin(), entries_.end(),
+                                           [](const auto &a, const auto &b)
+                                           { return a.second->last_used < b.second->last_used; });
+            entries_.erase(oldest);
+        }
+        auto entry = std::make_shared<Entry>();
+        entry->last_used = now;
+        entries_.emplace(path, entry);
+        return entry;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+    }
+
+private:
+    static const size_t kCapacity = 64;
+
+    LineIndexCache() = default;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Entry>> entries_;
+};
+
+/**
+ * @struct LineIndexUpdate
+ * @brief 一次索引更新的统计
+ */
+struct LineIndexUpdate
+{
+    bool rebuilt = false;      // 索引从头重建（首次、文件被替换或截断）
+    uint64_t scanned_bytes = 0; // 本次新扫描的字节数
+};
+
+/**
+ * @brief 校验并增量更新行索引（调用方持有条目锁，GIL 已释放）
+ *
+ * - 内存中没有可用索引时先尝试加载 index_path
+ * - (dev, ino) 变化或 tail 指纹不符：文件被轮转 / 截断 / 重写，从头重建
+ * - 文件增长：只扫描新增部分（按 4MB 分块 pread）
+ */
+static LineIndexUpdate update_line_index(int fd, const FileStat &st, const std::string &file_path,
+                                         const std::string &index_path, uint32_t stride,
+                                         LineIndex &index)
+{
+    LineIndexUpdate update;
+
+    auto matches_file = [&](const LineIndex &candidate)
+    {
+        if (candidate.stride != stride || candidate.dev != st.dev || candidate.ino != st.ino ||
+            candidate.indexed_size > st.size)
+            return false;
+        if (candidate.tail_len == 0)
+            return true;
+        uint8_t current[LineIndex::kTailBytes];
+        return pread_full(fd, current, candidate.tail_len,
+                          candidate.indexed_size - candidate.tail_len) ==
+                   static_cast<ssize_t>(candidate.tail_len) &&
+               std::memcmp(current, candidate.tail, candidate.tail_len) == 0;
+    };
+
+    if (index.checkpoints.empty() || !matches_file(index))
+    {
+        LineIndex loaded;
+        if (!index_path.empty() && load_line_index(index_path, loaded) && matches_file(loaded))
+        {
+            index = std::move(loaded);
+        }
+        else
+        {
+            index.reset(st.dev, st.ino, stride);
+            update.rebuilt = true;
+        }
+    }
+
+    if (st.size == index.indexed_size)
+        return update;
+
+    // pread 分块读取而不是 mmap：日志被 copytruncate 截短时 mmap 访问会触发 SIGBUS，
+    // pread 只会提前读到 EOF，索引停在实际读到的位置
+    static const size_t kChunk = 4 * 1024 * 1024;
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[kChunk]);
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fd, static_cast<off_t>(index.indexed_size), 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    uint64_t start = index.indexed_size;
+    while (index.indexed_size < st.size)
+    {
+        uint64_t offset = index.indexed_size;
+        size_t want = static_cast<size_t>(std::min<uint64_t>(st.size - offset, kChunk));
+        ssize_t n = pread_full(fd, buffer.get(), want, offset);
+        if (n < 0)
+            throw FsError(errno, file_path);
+        if (n == 0)
+            break;
+        index.scan(buffer.get(), static_cast<size_t>(n), offset);
+    }
+    update.scanned_bytes = index.indexed_size - start;
+
+    index.tail_len = static_cast<uint32_t>(std::min<uint64_t>(index.indexed_size, LineIndex::kTailBytes));
+    if (pread_full(fd, index.tail, index.tail_len, index.indexed_size - index.tail_len) !=
+        static_cast<ssize_t>(index.tail_len))
+        index.tail_len = 0;
+
+    if (!index_path.empty())
+        save_line_index(index_path, index);
+    return update;
+}
+
+/**
+ * @brief 打开文本文件，返回 fd 与 stat 结果；不是普通文件时抛出异常
+ */
+static int open_text_file(const std::string &file_path, FileStat &st)
+{
+    int fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw FsError(errno, file_path);
+    struct stat raw;
+    if (::fstat(fd, &raw) != 0)
+    {
+        int err = errno;
+        ::close(fd);
+        throw FsError(err, file_path);
+    }
+    fill_from_stat(raw, st);
+    if (!S_ISREG(st.mode))
+    {
+        ::close(fd);
+        throw std::runtime_error("Path is not a regular file: " + file_path);
+    }
+    return fd;
+}
+
+/**
+ * @brief 构建或增量更新文件的行索引
+ *
+ * @param file_path 文本文件路径
+ * @param index_path 索引文件路径（为空时只保存在进程内缓存）
+ * @param stride 检查点间隔（行数）
+ * @return 字典：total_lines、indexed_size、checkpoints、stride、rebuilt、scanned_bytes
+ */
+py::dict build_line_index(const std::string &file_path, const std::string &index_path = "",
+                          uint32_t stride = 1000)
+{
+    if (stride == 0)
+        throw std::invalid_argument("stride must be positive");
+
+    auto entry = LineIndexCache::instance().acquire(file_path);
+    LineIndexUpdate update;
+    uint64_t total_lines, indexed_size, checkpoints;
+    {
+        py::gil_scoped_release release;
+
+        FileStat st;
+        FdGuard fd(open_text_file(file_path, st));
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        update = update_line_index(fd.get(), st, file_path, index_path, stride, entry->index);
+        total_lines = entry->index.total_lines();
+        indexed_size = entry->index.indexed_size;
+        checkpoints = entry->index.checkpoints.size();
+    }
+
+    py::dict result;
+    result["total_lines"] = total_lines;
+    result["indexed_size"] = indexed_size;
+    result["checkpoints"] = checkpoints;
+    result["stride"] = stride;
+    result["rebuilt"] = update.rebuilt;
+    result["scanned_bytes"] = update.scanned_bytes;
+    return result;
+}
+
+/**
+ * @brief 读取文件中的一段行
+ *
+ * 先增量更新行索引，再由检查点确定覆盖目标行的字节窗口，按定长块 pread 扫描。
+ * 超长行截断到 max_line_length；收集阶段读取的字节数以 count * max_line_length 为上限，
+ * 用尽时返回的行数可能少于 count（后续行按行号继续请求即可）。
+ *
+ * @param file_path 文本文件路径
+ * @param first_line 起始行号（从 1 开始）
+ * @param count 行数
+ * @param index_path 索引文件路径（为空时只保存在进程内缓存）
+ * @param stride 检查点间隔（行数）
+ * @param max_line_length 单行最多返回的字节数，超出部分截断
+ * @return 字典：first_line、lines、offset（首行字节偏移）、total_lines、indexed_size
+ */
+py::dict read_lines(const std::string &file_path, uint64_t first_line, uint64_t count,
+                    const std::string &index_path = "", uint32_t stride = 1000,
+                    size_t max_line_length = 64 * 1024)
+{
+    if (stride == 0)
+        throw std::invalid_argument("stride must be positive");
+    if (first_line == 0)
+        first_line = 1;
+
+    auto entry = LineIndexCache::instance().acquire(file_path);
+    std::vector<std::string> lines;
+    uint64_t total_lines = 0, indexed_size = 0, first_offset = 0;
+    {
+        py::gil_scoped_release release;
+
+        FileStat st;
+        FdGuard fd(open_text_file(file_path, st));
+
+        uint64_t begin = 0, end = 0, skip = 0;
+        {
+            std::lock_guard<std::mutex> lock(entry->mutex);
+            const LineIndex &index = entry->index;
+            update_line_index(fd.get(), st, file_path, index_path, stride, entry->index);
+            total_lines = index.total_lines();
+            indexed_size = index.indexed_size;
+            if (first_line <= total_lines && count > 0)
+            {
+                uint64_t last_line = std::min(first_line + count - 1, total_lines);
+                uint64_t k_begin = (first_line - 1) / stride;
+                uint64_t k_end = (last_line - 1) / stride + 1;
+                begin = index.checkpoints[k_begin];
+                end = k_end < index.checkpoints.size() ? index.checkpoints[k_end] : index.indexed_size;
+                skip = (first_line - 1) - k_begin * stride;
+                count = last_line - first_line + 1;
+            }
+        }
+
+        if (end > begin)
+        {
+            // 定长分块 pread：内存只占一个块加已收集的行（每行至多 max_line_length + 1 字节）。
+            // 收集阶段最多读取 count * max_line_length 字节，超长行截断后提前结束，
+            // 少有换行的大文件不会因一次请求读入整个检查点窗口
+            static const size_t kChunk = 256 * 1024;
+            std::unique_ptr<uint8_t[]> buffer(new uint8_t[kChunk]);
+            const uint64_t budget = max_line_length > 0 && count > UINT64_MAX / max_line_length
+                                        ? UINT64_MAX
+                                        : std::max<uint64_t>(count * max_line_length, kChunk);
+            uint64_t skipped = 0, collected = 0;
+            uint64_t line_bytes = 0; // 当前行已读到的原始字节数
+            uint8_t last_byte = 0;
+            std::string line;
+            bool collecting = skip == 0;
+            if (collecting)
+                first_offset = begin;
+
+            auto finish_line = [&]()
+            {
+                uint64_t text_len = line_bytes;
+                if (text_len > 0 && last_byte == '\r')
+                    --text_len;
+                line.resize(static_cast<size_t>(std::min<uint64_t>(text_len, max_line_length)));
+                lines.push_back(std::move(line));
+                line.clear();
+                line_bytes = 0;
+            };
+
+            uint64_t offset = begin;
+            bool done = false;
+            while (!done && offset < end && lines.size() < count)
+            {
+                const size_t want = static_cast<size_t>(std::min<uint64_t>(kChunk, end - offset));
+                ssize_t n = pread_full(fd.get(), buffer.get(), want, offset);
+                if (n < 0)
+                    throw FsError(errno, file_path);
+                if (n == 0)
+                    break; // 文件在索引后被截短
+                const uint8_t *data = buffer.get();
+                const size_t len = static_cast<size_t>(n);
+                size_t pos = 0;
+                while (pos < len)
+                {
+                    const void *found = std::memchr(data + pos, '\n', len - pos);
+                    const size_t nl = found ? static_cast<size_t>(static_cast<const uint8_t *>(found) - data) : len;
+                    if (!collecting)
+                    {
+                        if (!found)
+                            break;
+                        pos = nl + 1;
+                        if (++skipped == skip)
+                        {
+                            collecting = true;
+                            first_offset = offset + pos;
+                        }
+                        continue;
+                    }
+
+                    const size_t segment = nl - pos;
+                    if (line.size() <= max_line_length)
+                        line.append(reinterpret_cast<const char *>(data) + pos,
+                                    std::min(segment, max_line_length + 1 - line.size()));
+                    if (segment > 0)
+                    {
+                        line_bytes += segment;
+                        last_byte = data[nl - 1];
+                    }
+                    collected += segment + (found ? 1 : 0);
+                    pos = found ? nl + 1 : len;
+                    if (found)
+                        finish_line();
+                    if (lines.size() >= count || collected >= budget)
+                    {
+                        done = true;
+                        break;
+                    }
+                }
+                offset += len;
+                if (len < want)
+                    break;
+            }
+            if (!collecting)
+                first_offset = offset; // 文件在跳过阶段结束
+            // 末行没有换行（或收集预算用尽时的超长行）
+            if (collecting && line_bytes > 0 && lines.size() < count)
+                finish_line();
+        }
+    }
+
+    py::list py_lines;
+    for (const auto &line : lines)
+        py_lines.append(py::bytes(line).attr("decode")("utf-8", "replace"));
+
+    py::dict result;
+    result["first_line"] = first_line;
+    result["lines"] = py_lines;
+    result["offset"] = first_offset;
+    result["total_lines"] = total_lines;
+    result["indexed_size"] = indexed_size;
+    return result;
+}
+
+// ============================================================================
+// 实时跟踪（tail -f）
+// ============================================================================
+
+/**
+ * @class TailHub
+ * @brief 共享的文件跟踪中心
+ *
+ * 同一路径无论有多少客户端在跟踪，都只持有一个 fd、一组 inotify watch：
+ * - 文件本身：IN_MODIFY / IN_ATTRIB / IN_MOVE_SELF / IN_DELETE_SELF
+ * - 所在目录：IN_CREATE / IN_MOVED_TO（按文件名过滤），用于发现轮转后的新文件
+ * 后台线程读取 inotify 事件并递增对应条目的 generation，唤醒等待者。
+ * 最近读取的字节保存在共享缓存中，跟在同一位置的客户端无需重复 pread。
+ * 非 Linux 平台退化为定时轮询。
+ */
+class TailHub
+{
+public:
+    struct Watch
+    {
+        std::string path;
+        std::string name; // 文件名，用于匹配目录事件
+        int fd = -1;
+        uint64_t dev = 0;
+        uint64_t ino = 0;
+        int file_wd = -1;
+        int dir_wd = -1;
+        uint64_t generation = 0; // 受 TailHub::mutex_ 保护
+        size_t refs = 0;         // 受 TailHub::mutex_ 保护
+
+        std::mutex io_mutex; // 串行化重新打开与读取
+        uint64_t cache_offset = 0;
+        std::string cache; // [cache_offset, cache_offset + cache.size()) 的文件内容
+
+        ~Watch()
+        {
+            if (fd >= 0)
+                ::close(fd);
+        }
+    };
+
+    static TailHub &instance()
+    {
+        static TailHub hub;
+        return hub;
+    }
+
+    /**
+     * @brief 取得路径对应的跟踪条目（不存在则打开文件并注册 watch）
+     */
+    std::shared_ptr<Watch> acquire(const std::string &path)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = watches_.find(path);
+        if (it != watches_.end())
+        {
+            ++it->second->refs;
+            return it->second;
+        }
+
+        auto watch = std::make_shared<Watch>();
+        watch->path = path;
+        size_t slash = path.find_last_of('/');
+        watch->name = slash == std::string::npos ? path : path.substr(slash + 1);
+        watch->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (watch->fd < 0)
+            throw FsError(errno, path);
+        struct stat st;
+        if (::fstat(watch->fd, &st) != 0)
+            throw FsError(errno, path);
+        if (!S_ISREG(st.st_mode))
+            throw std::runtime_error("Path is not a regular file: " + path);
+        watch->dev = st.st_dev;
+        watch->ino = st.st_ino;
+
+#ifdef __linux__
+        ensure_thread();
+        if (inotify_fd_ >= 0)
+        {
+            watch->file_wd = add_listener(path, kFileMask, watch.get());
+            std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+            watch->dir_wd = add_listener(dir, kDirMask, watch.get());
+        }
+#endif
+        watch->refs = 1;
+        watches_.emplace(path, watch);
+        return watch;
+    }
+
+    void release(const std::shared_ptr<Watch> &watch)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--watch->refs > 0)
+            return;
+#ifdef __linux__
+        remove_listener(watch->file_wd, watch.get());
+        remove_listener(watch->dir_wd, watch.get());
+#endif
+        watches_.erase(watch->path);
+    }
+
+    uint64_t generation(const Watch &watch)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return watch.generation;
+    }
+
+    /**
+     * @brief 等待条目的 generation 变化
+     * @return 超时返回 false
+     */
+    bool wait_change(const Watch &watch, uint64_t seen,
+                     std::chrono::steady_clock::time_point deadline)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (inotify_fd_ < 0)
+        {
+            // 无 inotify：定时轮询，调用方每次醒来都重新检查文件大小
+            auto poll_deadline = std::min(deadline, std::chrono::steady_clock::now() +
+                                                        std::chrono::milliseconds(250));
+            cv_.wait_until(lock, poll_deadline);
+            return std::chrono::steady_clock::now() < deadline;
+        }
+        return cv_.wait_until(lock, deadline, [&] { return watch.generation != seen; });
+    }
+
+    /**
+     * @brief 文件被轮转后重新打开（调用方持有 io_mutex）
+     */
+    void reopen(Watch &watch, int new_fd, const struct stat &st)
+    {
+        ::close(watch.fd);
+        watch.fd = new_fd;
+        watch.dev = st.st_dev;
+        watch.ino = st.st_ino;
+        watch.cache.clear();
+        watch.cache_offset = 0;
+#ifdef __linux__
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (inotify_fd_ >= 0)
+        {
+            remove_listener(watch.file_wd, &watch);
+            watch.file_wd = add_listener(watch.path, kFileMask, &watch);
+        }
+#endif
+    }
+
+private:
+#ifdef __linux__
+    static const uint32_t kFileMask = IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF;
+    static const uint32_t kDirMask = IN_CREATE | IN_MOVED_TO;
+#endif
+
+    TailHub() = default;
+
+#ifdef __linux__
+    void ensure_thread()
+    {
+        if (thread_started_)
+            return;
+        thread_started_ = true;
+        inotify_fd_ = ::inotify_init1(IN_CLOEXEC);
+        if (inotify_fd_ < 0)
+            return;
+        // 进程级单例，线程随进程结束
+        std::thread([this] { event_loop(); }).detach();
+    }
+
+    int add_listener(const std::string &path, uint32_t mask, Watch *watch)
+    {
+        int wd = ::inotify_add_watch(inotify_fd_, path.c_str(), mask);
+        if (wd >= 0)
+            listeners_[wd].push_back(watch);
+        return wd;
+    }
+
+    void remove_listener(int wd, Watch *watch)
+    {
+        auto it = listeners_.find(wd);
+        if (wd < 0 || it == listeners_.end())
+            return;
+        auto &list = it->second;
+        list.erase(std::remove(list.begin(), list.end(), watch), list.end());
+        if (list.empty())
+        {
+            ::inotify_rm_watch(inotify_fd_, wd);
+            listeners_.erase(it);
+        }
+    }
+
+    void event_loop()
+    {
+        alignas(struct inotify_event) char buffer[64 * 1024];
+        while (true)
+        {
+            ssize_t n = ::read(inotify_fd_, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (char *p = buffer; p < buffer + n;)
+            {
+                auto *event = reinterpret_cast<struct inotify_event *>(p);
+                p += sizeof(struct inotify_event) + event->len;
+
+                auto it = listeners_.find(event->wd);
+                if (it == listeners_.end())
+                    continue;
+                if (event->mask & IN_IGNORED)
+                {
+                    // watch 已被内核移除（文件删除），避免 wd 复用后误匹配
+                    for (Watch *watch : it->second)
+                    {
+                        if (watch->file_wd == event->wd)
+                            watch->file_wd = -1;
+                        if (watch->dir_wd == event->wd)
+                            watch->dir_wd = -1;
+                        ++watch->generation;
+                    }
+                    listeners_.erase(it);
+                    continue;
+                }
+                for (Watch *watch : it->second)
+                {
+                    bool is_dir_event = event->wd == watch->dir_wd && event->wd != watch->file_wd;
+                    if (is_dir_event && (event->len == 0 || watch->name != event->name))
                         continue;
+                    ++watch->generation;
+                }
+            }
+            cv_.notify_all();
+        }
+    }
+
+    bool thread_started_ = false;
+    std::unordered_map<int, std::vector<Watch *>> listeners_; // wd -> 条目（目录 watch 可被共享）
+#endif
+
+    int inotify_fd_ = -1;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<std::string, std::shared_ptr<Watch>> watches_;
+};
+
+/**
+ * @brief 在已持有的跟踪条目上读取 offset 之后的新增内容（长轮询）
+ *
+ * 返回 offset 之后的新字节；没有新内容时阻塞等待 inotify 事件（GIL 已释放），
+ * 醒来后再等待 batch_ms 合并连续的小写入，超时返回空数据。
+ * 客户端应把返回的 offset / inode 原样带入下一次调用：
+ * - 路径指向了新的 inode（日志轮转）：从新文件开头读取，rotated = true
+ * - 文件小于 offset（被截断）：从头读取，truncated = true
+ *
+ * @return 字典：data、offset、inode、size、rotated、truncated
+ */
+static py::dict tail_read_watch(const std::shared_ptr<TailHub::Watch> &watch, const std::string &file_path,
+                                int64_t offset, uint64_t inode, double timeout, size_t max_bytes,
+                                int batch_ms)
+{
+    static const size_t kCacheBytes = 1024 * 1024;
+
+    auto &hub = TailHub::instance();
+    std::string data;
+    uint64_t position = 0, size = 0, current_inode = 0;
+    bool rotated = false, truncated = false;
+
+    {
+        py::gil_scoped_release release;
+
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>(std::max(0.0, timeout)));
+        bool first_pass = true;
+        uint64_t read_inode = 0; // position 所对应文件的 inode
+
+        while (true)
+        {
+            uint64_t seen = hub.generation(*watch);
+            {
+                std::lock_guard<std::mutex> io_lock(watch->io_mutex);
+
+                // 路径指向了新文件：日志轮转
+                struct stat path_st;
+                if (::stat(file_path.c_str(), &path_st) == 0 &&
+                    (static_cast<uint64_t>(path_st.st_ino) != watch->ino ||
+                     static_cast<uint64_t>(path_st.st_dev) != watch->dev))
+                {
+                    int new_fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+                    if (new_fd >= 0)
+                        hub.reopen(*watch, new_fd, path_st);
+                }
+
+                struct stat st;
+                if (::fstat(watch->fd, &st) != 0)
+                    throw FsError(errno, file_path);
+                size = static_cast<uint64_t>(st.st_size);
+                current_inode = watch->ino;
+
+                if (first_pass)
+                {
+                    if (inode != 0 && inode != watch->ino)
+                    {
+                        rotated = true;
+                        position = 0;
+                    }
+                    else if (offset < 0)
+                    {
+                        // 无符号取反：INT64_MIN 也不会溢出
+                        uint64_t back = 0 - static_cast<uint64_t>(offset);
+                        position = back >= size ? 0 : size - back;
+                    }
+                    else
+                    {
+                        position = static_cast<uint64_t>(offset);
+                        if (position > size)
+                        {
+                            truncated = true;
+                            position = 0;
+                        }
+                    }
+                    first_pass = false;
+                }
+                else if (watch->ino != read_inode)
+                {
+                    // 等待期间发生轮转（本次或其他客户端重新打开了条目）：
+                    // position 属于旧文件，新文件从头读取
+                    rotated = true;
+                    position = 0;
+                }
+                else if (position > size)
+                {
+                    truncated = true;
+                    position = 0;
+                }
+                read_inode = watch->ino;
+                if (truncated && watch->cache_offset + watch->cache.size() > size)
+                {
+                    watch->cache.clear();
+                    watch->cache_offset = 0;
+                }
+
+                if (size > position)
+                {
+                    size_t want = static_cast<size_t>(std::min<uint64_t>(size - position, max_bytes));
+                    uint64_t cache_end = watch->cache_offset + watch->cache.size();
+                    if (position >= watch->cache_offset && position + want <= cache_end)
+                    {
+                        // 其他客户端刚读过这段内容
+                        data.assign(watch->cache, static_cast<size_t>(position - watch->cache_offset), want);
+                    }
+                    else
+                    {
+                        data.resize(want);
+                        ssize_t n = pread_full(watch->fd, reinterpret_cast<uint8_t *>(&data[0]), want, position);
+                        if (n < 0)
+                            throw FsError(errno, file_path);
+                        data.resize(static_cast<size_t>(n));
+
+                        if (position == cache_end)
+                        {
+                            watch->cache.append(data);
+                        }
+                        else
+                        {
+                            watch->cache = data;
+                            watch->cache_offset = position;
+                        }
+                        if (watch->cache.size() > kCacheBytes)
+                        {
+                            size_t drop = watch->cache.size() - kCacheBytes;
+                            watch->cache.erase(0, drop);
+                            watch->cache_offset += drop;
+                        }
                     }
+                    break;
+                }
+            }
+
+            // 轮转 / 截断本身也要让客户端尽快知道
+            if (rotated || truncated)
+                break;
+            if (!hub.wait_change(*watch, seen, deadline))
+                break;
+            if (batch_ms > 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(batch_ms));
+        }
+    }
+
+    py::dict result;
+    result["data"] = py::bytes(data);
+    result["offset"] = position + data.size();
+    result["inode"] = current_inode;
+    result["size"] = size;
+    result["rotated"] = rotated;
+    result["truncated"] = truncated;
+    return result;
+}
+
+/**
+ * @brief 跟踪文件的新增内容（单次长轮询）
+ *
+ * 每次调用都会取得并释放跟踪条目；没有其他订阅者时 fd 与 inotify watch
+ * 会随之关闭。持续跟踪应使用 TailSubscription，在整个订阅期间保持它们。
+ *
+ * @param file_path 文件路径
+ * @param offset 起始偏移；负数表示从末尾倒数 |offset| 字节开始
+ * @param inode 上次调用返回的 inode（首次调用传 0）
+ * @param timeout 最长等待秒数
+ * @param max_bytes 单次最多返回的字节数
+ * @param batch_ms 收到变更后合并写入的等待毫秒数
+ * @return 字典：data、offset、inode、size、rotated、truncated
+ */
+py::dict tail_read(const std::string &file_path, int64_t offset = 0, uint64_t inode = 0,
+                   double timeout = 30.0, size_t max_bytes = 1024 * 1024, int batch_ms = 50)
+{
+    auto &hub = TailHub::instance();
+    std::shared_ptr<TailHub::Watch> watch;
+    {
+        py::gil_scoped_release release;
+        watch = hub.acquire(file_path);
+    }
+    struct Releaser
+    {
+        TailHub &hub;
+        std::shared_ptr<TailHub::Watch> &watch;
+        ~Releaser() { hub.release(watch); }
+    } releaser{hub, watch};
+    return tail_read_watch(watch, file_path, offset, inode, timeout, max_bytes, batch_ms);
+}
+
+/**
+ * @class TailSubscription
+ * @brief 一个客户端的持续跟踪
+ *
+ * 构造时取得 TailHub 条目，close()（或析构）时释放；
+ * 其间的多次 read() 复用同一个 fd 与 inotify watch，
+ * 不会在每次长轮询超时后拆掉再重建。
+ */
+class TailSubscription
+{
+public:
+    explicit TailSubscription(const std::string &file_path)
+        : path_(file_path), watch_(TailHub::instance().acquire(file_path))
+    {
+    }
+
+    ~TailSubscription() { close(); }
+
+    TailSubscription(const TailSubscription &) = delete;
+    TailSubscription &operator=(const TailSubscription &) = delete;
+
+    py::dict read(int64_t offset, uint64_t inode, double timeout, size_t max_bytes, int batch_ms)
+    {
+        std::shared_ptr<TailHub::Watch> watch;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            watch = watch_;
+        }
+        if (!watch)
+            throw std::runtime_error("Tail subscription is closed: " + path_);
+        return tail_read_watch(watch, path_, offset, inode, timeout, max_bytes, batch_ms);
+    }
+
+    void close()
+    {
+        std::shared_ptr<TailHub::Watch> watch;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            watch.swap(watch_);
+        }
+        if (watch)
+            TailHub::instance().release(watch);
+    }
+
+    bool closed() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return !watch_;
+    }
+
+private:
+    std::string path_;
+    std::shared_ptr<TailHub::Watch> watch_;
+    mutable std::mutex mutex_;
+};
+
+// ============================================================================
+// 零拷贝范围读取
+// ============================================================================
+
+/**
+ * @class BufferPool
+ * @brief 按 2 的幂分级的读缓冲区池
+ *
+ * 预览类请求频繁且短小，复用缓冲区避免每次分配 / 缺页。
+ * 每个尺寸级别最多保留 kMaxFreePerClass 个空闲缓冲区。
+ */
+class BufferPool
+{
+public:
+    static BufferPool &instance()
+    {
+        static BufferPool pool;
+        return pool;
+    }
+
+    /** @brief 取得至少 size 字节的缓冲区，capacity 返回实际容量 */
+    std::unique_ptr<uint8_t[]> acquire(size_t size, size_t &capacity)
+    {
+        capacity = kMinClass;
+        while (capacity < size)
+            capacity <<= 1;
+        if (capacity <= kMaxPooled)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto &list = free_[capacity];
+            if (!list.empty())
+            {
+                auto buffer = std::move(list.back());
+                list.pop_back();
+                return buffer;
+            }
+        }
+        return std::unique_ptr<uint8_t[]>(new uint8_t[capacity]);
+    }
+
+    void release(std::unique_ptr<uint8_t[]> buffer, size_t capacity)
+    {
+        if (!buffer || capacity > kMaxPooled)
+            return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto &list = free_[capacity];
+        if (list.size() < kMaxFreePerClass)
+            list.push_back(std::move(buffer));
+    }
+
+private:
+    static const size_t kMinClass = 4096;
+    static const size_t kMaxPooled = 16 * 1024 * 1024;
+    static const size_t kMaxFreePerClass = 8;
+
+    BufferPool() = default;
+
+    std::mutex mutex_;
+    std::unordered_map<size_t, std::vector<std::unique_ptr<uint8_t[]>>> free_;
+};
+
+/**
+ * @class ReadBuffer
+ * @brief 只读字节区域：池化缓冲区，通过缓冲区协议暴露给 Python
+ *
+ * Python 侧拿到的是指向本对象的 memoryview，不复制数据；
+ * 最后一个 memoryview 释放时缓冲区归还到池。
+ */
+class ReadBuffer
+{
+public:
+    /** @brief 从缓冲区池分配 */
+    static std::unique_ptr<ReadBuffer> pooled(size_t size)
+    {
+        std::unique_ptr<ReadBuffer> buffer(new ReadBuffer());
+        buffer->pooled_ = BufferPool::instance().acquire(size, buffer->capacity_);
+        buffer->data_ = buffer->pooled_.get();
+        return buffer;
+    }
+
+    ReadBuffer(const ReadBuffer &) = delete;
+    ReadBuffer &operator=(const ReadBuffer &) = delete;
+
+    ~ReadBuffer()
+    {
+        BufferPool::instance().release(std::move(pooled_), capacity_);
+    }
+
+    const uint8_t *data() const { return data_; }
+    uint8_t *writable() { return data_; } // 仅在填充阶段使用
+    size_t size() const { return size_; }
+    void set_size(size_t size) { size_ = size; }
+
+private:
+    ReadBuffer() = default;
+
+    std::unique_ptr<uint8_t[]> pooled_;
+    size_t capacity_ = 0;
+    uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+/**
+ * @brief 读取文件的一个字节范围，返回只读 memoryview
+ *
+ * 释放 GIL 后 pread 到池化缓冲区，memoryview 直接指向这块缓冲区，
+ * 不再复制为 bytes。不使用 mmap：数据在返回前已读入进程内存，
+ * 文件随后被截短也不会在访问视图时触发 SIGBUS。
+ *
+ * @param file_path 文件路径
+ * @param offset 起始偏移
+ * @param length 最大长度（超出文件末尾的部分被截掉）
+ * @return 只读 memoryview
+ */
+py::memoryview read_range(const std::string &file_path, uint64_t offset, size_t length)
+{
+    std::unique_ptr<ReadBuffer> buffer;
+    {
+        py::gil_scoped_release release;
+
+        // O_NONBLOCK：避免在 FIFO 上阻塞；对普通文件无影响
+        FdGuard fd(::open(file_path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK));
+        if (!fd.valid())
+            throw FsError(errno, file_path);
+        struct stat st;
+        if (::fstat(fd.get(), &st) != 0)
+            throw FsError(errno, file_path);
+        if (!S_ISREG(st.st_mode))
+            throw std::runtime_error("Path is not a regular file: " + file_path);
+
+        uint64_t file_size = static_cast<uint64_t>(st.st_size);
+        size_t available = offset >= file_size
+                               ? 0
+                               : static_cast<size_t>(std::min<uint64_t>(length, file_size - offset));
+
+        buffer = ReadBuffer::pooled(available);
+        ssize_t n = available > 0 ? pread_full(fd.get(), buffer->writable(), available, offset) : 0;
+        if (n < 0)
+            throw FsError(errno, file_path);
+        buffer->set_size(static_cast<size_t>(n));
+    }
+    return py::memoryview(py::cast(std::move(buffer)));
+}
+
+/**
+ * @brief 批量读取多个文件的开头（悬停预览）
+ *
+ * 所有文件的内容并行 pread 到同一块池化缓冲区，
+ * 返回的每个 memoryview 都是这块缓冲区的切片。
+ *
+ * @param paths 路径列表
+ * @param length 每个文件读取的字节数（默认 4096）
+ * @param num_threads 线程数，0 = CPU 核心数
+ * @return 与 paths 等长的列表，元素为 memoryview；无法读取或不是普通文件为 None
+ */
+py::list read_heads(const std::vector<std::string> &paths, size_t length = 4096, int num_threads = 0)
+{
+    const size_t count = paths.size();
+    std::vector<ssize_t> sizes(count, -1);
+    std::unique_ptr<ReadBuffer> slab = ReadBuffer::pooled(std::max<size_t>(count * length, 1));
+    {
+        py::gil_scoped_release release;
+
+        uint8_t *base = slab->writable();
+        parallel_for(count, num_threads, [&](size_t i, size_t)
+        {
+            FdGuard fd(::open(paths[i].c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK));
+            if (!fd.valid())
+                return;
+            struct stat st;
+            if (::fstat(fd.get(), &st) != 0 || !S_ISREG(st.st_mode))
+                return;
+            sizes[i] = pread_full(fd.get(), base + i * length, length, 0);
+        });
+        slab->set_size(count * length);
+    }
+
+    py::memoryview view(py::cast(std::move(slab)));
+    py::list result;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (sizes[i] < 0)
+        {
+            result.append(py::none());
+            continue;
+        }
+        ssize_t start = static_cast<ssize_t>(i * length);
+        result.append(view[py::slice(start, start + sizes[i], 1)]);
+    }
+    return result;
+}
+
+// ============================================================================
+// find：编译谓词查询
+// ============================================================================
+
+/**
+ * @struct FindPredicate
+ * @brief 查询谓词语法树节点
+ *
+ * 由 Python 字典编译而来（见 compile_find_predicate），
+ * 之后在工作线程中求值，不再接触 Python 对象。
+ */
+struct FindPredicate
+{
+    enum class Kind
+    {
+        True,
+        And,
+        Or,
+        Not,
+        Name,  // 文件名 glob
+        IName, // 文件名 glob（忽略大小写）
+        Path,  // 相对根目录路径的 glob
+        Regex, // 文件名正则（search 语义）
+        Ext,   // 扩展名集合（忽略大小写）
+        Size,
+        Mtime,
+        Type,
+        Depth // 深度，根目录的直接子项为 1（与 find 一致）
+    };
+
+    Kind kind = Kind::True;
+    std::vector<FindPredicate> children;
+    std::string pattern;
+    std::shared_ptr<const std::regex> regex;
+    std::vector<std::string> exts; // 小写，不含点
+    double lo = -std::numeric_limits<double>::infinity();
+    double hi = std::numeric_limits<double>::infinity();
+    bool lo_open = false, hi_open = false;
+    uint32_t type_mode = 0;
+
+    bool in_range(double value) const
+    {
+        return (lo_open ? value > lo : value >= lo) && (hi_open ? value < hi : value <= hi);
+    }
+
+    /** @brief 是否需要 lstat 结果（否则 d_type 即可求值） */
+    bool needs_stat() const
+    {
+        if (kind == Kind::Size || kind == Kind::Mtime)
+            return true;
+        for (const auto &child : children)
+        {
+            if (child.needs_stat())
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief 深度为 depth 的目录之下是否可能存在匹配项（保守估计）
+     *
+     * 仅依据深度约束剪枝：depth 为目录自身的深度，子孙条目的深度 > depth。
+     */
+    bool may_match_below(int depth) const
+    {
+        switch (kind)
+        {
+        case Kind::Depth:
+            return hi_open ? hi > depth + 1 : hi >= depth + 1;
+        case Kind::And:
+            for (const auto &child : children)
+            {
+                if (!child.may_match_below(depth))
+                    return false;
+            }
+            return true;
+        case Kind::Or:
+            for (const auto &child : children)
+            {
+                if (child.may_match_below(depth))
+                    return true;
+            }
+            return children.empty();
+        default:
+            return true;
+        }
+    }
+};
+
+/**
+ * @struct FindCandidate
+ * @brief 待求值的条目；lstat 结果按需获取
+ */
+struct FindCandidate
+{
+    const WalkEntry &entry;
+    const char *rel_path; // 相对根目录的路径
+    FileStat st;
+    bool has_stat;
+
+    const FileStat &stat()
+    {
+        if (!has_stat)
+        {
+            uint32_t mode = st.mode;
+            if (stat_path(entry.dirfd, entry.name, false, st) != 0)
+                st.mode = mode; // 条目已消失：保留 d_type，其余为 0
+            has_stat = true;
+        }
+        return st;
+    }
+};
+
+static bool eval_find_predicate(const FindPredicate &node, FindCandidate &c)
+{
+    using Kind = FindPredicate::Kind;
+    switch (node.kind)
+    {
+    case Kind::True:
+        return true;
+    case Kind::And:
+        for (const auto &child : node.children)
+        {
+            if (!eval_find_predicate(child, c))
+                return false;
+        }
+        return true;
+    case Kind::Or:
+        for (const auto &child : node.children)
+        {
+            if (eval_find_predicate(child, c))
+                return true;
+        }
+        return false;
+    case Kind::Not:
+        return !eval_find_predicate(node.children[0], c);
+    case Kind::Name:
+        return ::fnmatch(node.pattern.c_str(), c.entry.name, 0) == 0;
+    case Kind::IName:
+#ifdef FNM_CASEFOLD
+        return ::fnmatch(node.pattern.c_str(), c.entry.name, FNM_CASEFOLD) == 0;
+#else
+    {
+        std::string lowered(c.entry.name);
+        for (auto &ch : lowered)
+            ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        return ::fnmatch(node.pattern.c_str(), lowered.c_str(), 0) == 0;
+    }
+#endif
+    case Kind::Path:
+        return ::fnmatch(node.pattern.c_str(), c.rel_path, 0) == 0;
+    case Kind::Regex:
+        return std::regex_search(c.entry.name, *node.regex);
+    case Kind::Ext:
+    {
+        const char *dot = std::strrchr(c.entry.name, '.');
+        if (!dot || dot == c.entry.name || !S_ISREG(c.st.mode))
+            return false;
+        std::string ext(dot + 1);
+        for (auto &ch : ext)
+            ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        return std::find(node.exts.begin(), node.exts.end(), ext) != node.exts.end();
+    }
+    case Kind::Size:
+        return !S_ISDIR(c.st.mode) && node.in_range(static_cast<double>(c.stat().size));
+    case Kind::Mtime:
+        return node.in_range(static_cast<double>(c.stat().mtime_ns) / 1e9);
+    case Kind::Type:
+        return (c.st.mode & S_IFMT) == node.type_mode;
+    case Kind::Depth:
+        return node.in_range(static_cast<double>(c.entry.depth + 1));
+    }
+    return false;
+}
+
+/**
+ * @brief 解析范围条件：数字表示相等，字典支持 gt / gte / lt / lte（min / max 为闭区间别名）
+ */
+static void parse_find_range(const py::handle &value, FindPredicate &node, const char *key)
+{
+    if (py::isinstance<py::dict>(value))
+    {
+        for (auto item : py::reinterpret_borrow<py::dict>(value))
+        {
+            std::string op = item.first.cast<std::string>();
+            double bound = item.second.cast<double>();
+            if (op == "gt")
+                node.lo = bound, node.lo_open = true;
+            else if (op == "gte" || op == "min")
+                node.lo = bound, node.lo_open = false;
+            else if (op == "lt")
+                node.hi = bound, node.hi_open = true;
+            else if (op == "lte" || op == "max")
+                node.hi = bound, node.hi_open = false;
+            else
+                throw std::invalid_argument(std::string("Unknown range operator for '") + key + "': " + op);
+        }
+        return;
+    }
+    double exact = value.cast<double>();
+    node.lo = node.hi = exact;
+}
+
+static uint32_t parse_find_type(const std::string &name)
+{
+    static const std::pair<const char *, uint32_t> types[] = {
+        {"file", S_IFREG}, {"directory", S_IFDIR}, {"symlink", S_IFLNK}, {"block", S_IFBLK},
+        {"char", S_IFCHR}, {"fifo", S_IFIFO}, {"socket", S_IFSOCK}};
+    for (const auto &type : types)
+    {
+        if (name == type.first)
+            return type.second;
+    }
+    throw std::invalid_argument("Unknown file type: " + name);
+}
+
+/**
+ * @brief 将 Python 查询字典编译为谓词树
+ *
+ * 支持的键（同一字典中的多个键为 AND 关系）：
+ * - and / or: 子查询列表；not: 子查询
+ * - name / iname / path: glob；regex: 文件名正则
+ * - ext: 扩展名或扩展名列表
+ * - size / mtime / depth: 数字或 {gt, gte, lt, lte}
+ * - type: file / directory / symlink / block / char / fifo / socket
+ */
+static FindPredicate compile_find_predicate(const py::handle &query)
+{
+    using Kind = FindPredicate::Kind;
+    if (query.is_none())
+        return FindPredicate();
+    if (!py::isinstance<py::dict>(query))
+        throw std::invalid_argument("find query must be a dict");
+
+    std::vector<FindPredicate> terms;
+    for (auto item : py::reinterpret_borrow<py::dict>(query))
+    {
+        std::string key = item.first.cast<std::string>();
+        py::handle value = item.second;
+        FindPredicate node;
+
+        if (key == "and" || key == "or")
+        {
+            node.kind = key == "and" ? Kind::And : Kind::Or;
+            for (auto child : value)
+                node.children.push_back(compile_find_predicate(child));
+        }
+        else if (key == "not")
+        {
+            node.kind = Kind::Not;
+            node.children.push_back(compile_find_predicate(value));
+        }
+        else if (key == "name" || key == "iname" || key == "path")
+        {
+            node.kind = key == "name" ? Kind::Name : (key == "iname" ? Kind::IName : Kind::Path);
+            node.pattern = value.cast<std::string>();
+#ifndef FNM_CASEFOLD
+            if (node.kind == Kind::IName)
+            {
+                for (auto &ch : node.pattern)
+                    ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+            }
+#endif
+        }
+        else if (key == "regex")
+        {
+            node.kind = Kind::Regex;
+            try
+            {
+                node.regex = std::make_shared<const std::regex>(
+                    value.cast<std::string>(), std::regex::ECMAScript | std::regex::optimize);
+            }
+            catch (const std::regex_error &e)
+            {
+                throw std::invalid_argument(std::string("Invalid regex: ") + e.what());
+            }
+        }
+        else if (key == "ext")
+        {
+            node.kind = Kind::Ext;
+            std::vector<std::string> exts;
+            if (py::isinstance<py::str>(value))
+                exts.push_back(value.cast<std::string>());
+            else
+                exts = value.cast<std::vector<std::string>>();
+            for (auto ext : exts)
+            {
+                if (!ext.empty() && ext[0] == '.')
+                    ext.erase(0, 1);
+                for (auto &ch : ext)
+                    ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+                node.exts.push_back(ext);
+            }
+        }
+        else if (key == "size" || key == "mtime" || key == "depth")
+        {
+            node.kind = key == "size" ? Kind::Size : (key == "mtime" ? Kind::Mtime : Kind::Depth);
+            parse_find_range(value, node, key.c_str());
+        }
+        else if (key == "type")
+        {
+            node.kind = Kind::Type;
+            node.type_mode = parse_find_type(value.cast<std::string>());
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown find predicate: " + key);
+        }
+        terms.push_back(std::move(node));
+    }
+
+    if (terms.size() == 1)
+        return std::move(terms[0]);
+    FindPredicate all;
+    all.kind = Kind::And;
+    all.children = std::move(terms);
+    return all;
+}
+
+/**
+ * @brief 并行遍历并收集谓词匹配的条目（按路径排序），find 与 find_arrow 共用
+ *
+ * 在持有 GIL 时调用：先校验根目录，遍历期间释放 GIL。
+ *
+ * @param prune_predicate 剪枝谓词（nullptr 表示不剪枝）
+ * @param exclusions 禁止访问的路径 / 名称：在求值前剪枝，不计入 limit
+ * @return 是否因 limit 提前结束
+ */
+static bool find_entries(const std::string &root_path, const FindPredicate &predicate,
+                         const FindPredicate *prune_predicate, const WalkExclusions &exclusions,
+                         bool include_hidden, size_t limit, int num_threads, MountFilter &mounts,
+                         IoPriority io_priority, RateLimiter *limiter, std::vector<FileInfo> &all,
+                         std::vector<std::string> &errors)
+{
+    FileStat root_stat;
+    int err = stat_path(AT_FDCWD, root_path.c_str(), true, root_stat);
+    if (err != 0)
+        throw FsError(err, root_path);
+    if (!S_ISDIR(root_stat.mode))
+        throw std::runtime_error("Path is not a directory: " + root_path);
+
+    const size_t workers = static_cast<size_t>(resolve_thread_count(num_threads));
+    std::vector<std::vector<FileInfo>> per_worker(workers);
+    std::atomic<size_t> matched{0};
+    std::atomic<bool> stop{false};
+
+    py::gil_scoped_release release;
+    IoPriorityScope priority_scope(io_priority);
+    RateLimitScope limit_scope(limiter);
+
+    WalkOptions options;
+    options.include_hidden = include_hidden;
+    options.num_threads = num_threads;
+    options.stat_entries = false;
+    if (mounts.active())
+        options.mounts = &mounts;
+
+    const size_t prefix_len = root_path.size() + (root_path.back() == '/' ? 0 : 1);
+
+    auto visit = [&](const WalkEntry &entry, size_t worker_id) -> bool
+    {
+        if (exclusions.excluded(entry))
+            return false;
+        FindCandidate candidate{entry, entry.path.c_str() + prefix_len, entry.st, false};
+        if (eval_find_predicate(predicate, candidate))
+        {
+            if (limit > 0 && matched.fetch_add(1) >= limit)
+            {
+                stop.store(true);
+                return false;
+            }
+            per_worker[worker_id].push_back(make_file_info(entry, candidate.stat()));
+        }
+
+        if (!S_ISDIR(entry.st.mode))
+            return true;
+        if (prune_predicate && eval_find_predicate(*prune_predicate, candidate))
+            return false;
+        return predicate.may_match_below(entry.depth + 1);
+    };
+
+    parallel_walk(root_path, options, visit, errors, &stop);
+
+    for (auto &part : per_worker)
+    {
+        all.insert(all.end(), std::make_move_iterator(part.begin()),
+                   std::make_move_iterator(part.end()));
+    }
+    std::sort(all.begin(), all.end(), [](const FileInfo &a, const FileInfo &b)
+              { return a.path < b.path; });
+    return stop.load();
+}
+
+/**
+ * @brief 按谓词查询目录树（类似 find(1)）
+ *
+ * 查询在遍历线程中求值，不匹配的条目不会被构造；
+ * 只有用到 size / mtime 的查询才会对每个条目 lstat（否则依赖 d_type）。
+ * 目录剪枝：
+ * - prune 谓词匹配的目录不再进入（如 {"name": "node_modules"}）
+ * - 查询的深度约束不可能在更深层满足时停止下探
+ *
+ * @param root_path 根目录
+ * @param query 查询字典（None 匹配所有条目）
+ * @param prune 剪枝谓词（None 表示不剪枝）
+ * @param include_hidden 是否包含隐藏条目
+ * @param limit 最多返回的条目数（0 = 不限制）
+ * @param num_threads 线程数（0 = CPU 核心数）
+ * @param one_file_system 不进入其他文件系统（挂载点）
+ * @param skip_fs_types 不进入这些类型的文件系统
+ * @param priority 优先级："interactive"（默认）或 "background"
+ * @param limiter 可选的 RateLimiter（字节 / IOPS 限速）
+ * @param exclude_paths 不进入的绝对路径（自身及其下所有条目），不计入 limit
+ * @param exclude_names 不进入 / 不匹配的文件名（任意层级）
+ * @return 字典：entries（FileInfo 字典列表，按路径排序）、truncated、errors、skipped_mounts
+ */
+py::dict find(const std::string &root_path, const py::object &query, const py::object &prune,
+              bool include_hidden = false, size_t limit = 0, int num_threads = 0,
+              bool one_file_system = false, const std::vector<std::string> &skip_fs_types = {},
+              const std::string &priority = "interactive",
+              std::shared_ptr<RateLimiter> limiter = nullptr,
+              const std::vector<std::string> &exclude_paths = {},
+              const std::vector<std::string> &exclude_names = {})
+{
+    const IoPriority io_priority = parse_io_priority(priority);
+    FindPredicate predicate = compile_find_predicate(query);
+    FindPredicate prune_predicate = compile_find_predicate(prune);
+    MountFilter mounts(root_path, one_file_system, skip_fs_types);
+
+    std::vector<FileInfo> all;
+    std::vector<std::string> errors;
+    const WalkExclusions exclusions(exclude_paths, exclude_names);
+    const bool truncated = find_entries(root_path, predicate, prune.is_none() ? nullptr : &prune_predicate,
+                                        exclusions, include_hidden, limit, num_threads, mounts,
+                                        io_priority, limiter.get(), all, errors);
+
+    py::list entries;
+    for (const auto &info : all)
+        entries.append(info.to_dict());
+
+    py::dict result;
+    result["entries"] = entries;
+    result["truncated"] = truncated;
+    result["errors"] = errors;
+    result["skipped_mounts"] = skipped_mounts_to_list(mounts);
+    return result;
+}
+
+// ============================================================================
+// Top-N 文件
+// ============================================================================
+
+/**
+ * @brief 找出目录树中最大 / 最近修改的 n 个普通文件
+ *
+ * 每个工作线程维护容量为 n 的小顶堆，只有胜过堆顶的条目才会构造 FileInfo，
+ * 遍历结束后合并各线程的堆。内存占用为 O(n × 线程数)，与目录树规模无关。
+ *
+ * @param root_path 根目录
+ * @param n 返回的条目数
+ * @param key 排序依据："size" 或 "mtime"
+ * @param include_hidden 是否包含隐藏条目
+ * @param num_threads 线程数（0 = CPU 核心数）
+ * @param priority 优先级："interactive"（默认）或 "background"
+ * @param limiter 可选的 RateLimiter（字节 / IOPS 限速）
+ * @param exclude_paths 不进入的绝对路径（自身及其下所有条目），在排名之前剪枝
+ * @param exclude_names 不进入 / 不计入的文件名（任意层级）
+ * @return FileInfo 字典列表，按 key 降序
+ */
+py::list top_files(const std::string &root_path, size_t n, const std::string &key = "size",
+                   bool include_hidden = false, int num_threads = 0,
+                   const std::string &priority = "interactive",
+                   std::shared_ptr<RateLimiter> limiter = nullptr,
+                   const std::vector<std::string> &exclude_paths = {},
+                   const std::vector<std::string> &exclude_names = {})
+{
+    const IoPriority io_priority = parse_io_priority(priority);
+    bool by_size;
+    if (key == "size")
+        by_size = true;
+    else if (key == "mtime")
+        by_size = false;
+    else
+        throw std::invalid_argument("key must be 'size' or 'mtime'");
+
+    FileStat root_stat;
+    int err = stat_path(AT_FDCWD, root_path.c_str(), true, root_stat);
+    if (err != 0)
+        throw FsError(err, root_path);
+    if (!S_ISDIR(root_stat.mode))
+        throw std::runtime_error("Path is not a directory: " + root_path);
+
+    struct Ranked
+    {
+        int64_t rank;
+        FileInfo info;
+    };
+    // 小顶堆：堆顶是当前保留的最小值；同值时路径较大者先被淘汰，保证结果稳定
+    auto worse = [](const Ranked &a, const Ranked &b)
+    { return a.rank != b.rank ? a.rank > b.rank : a.info.path < b.info.path; };
+    using Heap = std::priority_queue<Ranked, std::vector<Ranked>, decltype(worse)>;
+
+    const size_t workers = static_cast<size_t>(resolve_thread_count(num_threads));
+    std::vector<Heap> heaps;
+    heaps.reserve(workers);
+    for (size_t w = 0; w < workers; ++w)
+        heaps.emplace_back(worse);
+    std::vector<std::string> errors;
+
+    if (n > 0)
+    {
+        py::gil_scoped_release release;
+        IoPriorityScope priority_scope(io_priority);
+        RateLimitScope limit_scope(limiter.get());
+
+        WalkOptions options;
+        options.include_hidden = include_hidden;
+        options.num_threads = num_threads;
+        const WalkExclusions exclusions(exclude_paths, exclude_names);
+
+        auto visit = [&](const WalkEntry &entry, size_t worker_id) -> bool
+        {
+            if (exclusions.excluded(entry))
+                return false;
+            if (!S_ISREG(entry.st.mode))
+                return true;
+            int64_t rank = by_size ? static_cast<int64_t>(entry.st.size) : entry.st.mtime_ns;
+            Heap &heap = heaps[worker_id];
+            if (heap.size() >= n)
+            {
+                const Ranked &top = heap.top();
+                if (rank < top.rank || (rank == top.rank && entry.path > top.info.path))
+                    return true;
+                heap.pop();
+            }
+            heap.push(Ranked{rank, make_file_info(entry, entry.st)});
+            return true;
+        };
+
+        parallel_walk(root_path, options, visit, errors);
+    }
+
+    // 合并：各线程的堆倒入同一个向量，取前 n
+    std::vector<Ranked> merged;
+    for (auto &heap : heaps)
+    {
+        while (!heap.empty())
+        {
+            merged.push_back(std::move(const_cast<Ranked &>(heap.top())));
+            heap.pop();
+        }
+    }
+    std::sort(merged.begin(), merged.end(), [&worse](const Ranked &a, const Ranked &b)
+              { return worse(a, b); });
+    if (merged.size() > n)
+        merged.resize(n);
+
+    py::list result;
+    for (const auto &item : merged)
+        result.append(item.info.to_dict());
+    return result;
+}
+
+// ============================================================================
+// 三元组文件名索引
+// ============================================================================
+
+static inline uint32_t trigram_key(unsigned char a, unsigned char b, unsigned char c)
+{
+    return (static_cast<uint32_t>(a) << 16) | (static_cast<uint32_t>(b) << 8) | c;
+}
+
+/** @brief 收集字符串（折叠 ASCII 大小写后）的三元组，排序去重后追加到 out */
+static void collect_trigrams(std::string_view text, std::vector<uint32_t> &out)
+{
+    size_t first = out.size();
+    for (size_t i = 0; i + 3 <= text.size(); ++i)
+    {
+        out.push_back(trigram_key(fold_ascii(static_cast<unsigned char>(text[i])),
+                                  fold_ascii(static_cast<unsigned char>(text[i + 1])),
+                                  fold_ascii(static_cast<unsigned char>(text[i + 2]))));
+    }
+    std::sort(out.begin() + static_cast<std::ptrdiff_t>(first), out.end());
+    out.erase(std::unique(out.begin() + static_cast<std::ptrdiff_t>(first), out.end()), out.end());
+}
+
+/** @brief 折叠 ASCII 大小写的子串查找 */
+static bool contains_folded(std::string_view haystack, std::string_view folded_needle)
+{
+    if (folded_needle.size() > haystack.size())
+        return false;
+    for (size_t i = 0; i + folded_needle.size() <= haystack.size(); ++i)
+    {
+        size_t j = 0;
+        while (j < folded_needle.size() &&
+               fold_ascii(static_cast<unsigned char>(haystack[i + j])) ==
+                   static_cast<unsigned char>(folded_needle[j]))
+            ++j;
+        if (j == folded_needle.size())
+            return true;
+    }
+    return false;
+}
+
+static inline void append_varint(std::string &out, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static inline const uint8_t *read_varint(const uint8_t *p, uint32_t &value)
+{
+    uint32_t result = 0;
+    int shift = 0;
+    while (*p & 0x80)
+    {
+        result |= static_cast<uint32_t>(*p++ & 0x7F) << shift;
+        shift += 7;
+    }
+    value = result | (static_cast<uint32_t>(*p++) << shift);
+    return p;
+}
+
+// ---- 模糊路径匹配评分 ----
+
+/**
+ * @brief 字符类别位掩码：字母（折叠大小写）、数字、常见分隔符各占一位，其余字节散列到剩余位
+ *
+ * 路径的掩码是所有字符位的并集；查询掩码不是其子集的路径不可能包含该子序列。
+ */
+static inline uint64_t fuzzy_char_bit(unsigned char c)
+{
+    c = fold_ascii(c);
+    if (c >= 'a' && c <= 'z')
+        return 1ULL << (c - 'a');
+    if (c >= '0' && c <= '9')
+        return 1ULL << (26 + c - '0');
+    switch (c)
+    {
+    case '.': return 1ULL << 36;
+    case '_': return 1ULL << 37;
+    case '-': return 1ULL << 38;
+    case ' ': return 1ULL << 39;
+    case '/': return 1ULL << 40;
+    default: return 1ULL << (41 + c % 23);
+    }
+}
+
+static uint64_t fuzzy_mask(std::string_view text)
+{
+    uint64_t mask = 0;
+    for (unsigned char c : text)
+        mask |= fuzzy_char_bit(c);
+    return mask;
+}
+
+/**
+ * @class FuzzyScorer
+ * @brief 子序列匹配评分（与 fzf v1 相同的思路）
+ *
+ * 1. 正向贪心找到最早能完成匹配的结束位置
+ * 2. 从结束位置反向贪心，收紧到最晚的起始位置
+ * 3. 在收紧后的窗口内正向评分：每个匹配字符得分，单词 / 路径段边界、
+ *    驼峰、连续匹配有加分，间隔扣分；落在文件名（最后一段）中的匹配额外加分
+ *
+ * 查询中含大写字母时区分大小写（smart case）。
+ */
+class FuzzyScorer
+{
+public:
+    explicit FuzzyScorer(const std::string &query) : query_(query)
+    {
+        case_sensitive_ = std::any_of(query.begin(), query.end(), [](char c)
+                                      { return c >= 'A' && c <= 'Z'; });
+        mask_ = fuzzy_mask(query);
+    }
+
+    uint64_t mask() const { return mask_; }
+
+    size_t length() const { return query_.size(); }
+
+    /**
+     * @brief 从文本末尾反向匹配查询的前 remaining 个字符，返回仍未匹配的数量
+     *
+     * 子序列是否存在与方向无关：按路径段从叶到根依次调用即可判定，无需拼接完整路径。
+     */
+    size_t match_backward(std::string_view text, size_t remaining) const
+    {
+        for (size_t i = text.size(); i-- > 0 && remaining > 0;)
+        {
+            if (eq(text[i], query_[remaining - 1]))
+                --remaining;
+        }
+        return remaining;
+    }
+
+    /**
+     * @brief 评分；不匹配返回 INT_MIN。positions 非空时写入匹配字节位置
+     */
+    int score(std::string_view text, std::vector<uint32_t> *positions = nullptr) const
+    {
+        const size_t m = query_.size();
+        if (m == 0 || m > text.size())
+            return m == 0 ? 0 : INT_MIN;
+
+        size_t qi = 0, end = 0;
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            if (eq(text[i], query_[qi]) && ++qi == m)
+            {
+                end = i;
+                break;
+            }
+        }
+        if (qi < m)
+            return INT_MIN;
+
+        size_t start = end;
+        for (size_t i = end + 1, k = m; i-- > 0;)
+        {
+            if (eq(text[i], query_[k - 1]) && --k == 0)
+            {
+                start = i;
+                break;
+            }
+        }
+
+        const size_t last_slash = text.rfind('/');
+        const size_t basename_start = last_slash == std::string_view::npos ? 0 : last_slash + 1;
+
+        int total = 0, consecutive = 0, first_bonus = 0;
+        bool in_gap = false;
+        CharClass prev = start > 0 ? classify(text[start - 1]) : CharClass::Delimiter;
+        qi = 0;
+        for (size_t i = start; i <= end; ++i)
+        {
+            CharClass cls = classify(text[i]);
+            if (qi < m && eq(text[i], query_[qi]))
+            {
+                int bonus = boundary_bonus(prev, cls);
+                if (consecutive == 0)
+                {
+                    first_bonus = bonus;
+                }
+                else
+                {
+                    if (bonus >= kBonusBoundary)
+                        first_bonus = bonus;
+                    bonus = std::max({bonus, first_bonus, kBonusConsecutive});
+                }
+                total += kScoreMatch + (qi == 0 ? bonus * kFirstCharMultiplier : bonus);
+                if (i >= basename_start)
+                    total += kBonusBasename;
+                if (positions)
+                    positions->push_back(static_cast<uint32_t>(i));
+                ++qi;
+                ++consecutive;
+                in_gap = false;
+            }
+            else
+            {
+                total += in_gap ? kGapExtension : kGapStart;
+                in_gap = true;
+                consecutive = 0;
+                first_bonus = 0;
+            }
+            prev = cls;
+        }
+        return total;
+    }
+
+private:
+    enum class CharClass
+    {
+        Delimiter, // '/'
+        NonWord,
+        Lower,
+        Upper,
+        Digit
+    };
+
+    static const int kScoreMatch = 16;
+    static const int kGapStart = -3;
+    static const int kGapExtension = -1;
+    static const int kBonusBoundary = 8;
+    static const int kBonusDelimiter = 9;
+    static const int kBonusCamel = 7;
+    static const int kBonusConsecutive = 4;
+    static const int kBonusBasename = 2;
+    static const int kFirstCharMultiplier = 2;
+
+    bool eq(char a, char b) const
+    {
+        return case_sensitive_ ? a == b
+                               : fold_ascii(static_cast<unsigned char>(a)) == static_cast<unsigned char>(b);
+    }
+
+    static CharClass classify(char c)
+    {
+        if (c >= 'a' && c <= 'z')
+            return CharClass::Lower;
+        if (c >= 'A' && c <= 'Z')
+            return CharClass::Upper;
+        if (c >= '0' && c <= '9')
+            return CharClass::Digit;
+        if (c == '/')
+            return CharClass::Delimiter;
+        if (c == '_' || c == '-' || c == '.' || c == ' ')
+            return CharClass::NonWord;
+        return static_cast<unsigned char>(c) >= 0x80 ? CharClass::Lower : CharClass::NonWord;
+    }
+
+    static int boundary_bonus(CharClass prev, CharClass cls)
+    {
+        if (cls == CharClass::Delimiter || cls == CharClass::NonWord)
+            return kBonusBoundary;
+        if (prev == CharClass::Delimiter)
+            return kBonusDelimiter;
+        if (prev == CharClass::NonWord)
+            return kBonusBoundary;
+        if ((prev == CharClass::Lower && cls == CharClass::Upper) ||
+            (prev != CharClass::Digit && cls == CharClass::Digit))
+            return kBonusCamel;
+        return 0;
+    }
+
+    std::string query_; // 不含大写 ASCII 时即为折叠形式
+    bool case_sensitive_ = false;
+    uint64_t mask_ = 0;
+};
+
+/**
+ * @class FilenameIndex
+ * @brief 基于三元组倒排的文件名索引（子串 / glob 查询）
+ *
+ * 结构：
+ * - 条目表：每个条目只存 (父条目 id, 文件名, 是否目录)，完整路径沿父链拼出，
+ *   500 万条目的索引不需要存 500 万个完整路径
+ * - 倒排表：文件名（折叠 ASCII 大小写）的每个三元组 -> 条目 id 列表，
+ *   id 升序、差分后 varint 编码
+ *
+ * 分层：
+ * - 基础层：build 生成或从索引文件 mmap 加载，只读
+ * - 增量层：add 追加的条目与其倒排（内存中），remove 以墓碑标记
+ * save 时合并两层、去掉墓碑并重新编号，写出的文件可直接 mmap 使用。
+ * build 时的 include_hidden 随索引保存，add 按同样的规则跳过隐藏条目。
+ *
+ * 查询：取查询串的三元组，从最短的倒排开始求交集，再对候选逐个验证。
+ * 少于 3 个字节的查询退化为线性扫描文件名。
+ *
+ * 并发：查询持有共享锁，add / remove 持有独占锁。
+ */
+class FilenameIndex
+{
+public:
+    static constexpr uint32_t kNoParent = UINT32_MAX;
+
+    struct TrigramSlot
+    {
+        uint32_t trigram;
+        uint32_t count;
+        uint64_t offset; // 在倒排数据中的偏移
+    };
+
+    FilenameIndex(const FilenameIndex &) = delete;
+    FilenameIndex &operator=(const FilenameIndex &) = delete;
+
+    ~FilenameIndex()
+    {
+        if (map_base_ != MAP_FAILED)
+            ::munmap(map_base_, map_len_);
+    }
+
+    /**
+     * @brief 并行遍历目录树构建索引（调用方已释放 GIL）
+     */
+    static std::unique_ptr<FilenameIndex> build(const std::string &root_path, bool include_hidden,
+                                                int num_threads, bool one_file_system = false,
+                                                const std::vector<std::string> &skip_fs_types = {})
+    {
+        std::string root = root_path;
+        while (root.size() > 1 && root.back() == '/')
+            root.pop_back();
+
+        FileStat root_stat;
+        int err = stat_path(AT_FDCWD, root.c_str(), true, root_stat);
+        if (err != 0)
+            throw FsError(err, root);
+        if (!S_ISDIR(root_stat.mode))
+            throw std::runtime_error("Path is not a directory: " + root);
+
+        struct Found
+        {
+            std::string path;
+            bool is_dir;
+        };
+        const size_t workers = static_cast<size_t>(resolve_thread_count(num_threads));
+        std::vector<std::vector<Found>> per_worker(workers);
+        std::vector<std::string> errors;
+
+        MountFilter mounts(root, one_file_system, skip_fs_types);
+        WalkOptions options;
+        options.include_hidden = include_hidden;
+        options.stat_entries = false;
+        options.num_threads = num_threads;
+        if (mounts.active())
+            options.mounts = &mounts;
+        parallel_walk(root, options, [&](const WalkEntry &entry, size_t worker_id)
+        {
+            per_worker[worker_id].push_back({entry.path, S_ISDIR(entry.st.mode)});
+            return true;
+        }, errors);
+
+        std::vector<Found> all;
+        for (auto &part : per_worker)
+        {
+            all.insert(all.end(), std::make_move_iterator(part.begin()),
+                       std::make_move_iterator(part.end()));
+            part.clear();
+            part.shrink_to_fit();
+        }
+        // 字典序保证父目录排在子条目之前（前缀先于其扩展）
+        std::sort(all.begin(), all.end(), [](const Found &a, const Found &b)
+                  { return a.path < b.path; });
+
+        std::unique_ptr<FilenameIndex> index(new FilenameIndex());
+        index->root_ = root;
+        index->include_hidden_ = include_hidden;
+        const size_t prefix = root == "/" ? 1 : root.size() + 1;
+
+        std::unordered_map<std::string_view, uint32_t> dir_ids;
+        index->own_parents_.reserve(all.size());
+        index->own_dirs_.reserve(all.size());
+        index->own_name_offsets_.reserve(all.size() + 1);
+        for (size_t id = 0; id < all.size(); ++id)
+        {
+            std::string_view rel(all[id].path);
+            rel.remove_prefix(prefix);
+            size_t slash = rel.find_last_of('/');
+            uint32_t parent = kNoParent;
+            if (slash != std::string_view::npos)
+            {
+                auto it = dir_ids.find(rel.substr(0, slash));
+                parent = it != dir_ids.end() ? it->second : kNoParent;
+            }
+            if (all[id].is_dir)
+                dir_ids.emplace(rel, static_cast<uint32_t>(id));
+
+            std::string_view name = slash == std::string_view::npos ? rel : rel.substr(slash + 1);
+            index->own_parents_.push_back(parent);
+            index->own_dirs_.push_back(all[id].is_dir ? 1 : 0);
+            index->own_name_offsets_.push_back(static_cast<uint32_t>(index->own_names_.size()));
+            index->own_names_.append(name);
+        }
+        index->own_name_offsets_.push_back(static_cast<uint32_t>(index->own_names_.size()));
+
+        index->encode_postings(all.size(), [&index](uint32_t id)
+                               { return index->own_name(id); },
+                               index->own_slots_, index->own_postings_);
+        index->attach_owned();
+        return index;
+    }
+
+    /**
+     * @brief mmap 加载索引文件
+     *
+     * 文件格式（本机字节序，各段 8 字节对齐）：
+     * header | root | parents u32[n] | name_offsets u32[n+1] | dirs u8[n] | names |
+     * slots TrigramSlot[m] | postings
+     *
+     * 截断或损坏的文件抛出 RuntimeError（调用方据此重建），不会带着越界偏移进入查询。
+     */
+    static std::unique_ptr<FilenameIndex> load(const std::string &index_path)
+    {
+        FdGuard fd(::open(index_path.c_str(), O_RDONLY | O_CLOEXEC));
+        if (!fd.valid())
+            throw FsError(errno, index_path);
+        struct stat st;
+        if (::fstat(fd.get(), &st) != 0)
+            throw FsError(errno, index_path);
+        size_t len = static_cast<size_t>(st.st_size);
+        if (len < sizeof(FileHeader))
+            throw std::runtime_error("Invalid filename index: " + index_path);
+
+        void *base = ::mmap(nullptr, len, PROT_READ, MAP_SHARED, fd.get(), 0);
+        if (base == MAP_FAILED)
+            throw FsError(errno, index_path);
+        std::unique_ptr<FilenameIndex> index(new FilenameIndex());
+        index->map_base_ = base;
+        index->map_len_ = len;
+
+        const uint8_t *data = static_cast<const uint8_t *>(base);
+        FileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, "FFTRIDX2", 8) != 0)
+            throw std::runtime_error("Invalid filename index: " + index_path);
+
+        // 各段长度来自文件本身：先与文件大小比较再相乘，避免溢出后越界
+        const uint64_t n = header.entry_count;
+        if (n >= kNoParent || n > len || header.root_bytes == 0 || header.root_bytes > len ||
+            header.names_bytes > len ||
+            header.names_bytes > UINT32_MAX || header.slot_count > len / sizeof(TrigramSlot) ||
+            header.postings_bytes > len)
+            throw std::runtime_error("Corrupted filename index: " + index_path);
+
+        size_t pos = sizeof(FileHeader);
+        auto take = [&](size_t bytes) -> const uint8_t *
+        {
+            if (bytes > len - pos)
+                throw std::runtime_error("Truncated filename index: " + index_path);
+            const uint8_t *p = data + pos;
+            pos = std::min(align8(pos + bytes), len);
+            return p;
+        };
+
+        index->root_.assign(reinterpret_cast<const char *>(take(header.root_bytes)), header.root_bytes);
+        index->include_hidden_ = (header.flags & kFlagIncludeHidden) != 0;
+        index->parents_ = reinterpret_cast<const uint32_t *>(take(n * sizeof(uint32_t)));
+        index->name_offsets_ = reinterpret_cast<const uint32_t *>(take((n + 1) * sizeof(uint32_t)));
+        index->dirs_ = take(n);
+        index->names_ = reinterpret_cast<const char *>(take(header.names_bytes));
+        index->slots_ = reinterpret_cast<const TrigramSlot *>(take(header.slot_count * sizeof(TrigramSlot)));
+        index->postings_ = take(header.postings_bytes);
+        index->postings_bytes_ = header.postings_bytes;
+        index->base_count_ = n;
+        index->slot_count_ = header.slot_count;
+        if (!index->validate_base(header.names_bytes))
+            throw std::runtime_error("Corrupted filename index: " + index_path);
+        index->removed_.assign(n, 0);
+        ::madvise(base, len, MADV_RANDOM);
+        return index;
+    }
+
+    /**
+     * @brief 合并增量层并写出索引文件（atomic_write_file）
+     */
+    void save(const std::string &index_path) const
+    {
+        // 更新线程的阈值保存与退出时的保存可能同时发生：串行化，后写者覆盖先写者
+        std::lock_guard<std::mutex> save_lock(save_mutex_);
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+
+        // 去掉墓碑并重新编号（父条目 id 总是小于子条目，顺序扫描即可映射）
+        const size_t total = entry_count();
+        std::vector<uint32_t> remap(total, kNoParent);
+        std::vector<uint32_t> live;
+        live.reserve(total - removed_count_);
+        for (uint32_t id = 0; id < total; ++id)
+        {
+            if (removed_[id])
+                continue;
+            remap[id] = static_cast<uint32_t>(live.size());
+            live.push_back(id);
+        }
+
+        std::vector<uint32_t> parents, offsets;
+        std::vector<uint8_t> dirs;
+        std::string names;
+        parents.reserve(live.size());
+        offsets.reserve(live.size() + 1);
+        dirs.reserve(live.size());
+        for (uint32_t id : live)
+        {
+            uint32_t parent = parent_of(id);
+            parents.push_back(parent == kNoParent ? kNoParent : remap[parent]);
+            dirs.push_back(is_dir(id) ? 1 : 0);
+            offsets.push_back(static_cast<uint32_t>(names.size()));
+            names.append(name_of(id));
+        }
+        offsets.push_back(static_cast<uint32_t>(names.size()));
+
+        std::vector<TrigramSlot> slots;
+        std::string postings;
+        encode_postings(live.size(), [&](uint32_t id)
+                        { return std::string_view(names).substr(offsets[id], offsets[id + 1] - offsets[id]); },
+                        slots, postings);
+
+        FileHeader header{};
+        std::memcpy(header.magic, "FFTRIDX2", 8);
+        header.flags = include_hidden_ ? kFlagIncludeHidden : 0;
+        header.entry_count = live.size();
+        header.root_bytes = root_.size();
+        header.names_bytes = names.size();
+        header.slot_count = slots.size();
+        header.postings_bytes = postings.size();
+
+        std::string out;
+        auto put = [&out](const void *data, size_t bytes)
+        {
+            out.append(static_cast<const char *>(data), bytes);
+            out.resize(align8(out.size()), '\0');
+        };
+        put(&header, sizeof(header));
+        put(root_.data(), root_.size());
+        put(parents.data(), parents.size() * sizeof(uint32_t));
+        put(offsets.data(), offsets.size() * sizeof(uint32_t));
+        put(dirs.data(), dirs.size());
+        put(names.data(), names.size());
+        put(slots.data(), slots.size() * sizeof(TrigramSlot));
+        put(postings.data(), postings.size());
+
+        atomic_write_file(index_path, out, 0600);
+    }
+
+    /**
+     * @brief 子串查询：文件名包含 query 的条目
+     *
+     * under 非空时只返回该目录下的条目（在计入 limit 之前过滤）
+     */
+    std::vector<std::string> search(const std::string &query, size_t limit, bool ignore_case,
+                                    const std::string &under = "") const
+    {
+        std::string folded(query);
+        for (auto &ch : folded)
+            ch = static_cast<char>(fold_ascii(static_cast<unsigned char>(ch)));
+
+        auto verify = [&](std::string_view name)
+        {
+            return ignore_case ? contains_folded(name, folded)
+                               : name.find(query) != std::string_view::npos;
+        };
+        std::vector<uint32_t> trigrams;
+        collect_trigrams(query, trigrams);
+        return run_query(trigrams, limit, under, verify);
+    }
+
+    /**
+     * @brief glob 查询：用模式中的字面量片段筛选候选，再以 fnmatch 验证（under 同 search）
+     */
+    std::vector<std::string> glob(const std::string &pattern, size_t limit, bool ignore_case,
+                                  const std::string &under = "") const
+    {
+        std::vector<uint32_t> trigrams;
+        std::string literal;
+        auto flush = [&]()
+        {
+            collect_trigrams(literal, trigrams);
+            literal.clear();
+        };
+        for (size_t i = 0; i < pattern.size(); ++i)
+        {
+            char ch = pattern[i];
+            if (ch == '*' || ch == '?')
+            {
+                flush();
+            }
+            else if (ch == '[')
+            {
+                flush();
+                size_t close = pattern.find(']', i + 2);
+                if (close == std::string::npos)
+                    break; // 非法字符类：不再提取字面量，交由 fnmatch 验证
+                i = close;
+            }
+            else if (ch == '\\' && i + 1 < pattern.size())
+            {
+                literal.push_back(pattern[++i]);
+            }
+            else
+            {
+                literal.push_back(ch);
+            }
+        }
+        flush();
+        std::sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+        std::string name_buffer;
+        int flags = 0;
+#ifdef FNM_CASEFOLD
+        if (ignore_case)
+            flags |= FNM_CASEFOLD;
+#endif
+        auto verify = [&](std::string_view name)
+        {
+            name_buffer.assign(name);
+            return ::fnmatch(pattern.c_str(), name_buffer.c_str(), flags) == 0;
+        };
+        return run_query(trigrams, limit, under, verify);
+    }
+
+    struct FuzzyMatch
+    {
+        std::string path;
+        int score;
+        std::vector<uint32_t> positions; // 匹配字符在 path 中的下标（按 Unicode 字符计）
+    };
+
+    /**
+     * @brief 模糊匹配根目录相对路径（quick-open）
+     *
+     * 先用路径字符掩码批量剔除不可能匹配的条目（AVX2 一次比较 4 个），
+     * 剩余候选按块并行评分，每个线程只保留 limit 个最佳结果，最后合并。
+     * 同分时路径短者优先。
+     */
+    std::vector<FuzzyMatch> fuzzy(const std::string &query, size_t limit, int num_threads) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (limit == 0)
+            return {};
+        const uint64_t *masks = ensure_path_masks();
+        const FuzzyScorer scorer(query);
+        const uint64_t query_mask = scorer.mask();
+        const size_t total = entry_count();
+        constexpr size_t kChunk = 16384;
+        const size_t chunks = (total + kChunk - 1) / kChunk;
+
+        struct Ranked
+        {
+            int score;
+            uint32_t length;
+            uint32_t id;
+        };
+        auto better = [](const Ranked &a, const Ranked &b)
+        {
+            if (a.score != b.score)
+                return a.score > b.score;
+            if (a.length != b.length)
+                return a.length < b.length;
+            return a.id < b.id;
+        };
+
+        // 每个线程一个容量为 limit 的堆，堆顶是其中最差的结果
+        std::vector<std::vector<Ranked>> heaps(static_cast<size_t>(resolve_thread_count(num_threads)));
+        parallel_for(chunks, num_threads, [&](size_t chunk, size_t worker_id)
+        {
+            const size_t begin = chunk * kChunk;
+            const size_t end = std::min(total, begin + kChunk);
+            std::vector<uint32_t> candidates;
+            candidates.reserve(end - begin);
+            select_by_mask(masks, begin, end, query_mask, candidates);
+
+            auto &heap = heaps[worker_id];
+            std::string path;
+            for (uint32_t id : candidates)
+            {
+                if (removed_[id])
+                    continue;
+                size_t remaining = scorer.length();
+                for (uint32_t cur = id; cur != kNoParent && remaining > 0; cur = parent_of(cur))
+                {
+                    remaining = scorer.match_backward(name_of(cur), remaining);
+                    if (parent_of(cur) != kNoParent)
+                        remaining = scorer.match_backward("/", remaining);
+                }
+                if (remaining > 0)
+                    continue;
+                path.clear();
+                append_relative_path(id, path);
+                int score = scorer.score(path);
+                if (score == INT_MIN)
+                    continue;
+                Ranked ranked{score, static_cast<uint32_t>(path.size()), id};
+                if (heap.size() < limit)
+                {
+                    heap.push_back(ranked);
+                    std::push_heap(heap.begin(), heap.end(), better);
+                }
+                else if (better(ranked, heap.front()))
+                {
+                    std::pop_heap(heap.begin(), heap.end(), better);
+                    heap.back() = ranked;
+                    std::push_heap(heap.begin(), heap.end(), better);
+                }
+            }
+        });
+
+        std::vector<Ranked> merged;
+        for (const auto &heap : heaps)
+            merged.insert(merged.end(), heap.begin(), heap.end());
+        std::sort(merged.begin(), merged.end(), better);
+        if (merged.size() > limit)
+            merged.resize(limit);
+
+        std::vector<FuzzyMatch> results;
+        results.reserve(merged.size());
+        std::string rel;
+        std::vector<uint32_t> byte_positions;
+        for (const auto &ranked : merged)
+        {
+            rel.clear();
+            append_relative_path(ranked.id, rel);
+            byte_positions.clear();
+            scorer.score(rel, &byte_positions);
+
+            FuzzyMatch match;
+            match.score = ranked.score;
+            match.path = root_;
+            if (match.path.back() != '/')
+                match.path.push_back('/');
+            const size_t prefix_bytes = match.path.size();
+            match.path.append(rel);
+
+            // 字节偏移 -> 字符下标（Python str 按码点索引）
+            size_t chars = 0, next = 0;
+            for (size_t i = 0; i < match.path.size() && next < byte_positions.size(); ++i)
+            {
+                if (i == prefix_bytes + byte_positions[next])
+                {
+                    match.positions.push_back(static_cast<uint32_t>(chars));
+                    ++next;
+                }
+                if ((static_cast<unsigned char>(match.path[i]) & 0xC0) != 0x80)
+                    ++chars;
+            }
+            // 上面在计数前比较，位置即为该字节所在字符的下标
+            results.push_back(std::move(match));
+        }
+        return results;
+    }
+
+    /**
+     * @brief 加入条目（缺失的父目录一并加入）；recursive 时目录的内容也加入
+     * @return 新加入的条目数
+     */
+    size_t add(const std::vector<std::string> &paths, bool recursive)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        ensure_child_map();
+        size_t added = 0;
+        for (const auto &path : paths)
+        {
+            FileStat st;
+            if (stat_path(AT_FDCWD, path.c_str(), false, st) != 0)
+                continue;
+            std::string_view rel;
+            if (!relative_path(path, rel))
+                continue;
+            if (!include_hidden_ && has_hidden_component(rel))
+                continue; // 与 build 一致：隐藏条目及其下的内容不入索引
+            uint32_t id = ensure_entry(rel, S_ISDIR(st.mode), added);
+            if (id == kNoParent || !recursive || !S_ISDIR(st.mode))
+                continue;
+
+            std::vector<std::string> errors;
+            WalkOptions options;
+            options.include_hidden = include_hidden_;
+            options.stat_entries = false;
+            options.num_threads = 1;
+            parallel_walk(path, options, [&](const WalkEntry &entry, size_t)
+            {
+                std::string_view child_rel;
+                if (relative_path(entry.path, child_rel))
+                    ensure_entry(child_rel, S_ISDIR(entry.st.mode), added);
+                return true;
+            }, errors);
+        }
+        return added;
+    }
+
+    /**
+     * @brief 移除条目（目录连同其下所有条目）
+     * @return 被标记移除的条目数
+     */
+    size_t remove(const std::vector<std::string> &paths)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        ensure_child_map();
+        size_t before = removed_count_;
+        bool removed_dir = false;
+        for (const auto &path : paths)
+        {
+            std::string_view rel;
+            if (!relative_path(path, rel))
+                continue;
+            uint32_t id = lookup(rel);
+            if (id == kNoParent || removed_[id])
+                continue;
+            removed_[id] = 1;
+            ++removed_count_;
+            removed_dir |= is_dir(id);
+        }
+        if (removed_dir)
+        {
+            // 父条目 id 总是小于子条目：一次顺序扫描即可传播到所有子孙
+            const size_t total = entry_count();
+            for (uint32_t id = 0; id < total; ++id)
+            {
+                uint32_t parent = parent_of(id);
+                if (!removed_[id] && parent != kNoParent && removed_[parent])
+                {
+                    removed_[id] = 1;
+                    ++removed_count_;
+                }
+            }
+        }
+        return removed_count_ - before;
+    }
+
+    const std::string &root() const { return root_; }
+
+    bool include_hidden() const { return include_hidden_; }
+
+    size_t live_count() const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return entry_count() - removed_count_;
+    }
+
+    py::dict stats() const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        py::dict d;
+        d["root"] = root_;
+        d["include_hidden"] = include_hidden_;
+        d["entries"] = entry_count() - removed_count_;
+        d["base_entries"] = base_count_;
+        d["delta_entries"] = delta_names_.size();
+        d["removed"] = removed_count_;
+        d["trigrams"] = slot_count_;
+        d["postings_bytes"] = postings_bytes_;
+        d["mapped"] = map_base_ != MAP_FAILED;
+        return d;
+    }
+
+private:
+    // FileHeader::flags
+    static constexpr uint64_t kFlagIncludeHidden = 1;
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint64_t flags;
+        uint64_t entry_count;
+        uint64_t root_bytes;
+        uint64_t names_bytes;
+        uint64_t slot_count;
+        uint64_t postings_bytes;
+    };
+
+    FilenameIndex() = default;
+
+    static size_t align8(size_t value) { return (value + 7) & ~static_cast<size_t>(7); }
+
+    // ---- 条目访问（基础层 + 增量层） ----
+
+    size_t entry_count() const { return base_count_ + delta_names_.size(); }
+
+    std::string_view own_name(uint32_t id) const
+    {
+        return std::string_view(own_names_).substr(own_name_offsets_[id],
+                                                   own_name_offsets_[id + 1] - own_name_offsets_[id]);
+    }
+
+    std::string_view name_of(uint32_t id) const
+    {
+        if (id < base_count_)
+            return std::string_view(names_ + name_offsets_[id], name_offsets_[id + 1] - name_offsets_[id]);
+        return delta_names_[id - base_count_];
+    }
+
+    uint32_t parent_of(uint32_t id) const
+    {
+        return id < base_count_ ? parents_[id] : delta_parents_[id - base_count_];
+    }
+
+    bool is_dir(uint32_t id) const
+    {
+        return id < base_count_ ? dirs_[id] != 0 : delta_dirs_[id - base_count_] != 0;
+    }
+
+    std::string full_path(uint32_t id) const
+    {
+        std::vector<std::string_view> parts;
+        for (uint32_t cur = id; cur != kNoParent; cur = parent_of(cur))
+            parts.push_back(name_of(cur));
+        std::string path = root_;
+        for (auto it = parts.rbegin(); it != parts.rend(); ++it)
+        {
+            if (path.empty() || path.back() != '/')
+                path.push_back('/');
+            path.append(*it);
+        }
+        return path;
+    }
+
+    void append_relative_path(uint32_t id, std::string &out) const
+    {
+        // 深度不设上限：父链多深就拼多深（thread_local 复用，避免每个候选都分配）
+        thread_local std::vector<uint32_t> chain;
+        chain.clear();
+        for (uint32_t cur = id; cur != kNoParent; cur = parent_of(cur))
+            chain.push_back(cur);
+        for (size_t depth = chain.size(); depth > 0; --depth)
+        {
+            out.append(name_of(chain[depth - 1]));
+            if (depth > 1)
+                out.push_back('/');
+        }
+    }
+
+    /**
+     * @brief 每个条目的路径字符掩码（父掩码 | 自身文件名掩码），惰性计算并随增量层扩展
+     *
+     * 调用方持有 mutex_ 共享锁：条目只会在独占锁下追加，返回的指针在锁内有效。
+     */
+    const uint64_t *ensure_path_masks() const
+    {
+        std::lock_guard<std::mutex> guard(masks_mutex_);
+        const size_t total = entry_count();
+        path_masks_.reserve(total);
+        for (size_t id = path_masks_.size(); id < total; ++id)
+        {
+            uint32_t parent = parent_of(static_cast<uint32_t>(id));
+            uint64_t mask = fuzzy_mask(name_of(static_cast<uint32_t>(id)));
+            if (parent != kNoParent)
+                mask |= path_masks_[parent] | fuzzy_char_bit('/');
+            path_masks_.push_back(mask);
+        }
+        return path_masks_.data();
+    }
+
+    /** @brief 选出 [begin, end) 中掩码包含 query_mask 的条目 */
+    static void select_by_mask(const uint64_t *masks, size_t begin, size_t end, uint64_t query_mask,
+                               std::vector<uint32_t> &out)
+    {
+        size_t i = begin;
+#if defined(__AVX2__)
+        const __m256i needle = _mm256_set1_epi64x(static_cast<long long>(query_mask));
+        for (; i + 4 <= end; i += 4)
+        {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(masks + i));
+            __m256i hit = _mm256_cmpeq_epi64(_mm256_and_si256(block, needle), needle);
+            unsigned bits = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(hit)));
+            while (bits)
+            {
+                out.push_back(static_cast<uint32_t>(i + static_cast<size_t>(__builtin_ctz(bits))));
+                bits &= bits - 1;
+            }
+        }
+#endif
+        for (; i < end; ++i)
+        {
+            if ((masks[i] & query_mask) == query_mask)
+                out.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    void attach_owned()
+    {
+        parents_ = own_parents_.data();
+        name_offsets_ = own_name_offsets_.data();
+        dirs_ = own_dirs_.data();
+        names_ = own_names_.data();
+        slots_ = own_slots_.data();
+        postings_ = reinterpret_cast<const uint8_t *>(own_postings_.data());
+        postings_bytes_ = own_postings_.size();
+        base_count_ = own_parents_.size();
+        slot_count_ = own_slots_.size();
+        removed_.assign(base_count_, 0);
+    }
+
+    /**
+     * @brief 校验 mmap 进来的基础层，查询路径上不再做边界检查
+     *
+     * - 父条目 id 小于自身（也保证父链无环）
+     * - 文件名偏移从 0 单调递增到 names_bytes
+     * - 三元组槽按 trigram 严格递增，倒排按槽顺序首尾相接铺满 postings，
+     *   每个倒排解码出的 id 严格递增且小于条目数
+     */
+    bool validate_base(uint64_t names_bytes) const
+    {
+        const size_t n = base_count_;
+        for (size_t id = 0; id < n; ++id)
+        {
+            if (parents_[id] != kNoParent && parents_[id] >= id)
+                return false;
+            if (name_offsets_[id + 1] < name_offsets_[id])
+                return false;
+        }
+        if (name_offsets_[0] != 0 || name_offsets_[n] != names_bytes)
+            return false;
+
+        uint64_t expected = 0;
+        for (size_t k = 0; k < slot_count_; ++k)
+        {
+            const TrigramSlot &slot = slots_[k];
+            if ((k > 0 && slot.trigram <= slots_[k - 1].trigram) || slot.offset != expected ||
+                slot.count == 0 || slot.count > n)
+                return false;
+            size_t p = static_cast<size_t>(slot.offset);
+            uint64_t id = 0;
+            for (uint32_t i = 0; i < slot.count; ++i)
+            {
+                uint64_t delta = 0;
+                for (int shift = 0;; shift += 7)
+                {
+                    if (p >= postings_bytes_ || shift > 28)
+                        return false;
+                    uint8_t byte = postings_[p++];
+                    delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                    if (!(byte & 0x80))
+                        break;
+                }
+                if (i > 0 && delta == 0)
+                    return false;
+                id += delta;
+                if (id >= n)
+                    return false;
+            }
+            expected = p;
+        }
+        return expected == postings_bytes_;
+    }
+
+    /**
+     * @brief 为 [0, count) 的文件名生成倒排（id 升序，差分 varint）
+     */
+    template <typename NameFn>
+    static void encode_postings(size_t count, NameFn &&name_fn, std::vector<TrigramSlot> &slots,
+                                std::string &postings)
+    {
+        struct Encoder
+        {
+            uint32_t last = 0;
+            uint32_t count = 0;
+            std::string bytes;
+        };
+        std::unordered_map<uint32_t, Encoder> encoders;
+        std::vector<uint32_t> trigrams;
+        for (size_t id = 0; id < count; ++id)
+        {
+            trigrams.clear();
+            collect_trigrams(name_fn(static_cast<uint32_t>(id)), trigrams);
+            for (uint32_t tri : trigrams)
+            {
+                Encoder &enc = encoders[tri];
+                append_varint(enc.bytes, static_cast<uint32_t>(id) - enc.last);
+                enc.last = static_cast<uint32_t>(id);
+                ++enc.count;
+            }
+        }
+
+        slots.clear();
+        slots.reserve(encoders.size());
+        for (const auto &item : encoders)
+            slots.push_back(TrigramSlot{item.first, item.second.count, 0});
+        std::sort(slots.begin(), slots.end(), [](const TrigramSlot &a, const TrigramSlot &b)
+                  { return a.trigram < b.trigram; });
+        postings.clear();
+        for (auto &slot : slots)
+        {
+            slot.offset = postings.size();
+            postings.append(encoders[slot.trigram].bytes);
+        }
+    }
+
+    const TrigramSlot *find_slot(uint32_t trigram) const
+    {
+        const TrigramSlot *end = slots_ + slot_count_;
+        const TrigramSlot *it = std::lower_bound(slots_, end, trigram,
+                                                 [](const TrigramSlot &slot, uint32_t key)
+                                                 { return slot.trigram < key; });
+        return it != end && it->trigram == trigram ? it : nullptr;
+    }
+
+    /** @brief 基础层：所有三元组倒排的交集 */
+    std::vector<uint32_t> base_candidates(const std::vector<uint32_t> &trigrams) const
+    {
+        std::vector<const TrigramSlot *> lists;
+        for (uint32_t tri : trigrams)
+        {
+            const TrigramSlot *slot = find_slot(tri);
+            if (!slot)
+                return {};
+            lists.push_back(slot);
+        }
+        std::sort(lists.begin(), lists.end(), [](const TrigramSlot *a, const TrigramSlot *b)
+                  { return a->count < b->count; });
+
+        std::vector<uint32_t> result(lists[0]->count);
+        const uint8_t *p = postings_ + lists[0]->offset;
+        uint32_t id = 0;
+        for (uint32_t i = 0; i < lists[0]->count; ++i)
+        {
+            uint32_t delta;
+            p = read_varint(p, delta);
+            id += delta;
+            result[i] = id;
+        }
+
+        for (size_t k = 1; k < lists.size() && !result.empty(); ++k)
+        {
+            const uint8_t *q = postings_ + lists[k]->offset;
+            uint32_t value = 0, remaining = lists[k]->count;
+            size_t out = 0;
+            bool have = false;
+            for (uint32_t candidate : result)
+            {
+                while (remaining > 0 && (!have || value < candidate))
+                {
+                    uint32_t delta;
+                    q = read_varint(q, delta);
+                    value = have ? value + delta : delta;
+                    have = true;
+                    --remaining;
+                }
+                if (have && value == candidate)
+                    result[out++] = candidate;
+                else if (remaining == 0 && (!have || value < candidate))
+                    break;
+            }
+            result.resize(out);
+        }
+        return result;
+    }
+
+    /** @brief 增量层：所有三元组倒排的交集 */
+    std::vector<uint32_t> delta_candidates(const std::vector<uint32_t> &trigrams) const
+    {
+        std::vector<const std::vector<uint32_t> *> lists;
+        for (uint32_t tri : trigrams)
+        {
+            auto it = delta_postings_.find(tri);
+            if (it == delta_postings_.end())
+                return {};
+            lists.push_back(&it->second);
+        }
+        std::sort(lists.begin(), lists.end(), [](const auto *a, const auto *b)
+                  { return a->size() < b->size(); });
+        std::vector<uint32_t> result = *lists[0];
+        for (size_t k = 1; k < lists.size() && !result.empty(); ++k)
+        {
+            std::vector<uint32_t> next;
+            std::set_intersection(result.begin(), result.end(), lists[k]->begin(), lists[k]->end(),
+                                  std::back_inserter(next));
+            result.swap(next);
+        }
+        return result;
+    }
+
+    template <typename Verify>
+    std::vector<std::string> run_query(const std::vector<uint32_t> &trigrams, size_t limit,
+                                       const std::string &under, Verify &&verify) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        // 限定目录：名称验证通过后再按完整路径前缀过滤，范围外的条目不占 limit
+        std::string prefix = under;
+        while (prefix.size() > 1 && prefix.back() == '/')
+            prefix.pop_back();
+        if (prefix == root_ || prefix == "/")
+            prefix.clear();
+        else if (!prefix.empty())
+            prefix.push_back('/');
+
+        std::vector<std::string> results;
+        auto consider = [&](uint32_t id)
+        {
+            if (removed_[id] || !verify(name_of(id)))
+                return true;
+            std::string path = full_path(id);
+            if (!prefix.empty() && path.compare(0, prefix.size(), prefix) != 0)
+                return true;
+            results.push_back(std::move(path));
+            return limit == 0 || results.size() < limit;
+        };
+
+        if (trigrams.empty())
+        {
+            // 查询太短，没有三元组可用：线性扫描
+            const size_t total = entry_count();
+            for (uint32_t id = 0; id < total; ++id)
+            {
+                if (!consider(id))
+                    break;
+            }
+            return results;
+        }
+
+        for (uint32_t id : base_candidates(trigrams))
+        {
+            if (!consider(id))
+                return results;
+        }
+        for (uint32_t id : delta_candidates(trigrams))
+        {
+            if (!consider(id))
+                return results;
+        }
+        return results;
+    }
+
+    // ---- 增量更新 ----
+
+    bool relative_path(const std::string &path, std::string_view &rel) const
+    {
+        std::string_view view(path);
+        while (view.size() > 1 && view.back() == '/')
+            view.remove_suffix(1);
+        if (root_ == "/")
+        {
+            if (view.size() < 2 || view[0] != '/')
+                return false;
+            rel = view.substr(1);
+            return true;
+        }
+        if (view.size() <= root_.size() + 1 || view.compare(0, root_.size(), root_) != 0 ||
+            view[root_.size()] != '/')
+            return false;
+        rel = view.substr(root_.size() + 1);
+        return true;
+    }
+
+    static bool has_hidden_component(std::string_view rel)
+    {
+        for (size_t start = 0; start < rel.size();)
+        {
+            if (rel[start] == '.')
+                return true;
+            size_t slash = rel.find('/', start);
+            if (slash == std::string_view::npos)
+                break;
+            start = slash + 1;
+        }
+        return false;
+    }
+
+    static std::string child_key(uint32_t parent, std::string_view name)
+    {
+        std::string key(reinterpret_cast<const char *>(&parent), sizeof(parent));
+        key.append(name);
+        return key;
+    }
+
+    void ensure_child_map()
+    {
+        if (child_map_built_)
+            return;
+        const size_t total = entry_count();
+        child_map_.reserve(total);
+        for (uint32_t id = 0; id < total; ++id)
+        {
+            if (!removed_[id])
+                child_map_[child_key(parent_of(id), name_of(id))] = id;
+        }
+        child_map_built_ = true;
+    }
+
+    uint32_t lookup(std::string_view rel) const
+    {
+        uint32_t parent = kNoParent;
+        size_t start = 0;
+        while (start <= rel.size())
+        {
+            size_t slash = rel.find('/', start);
+            std::string_view part = rel.substr(start, slash == std::string_view::npos ? std::string_view::npos : slash - start);
+            auto it = child_map_.find(child_key(parent, part));
+            if (it == child_map_.end() || removed_[it->second])
+                return kNoParent;
+            parent = it->second;
+            if (slash == std::string_view::npos)
+                break;
+            start = slash + 1;
+        }
+        return parent;
+    }
+
+    /** @brief 确保相对路径对应的条目存在（逐级创建），返回其 id */
+    uint32_t ensure_entry(std::string_view rel, bool dir, size_t &added)
+    {
+        uint32_t parent = kNoParent;
+        size_t start = 0;
+        while (true)
+        {
+            size_t slash = rel.find('/', start);
+            bool last = slash == std::string_view::npos;
+            std::string_view part = rel.substr(start, last ? std::string_view::npos : slash - start);
+            if (part.empty())
+                return kNoParent;
+            std::string key = child_key(parent, part);
+            auto it = child_map_.find(key);
+            uint32_t id;
+            if (it != child_map_.end() && !removed_[it->second])
+            {
+                id = it->second;
+            }
+            else
+            {
+                id = static_cast<uint32_t>(entry_count());
+                delta_parents_.push_back(parent);
+                delta_names_.emplace_back(part);
+                delta_dirs_.push_back(last ? (dir ? 1 : 0) : 1);
+                removed_.push_back(0);
+                std::vector<uint32_t> trigrams;
+                collect_trigrams(part, trigrams);
+                for (uint32_t tri : trigrams)
+                    delta_postings_[tri].push_back(id);
+                child_map_[key] = id;
+                ++added;
+            }
+            if (last)
+                return id;
+            parent = id;
+            start = slash + 1;
+        }
+    }
+
+    std::string root_;
+    bool include_hidden_ = false;
+
+    // 基础层视图（指向 own_* 或 mmap 区域）
+    const uint32_t *parents_ = nullptr;
+    const uint32_t *name_offsets_ = nullptr;
+    const uint8_t *dirs_ = nullptr;
+    const char *names_ = nullptr;
+    const TrigramSlot *slots_ = nullptr;
+    const uint8_t *postings_ = nullptr;
+    size_t base_count_ = 0;
+    size_t slot_count_ = 0;
+    size_t postings_bytes_ = 0;
+
+    // build 生成的基础层
+    std::vector<uint32_t> own_parents_;
+    std::vector<uint32_t> own_name_offsets_;
+    std::vector<uint8_t> own_dirs_;
+    std::string own_names_;
+    std::vector<TrigramSlot> own_slots_;
+    std::string own_postings_;
+
+    // load 的 mmap 区域
+    void *map_base_ = MAP_FAILED;
+    size_t map_len_ = 0;
+
+    // 增量层
+    std::vector<uint32_t> delta_parents_;
+    std::vector<std::string> delta_names_;
+    std::vector<uint8_t> delta_dirs_;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> delta_postings_;
+    std::vector<uint8_t> removed_; // 墓碑（基础层 + 增量层）
+    size_t removed_count_ = 0;
+
+    // 模糊匹配用的路径字符掩码（按 id 追加，条目不会被重新编号）
+    mutable std::vector<uint64_t> path_masks_;
+    mutable std::mutex masks_mutex_;
+
+    // (父 id, 文件名) -> id，首次增量更新时惰性构建
+    std::unordered_map<std::string, uint32_t> child_map_;
+    bool child_map_built_ = false;
+
+    mutable std::shared_mutex mutex_;
+    mutable std::mutex save_mutex_;
+};
+
+// ============================================================================
+// Arrow IPC 导出
+// ============================================================================
+
+/**
+ * @brief 按小端序写入整数的低 width 字节
+ */
+static void store_le(char *dst, uint64_t value, size_t width)
+{
+    for (size_t i = 0; i < width; ++i)
+        dst[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+/**
+ * @brief 最小的 FlatBuffers 构建器（Arrow IPC 元数据用）
+ *
+ * 与官方实现一样从尾部向前构建：对象位置以「距缓冲区末尾的字节数」表示，
+ * 被引用的对象必须先于引用者创建，同一时刻只能构建一个表。
+ * 元数据只有几百字节，直接在 std::string 头部插入。
+ */
+class FlatBuilder
+{
+public:
+    using Offset = uint32_t;
+
+    size_t size() const { return buf_.size(); }
+
+    template <typename T>
+    void push(T value)
+    {
+        align(sizeof(T));
+        char bytes[sizeof(T)];
+        store_le(bytes, static_cast<uint64_t>(static_cast<std::make_unsigned_t<T>>(value)), sizeof(T));
+        buf_.insert(0, bytes, sizeof(T));
+    }
+
+    Offset string(std::string_view value)
+    {
+        pad_for(value.size() + 1, 4);
+        buf_.insert(0, 1, '\0');
+        buf_.insert(0, value.data(), value.size());
+        push<uint32_t>(static_cast<uint32_t>(value.size()));
+        return static_cast<Offset>(size());
+    }
+
+    Offset offsets(const std::vector<Offset> &items)
+    {
+        pad_for(items.size() * 4, 4);
+        for (auto it = items.rbegin(); it != items.rend(); ++it)
+            push<uint32_t>(refer(*it));
+        push<uint32_t>(static_cast<uint32_t>(items.size()));
+        return static_cast<Offset>(size());
+    }
+
+    /// 结构体向量：bytes 为 count 个已按小端序排好的结构体
+    Offset structs(const std::string &bytes, size_t count, size_t alignment)
+    {
+        pad_for(bytes.size(), 4);
+        pad_for(bytes.size(), alignment);
+        buf_.insert(0, bytes);
+        push<uint32_t>(static_cast<uint32_t>(count));
+        return static_cast<Offset>(size());
+    }
+
+    void start_table()
+    {
+        fields_.clear();
+        table_start_ = size();
+    }
+
+    template <typename T>
+    void add(uint16_t id, T value)
+    {
+        push(value);
+        fields_.push_back({id, size()});
+    }
 
-                    while (file)
-                    {
-                        file.read(reinterpret_cast<char *>(buffer.get()), chunk_size);
-                        std::streamsize bytes_read = file.gcount();
-                        if (bytes_read > 0)
-                        {
-                            blake3_hasher_update(&hasher, buffer.get(),
-                                                 static_cast<size_t>(bytes_read));
-                        }
-                    }
+    void add_offset(uint16_t id, Offset target)
+    {
+        push<uint32_t>(refer(target));
+        fields_.push_back({id, size()});
+    }
 
-                    if (file.bad())
-                    {
-                        errors[idx] = "Error reading file";
-                        continue;
-                    }
+    Offset end_table()
+    {
+        push<int32_t>(0); // vtable 的 soffset，写完 vtable 后回填
+        const size_t table = size();
 
-                    blake3_hasher_finalize(&hasher, output, BLAKE3_OUT_LEN);
+        uint16_t slots = 0;
+        for (const auto &field : fields_)
+            slots = std::max<uint16_t>(slots, field.id + 1);
+        std::vector<uint16_t> vtable(slots, 0);
+        for (const auto &field : fields_)
+            vtable[field.id] = static_cast<uint16_t>(table - field.pos);
+        for (auto it = vtable.rbegin(); it != vtable.rend(); ++it)
+            push<uint16_t>(*it);
+        push<uint16_t>(static_cast<uint16_t>(table - table_start_));
+        push<uint16_t>(static_cast<uint16_t>((slots + 2) * 2));
 
-                    // 转换为十六进制
-                    std::string hex_result;
-                    hex_result.reserve(BLAKE3_OUT_LEN * 2);
-                    static const char hex_chars[] = "0123456789abcdef";
-                    for (size_t i = 0; i < BLAKE3_OUT_LEN; ++i)
-                    {
-                        hex_result.push_back(hex_chars[(output[i] >> 4) & 0x0F]);
-                        hex_result.push_back(hex_chars[output[i] & 0x0F]);
-                    }
-                    results[idx] = {path, hex_result};
-                }
-                catch (const std::exception &e)
-                {
-                    errors[idx] = e.what();
-                }
-            }
-        };
+        store_le(&buf_[buf_.size() - table], static_cast<uint32_t>(size() - table), 4);
+        fields_.clear();
+        return static_cast<Offset>(table);
+    }
+
+    std::string finish(Offset root)
+    {
+        pad_for(4, min_align_);
+        push<uint32_t>(refer(root));
+        return std::move(buf_);
+    }
+
+private:
+    struct FieldLoc
+    {
+        uint16_t id;
+        size_t pos;
+    };
+
+    /// 填充到：再写入 len 字节后位置按 alignment 对齐
+    void pad_for(size_t len, size_t alignment)
+    {
+        min_align_ = std::max(min_align_, alignment);
+        buf_.insert(0, (~(buf_.size() + len) + 1) & (alignment - 1), '\0');
+    }
+
+    void align(size_t alignment) { pad_for(0, alignment); }
+
+    /// 下一个 4 字节字段指向 target 时应写入的 uoffset
+    uint32_t refer(Offset target)
+    {
+        align(4);
+        return static_cast<uint32_t>(size() + 4 - target);
+    }
+
+    std::string buf_;
+    std::vector<FieldLoc> fields_;
+    size_t table_start_ = 0;
+    size_t min_align_ = 1;
+};
 
-        // 启动线程
-        for (int i = 0; i < num_threads; ++i)
+/**
+ * @brief 导出列的物理类型（字典编码列的值类型固定为 Utf8，索引为 int32）
+ */
+enum class ArrowType
+{
+    Utf8,
+    LargeUtf8,
+    Int64,
+    UInt32,
+    Bool,
+    TimestampNs,
+};
+
+/**
+ * @brief 一列数据：单个 FieldNode 加上按 Arrow 规范顺序排列的缓冲区（validity 在前）
+ */
+struct ArrowColumn
+{
+    std::string name;
+    ArrowType type = ArrowType::Utf8;
+    bool nullable = false;
+    int64_t dictionary_id = -1; // >= 0 时为字典编码列
+    int64_t length = 0;
+    int64_t null_count = 0;
+    std::vector<std::string> buffers;
+};
+
+/**
+ * @brief 位图（validity / Bool 值），LSB 在前
+ */
+template <typename Bit>
+static std::string arrow_bitmap(size_t rows, Bit bit)
+{
+    std::string bits((rows + 7) / 8, '\0');
+    for (size_t i = 0; i < rows; ++i)
+    {
+        if (bit(i))
+            bits[i / 8] |= static_cast<char>(1u << (i % 8));
+    }
+    return bits;
+}
+
+/**
+ * @brief 追加字符串，无效的 UTF-8 字节替换为 U+FFFD（Arrow utf8 列要求合法编码）
+ */
+static void append_utf8(std::string &out, std::string_view value)
+{
+    const auto *p = reinterpret_cast<const unsigned char *>(value.data());
+    const auto *end = p + value.size();
+    while (p < end)
+    {
+        const auto *run = p;
+        while (p < end && *p < 0x80)
+            ++p;
+        out.append(reinterpret_cast<const char *>(run), p - run);
+        if (p == end)
+            break;
+        const size_t length = JsonWriter::utf8_sequence_length(p, end);
+        if (length == 0)
         {
-            threads.emplace_back(worker);
+            out.append("\xEF\xBF\xBD", 3);
+            ++p;
         }
-
-        // 等待所有线程完成
-        for (auto &t : threads)
+        else
         {
-            t.join();
+            out.append(reinterpret_cast<const char *>(p), length);
+            p += length;
         }
     }
-    // GIL 已重新获取
+}
 
-    // 构建返回结果
-    py::dict py_results;
-    for (size_t i = 0; i < file_paths.size(); ++i)
+/**
+ * @brief 字符串列；总字节数超过 int32 偏移的范围时改用 LargeUtf8
+ */
+template <typename Get>
+static ArrowColumn arrow_string_column(std::string name, size_t rows, Get get)
+{
+    std::vector<int64_t> ends(rows);
+    std::string data;
+    for (size_t i = 0; i < rows; ++i)
+    {
+        append_utf8(data, get(i));
+        ends[i] = static_cast<int64_t>(data.size());
+    }
+
+    ArrowColumn column;
+    column.name = std::move(name);
+    column.length = static_cast<int64_t>(rows);
+    const bool large = data.size() > static_cast<size_t>(INT32_MAX);
+    column.type = large ? ArrowType::LargeUtf8 : ArrowType::Utf8;
+
+    std::string offsets((rows + 1) * (large ? 8 : 4), '\0');
+    for (size_t i = 0; i < rows; ++i)
     {
-        if (errors[i].empty() && !results[i].second.empty())
+        if (large)
+            std::memcpy(&offsets[(i + 1) * 8], &ends[i], 8);
+        else
         {
-            py_results[py::str(results[i].first)] = results[i].second;
+            const auto end = static_cast<int32_t>(ends[i]);
+            std::memcpy(&offsets[(i + 1) * 4], &end, 4);
         }
+    }
+    column.buffers = {std::string(), std::move(offsets), std::move(data)};
+    return column;
+}
+
+template <typename T, typename Get>
+static ArrowColumn arrow_fixed_column(std::string name, ArrowType type, size_t rows, Get get)
+{
+    ArrowColumn column;
+    column.name = std::move(name);
+    column.type = type;
+    column.length = static_cast<int64_t>(rows);
+    std::string values(rows * sizeof(T), '\0');
+    for (size_t i = 0; i < rows; ++i)
+    {
+        const T value = get(i);
+        std::memcpy(&values[i * sizeof(T)], &value, sizeof(T));
+    }
+    column.buffers = {std::string(), std::move(values)};
+    return column;
+}
+
+template <typename Get>
+static ArrowColumn arrow_bool_column(std::string name, size_t rows, Get get)
+{
+    ArrowColumn column;
+    column.name = std::move(name);
+    column.type = ArrowType::Bool;
+    column.length = static_cast<int64_t>(rows);
+    column.buffers = {std::string(), arrow_bitmap(rows, get)};
+    return column;
+}
+
+/**
+ * @brief 字典编码的字符串列；get 返回 nullopt 表示 null
+ * @param dictionary 输出：字典值（下标即索引）
+ */
+template <typename Get>
+static ArrowColumn arrow_dictionary_column(std::string name, int64_t dictionary_id, size_t rows, Get get,
+                                           std::vector<std::string_view> &dictionary)
+{
+    ArrowColumn column;
+    column.name = std::move(name);
+    column.type = ArrowType::Utf8;
+    column.nullable = true;
+    column.dictionary_id = dictionary_id;
+    column.length = static_cast<int64_t>(rows);
+
+    StringTable table;
+    std::vector<uint32_t> slots(rows); // 0 = null，否则为字典下标 + 1
+    for (size_t i = 0; i < rows; ++i)
+    {
+        const std::optional<std::string_view> value = get(i);
+        if (value)
+            slots[i] = table.index(*value);
         else
+            ++column.null_count;
+    }
+    dictionary = table.values();
+
+    std::string indices(rows * sizeof(int32_t), '\0');
+    for (size_t i = 0; i < rows; ++i)
+    {
+        const int32_t index = slots[i] ? static_cast<int32_t>(slots[i] - 1) : 0;
+        std::memcpy(&indices[i * sizeof(int32_t)], &index, sizeof(int32_t));
+    }
+    std::string validity;
+    if (column.null_count > 0)
+        validity = arrow_bitmap(rows, [&](size_t i) { return slots[i] != 0; });
+    column.buffers = {std::move(validity), std::move(indices)};
+    return column;
+}
+
+/**
+ * @brief 写出 Field 表（包括类型与字典编码）
+ */
+static FlatBuilder::Offset arrow_field(FlatBuilder &fb, const ArrowColumn &column)
+{
+    const FlatBuilder::Offset name = fb.string(column.name);
+
+    // Type 联合体：Int = 2，Utf8 = 5，Bool = 6，Timestamp = 10，LargeUtf8 = 20
+    uint8_t type_id = 0;
+    FlatBuilder::Offset type = 0;
+    switch (column.type)
+    {
+    case ArrowType::Utf8:
+    case ArrowType::LargeUtf8:
+    case ArrowType::Bool:
+        type_id = column.type == ArrowType::Utf8 ? 5 : (column.type == ArrowType::LargeUtf8 ? 20 : 6);
+        fb.start_table();
+        type = fb.end_table();
+        break;
+    case ArrowType::Int64:
+    case ArrowType::UInt32:
+        type_id = 2;
+        fb.start_table();
+        fb.add<int32_t>(0, column.type == ArrowType::Int64 ? 64 : 32); // bitWidth
+        fb.add<uint8_t>(1, column.type == ArrowType::Int64);           // is_signed
+        type = fb.end_table();
+        break;
+    case ArrowType::TimestampNs:
+    {
+        type_id = 10;
+        const FlatBuilder::Offset timezone = fb.string("UTC");
+        fb.start_table();
+        fb.add<int16_t>(0, 3); // TimeUnit::NANOSECOND
+        fb.add_offset(1, timezone);
+        type = fb.end_table();
+        break;
+    }
+    }
+
+    FlatBuilder::Offset dictionary = 0;
+    if (column.dictionary_id >= 0)
+    {
+        fb.start_table();
+        fb.add<int32_t>(0, 32);
+        fb.add<uint8_t>(1, 1);
+        const FlatBuilder::Offset index_type = fb.end_table();
+        fb.start_table();
+        fb.add<int64_t>(0, column.dictionary_id);
+        fb.add_offset(1, index_type);
+        dictionary = fb.end_table();
+    }
+
+    const FlatBuilder::Offset children = fb.offsets({});
+    fb.start_table();
+    fb.add_offset(0, name);
+    fb.add<uint8_t>(1, column.nullable);
+    fb.add<uint8_t>(2, type_id);
+    fb.add_offset(3, type);
+    if (column.dictionary_id >= 0)
+        fb.add_offset(4, dictionary);
+    fb.add_offset(5, children);
+    return fb.end_table();
+}
+
+/**
+ * @brief 写出 Schema 表；数值缓冲区按本机字节序存放，endianness 如实声明
+ */
+static FlatBuilder::Offset arrow_schema(FlatBuilder &fb, const std::vector<ArrowColumn> &columns,
+                                        const std::vector<std::pair<std::string, std::string>> &metadata)
+{
+    std::vector<FlatBuilder::Offset> fields;
+    for (const auto &column : columns)
+        fields.push_back(arrow_field(fb, column));
+    const FlatBuilder::Offset field_vector = fb.offsets(fields);
+
+    std::vector<FlatBuilder::Offset> pairs;
+    for (const auto &[key, value] : metadata)
+    {
+        const FlatBuilder::Offset k = fb.string(key);
+        const FlatBuilder::Offset v = fb.string(value);
+        fb.start_table();
+        fb.add_offset(0, k);
+        fb.add_offset(1, v);
+        pairs.push_back(fb.end_table());
+    }
+    const FlatBuilder::Offset pair_vector = fb.offsets(pairs);
+
+    fb.start_table();
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    fb.add<int16_t>(0, 1);
+#else
+    fb.add<int16_t>(0, 0);
+#endif
+    fb.add_offset(1, field_vector);
+    fb.add_offset(2, pair_vector);
+    return fb.end_table();
+}
+
+/**
+ * @brief 写出 RecordBatch 表：每列一个 FieldNode，缓冲区按 8 字节对齐依次排在 body 中
+ * @return 表位置；body_length 输出 body 的总长度
+ */
+static FlatBuilder::Offset arrow_record_batch(FlatBuilder &fb, const std::vector<const ArrowColumn *> &columns,
+                                              int64_t length, uint64_t &body_length)
+{
+    std::string nodes, buffers;
+    char scratch[16];
+    body_length = 0;
+    for (const ArrowColumn *column : columns)
+    {
+        store_le(scratch, static_cast<uint64_t>(column->length), 8);
+        store_le(scratch + 8, static_cast<uint64_t>(column->null_count), 8);
+        nodes.append(scratch, 16);
+        for (const auto &buffer : column->buffers)
         {
-            // 包含错误信息
-            py::dict error_info;
-            error_info["error"] = errors[i].empty() ? "Unknown error" : errors[i];
-            py_results[py::str(file_paths[i])] = error_info;
+            store_le(scratch, body_length, 8);
+            store_le(scratch + 8, buffer.size(), 8);
+            buffers.append(scratch, 16);
+            body_length += (buffer.size() + 7) & ~static_cast<uint64_t>(7);
         }
     }
+    const FlatBuilder::Offset node_vector = fb.structs(nodes, columns.size(), 8);
+    const FlatBuilder::Offset buffer_vector = fb.structs(buffers, buffers.size() / 16, 8);
+    fb.start_table();
+    fb.add<int64_t>(0, length);
+    fb.add_offset(1, node_vector);
+    fb.add_offset(2, buffer_vector);
+    return fb.end_table();
+}
 
-    return py_results;
+/**
+ * @brief Footer 中的消息索引
+ */
+struct ArrowBlock
+{
+    uint64_t offset;
+    uint32_t metadata_length;
+    uint64_t body_length;
+};
+
+/**
+ * @brief 以封装格式追加一条消息：0xFFFFFFFF、元数据长度、元数据（补齐到 8 字节）、body
+ *
+ * @param header_type MessageHeader 联合体：Schema = 1，DictionaryBatch = 2，RecordBatch = 3
+ * @param columns 写入 body 的列（Schema 消息为空）
+ * @param build 在给定 builder 中写出消息头表，返回其位置并输出 body 长度
+ */
+template <typename Build>
+static ArrowBlock arrow_message(std::string &out, uint8_t header_type,
+                                const std::vector<const ArrowColumn *> &columns, Build build)
+{
+    FlatBuilder fb;
+    uint64_t body_length = 0;
+    const FlatBuilder::Offset header = build(fb, body_length);
+    fb.start_table();
+    fb.add<int16_t>(0, 4); // MetadataVersion::V5
+    fb.add<uint8_t>(1, header_type);
+    fb.add_offset(2, header);
+    fb.add<int64_t>(3, static_cast<int64_t>(body_length));
+    std::string metadata = fb.finish(fb.end_table());
+    metadata.resize(((metadata.size() + 8 + 7) & ~static_cast<size_t>(7)) - 8, '\0');
+
+    ArrowBlock block{out.size(), static_cast<uint32_t>(metadata.size() + 8), body_length};
+    char prefix[8];
+    store_le(prefix, 0xffffffffu, 4);
+    store_le(prefix + 4, metadata.size(), 4);
+    out.reserve(out.size() + 8 + metadata.size() + body_length);
+    out.append(prefix, 8);
+    out.append(metadata);
+    for (const ArrowColumn *column : columns)
+    {
+        for (const auto &buffer : column->buffers)
+        {
+            out.append(buffer);
+            out.resize((out.size() + 7) & ~static_cast<size_t>(7), '\0');
+        }
+    }
+    return block;
 }
 
 /**
- * @brief 获取文件详细信息
+ * @brief 把 FileInfo 列表编码为 Arrow IPC 文件格式（Feather v2）
  *
- * @param file_path 文件路径
- * @return Python 字典包含详细文件信息
+ * 列：path、name（utf8）、size（int64）、mtime（timestamp[ns, UTC]）、is_directory、is_symlink（bool）、
+ * extension（dictionary<int32, utf8>，仅普通文件，无扩展名为 ""，其余为 null）、uid、gid（uint32），
+ * include_owner 时追加 owner、group（dictionary<int32, utf8>，解析失败为 null）。
+ * 所有行在一个 RecordBatch 中，字典各一个 DictionaryBatch；缓冲区 8 字节对齐，可直接 mmap 零拷贝读取。
+ * 调用方已释放 GIL。
  */
-py::dict get_file_info(const std::string &file_path)
+static std::string arrow_ipc_file(const std::vector<FileInfo> &infos, bool include_owner,
+                                  const std::vector<std::pair<std::string, std::string>> &metadata)
 {
-    fs::path path(file_path);
+    const size_t rows = infos.size();
+    std::vector<ArrowColumn> columns;
+    std::vector<std::vector<std::string_view>> dictionaries;
 
-    if (!fs::exists(path))
+    columns.push_back(arrow_string_column("path", rows, [&](size_t i) { return std::string_view(infos[i].path); }));
+    columns.push_back(arrow_string_column("name", rows, [&](size_t i) { return std::string_view(infos[i].name); }));
+    columns.push_back(arrow_fixed_column<int64_t>("size", ArrowType::Int64, rows,
+                                                  [&](size_t i) { return static_cast<int64_t>(infos[i].size); }));
+    columns.push_back(arrow_fixed_column<int64_t>("mtime", ArrowType::TimestampNs, rows,
+                                                  [&](size_t i) { return infos[i].mtime_ns; }));
+    columns.push_back(arrow_bool_column("is_directory", rows, [&](size_t i) { return infos[i].is_directory; }));
+    columns.push_back(arrow_bool_column("is_symlink", rows, [&](size_t i) { return infos[i].is_symlink; }));
+
+    auto extension = [&](size_t i) -> std::optional<std::string_view> {
+        const FileInfo &info = infos[i];
+        if (info.is_directory || info.is_symlink)
+            return std::nullopt;
+        const size_t dot = info.name.rfind('.');
+        if (dot != std::string::npos && dot > 0 && dot + 1 < info.name.size())
+            return std::string_view(info.name).substr(dot + 1);
+        return std::string_view();
+    };
+    dictionaries.emplace_back();
+    columns.push_back(arrow_dictionary_column("extension", 0, rows, extension, dictionaries.back()));
+
+    columns.push_back(arrow_fixed_column<uint32_t>("uid", ArrowType::UInt32, rows, [&](size_t i) { return infos[i].uid; }));
+    columns.push_back(arrow_fixed_column<uint32_t>("gid", ArrowType::UInt32, rows, [&](size_t i) { return infos[i].gid; }));
+    if (include_owner)
     {
-        throw std::runtime_error("Path does not exist: " + file_path);
+        auto name_or_null = [](const std::string &owner, const std::string &value) -> std::optional<std::string_view> {
+            if (owner.empty())
+                return std::nullopt;
+            return std::string_view(value);
+        };
+        dictionaries.emplace_back();
+        columns.push_back(arrow_dictionary_column(
+            "owner", 1, rows, [&](size_t i) { return name_or_null(infos[i].owner, infos[i].owner); },
+            dictionaries.back()));
+        dictionaries.emplace_back();
+        columns.push_back(arrow_dictionary_column(
+            "group", 2, rows, [&](size_t i) { return name_or_null(infos[i].owner, infos[i].group); },
+            dictionaries.back()));
     }
 
-    // 在 C++ 结构中收集数据，避免在 GIL 释放期间操作 Python 对象
-    std::string info_path, info_name, info_extension, info_parent;
-    bool is_regular_file, is_directory, is_symlink_val;
-    bool is_block_file, is_character_file, is_fifo, is_socket;
-    uint64_t size_val = 0;
-    double mtime_val = 0.0;
-    uint32_t perms_val = 0;
-    bool is_readable = false, is_writable = false, is_executable = false;
+    std::string out("ARROW1\0\0", 8);
+    arrow_message(out, 1, {}, [&](FlatBuilder &fb, uint64_t &) { return arrow_schema(fb, columns, metadata); });
+
+    std::vector<ArrowBlock> dictionary_blocks, batch_blocks;
+    for (size_t d = 0; d < dictionaries.size(); ++d)
+    {
+        const auto &values = dictionaries[d];
+        const ArrowColumn column = arrow_string_column("", values.size(), [&](size_t i) { return values[i]; });
+        dictionary_blocks.push_back(arrow_message(out, 2, {&column}, [&](FlatBuilder &fb, uint64_t &body_length) {
+            const FlatBuilder::Offset data = arrow_record_batch(fb, {&column}, column.length, body_length);
+            fb.start_table();
+            fb.add<int64_t>(0, static_cast<int64_t>(d));
+            fb.add_offset(1, data);
+            return fb.end_table();
+        }));
+    }
+
+    std::vector<const ArrowColumn *> batch_columns;
+    for (const auto &column : columns)
+        batch_columns.push_back(&column);
+    batch_blocks.push_back(arrow_message(out, 3, batch_columns, [&](FlatBuilder &fb, uint64_t &body_length) {
+        return arrow_record_batch(fb, batch_columns, static_cast<int64_t>(rows), body_length);
+    }));
+
+    // 流结束标记，之后是 Footer
+    out.append("\xff\xff\xff\xff\0\0\0\0", 8);
+
+    FlatBuilder fb;
+    const FlatBuilder::Offset schema = arrow_schema(fb, columns, metadata);
+    auto block_vector = [&fb](const std::vector<ArrowBlock> &blocks) {
+        std::string bytes(blocks.size() * 24, '\0');
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            store_le(&bytes[i * 24], blocks[i].offset, 8);
+            store_le(&bytes[i * 24 + 8], blocks[i].metadata_length, 4);
+            store_le(&bytes[i * 24 + 16], blocks[i].body_length, 8);
+        }
+        return fb.structs(bytes, blocks.size(), 8);
+    };
+    const FlatBuilder::Offset dictionary_vector = block_vector(dictionary_blocks);
+    const FlatBuilder::Offset batch_vector = block_vector(batch_blocks);
+    fb.start_table();
+    fb.add<int16_t>(0, 4);
+    fb.add_offset(1, schema);
+    fb.add_offset(2, dictionary_vector);
+    fb.add_offset(3, batch_vector);
+    const std::string footer = fb.finish(fb.end_table());
+
+    out.append(footer);
+    char length[4];
+    store_le(length, footer.size(), 4);
+    out.append(length, 4);
+    out.append("ARROW1", 6);
+    return out;
+}
+
+/**
+ * @brief 把遍历中的非致命错误写入 schema 元数据
+ *
+ * fluxfile.errors 为错误总数（十进制字符串），fluxfile.error_list 为 JSON 字符串数组，
+ * 只保留前 kMaxListed 条，避免权限问题成片出现时元数据膨胀。
+ */
+static void arrow_error_metadata(const std::vector<std::string> &errors,
+                                 std::vector<std::pair<std::string, std::string>> &metadata)
+{
+    static const size_t kMaxListed = 100;
+    std::string list;
+    JsonWriter writer(list);
+    writer.raw("[");
+    for (size_t i = 0; i < errors.size() && i < kMaxListed; ++i)
+    {
+        if (i > 0)
+            writer.raw(",");
+        writer.string(errors[i]);
+    }
+    writer.raw("]");
+    metadata.emplace_back("fluxfile.errors", std::to_string(errors.size()));
+    metadata.emplace_back("fluxfile.error_list", std::move(list));
+}
+
+/**
+ * @brief output_path 为空时返回 bytes；否则原子写入文件（atomic_write_file）并返回行数
+ */
+static py::object arrow_output(const std::string &data, const std::string &output_path, size_t rows)
+{
+    if (output_path.empty())
+        return py::bytes(data);
 
     {
         py::gil_scoped_release release;
+        atomic_write_file(output_path, data, 0644);
+    }
+    return py::int_(rows);
+}
+
+/**
+ * @brief 递归扫描目录并导出为 Arrow IPC 文件（列定义见 arrow_ipc_file）
+ *
+ * 扫描参数同 scandir_recursive；结果不经过 Python 字典，编码同样在释放 GIL 后完成。
+ * Schema 元数据：fluxfile.source = "scandir"、fluxfile.root、
+ * fluxfile.errors / fluxfile.error_list（见 arrow_error_metadata）。
+ *
+ * @param output_path 输出文件；为空时直接返回 bytes（可用 pyarrow.py_buffer 零拷贝包装）
+ * @return bytes 或写入的行数
+ */
+py::object scandir_arrow(
+    const std::string &root_path,
+    const std::string &output_path = "",
+    int max_depth = 0,
+    bool include_hidden = false,
+    bool include_owner = false,
+    const std::string &sort_by = "",
+    bool sort_desc = false,
+    bool dirs_first = false,
+    bool follow_symlinks = false,
+    bool one_file_system = false,
+    const std::vector<std::string> &skip_fs_types = {},
+    const std::string &priority = "interactive",
+    std::shared_ptr<RateLimiter> limiter = nullptr)
+{
+    const SortField sort_field = parse_sort_field(sort_by);
+    const IoPriority io_priority = parse_io_priority(priority);
 
-        // 获取文件状态
-        auto status = fs::status(path);
-        auto symlink_status = fs::symlink_status(path);
-
-        // 基本信息
-        info_path = path.string();
-        info_name = path.filename().string();
-        info_extension = path.extension().string();
-        info_parent = path.parent_path().string();
-
-        // 类型信息
-        is_regular_file = fs::is_regular_file(status);
-        is_directory = fs::is_directory(status);
-        is_symlink_val = fs::is_symlink(symlink_status);
-        is_block_file = fs::is_block_file(status);
-        is_character_file = fs::is_character_file(status);
-        is_fifo = fs::is_fifo(status);
-        is_socket = fs::is_socket(status);
-
-        // 大小
-        if (fs::is_regular_file(path))
-        {
-            size_val = fs::file_size(path);
-        }
-
-        // 时间信息 - 同时捕获两个时钟以减小误差
-        auto ftime = fs::last_write_time(path);
-        auto file_clock_now = fs::file_time_type::clock::now();
-        auto sys_clock_now = std::chrono::system_clock::now();
-        auto sctp = std::chrono::time_point_cast<std::chrono::seconds>(
-            sys_clock_now + (ftime - file_clock_now));
-        mtime_val = static_cast<double>(sctp.time_since_epoch().count());
-
-        // 权限
-        auto perms = status.permissions();
-        perms_val = static_cast<uint32_t>(perms);
-        is_readable = (perms & fs::perms::owner_read) != fs::perms::none;
-        is_writable = (perms & fs::perms::owner_write) != fs::perms::none;
-        is_executable = (perms & fs::perms::owner_exec) != fs::perms::none;
+    if (!fs::exists(root_path))
+    {
+        throw std::runtime_error("Path does not exist: " + root_path);
+    }
+    if (!fs::is_directory(root_path))
+    {
+        throw std::runtime_error("Path is not a directory: " + root_path);
     }
-    // GIL 已重新获取，现在安全地构建 Python 字典
 
-    py::dict info;
-    info["path"] = info_path;
-    info["name"] = info_name;
-    info["extension"] = info_extension;
-    info["parent"] = info_parent;
-    info["is_regular_file"] = is_regular_file;
-    info["is_directory"] = is_directory;
-    info["is_symlink"] = is_symlink_val;
-    info["is_block_file"] = is_block_file;
-    info["is_character_file"] = is_character_file;
-    info["is_fifo"] = is_fifo;
-    info["is_socket"] = is_socket;
-    info["size"] = size_val;
-    info["mtime"] = mtime_val;
-    info["permissions"] = perms_val;
-    info["is_readable"] = is_readable;
-    info["is_writable"] = is_writable;
-    info["is_executable"] = is_executable;
+    std::vector<FileInfo> results;
+    std::vector<std::string> errors;
+    std::string data;
+    {
+        py::gil_scoped_release release;
+        IoPriorityScope priority_scope(io_priority);
+        RateLimitScope limit_scope(limiter.get());
 
-    return info;
+        collect_file_infos(root_path, max_depth, include_hidden, include_owner, follow_symlinks,
+                           one_file_system, skip_fs_types, results, errors);
+        sort_file_infos(results, sort_field, sort_desc, dirs_first);
+        std::vector<std::pair<std::string, std::string>> metadata = {
+            {"fluxfile.source", "scandir"}, {"fluxfile.root", root_path}};
+        arrow_error_metadata(errors, metadata);
+        data = arrow_ipc_file(results, include_owner, metadata);
+    }
+
+    for (const auto &err : errors)
+    {
+        if (err.find("Fatal error:") == 0)
+        {
+            throw std::runtime_error(err);
+        }
+    }
+    return arrow_output(data, output_path, results.size());
+}
+
+/**
+ * @brief 按谓词查询目录树并导出为 Arrow IPC 文件（列定义见 arrow_ipc_file，行按路径排序）
+ *
+ * 查询参数同 find。Schema 元数据：fluxfile.source = "find"、fluxfile.root、
+ * fluxfile.truncated（"true" / "false"，是否因 limit 提前结束）、
+ * fluxfile.errors / fluxfile.error_list（见 arrow_error_metadata）。
+ *
+ * @param output_path 输出文件；为空时直接返回 bytes
+ * @return bytes 或写入的行数
+ */
+py::object find_arrow(const std::string &root_path, const py::object &query, const py::object &prune,
+                      const std::string &output_path = "", bool include_hidden = false, size_t limit = 0,
+                      int num_threads = 0, bool one_file_system = false,
+                      const std::vector<std::string> &skip_fs_types = {},
+                      const std::string &priority = "interactive",
+                      std::shared_ptr<RateLimiter> limiter = nullptr,
+                      const std::vector<std::string> &exclude_paths = {},
+                      const std::vector<std::string> &exclude_names = {})
+{
+    const IoPriority io_priority = parse_io_priority(priority);
+    FindPredicate predicate = compile_find_predicate(query);
+    FindPredicate prune_predicate = compile_find_predicate(prune);
+    MountFilter mounts(root_path, one_file_system, skip_fs_types);
+
+    std::vector<FileInfo> all;
+    std::vector<std::string> errors;
+    const WalkExclusions exclusions(exclude_paths, exclude_names);
+    const bool truncated = find_entries(root_path, predicate, prune.is_none() ? nullptr : &prune_predicate,
+                                        exclusions, include_hidden, limit, num_threads, mounts,
+                                        io_priority, limiter.get(), all, errors);
+
+    std::string data;
+    {
+        py::gil_scoped_release release;
+        std::vector<std::pair<std::string, std::string>> metadata = {
+            {"fluxfile.source", "find"},
+            {"fluxfile.root", root_path},
+            {"fluxfile.truncated", truncated ? "true" : "false"}};
+        arrow_error_metadata(errors, metadata);
+        data = arrow_ipc_file(all, false, metadata);
+    }
+    return arrow_output(data, output_path, all.size());
 }
 
 // ============================================================================
@@ -585,7 +10289,18 @@ PYBIND11_MODULE(fast_fs, m)
         - scandir_recursive: 高速递归目录扫描
         - calculate_blake3: BLAKE3 哈希计算
         - calculate_blake3_batch: 批量并行哈希计算
+        - copy_file: 稀疏文件感知的文件复制
         - get_file_info: 获取文件详细信息
+        - stat_batch: 批量并行 statx（列式结果）
+        - resolve_id_names: 带 TTL 缓存的 uid/gid 名称解析
+        - detect_types: 基于魔数的批量 MIME 探测
+        - search_content: 并行多模式内容搜索
+        - build_line_index / read_lines: 大文本文件行索引与随机行读取
+        - tail_read: 实时跟踪文件新增内容（inotify，多客户端共享）
+        - read_range / read_heads: 返回只读 memoryview 的范围读取
+        - find: 谓词查询（名称 / 扩展名 / 大小 / 时间 / 类型 / 深度）
+        - top_files: 最大 / 最近修改的 N 个文件
+        - FilenameIndex: 可 mmap 加载、支持增量更新的三元组文件名索引，含模糊路径匹配
         
         使用示例：
         >>> import fast_fs
@@ -593,6 +10308,21 @@ PYBIND11_MODULE(fast_fs, m)
         >>> hash = fast_fs.calculate_blake3("/path/to/file")
     )doc";
 
+    // FsError -> OSError(errno, strerror, filename)
+    py::register_exception_translator([](std::exception_ptr p)
+    {
+        try
+        {
+            if (p)
+                std::rethrow_exception(p);
+        }
+        catch (const FsError &e)
+        {
+            py::tuple args = py::make_tuple(e.code(), std::string(e.what()), e.path());
+            PyErr_SetObject(PyExc_OSError, args.ptr());
+        }
+    });
+
     // 绑定 scandir_recursive 函数
     m.def("scandir_recursive", &scandir_recursive,
           R"doc(
@@ -602,6 +10332,8 @@ PYBIND11_MODULE(fast_fs, m)
                 root_path: 要扫描的根目录路径
                 max_depth: 最大递归深度，0 表示无限制（默认）
                 include_hidden: 是否包含隐藏文件（默认 False）
+                include_owner: 是否解析属主 / 属组名称（默认 False，结果有缓存）
+                priority: "interactive"（默认）或 "background"
             
             Returns:
                 文件信息字典列表，每个字典包含：
@@ -611,17 +10343,155 @@ PYBIND11_MODULE(fast_fs, m)
                 - mtime: 修改时间（Unix 时间戳）
                 - is_directory: 是否为目录
                 - is_symlink: 是否为符号链接
+                - uid / gid: 属主与属组 id
+                - owner / group: 属主与属组名称（仅 include_owner=True）
+            
+            排序（sort_by 非空时在释放 GIL 期间完成）：
+                sort_by: "name"（自然排序：忽略大小写，file2 < file10）、
+                         "size"、"mtime"、"type"；默认 "" 保持遍历顺序
+                sort_desc: 是否降序
+                dirs_first: 目录是否排在前面
+            
+            跟随符号链接（follow_symlinks=True）：
+                - 进入指向目录的符号链接，以 (st_dev, st_ino) 集合检测环路
+                - 符号链接条目的 size / mtime / is_directory 取自目标，
+                  并附加 link_target（readlink 原文）、link_broken（目标失效）、
+                  link_cycle（指向已访问目录，未进入）
+                - scope_roots 非空时，目标不在任一 scope_roots 下、或位于 exclude_paths /
+                  exclude_names 下的链接不报告目标也不进入，保留链接自身的 lstat 数据
+                  （不暴露范围外的文件是否存在及其元数据）
+            
+            挂载点（one_file_system=True 或 skip_fs_types 非空）：
+                - one_file_system: 不进入任何其他挂载点（含 bind mount）
+                - skip_fs_types: 不进入这些类型的文件系统，如 ["proc", "sysfs", "nfs"]，
+                  "fuse" 同时匹配 "fuse.sshfs" 等子类型
+                - 未进入的挂载点仍作为条目返回，附加 mount_skipped=True 与 fstype；
+                  挂载表中的挂载点不会被 stat（失联的 NFS 不会卡住扫描）
+            
+            Raises:
+                RuntimeError: 如果路径不存在或不是目录
+                ValueError: 未知的排序字段
+            
+            性能说明：
+                - 在扫描期间释放 GIL，允许其他 Python 线程执行
+                - 对于 10 万+ 文件的目录，比 os.walk() 快 3-5 倍
+                - 每个条目只计算一次排序键，排序只做字节比较
+        )doc",
+          py::arg("root_path"),
+          py::arg("max_depth") = 0,
+          py::arg("include_hidden") = false,
+          py::arg("include_owner") = false,
+          py::arg("sort_by") = "",
+          py::arg("sort_desc") = false,
+          py::arg("dirs_first") = false,
+          py::arg("follow_symlinks") = false,
+          py::arg("one_file_system") = false,
+          py::arg("skip_fs_types") = std::vector<std::string>(),
+          py::arg("priority") = "interactive",
+          py::arg("scope_roots") = std::vector<std::string>(),
+          py::arg("exclude_paths") = std::vector<std::string>(),
+          py::arg("exclude_names") = std::vector<std::string>());
+
+    m.def("list_directory_json", &list_directory_json,
+          R"doc(
+            生成 /api/fs/list 的完整响应体（JSON bytes），可直接作为 Response 返回
+            
+            与 DirectoryListResponse 模型经 FastAPI 编码（camelCase 别名）的输出逐字节一致，
+            但不为每个条目构造 pydantic 模型：扫描、排序、统计、分页与序列化
+            都在 C++ 中完成（释放 GIL）。
+            
+            Args:
+                dir_path: 目录的绝对路径（已解析）
+                root_path: 根目录的绝对路径，条目 path 为相对它的 "/..." 路径
+                display_path: 响应中的 path 字段
+                parent: 响应中的 parent 字段（None 或字符串）
+                include_hidden / include_owner / sort_by / sort_desc / dirs_first /
+                follow_symlinks: 同 scandir_recursive（只扫描一层）
+                offset: 分页偏移
+                limit: 每页条目数（0 = 不限）
+                scope_roots / exclude_paths / exclude_names: 同 scandir_recursive，
+                    范围外的链接 linkTarget 为 null
+            
+            Returns:
+                UTF-8 编码的 JSON bytes；mimeType 总是 null（需要 MIME 时走模型路径）
+        )doc",
+          py::arg("dir_path"),
+          py::arg("root_path"),
+          py::arg("display_path"),
+          py::arg("parent") = py::none(),
+          py::arg("include_hidden") = false,
+          py::arg("include_owner") = false,
+          py::arg("sort_by") = "name",
+          py::arg("sort_desc") = false,
+          py::arg("dirs_first") = true,
+          py::arg("follow_symlinks") = false,
+          py::arg("offset") = 0,
+          py::arg("limit") = 0,
+          py::arg("scope_roots") = std::vector<std::string>(),
+          py::arg("exclude_paths") = std::vector<std::string>(),
+          py::arg("exclude_names") = std::vector<std::string>());
+
+    m.def("list_directory_msgpack", &list_directory_msgpack,
+          R"doc(
+            生成 /api/fs/list 的 MessagePack 响应体（application/x-msgpack），可直接作为 Response 返回
+            
+            参数与 list_directory_json 相同。条目按列编码：名称、大小、类型各一个数组，
+            修改时间为整数秒差值序列，扩展名 / 属主 / 属组为去重字符串表加下标数组，
+            条目路径由公共前缀 base 与名称拼接。isHidden、mtimeIso 由客户端推导。
+            
+            Returns:
+                MessagePack bytes（顶层 map，v = 1）
+        )doc",
+          py::arg("dir_path"),
+          py::arg("root_path"),
+          py::arg("display_path"),
+          py::arg("parent") = py::none(),
+          py::arg("include_hidden") = false,
+          py::arg("include_owner") = false,
+          py::arg("sort_by") = "name",
+          py::arg("sort_desc") = false,
+          py::arg("dirs_first") = true,
+          py::arg("follow_symlinks") = false,
+          py::arg("offset") = 0,
+          py::arg("limit") = 0,
+          py::arg("scope_roots") = std::vector<std::string>(),
+          py::arg("exclude_paths") = std::vector<std::string>(),
+          py::arg("exclude_names") = std::vector<std::string>());
+
+    m.def("configure_listing_cache", &configure_listing_cache,
+          R"doc(
+            调整目录列表缓存（list_directory_json / list_directory_msgpack 共用），参数为 None 时保持不变
             
-            Raises:
-                RuntimeError: 如果路径不存在或不是目录
+            缓存一层扫描的结果与各排序方式（name / size / mtime / type × 升降序 × 目录优先）
+            的置换数组，大目录翻页时只按置换数组取当前页。目录的 mtime / ctime / inode 变化、
+            超过 ttl 或 invalidate_listings 时重新扫描。
             
-            性能说明：
-                - 在扫描期间释放 GIL，允许其他 Python 线程执行
-                - 对于 10 万+ 文件的目录，比 os.walk() 快 3-5 倍
+            Args:
+                max_entries: 缓存的总条目数上限，超出时淘汰最久未使用的目录
+                    （默认 200000，每个条目约 300–400 字节，合计约 60–80MB）
+                min_entries: 条目数不少于此值的目录才缓存（默认 1000）
+                ttl: 缓存有效期（秒），兜底子项内容变化；0 表示不限（默认 60）
+            
+            Returns:
+                调整后的配置字典
         )doc",
-          py::arg("root_path"),
-          py::arg("max_depth") = 0,
-          py::arg("include_hidden") = false);
+          py::arg("max_entries") = py::none(),
+          py::arg("min_entries") = py::none(),
+          py::arg("ttl") = py::none());
+
+    m.def("invalidate_listings", &invalidate_listings,
+          R"doc(
+            使这些路径本身及其父目录的缓存列表失效（创建、删除、移动、写入之后调用）
+            
+            Returns:
+                失效的缓存项数
+        )doc",
+          py::arg("paths"));
+
+    m.def("listing_cache_stats", &listing_cache_stats,
+          R"doc(
+            目录列表缓存统计：directories、entries（缓存的条目总数）、hits、misses、invalidations
+        )doc");
 
     // 绑定 calculate_blake3 函数
     m.def("calculate_blake3", &calculate_blake3,
@@ -630,7 +10500,9 @@ PYBIND11_MODULE(fast_fs, m)
             
             Args:
                 file_path: 要计算哈希的文件路径
-                chunk_size: 读取缓冲区大小（默认 1MB）
+                chunk_size: 读取缓冲区大小（0 = 按设备画像自动选择，见 device_profile）
+                priority: "interactive"（默认）或 "background"
+                limiter: 可选的 RateLimiter，限制本任务的字节 / 操作速率
             
             Returns:
                 64 字符的十六进制哈希字符串
@@ -639,12 +10511,15 @@ PYBIND11_MODULE(fast_fs, m)
                 RuntimeError: 如果文件不存在或无法读取
             
             性能说明：
-                - 使用 1MB 缓冲区减少系统调用
+                - 缓冲区随设备定位延迟放大（机械盘 / 网络挂载使用更大的块）
+                - 稀疏文件的空洞以零页参与哈希，不产生 IO
                 - 在读取和计算期间释放 GIL
                 - BLAKE3 比 SHA-256 快 5-10 倍
         )doc",
           py::arg("file_path"),
-          py::arg("chunk_size") = 1024 * 1024);
+          py::arg("chunk_size") = 0,
+          py::arg("priority") = "interactive",
+          py::arg("limiter") = py::none());
 
     // 绑定 calculate_blake3_batch 函数
     m.def("calculate_blake3_batch", &calculate_blake3_batch,
@@ -655,7 +10530,14 @@ PYBIND11_MODULE(fast_fs, m)
             
             Args:
                 file_paths: 文件路径列表
-                num_threads: 线程数，默认为 CPU 核心数
+                num_threads: 线程数，0（默认）按设备画像选择：机械盘每块成员盘 2 个，
+                    固态盘按队列深度放大，其他为 CPU 核心数
+                priority: "interactive"（默认）或 "background"；后台批次的线程使用
+                    IDLE I/O 调度类，在数据块之间让出给进行中的交互操作
+                limiter: 可选的 RateLimiter，限制本任务的字节 / 操作速率
+                order: 读取顺序。"auto"（默认）在批次包含机械盘上的文件时
+                    按第一个数据块的物理位置（FIEMAP，不支持时为 inode 号）读取；
+                    "physical" 总是排序；"none" 按输入顺序
             
             Returns:
                 字典，key 为文件路径，value 为哈希值或错误信息
@@ -664,10 +10546,40 @@ PYBIND11_MODULE(fast_fs, m)
             
             性能说明：
                 - 完全释放 GIL 进行多线程并行计算
-                - 线程数建议等于 CPU 核心数
+                - 每个文件的读取缓冲区按所在设备的校准结果选择
         )doc",
           py::arg("file_paths"),
-          py::arg("num_threads") = 0);
+          py::arg("num_threads") = 0,
+          py::arg("priority") = "interactive",
+          py::arg("limiter") = py::none(),
+          py::arg("order") = "auto");
+
+    // 绑定 copy_file 函数
+    m.def("copy_file", &copy_file,
+          R"doc(
+            复制单个文件，保留稀疏文件空洞
+            
+            Args:
+                src_path: 源文件路径
+                dst_path: 目标文件路径（已存在时覆盖）
+                preserve_metadata: 是否保留扩展属性、权限位与访问/修改时间（默认 True，
+                    同 shutil.copy2：不支持或无权设置的扩展属性被跳过）
+            
+            Returns:
+                字典：size（文件大小）、bytes_copied（实际复制的数据字节）、
+                holes_skipped（跳过的空洞字节）
+            
+            Raises:
+                RuntimeError: 如果源文件不是普通文件、目标与源是同一文件
+                    （同一路径或硬链接，此时不会截断源文件）或读写失败
+            
+            性能说明：
+                - 通过 SEEK_DATA/SEEK_HOLE 只复制数据段，空洞不读不写
+                - Linux 上使用 copy_file_range，支持时可走 reflink
+        )doc",
+          py::arg("src_path"),
+          py::arg("dst_path"),
+          py::arg("preserve_metadata") = true);
 
     // 绑定 get_file_info 函数
     m.def("get_file_info", &get_file_info,
@@ -678,13 +10590,768 @@ PYBIND11_MODULE(fast_fs, m)
                 file_path: 文件路径
             
             Returns:
-                包含详细文件信息的字典
+                包含详细文件信息的字典，除类型 / 大小 / 时间 / 权限外还包括
+                uid、gid、inode、dev、nlink、blocks、btime（不支持时为 None）
+                以及当前进程的 is_readable / is_writable / is_executable
             
             Raises:
-                RuntimeError: 如果路径不存在
+                FileNotFoundError: 如果路径不存在
+                OSError: 其他 stat 错误（如 PermissionError）
+            
+            性能说明：
+                - 普通文件只需一次 statx，符号链接再多一次
         )doc",
           py::arg("file_path"));
 
+    // 绑定 stat_batch 函数
+    m.def("stat_batch", &stat_batch,
+          R"doc(
+            批量获取文件元数据，返回列式结果
+            
+            Args:
+                paths: 路径列表
+                fields: 字段列表，可选 type / mode / size / mtime / atime / ctime /
+                        btime / uid / gid / ino / dev / nlink / blocks / realpath；
+                        为空时返回 type / size / mtime
+                follow_symlinks: 是否跟随符号链接（默认 True，同 os.stat）
+                num_threads: 线程数，默认为 CPU 核心数
+            
+            Returns:
+                字典，每个字段对应一个与 paths 等长的列表，另有 "error" 列：
+                {"type": [...], "size": [...], "error": [None, "No such file or directory", ...]}
+                失败行的字段值为 None
+            
+            Raises:
+                ValueError: 如果包含未知字段
+            
+            性能说明：
+                - 每个路径一次 statx，只请求所需字段
+                - 在工作线程池中并行执行，完全释放 GIL
+        )doc",
+          py::arg("paths"),
+          py::arg("fields") = std::vector<std::string>{},
+          py::arg("follow_symlinks") = true,
+          py::arg("num_threads") = 0);
+
+    // 绑定 uid/gid 名称缓存
+    m.def("resolve_id_names", &resolve_id_names,
+          R"doc(
+            批量解析 uid / gid 对应的用户名和组名
+            
+            Args:
+                uids: uid 列表
+                gids: gid 列表
+            
+            Returns:
+                {"users": {uid: name}, "groups": {gid: name}}
+                无法解析的 id 返回其数字字符串（与 ls 一致）
+            
+            性能说明：
+                - 结果缓存在进程级 IdNameCache 中（默认 TTL 300 秒）
+                - NSS 查询在锁外执行，不阻塞并发扫描
+        )doc",
+          py::arg("uids") = std::vector<uint32_t>{},
+          py::arg("gids") = std::vector<uint32_t>{});
+
+    m.def("set_id_cache_ttl", [](double seconds)
+          { IdNameCache::instance().set_ttl(seconds); },
+          "设置 uid/gid 名称缓存的 TTL（秒），0 表示每次都重新解析",
+          py::arg("seconds"));
+
+    m.def("clear_id_cache", []()
+          { IdNameCache::instance().clear(); },
+          "清空 uid/gid 名称缓存（如修改了 LDAP 中的用户名后）");
+
+    // 绑定 detect_types 函数
+    m.def("detect_types", &detect_types,
+          R"doc(
+            根据文件头魔数批量探测 MIME 类型
+            
+            Args:
+                paths: 路径列表
+                sniff_bytes: 每个文件读取的字节数（默认 4096）
+                num_threads: 线程数，默认为 CPU 核心数
+            
+            Returns:
+                与 paths 等长的列表，元素为 MIME 字符串：
+                - 命中签名表：如 "image/png"、"application/pdf"
+                - 文本文件："text/plain"、"text/html"、"application/json" 等
+                - 空文件："inode/x-empty"；目录："inode/directory"
+                - 无法识别的二进制："application/octet-stream"
+                - 无法打开：None
+            
+            性能说明：
+                - 并行 pread 文件头，签名表编译为前缀树一次匹配
+                - 不依赖扩展名，无扩展名文件同样可靠
+        )doc",
+          py::arg("paths"),
+          py::arg("sniff_bytes") = 4096,
+          py::arg("num_threads") = 0);
+
+    m.def("search_content", &search_content,
+          R"doc(
+            在目录树中并行搜索文件内容（多模式字面量匹配）
+            
+            Args:
+                root_path: 搜索根目录
+                patterns: 字面量模式列表，任一命中即记为匹配
+                ignore_case: 是否忽略 ASCII 大小写（默认 False）
+                max_matches_per_file: 单个文件最多记录的匹配数（默认 100）
+                max_results: 总匹配数上限，达到后提前结束（默认 10000）
+                max_file_size: 跳过大于此字节数的文件，0 表示不限制
+                include_hidden: 是否搜索隐藏文件 / 目录（默认 False）
+                max_depth: 最大递归深度，0 表示无限制
+                num_threads: 线程数，默认为 CPU 核心数
+                priority: "interactive"（默认）或 "background"
+                limiter: 可选的 RateLimiter，限制本任务的字节 / 操作速率
+                exclude_paths: 不进入的绝对路径列表（自身及其下所有条目）
+                exclude_names: 不进入 / 不搜索的文件名列表（匹配任意层级的同名目录与文件）
+            
+            Returns:
+                字典：
+                - matches: 匹配列表（按路径、偏移排序），每项包含
+                  path / line（从 1 开始）/ column（字节）/ offset / pattern / text（所在行）
+                - files_scanned / files_matched / bytes_scanned: 统计
+                - truncated: 是否因 max_results 提前结束
+                - errors: 无法读取的目录
+            
+            Raises:
+                ValueError: patterns 为空、包含空字符串、单个模式超过 512KB
+                    或模式总长超过 64KB
+                OSError: 根目录不存在
+                RuntimeError: 根路径不是目录
+            
+            性能说明：
+                - 遍历与匹配在同一批工作线程中进行，全部核心参与
+                - 模式编译为 Aho-Corasick DFA，SIMD 首字节预过滤跳过无关字节
+                - 按 1MB 分块 pread（扫描中文件被截断不会崩溃）；前 8KB 含 NUL 的二进制文件被跳过
+                - exclude_paths / exclude_names 命中的目录在遍历时剪枝，其内容不会被读取
+        )doc",
+          py::arg("root_path"),
+          py::arg("patterns"),
+          py::arg("ignore_case") = false,
+          py::arg("max_matches_per_file") = 100,
+          py::arg("max_results") = 10000,
+          py::arg("max_file_size") = 0,
+          py::arg("include_hidden") = false,
+          py::arg("max_depth") = 0,
+          py::arg("num_threads") = 0,
+          py::arg("priority") = "interactive",
+          py::arg("limiter") = py::none(),
+          py::arg("exclude_paths") = std::vector<std::string>(),
+          py::arg("exclude_names") = std::vector<std::string>());
+
+    m.def("build_line_index", &build_line_index,
+          R"doc(
+            构建或增量更新文本文件的稀疏行索引
+            
+            Args:
+                file_path: 文本文件路径
+                index_path: 索引文件路径，为空时只缓存在进程内（默认）
+                stride: 检查点间隔行数（默认 1000）
+            
+            Returns:
+                字典：total_lines、indexed_size、checkpoints、stride、
+                rebuilt（是否从头重建）、scanned_bytes（本次扫描字节数）
+            
+            性能说明：
+                - 按 4MB 分块 pread（文件被截短时不会 SIGBUS），
+                  SIMD（AVX2 / SSE2）统计换行
+                - 文件只是追加增长时只扫描新增部分；
+                  inode 变化或内容被截断 / 重写时自动重建
+        )doc",
+          py::arg("file_path"),
+          py::arg("index_path") = "",
+          py::arg("stride") = 1000);
+
+    m.def("read_lines", &read_lines,
+          R"doc(
+            读取文本文件中任意位置的一段行
+            
+            Args:
+                file_path: 文本文件路径
+                first_line: 起始行号（从 1 开始）
+                count: 行数
+                index_path: 索引文件路径，为空时只缓存在进程内（默认）
+                stride: 检查点间隔行数（默认 1000）
+                max_line_length: 单行最多返回的字节数（默认 64KB），超出部分截断
+            
+            Returns:
+                字典：first_line、lines（字符串列表，不含换行符；
+                读取量达到 count * max_line_length 时可能少于 count 行）、
+                offset（首行字节偏移）、total_lines、indexed_size
+            
+            Raises:
+                OSError: 文件无法打开
+                RuntimeError: 不是普通文件
+            
+            性能说明：
+                - 先增量更新行索引，再由检查点确定覆盖目标行的窗口，按 256KB 分块 pread 读取
+                - 内存占用与 count * max_line_length 成正比，与检查点窗口大小无关
+                - 读取第 1000 万行与读取第 1 行代价相同
+        )doc",
+          py::arg("file_path"),
+          py::arg("first_line"),
+          py::arg("count"),
+          py::arg("index_path") = "",
+          py::arg("stride") = 1000,
+          py::arg("max_line_length") = 64 * 1024);
+
+    m.def("clear_line_index_cache", []()
+          { LineIndexCache::instance().clear(); },
+          "清空进程内的行索引缓存（索引文件不受影响）");
+
+    m.def("tail_read", &tail_read,
+          R"doc(
+            读取文件在 offset 之后新增的内容，没有新内容时阻塞等待（tail -f）
+            
+            Args:
+                file_path: 文件路径
+                offset: 起始偏移；负数表示从末尾倒数 |offset| 字节开始
+                inode: 上一次返回的 inode，首次调用传 0
+                timeout: 最长等待秒数（默认 30）
+                max_bytes: 单次最多返回的字节数（默认 1MB）
+                batch_ms: 收到变更后再等待的毫秒数，用于合并连续小写入（默认 50）
+            
+            Returns:
+                字典：
+                - data: 新增字节（超时为空）
+                - offset / inode: 下一次调用应传入的值
+                - size: 当前文件大小
+                - rotated: 路径已指向新文件（日志轮转），data 从新文件开头读取
+                - truncated: 文件被截断，data 从开头读取
+            
+            性能说明：
+                - 等待期间释放 GIL
+                - 同一路径的所有客户端共享一个 fd、一组 inotify watch 与最近读取缓存
+                - 每次调用都会取得并释放 watch；持续跟踪请使用 TailSubscription
+        )doc",
+          py::arg("file_path"),
+          py::arg("offset") = 0,
+          py::arg("inode") = 0,
+          py::arg("timeout") = 30.0,
+          py::arg("max_bytes") = 1024 * 1024,
+          py::arg("batch_ms") = 50);
+
+    py::class_<TailSubscription>(m, "TailSubscription",
+                                 R"doc(
+            持续跟踪一个文件：订阅期间保持 fd 与 inotify watch
+            
+            示例：
+                >>> sub = fast_fs.TailSubscription("/var/log/syslog")
+                >>> chunk = sub.read(offset=-4096)
+                >>> chunk = sub.read(chunk["offset"], chunk["inode"])
+                >>> sub.close()
+        )doc")
+        .def(py::init([](const std::string &file_path)
+        {
+            py::gil_scoped_release release;
+            return new TailSubscription(file_path);
+        }),
+             py::arg("file_path"))
+        .def("read", &TailSubscription::read,
+             "同 tail_read，但复用订阅持有的 fd 与 watch",
+             py::arg("offset") = 0,
+             py::arg("inode") = 0,
+             py::arg("timeout") = 30.0,
+             py::arg("max_bytes") = 1024 * 1024,
+             py::arg("batch_ms") = 50)
+        .def("close", [](TailSubscription &sub)
+        {
+            py::gil_scoped_release release;
+            sub.close();
+        },
+             "释放 fd 与 watch（可重复调用）")
+        .def_property_readonly("closed", &TailSubscription::closed);
+
+    // ReadBuffer：read_range / read_heads 返回的 memoryview 的底层对象
+    py::class_<ReadBuffer>(m, "ReadBuffer", py::buffer_protocol(),
+                           "只读字节缓冲区（池化内存），通过 memoryview 访问")
+        .def_buffer([](ReadBuffer &buffer) -> py::buffer_info
+        {
+            return py::buffer_info(
+                const_cast<uint8_t *>(buffer.data()),
+                sizeof(uint8_t),
+                py::format_descriptor<uint8_t>::format(),
+                1,
+                {static_cast<ssize_t>(buffer.size())},
+                {static_cast<ssize_t>(1)},
+                true); // readonly
+        })
+        .def("__len__", &ReadBuffer::size);
+
+    m.def("read_range", &read_range,
+          R"doc(
+            读取文件的一个字节范围，返回只读 memoryview（不复制为 bytes）
+            
+            Args:
+                file_path: 文件路径
+                offset: 起始偏移
+                length: 最大长度，超出文件末尾的部分被截掉
+            
+            Returns:
+                只读 memoryview；offset 超出文件末尾时长度为 0
+            
+            Raises:
+                OSError: 文件无法打开
+                RuntimeError: 不是普通文件
+            
+            性能说明：
+                - 释放 GIL 后 pread 到池化缓冲区，memoryview 直接指向该缓冲区，
+                  最后一个引用释放时缓冲区归还到池
+                - 不使用 mmap：文件在响应发送前被截短也不会触发 SIGBUS
+        )doc",
+          py::arg("file_path"),
+          py::arg("offset"),
+          py::arg("length"));
+
+    m.def("read_heads", &read_heads,
+          R"doc(
+            批量读取多个文件的开头，用于列表悬停预览
+            
+            Args:
+                paths: 路径列表
+                length: 每个文件读取的字节数（默认 4096）
+                num_threads: 线程数，默认为 CPU 核心数
+            
+            Returns:
+                与 paths 等长的列表，元素为只读 memoryview；
+                无法读取或不是普通文件时为 None
+            
+            性能说明：
+                - 并行 pread 到同一块池化缓冲区，每个结果都是它的切片
+        )doc",
+          py::arg("paths"),
+          py::arg("length") = 4096,
+          py::arg("num_threads") = 0);
+
+    m.def("find", &find,
+          R"doc(
+            按谓词查询目录树（类似 find(1)），查询在 C++ 遍历线程中求值
+            
+            Args:
+                root_path: 根目录
+                query: 查询字典，None 匹配所有条目。同一字典中的多个键为 AND：
+                    - name / iname / path: glob（path 相对根目录）
+                    - regex: 文件名正则
+                    - ext: 扩展名或扩展名列表（忽略大小写，可带点）
+                    - size / mtime / depth: 数字或 {"gt", "gte", "lt", "lte"}；
+                      mtime 为 Unix 时间戳，depth 以根目录的直接子项为 1
+                    - type: "file" / "directory" / "symlink" / ...
+                    - and / or: 子查询列表；not: 子查询
+                prune: 剪枝谓词（语法同 query），匹配的目录不再进入
+                include_hidden: 是否包含隐藏条目（默认 False）
+                limit: 最多返回的条目数，0 表示不限制
+                num_threads: 线程数，默认为 CPU 核心数
+                one_file_system: 不进入其他文件系统（挂载点）
+                skip_fs_types: 不进入这些类型的文件系统，如 ["proc", "nfs"]
+                priority: "interactive"（默认）或 "background"
+                limiter: 可选的 RateLimiter，限制本任务的字节 / 操作速率
+                exclude_paths: 不进入的绝对路径列表（自身及其下所有条目），不计入 limit
+                exclude_names: 不进入 / 不匹配的文件名列表（任意层级）
+            
+            Returns:
+                字典：entries（与 scandir_recursive 相同的字典列表，按路径排序）、
+                truncated（是否因 limit 提前结束）、errors、
+                skipped_mounts（未进入的挂载点：[{"path", "fstype"}, ...]）
+            
+            Raises:
+                ValueError: 查询包含未知的键、类型或非法正则
+            
+            示例：
+                >>> week_ago = time.time() - 7 * 86400
+                >>> fast_fs.find("/projects", {"ext": "mp4", "size": {"gt": 1 << 30},
+                ...                            "mtime": {"gte": week_ago}})
+            
+            性能说明：
+                - 不匹配的条目不会被构造为 Python 对象
+                - 查询不涉及 size / mtime 时只依赖 d_type，不对每个条目 lstat
+                - depth 上限与 prune 在目录层面剪枝整棵子树
+        )doc",
+          py::arg("root_path"),
+          py::arg("query") = py::none(),
+          py::arg("prune") = py::none(),
+          py::arg("include_hidden") = false,
+          py::arg("limit") = 0,
+          py::arg("num_threads") = 0,
+          py::arg("one_file_system") = false,
+          py::arg("skip_fs_types") = std::vector<std::string>(),
+          py::arg("priority") = "interactive",
+          py::arg("limiter") = py::none(),
+          py::arg("exclude_paths") = std::vector<std::string>(),
+          py::arg("exclude_names") = std::vector<std::string>());
+
+    m.def("scandir_arrow", &scandir_arrow,
+          R"doc(
+            递归扫描目录并导出为 Arrow IPC 文件格式（Feather v2），不依赖 pyarrow
+            
+            扫描参数与 scandir_recursive 相同，但结果不构造 Python 字典，
+            适合整树扫描后交给 pandas / polars / DuckDB 分析。
+            
+            列：
+                path, name: utf8（无效的 UTF-8 字节替换为 U+FFFD）
+                size: int64
+                mtime: timestamp[ns, tz=UTC]
+                is_directory, is_symlink: bool
+                extension: dictionary<int32, utf8>（仅普通文件，无扩展名为 ""，其余为 null）
+                uid, gid: uint32
+                owner, group: dictionary<int32, utf8>（仅 include_owner 时）
+            
+            无法访问的条目不会中断扫描：错误数记录在 schema 元数据 fluxfile.errors 中，
+            前 100 条错误信息以 JSON 数组记录在 fluxfile.error_list 中。
+            
+            Args:
+                root_path: 要扫描的根目录
+                output_path: 输出文件路径（原子写入）；为空时直接返回 bytes
+                limiter: 可选的 RateLimiter（每个条目计一次操作）
+                其余参数同 scandir_recursive
+            
+            Returns:
+                output_path 为空时返回 bytes，否则返回写入的行数
+            
+            示例：
+                >>> fast_fs.scandir_arrow("/data", "/tmp/scan.arrow")
+                >>> table = pyarrow.ipc.open_file(pyarrow.memory_map("/tmp/scan.arrow")).read_all()
+        )doc",
+          py::arg("root_path"),
+          py::arg("output_path") = "",
+          py::arg("max_depth") = 0,
+          py::arg("include_hidden") = false,
+          py::arg("include_owner") = false,
+          py::arg("sort_by") = "",
+          py::arg("sort_desc") = false,
+          py::arg("dirs_first") = false,
+          py::arg("follow_symlinks") = false,
+          py::arg("one_file_system") = false,
+          py::arg("skip_fs_types") = std::vector<std::string>(),
+          py::arg("priority") = "interactive",
+          py::arg("limiter") = py::none());
+
+    m.def("find_arrow", &find_arrow,
+          R"doc(
+            按谓词查询目录树并导出为 Arrow IPC 文件格式（列同 scandir_arrow，不含 owner / group）
+            
+            查询参数与 find 相同，行按路径排序。是否因 limit 提前结束记录在
+            schema 元数据 fluxfile.truncated 中（"true" / "false"），遍历错误同
+            scandir_arrow 记录在 fluxfile.errors / fluxfile.error_list 中。
+            
+            Args:
+                root_path: 根目录
+                query / prune: 同 find
+                output_path: 输出文件路径（原子写入）；为空时直接返回 bytes
+                其余参数同 find
+            
+            Returns:
+                output_path 为空时返回 bytes，否则返回写入的行数
+        )doc",
+          py::arg("root_path"),
+          py::arg("query") = py::none(),
+          py::arg("prune") = py::none(),
+          py::arg("output_path") = "",
+          py::arg("include_hidden") = false,
+          py::arg("limit") = 0,
+          py::arg("num_threads") = 0,
+          py::arg("one_file_system") = false,
+          py::arg("skip_fs_types") = std::vector<std::string>(),
+          py::arg("priority") = "interactive",
+          py::arg("limiter") = py::none(),
+          py::arg("exclude_paths") = std::vector<std::string>(),
+          py::arg("exclude_names") = std::vector<std::string>());
+
+    m.def("top_files", &top_files,
+          R"doc(
+            找出目录树中最大或最近修改的 N 个普通文件
+            
+            Args:
+                root_path: 根目录
+                n: 返回的条目数
+                key: "size"（默认）或 "mtime"
+                include_hidden: 是否包含隐藏条目（默认 False）
+                num_threads: 线程数，默认为 CPU 核心数
+                priority: "interactive"（默认）或 "background"
+                limiter: 可选的 RateLimiter，限制本任务的字节 / 操作速率
+                exclude_paths: 不进入的绝对路径列表（自身及其下所有条目）
+                exclude_names: 不进入 / 不计入的文件名列表（任意层级）
+            
+            Returns:
+                与 scandir_recursive 相同的字典列表，按 key 降序
+            
+            性能说明：
+                - 并行遍历，每个线程维护容量为 n 的有界堆，结束时合并
+                - 内存占用 O(n)，与目录树规模无关
+                - 排除项在遍历时剪枝，不会占用前 n 名的位置
+        )doc",
+          py::arg("root_path"),
+          py::arg("n"),
+          py::arg("key") = "size",
+          py::arg("include_hidden") = false,
+          py::arg("num_threads") = 0,
+          py::arg("priority") = "interactive",
+          py::arg("limiter") = py::none(),
+          py::arg("exclude_paths") = std::vector<std::string>(),
+          py::arg("exclude_names") = std::vector<std::string>());
+
+    py::class_<FilenameIndex>(m, "FilenameIndex",
+                              "三元组文件名索引：子串 / glob 查询，可持久化并 mmap 加载")
+        .def_static("build", [](const std::string &root_path, bool include_hidden, int num_threads,
+                                bool one_file_system, const std::vector<std::string> &skip_fs_types,
+                                const std::string &priority, std::shared_ptr<RateLimiter> limiter)
+        {
+            const IoPriority io_priority = parse_io_priority(priority);
+            py::gil_scoped_release release;
+            IoPriorityScope priority_scope(io_priority);
+            RateLimitScope limit_scope(limiter.get());
+            return FilenameIndex::build(root_path, include_hidden, num_threads,
+                                        one_file_system, skip_fs_types);
+        },
+             R"doc(
+            并行遍历目录树构建索引
+            
+            Args:
+                root_path: 根目录
+                include_hidden: 是否包含隐藏条目（默认 False）
+                num_threads: 线程数，默认为 CPU 核心数
+                one_file_system: 不进入其他文件系统（挂载点）
+                skip_fs_types: 不进入这些类型的文件系统
+                priority: "interactive"（默认）或 "background"（IDLE I/O 调度类，
+                    让交互操作先行）
+                limiter: 可选的 RateLimiter
+        )doc",
+             py::arg("root_path"),
+             py::arg("include_hidden") = false,
+             py::arg("num_threads") = 0,
+             py::arg("one_file_system") = false,
+             py::arg("skip_fs_types") = std::vector<std::string>(),
+             py::arg("priority") = "interactive",
+             py::arg("limiter") = py::none())
+        .def_static("load", [](const std::string &index_path)
+        {
+            py::gil_scoped_release release;
+            return FilenameIndex::load(index_path);
+        },
+             "mmap 加载 save 写出的索引文件",
+             py::arg("index_path"))
+        .def("save", [](const FilenameIndex &index, const std::string &index_path)
+        {
+            py::gil_scoped_release release;
+            index.save(index_path);
+        },
+             "合并增量更新并写出索引文件（原子替换）",
+             py::arg("index_path"))
+        .def("search", [](const FilenameIndex &index, const std::string &query, size_t limit, bool ignore_case,
+                          const std::string &under)
+        {
+            py::gil_scoped_release release;
+            return index.search(query, limit, ignore_case, under);
+        },
+             R"doc(
+            查询文件名包含 query 的条目
+            
+            Args:
+                query: 子串（少于 3 个字节时退化为线性扫描）
+                limit: 最大返回数，0 表示不限制（默认 1000）
+                ignore_case: 是否忽略 ASCII 大小写（默认 True）
+                under: 只返回该目录（绝对路径）下的条目，在计入 limit 之前过滤；
+                    为空表示整个索引（默认）
+            
+            Returns:
+                完整路径列表
+        )doc",
+             py::arg("query"),
+             py::arg("limit") = 1000,
+             py::arg("ignore_case") = true,
+             py::arg("under") = "")
+        .def("glob", [](const FilenameIndex &index, const std::string &pattern, size_t limit, bool ignore_case,
+                        const std::string &under)
+        {
+            py::gil_scoped_release release;
+            return index.glob(pattern, limit, ignore_case, under);
+        },
+             "按 fnmatch 模式匹配文件名，模式中长度不少于 3 的字面量片段用于倒排筛选；under 同 search",
+             py::arg("pattern"),
+             py::arg("limit") = 1000,
+             py::arg("ignore_case") = true,
+             py::arg("under") = "")
+        .def("fuzzy", [](const FilenameIndex &index, const std::string &query, size_t limit, int num_threads)
+        {
+            std::vector<FilenameIndex::FuzzyMatch> matches;
+            {
+                py::gil_scoped_release release;
+                matches = index.fuzzy(query, limit, num_threads);
+            }
+            py::list result;
+            for (const auto &match : matches)
+            {
+                py::dict item;
+                item["path"] = match.path;
+                item["score"] = match.score;
+                item["positions"] = match.positions;
+                result.append(item);
+            }
+            return result;
+        },
+             R"doc(
+            模糊匹配路径（子序列匹配，quick-open）
+            
+            Args:
+                query: 查询串；含大写字母时区分大小写
+                limit: 返回的最佳结果数（默认 50）
+                num_threads: 线程数，默认为 CPU 核心数
+            
+            Returns:
+                按分数降序的字典列表：path（绝对路径）、score、
+                positions（匹配字符在 path 中的下标，可直接用于高亮）
+            
+            性能说明：
+                - 路径字符掩码批量剔除（AVX2），只对可能匹配的条目评分
+                - 并行评分，每个线程维护有界堆
+        )doc",
+             py::arg("query"),
+             py::arg("limit") = 50,
+             py::arg("num_threads") = 0)
+        .def("add", [](FilenameIndex &index, const std::vector<std::string> &paths, bool recursive)
+        {
+            py::gil_scoped_release release;
+            return index.add(paths, recursive);
+        },
+             "加入新建 / 移入的路径（缺失的父目录一并加入；索引不含隐藏条目时跳过隐藏路径），返回新增条目数",
+             py::arg("paths"),
+             py::arg("recursive") = true)
+        .def("remove", [](FilenameIndex &index, const std::vector<std::string> &paths)
+        {
+            py::gil_scoped_release release;
+            return index.remove(paths);
+        },
+             "移除已删除 / 移出的路径（目录连同其子孙），返回移除条目数",
+             py::arg("paths"))
+        .def("stats", &FilenameIndex::stats, "索引统计信息")
+        .def_property_readonly("root", &FilenameIndex::root)
+        .def_property_readonly("include_hidden", &FilenameIndex::include_hidden,
+                               "build 时是否包含隐藏条目（随索引保存，add 沿用）")
+        .def("__len__", &FilenameIndex::live_count);
+
+    m.def("configure_io_governor", &configure_io_governor,
+          R"doc(
+            调整按设备（st_dev）的 I/O 并发调控，参数为 None 时保持不变
+            
+            并行遍历（scandir_recursive / find / search_content 等）的每个目录、
+            calculate_blake3_batch 的每个文件都会占用所在设备的一个槽位。
+            只调控网络 / FUSE 文件系统（NFS、SMB、sshfs 等）所在的设备，
+            本地磁盘不受限制（set_device_io_limit 固定的设备除外）。
+            每个设备按延迟窗口自适应：从 4 个并发起步，槽位用尽且延迟平稳时
+            翻倍（慢启动）/ 加 1，p99 超过基线 backoff_ratio 倍时乘以 3/4。
+            
+            Args:
+                default_limit: 每个设备的最大并发数，<= 0 关闭调控（默认 32）
+                min_limit: 自适应回退的下限（默认 1）
+                adaptive: 是否依据延迟调整（默认 True）
+                backoff_ratio: p99 超过基线多少倍时回退（默认 2.0）
+            
+            Returns:
+                调整后的配置字典
+        )doc",
+          py::arg("default_limit") = py::none(),
+          py::arg("min_limit") = py::none(),
+          py::arg("adaptive") = py::none(),
+          py::arg("backoff_ratio") = py::none());
+
+    m.def("set_device_io_limit", &set_device_io_limit,
+          R"doc(
+            固定 path 所在设备的并发上限（不参与自适应），limit <= 0 恢复自适应
+            
+            例如把慢速 NFS 挂载限制为 4 个并发操作：
+                >>> fast_fs.set_device_io_limit("/mnt/nas", 4)
+        )doc",
+          py::arg("path"),
+          py::arg("limit"));
+
+    m.def("io_governor_stats", &io_governor_stats,
+          R"doc(
+            各设备的调控状态
+            
+            Returns:
+                字典列表：dev、device（"major:minor"）、limit、in_flight、
+                governed（是否领取槽位：网络 / FUSE 设备或已固定上限）、pinned、
+                ops、background_ops、waits、wait_ms、p99_ms、baseline_p99_ms、backoffs
+        )doc");
+
+    m.def("device_profile", &device_profile,
+          R"doc(
+            path 所在设备的画像（自动调优使用的线程数与缓冲区大小）
+            
+            首次遇到设备时读取 /sys/block 的 rotational / nr_requests；
+            path 是不小于 16MB 的普通文件且设备尚未校准（或校准已超过 10 分钟）时，
+            先用它做一次简短校准（随机 4KB 读延迟 + 4MB 顺序读带宽，绕过页缓存）
+            来确定缓冲区大小。
+            
+            Returns:
+                字典：dev、device、block_device、rotational（未知时为 None）、
+                nr_requests、members、threads、buffer_size、calibrated、
+                calibration_age_s（未校准时为 None）、direct_io（校准是否使用 O_DIRECT）、
+                probe_latency_ms、read_mb_per_sec
+            
+            Raises:
+                OSError: path 无法打开
+        )doc",
+          py::arg("path"));
+
+    m.def("device_profiles", &device_profiles,
+          R"doc(
+            已缓存的全部设备画像（字段同 device_profile）
+        )doc");
+
+    py::class_<RateLimiter, std::shared_ptr<RateLimiter>>(m, "RateLimiter",
+                                                          R"doc(
+            字节 / IOPS 双令牌桶限速器，可附加到批量任务（limiter= 参数）
+            
+            同一个限速器可同时附加到多个任务，它们共享配额；
+            速率可在任务运行期间通过 set_rates 调整。
+            
+            示例：
+                >>> limiter = fast_fs.RateLimiter(bytes_per_sec=50 << 20)
+                >>> fast_fs.calculate_blake3_batch(paths, priority="background", limiter=limiter)
+                >>> limiter.set_rates(bytes_per_sec=200 << 20)  # 另一个线程中放宽
+                >>> limiter.stats()["bytes_per_sec"]
+        )doc")
+        .def(py::init<double, double, double>(),
+             py::arg("bytes_per_sec") = 0.0,
+             py::arg("iops") = 0.0,
+             py::arg("burst_seconds") = 1.0)
+        .def("set_rates", [](RateLimiter &limiter, const py::object &bytes_per_sec, const py::object &iops)
+        {
+            limiter.set_rates(bytes_per_sec.is_none() ? limiter.bytes_per_sec() : bytes_per_sec.cast<double>(),
+                              iops.is_none() ? limiter.iops() : iops.cast<double>());
+        },
+             "调整速率（None 保持不变，<= 0 表示不限制）",
+             py::arg("bytes_per_sec") = py::none(),
+             py::arg("iops") = py::none())
+        .def_property_readonly("bytes_per_sec", &RateLimiter::bytes_per_sec)
+        .def_property_readonly("iops", &RateLimiter::iops)
+        .def("stats", [](const RateLimiter &limiter)
+        {
+            const RateLimiter::Stats st = limiter.stats();
+            const double seconds = static_cast<double>(st.elapsed_ns) / 1e9;
+            py::dict d;
+            d["bytes"] = st.bytes;
+            d["ops"] = st.ops;
+            d["elapsed"] = seconds;
+            d["bytes_per_sec"] = seconds > 0 ? static_cast<double>(st.bytes) / seconds : 0.0;
+            d["iops"] = seconds > 0 ? static_cast<double>(st.ops) / seconds : 0.0;
+            d["throttled_ms"] = static_cast<double>(st.throttled_ns) / 1e6;
+            d["waits"] = st.waits;
+            d["limit_bytes_per_sec"] = limiter.bytes_per_sec();
+            d["limit_iops"] = limiter.iops();
+            return d;
+        },
+             R"doc(
+            实际达到的速率（第一次领取至今的平均值）
+            
+            Returns:
+                字典：bytes、ops、elapsed（秒）、bytes_per_sec、iops、
+                throttled_ms（各线程累计等待）、waits、limit_bytes_per_sec、limit_iops
+        )doc")
+        .def("reset_stats", &RateLimiter::reset_stats, "清零统计（重新开始计算平均速率）");
+
     // 版本信息
     m.attr("__version__") = "1.0.0";
     m.attr("__author__") = "FluxFile Team";
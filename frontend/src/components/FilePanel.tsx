@@ -13,6 +13,7 @@ import { VirtualFileTable } from '@/components/VirtualFileTable';
 import { useLocalFileSystem } from '@/hooks/useLocalFileSystem';
 import { useFileStore, usePane } from '@/stores/fileStore';
 import { cn } from '@/utils/cn';
+import { decodeDirectoryListing, MSGPACK_MEDIA_TYPE } from '@/utils/msgpack';
 import type { PanelId, FileEntry } from '@/types';
 
 // ============================================================================
@@ -22,12 +23,18 @@ import type { PanelId, FileEntry } from '@/types';
 const API_BASE = '/api';
 
 async function fetchRemoteDirectory(path: string): Promise<FileEntry[]> {
-    const response = await fetch(`${API_BASE}/fs/list?path=${encodeURIComponent(path)}`);
+    // 优先请求列式 MessagePack（体积远小于 JSON）；后端不可用 fast_fs 时仍返回 JSON
+    const response = await fetch(`${API_BASE}/fs/list?path=${encodeURIComponent(path)}`, {
+        headers: { Accept: `${MSGPACK_MEDIA_TYPE}, application/json;q=0.9` },
+    });
 
     if (!response.ok) {
         throw new Error(`HTTP ${response.status}: ${response.statusText}`);
     }
 
+    if (response.headers.get('Content-Type')?.startsWith(MSGPACK_MEDIA_TYPE)) {
+        return decodeDirectoryListing(await response.arrayBuffer()).entries;
+    }
     const data = await response.json();
     return data.entries as FileEntry[];
 }
@@ -0,0 +1,134 @@
+/**
+ * MessagePack 目录列表解码
+ * ==========================
+ *
+ * 解码 /api/fs/list 以 application/x-msgpack 返回的列式响应
+ * （后端 fast_fs.list_directory_msgpack），还原为 DirectoryListing。
+ *
+ * 只实现列表用到的类型：nil / bool / 整数 / str / array / map。
+ */
+
+import type { DirectoryListing, FileEntry, FileType } from '@/types';
+
+/** 列表响应的二进制媒体类型 */
+export const MSGPACK_MEDIA_TYPE = 'application/x-msgpack';
+
+type MsgPackValue = null | boolean | number | string | MsgPackValue[] | { [key: string]: MsgPackValue };
+
+const textDecoder = new TextDecoder();
+
+/**
+ * 解码一个 MessagePack 值
+ *
+ * 64 位整数按 Number 返回（文件大小 / 时间戳不会超过 2^53）
+ */
+export function decodeMsgPack(buffer: ArrayBuffer): MsgPackValue {
+    const bytes = new Uint8Array(buffer);
+    const view = new DataView(buffer);
+    let pos = 0;
+
+    const readString = (length: number): string => {
+        const value = textDecoder.decode(bytes.subarray(pos, pos + length));
+        pos += length;
+        return value;
+    };
+
+    const readArray = (length: number): MsgPackValue[] => {
+        const items = new Array<MsgPackValue>(length);
+        for (let i = 0; i < length; i++) {
+            items[i] = read();
+        }
+        return items;
+    };
+
+    const readMap = (length: number): { [key: string]: MsgPackValue } => {
+        const map: { [key: string]: MsgPackValue } = {};
+        for (let i = 0; i < length; i++) {
+            const key = read() as string;
+            map[key] = read();
+        }
+        return map;
+    };
+
+    const read = (): MsgPackValue => {
+        const type = bytes[pos++];
+        if (type < 0x80) return type;
+        if (type >= 0xe0) return type - 0x100;
+        if ((type & 0xe0) === 0xa0) return readString(type & 0x1f);
+        if ((type & 0xf0) === 0x90) return readArray(type & 0x0f);
+        if ((type & 0xf0) === 0x80) return readMap(type & 0x0f);
+
+        let value: number;
+        switch (type) {
+            case 0xc0: return null;
+            case 0xc2: return false;
+            case 0xc3: return true;
+            case 0xcc: value = view.getUint8(pos); pos += 1; return value;
+            case 0xcd: value = view.getUint16(pos); pos += 2; return value;
+            case 0xce: value = view.getUint32(pos); pos += 4; return value;
+            case 0xcf: value = Number(view.getBigUint64(pos)); pos += 8; return value;
+            case 0xd0: value = view.getInt8(pos); pos += 1; return value;
+            case 0xd1: value = view.getInt16(pos); pos += 2; return value;
+            case 0xd2: value = view.getInt32(pos); pos += 4; return value;
+            case 0xd3: value = Number(view.getBigInt64(pos)); pos += 8; return value;
+            case 0xd9: value = view.getUint8(pos); pos += 1; return readString(value);
+            case 0xda: value = view.getUint16(pos); pos += 2; return readString(value);
+            case 0xdb: value = view.getUint32(pos); pos += 4; return readString(value);
+            case 0xdc: value = view.getUint16(pos); pos += 2; return readArray(value);
+            case 0xdd: value = view.getUint32(pos); pos += 4; return readArray(value);
+            case 0xde: value = view.getUint16(pos); pos += 2; return readMap(value);
+            case 0xdf: value = view.getUint32(pos); pos += 4; return readMap(value);
+            default:
+                throw new Error(`Unsupported MessagePack type 0x${type.toString(16)}`);
+        }
+    };
+
+    return read();
+}
+
+const FILE_TYPES: FileType[] = ['file', 'directory', 'symlink'];
+
+/**
+ * 将列式列表响应还原为 DirectoryListing
+ *
+ * - path = base + name
+ * - mtimes 为与前一条目的差值，逐项累加
+ * - extIndex 为 extensions 下标 + 1，0 表示无扩展名字段（非普通文件）
+ * - mtimeIso 不在二进制格式中，需要时由 mtime 格式化
+ */
+export function decodeDirectoryListing(buffer: ArrayBuffer): DirectoryListing {
+    const data = decodeMsgPack(buffer) as { [key: string]: any };
+    if (data.v !== 1) {
+        throw new Error(`Unsupported listing version: ${data.v}`);
+    }
+
+    const names: string[] = data.names;
+    const extensions: string[] = data.extensions;
+    const entries: FileEntry[] = new Array(names.length);
+    let mtime = 0;
+    for (let i = 0; i < names.length; i++) {
+        const name = names[i];
+        mtime += data.mtimes[i];
+        const ext = data.extIndex[i];
+        entries[i] = {
+            name,
+            path: data.base + name,
+            size: data.sizes[i],
+            mtime,
+            type: FILE_TYPES[data.types[i]],
+            isHidden: name.startsWith('.'),
+            extension: ext ? extensions[ext - 1] : undefined,
+        };
+    }
+
+    return {
+        success: true,
+        path: data.path,
+        parent: data.parent,
+        entries,
+        totalCount: data.totalCount,
+        directoryCount: data.directoryCount,
+        fileCount: data.fileCount,
+        totalSize: data.totalSize,
+    };
+}